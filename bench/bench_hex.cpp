@@ -0,0 +1,95 @@
+// Measures hex encode, decode and validate throughput for each kernel this CPU supports.
+//
+// Two input shapes are timed: 32-byte txids, as handled one at a time by Txid, and a large
+// buffer, like the raw transaction hex returned by getrawtransaction.
+//
+// Usage: bench_hex [megabytes]
+
+#include "hex.h"
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+    /**
+     * Time 'work', which processes 'bytes' bytes per call, and return MB/s
+     */
+    template <typename F>
+    double throughput(size_t bytes, size_t calls, F work) {
+        auto start = std::chrono::steady_clock::now();
+        for(size_t i = 0; i < calls; ++i)
+            work(i);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        return static_cast<double>(bytes) * static_cast<double>(calls) / elapsed.count() / 1e6;
+    }
+
+    volatile bool sink;
+}
+
+
+int main(int argc, char *argv[]) {
+
+    size_t megabytes = argc > 1 ? std::stoul(argv[1]) : 64;
+    size_t bufferSize = 1 << 20;
+    size_t bufferCalls = megabytes;
+    size_t txidCalls = megabytes * (1 << 20) / 32;
+
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> byte(0, 255);
+
+    std::vector<uint8_t> buffer(bufferSize);
+    for(uint8_t & b : buffer)
+        b = static_cast<uint8_t>(byte(rng));
+    std::string bufferHex(2 * bufferSize, '\0');
+
+    // a few thousand distinct txids, so they don't all sit in L1
+    const size_t numTxids = 4096;
+    std::vector<uint8_t> txids(32 * numTxids);
+    for(uint8_t & b : txids)
+        b = static_cast<uint8_t>(byte(rng));
+    std::string txidHex(64 * numTxids, '\0');
+    hex::encode(txids.data(), txids.size(), &txidHex[0]);
+    hex::encode(buffer.data(), buffer.size(), &bufferHex[0]);
+
+    std::printf("%zu MB per test; MB/s of binary data\n", megabytes);
+    std::printf("%8s %14s %14s %14s %14s %14s %14s\n", "kernel",
+                "txid encode", "txid decode", "txid valid", "1MB encode", "1MB decode", "1MB valid");
+
+    for(hex::Kernel kernel : {hex::Kernel::scalar, hex::Kernel::sse2, hex::Kernel::avx2}) {
+        if(!hex::isSupported(kernel))
+            continue;
+        hex::setKernel(kernel);
+
+        char txidOut[64];
+        uint8_t txidBytes[32];
+        std::vector<uint8_t> bufferBytes(bufferSize);
+
+        double txidEncode = throughput(32, txidCalls, [&](size_t i) {
+            hex::encode(&txids[32 * (i % numTxids)], 32, txidOut);
+        });
+        double txidDecode = throughput(32, txidCalls, [&](size_t i) {
+            sink = hex::decode(&txidHex[64 * (i % numTxids)], 64, txidBytes);
+        });
+        double txidValid = throughput(32, txidCalls, [&](size_t i) {
+            sink = hex::isValid(&txidHex[64 * (i % numTxids)], 64);
+        });
+        double bufferEncode = throughput(bufferSize, bufferCalls, [&](size_t) {
+            hex::encode(buffer.data(), buffer.size(), &bufferHex[0]);
+        });
+        double bufferDecode = throughput(bufferSize, bufferCalls, [&](size_t) {
+            sink = hex::decode(bufferHex.data(), bufferHex.size(), bufferBytes.data());
+        });
+        double bufferValid = throughput(bufferSize, bufferCalls, [&](size_t) {
+            sink = hex::isValid(bufferHex.data(), bufferHex.size());
+        });
+
+        std::printf("%8s %14.0f %14.0f %14.0f %14.0f %14.0f %14.0f\n", hex::kernelName(kernel),
+                    txidEncode, txidDecode, txidValid, bufferEncode, bufferDecode, bufferValid);
+    }
+
+    return 0;
+}
@@ -0,0 +1,235 @@
+// Measures how ResolutionEngine throughput scales with the number of threads.
+//
+// bitcoind is simulated: every RPC call takes a fixed time, and only 'rpcthreads' calls are
+// served at once. Up to 'rpcworkqueue' more wait their turn; past that, calls are rejected
+// with "Work queue depth exceeded", like bitcoind's HTTP 503. Throughput should grow close
+// to linearly with threads until the simulated node's rpcthreads are all busy.
+//
+// A second run overloads a node with a short work queue, with and without a
+// ConcurrencyLimiter in front of it.
+//
+// Usage: bench_resolutionEngine [numDids] [latencyMs] [rpcthreads] [rpcworkqueue]
+
+#include "resolutionEngine.h"
+#include "cachingBitcoinRPCFacade.h"
+#include "concurrencyLimiter.h"
+#include "libtxref.h"
+
+#include <bitcoinapi/bitcoinapi.h>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+    const int FIRST_HEIGHT = 1300000;
+    const int NUM_BLOCKS = 200;
+    const int TX_PER_BLOCK = 500;
+
+    /**
+     * A simulated bitcoind: serves at most 'rpcthreads' calls at a time, each taking 'latency',
+     * with room for 'rpcworkqueue' more to wait
+     */
+    class SimulatedNode {
+    public:
+        SimulatedNode(int rpcthreads, int rpcworkqueue, std::chrono::microseconds latency)
+                : freeThreads(rpcthreads), maxAdmitted(rpcthreads + rpcworkqueue), latency(latency) {}
+
+        void call() {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                if(admitted >= maxAdmitted)
+                    throw BitcoinException(-32003, "Work queue depth exceeded");
+                ++admitted;
+                threadAvailable.wait(lock, [this] { return freeThreads > 0; });
+                --freeThreads;
+            }
+            std::this_thread::sleep_for(latency);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                ++freeThreads;
+                --admitted;
+            }
+            threadAvailable.notify_one();
+        }
+
+    private:
+        std::mutex mutex;
+        std::condition_variable threadAvailable;
+        int freeThreads;
+        int admitted = 0;
+        const int maxAdmitted;
+        std::chrono::microseconds latency;
+    };
+
+    std::string blockHashFor(int height) {
+        return std::string(56, '0') + std::to_string(height);
+    }
+
+    std::string txidFor(int height, int position) {
+        std::string s = std::to_string(height) + "f" + std::to_string(position);
+        return std::string(64 - s.size(), 'a') + s;
+    }
+
+    /**
+     * One RPC connection to the SimulatedNode
+     */
+    class Simulated_BitcoinRPCFacade : public BitcoinRPCFacade {
+    public:
+        explicit Simulated_BitcoinRPCFacade(SimulatedNode & node) : node(node) {}
+
+        blockchaininfo_t getblockchaininfo() const override {
+            node.call();
+            blockchaininfo_t info;
+            info.chain = "test";
+            return info;
+        }
+
+        std::string getblockhash(int height) const override {
+            node.call();
+            return blockHashFor(height);
+        }
+
+        blockinfo_t getblock(const std::string & hash) const override {
+            node.call();
+            blockinfo_t blockInfo;
+            blockInfo.hash = hash;
+            blockInfo.height = std::stoi(hash.substr(56));
+            for(int i = 0; i < TX_PER_BLOCK; ++i)
+                blockInfo.tx.push_back(txidFor(blockInfo.height, i));
+            return blockInfo;
+        }
+
+        getrawtransaction_t getrawtransaction(const std::string & txid, int) const override {
+            node.call();
+            size_t start = txid.find_first_not_of('a');
+            getrawtransaction_t rawTransaction;
+            rawTransaction.hex = "00";
+            rawTransaction.blockhash = blockHashFor(std::stoi(txid.substr(start, txid.find('f', start) - start)));
+            rawTransaction.vout.resize(2);
+            return rawTransaction;
+        }
+
+        utxoinfo_t gettxout(const std::string &, int) const override {
+            node.call();
+            utxoinfo_t utxoinfo;
+            utxoinfo.bestblock = blockHashFor(FIRST_HEIGHT + NUM_BLOCKS);
+            utxoinfo.confirmations = 10;
+            return utxoinfo;
+        }
+
+    private:
+        SimulatedNode & node;
+    };
+
+    /**
+     * All simulated outputs are unspent, so chains are never followed
+     */
+    class NoSpends_ChainQuery : public ChainQuery {
+    public:
+        UnspentData getUnspentOutputs(const std::string &, int, const std::string &) const override {
+            return UnspentData();
+        }
+
+        std::string getLastUpdatedTxid(const std::string & txid, int, const std::string &) const override {
+            return txid;
+        }
+    };
+
+    /**
+     * Make DIDs spread over NUM_BLOCKS blocks, with some blocks more popular than others
+     */
+    std::vector<std::string> makeDids(int numDids) {
+        std::mt19937 rng(42);
+        std::geometric_distribution<int> block(0.05);
+        std::uniform_int_distribution<int> position(0, TX_PER_BLOCK - 1);
+
+        std::vector<std::string> dids;
+        for(int i = 0; i < numDids; ++i) {
+            int height = FIRST_HEIGHT + block(rng) % NUM_BLOCKS;
+            std::string txref = txref::encodeTestnet(height, position(rng), 1, true);
+            dids.push_back("did:btcr:" + txref.substr(txref.find(':') + 1));
+        }
+        return dids;
+    }
+
+    struct RunResult {
+        double seconds = 0.0;
+        size_t failed = 0;
+    };
+
+    RunResult run(const std::vector<std::string> & dids, SimulatedNode & node, size_t threads,
+                  ConcurrencyLimiter * limiter) {
+        NoSpends_ChainQuery chainQuery;
+        RpcCache cache;
+        ResolutionEngine engine(
+                [&node] { return std::unique_ptr<BitcoinRPCFacade>(new Simulated_BitcoinRPCFacade(node)); },
+                cache, chainQuery, threads, limiter);
+
+        auto start = std::chrono::steady_clock::now();
+        std::vector<DidResolution> results = engine.resolve(dids);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        RunResult result;
+        result.seconds = elapsed.count();
+        for(const DidResolution & resolution : results) {
+            if(!resolution.ok)
+                ++result.failed;
+        }
+        return result;
+    }
+}
+
+
+int main(int argc, char *argv[]) {
+
+    int numDids = argc > 1 ? std::stoi(argv[1]) : 500;
+    int latencyMs = argc > 2 ? std::stoi(argv[2]) : 1;
+    int rpcthreads = argc > 3 ? std::stoi(argv[3]) : 16;
+    int rpcworkqueue = argc > 4 ? std::stoi(argv[4]) : 16;
+
+    std::vector<std::string> dids = makeDids(numDids);
+
+    std::printf("%d DIDs, %d ms per RPC call, %d simulated rpcthreads, rpcworkqueue %d\n",
+                numDids, latencyMs, rpcthreads, rpcworkqueue);
+    std::printf("%8s %10s %10s %8s %8s\n", "threads", "seconds", "DIDs/s", "speedup", "failed");
+
+    double baseline = 0.0;
+    for(size_t threads : {1u, 2u, 4u, 8u, 16u, 32u}) {
+        SimulatedNode node(rpcthreads, rpcworkqueue, std::chrono::milliseconds(latencyMs));
+        RunResult result = run(dids, node, threads, nullptr);
+
+        double rate = numDids / result.seconds;
+        if(threads == 1)
+            baseline = rate;
+        std::printf("%8zu %10.3f %10.1f %8.2f %8zu\n", threads, result.seconds, rate, rate / baseline, result.failed);
+    }
+
+    // overload: more threads than the node can take, even counting its work queue
+    const size_t overloadThreads = 32;
+    const int overloadThreadsOnNode = 4;
+    const int overloadQueue = 4;
+
+    std::printf("\n%zu threads against %d simulated rpcthreads, rpcworkqueue %d\n",
+                overloadThreads, overloadThreadsOnNode, overloadQueue);
+    std::printf("%8s %10s %8s %8s %10s\n", "limiter", "seconds", "failed", "limit", "rejected");
+
+    for(bool useLimiter : {false, true}) {
+        SimulatedNode node(overloadThreadsOnNode, overloadQueue, std::chrono::milliseconds(latencyMs));
+        ConcurrencyLimiter::Options options;
+        options.maxLimit = overloadThreads;
+        ConcurrencyLimiter limiter(options);
+
+        RunResult result = run(dids, node, overloadThreads, useLimiter ? &limiter : nullptr);
+
+        std::printf("%8s %10.3f %8zu %8zu %10zu\n", useLimiter ? "on" : "off", result.seconds, result.failed,
+                    useLimiter ? limiter.currentLimit() : overloadThreads, limiter.overloadCount());
+    }
+
+    return 0;
+}
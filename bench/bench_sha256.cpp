@@ -0,0 +1,86 @@
+// Measures SHA-256d throughput for each kernel this CPU supports.
+//
+// Three shapes are timed: transactions hashed one at a time, the same transactions hashed as
+// one batch (as when computing every txid in a block), and merkle roots over those txids.
+//
+// Usage: bench_sha256 [megabytes]
+
+#include "merkle.h"
+#include "sha256.h"
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+    /**
+     * Time 'work', which processes 'bytes' bytes per call, and return MB/s
+     */
+    template <typename F>
+    double throughput(size_t bytes, size_t calls, F work) {
+        auto start = std::chrono::steady_clock::now();
+        for(size_t i = 0; i < calls; ++i)
+            work(i);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        return static_cast<double>(bytes) * static_cast<double>(calls) / elapsed.count() / 1e6;
+    }
+
+    volatile uint8_t sink;
+}
+
+
+int main(int argc, char *argv[]) {
+
+    size_t megabytes = argc > 1 ? std::stoul(argv[1]) : 64;
+
+    // a block's worth of transactions, 150 to 600 bytes each
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> byte(0, 255);
+    std::uniform_int_distribution<size_t> txSize(150, 600);
+
+    std::vector<std::vector<uint8_t>> transactions(4000);
+    std::vector<const uint8_t *> data;
+    std::vector<size_t> lens;
+    size_t blockBytes = 0;
+    for(std::vector<uint8_t> & tx : transactions) {
+        tx.resize(txSize(rng));
+        for(uint8_t & b : tx)
+            b = static_cast<uint8_t>(byte(rng));
+        data.push_back(tx.data());
+        lens.push_back(tx.size());
+        blockBytes += tx.size();
+    }
+    size_t blockCalls = megabytes * (1 << 20) / blockBytes + 1;
+    std::vector<uint8_t> txids(transactions.size() * sha256::DIGEST_SIZE);
+    size_t merkleBytes = txids.size();
+    size_t merkleCalls = megabytes * (1 << 20) / merkleBytes + 1;
+
+    std::printf("%zu MB per test; MB/s of input\n", megabytes);
+    std::printf("%8s %14s %14s %14s\n", "kernel", "one at a time", "batched", "merkle root");
+
+    for(sha256::Kernel kernel : {sha256::Kernel::scalar, sha256::Kernel::avx2, sha256::Kernel::shani}) {
+        if(!sha256::isSupported(kernel))
+            continue;
+        sha256::setKernel(kernel);
+
+        double single = throughput(blockBytes, blockCalls, [&](size_t) {
+            for(size_t i = 0; i < transactions.size(); ++i)
+                sha256::doubleHash(data[i], lens[i], &txids[i * sha256::DIGEST_SIZE]);
+        });
+        double batched = throughput(blockBytes, blockCalls, [&](size_t) {
+            sha256::doubleHashMany(data.data(), lens.data(), data.size(), txids.data());
+        });
+        double merkleRoot = throughput(merkleBytes, merkleCalls, [&](size_t) {
+            uint8_t root[sha256::DIGEST_SIZE];
+            merkle::root(txids.data(), transactions.size(), root);
+            sink = root[0];
+        });
+
+        std::printf("%8s %14.0f %14.0f %14.0f\n", sha256::kernelName(kernel), single, batched, merkleRoot);
+    }
+
+    return 0;
+}
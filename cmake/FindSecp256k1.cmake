@@ -0,0 +1,40 @@
+# -*- cmake -*-
+# - Find Secp256k1
+# Find the Secp256k1 includes and library
+# This module defines
+#  SECP256K1_INCLUDE_DIRS, where to find secp256k1.h
+#  SECP256K1_LIBRARIES, the libraries needed to use Secp256k1.
+
+FIND_PATH(SECP256K1_INCLUDE_DIRS
+NAMES secp256k1.h
+PATHS /usr/include /usr/local/include
+)
+
+FIND_LIBRARY(SECP256K1_LIBRARIES
+NAMES secp256k1
+PATHS /usr/lib /usr/local/lib
+)
+
+IF (SECP256K1_LIBRARIES AND SECP256K1_INCLUDE_DIRS)
+    SET(SECP256K1_LIBRARIES ${SECP256K1_LIBRARIES})
+    SET(SECP256K1_FOUND "YES")
+ELSE (SECP256K1_LIBRARIES AND SECP256K1_INCLUDE_DIRS)
+  SET(SECP256K1_FOUND "NO")
+ENDIF (SECP256K1_LIBRARIES AND SECP256K1_INCLUDE_DIRS)
+
+
+IF (SECP256K1_FOUND)
+   IF (NOT SECP256K1_FIND_QUIETLY)
+      MESSAGE(STATUS "Found Secp256k1: ${SECP256K1_LIBRARIES}")
+   ENDIF (NOT SECP256K1_FIND_QUIETLY)
+ELSE (SECP256K1_FOUND)
+   IF (SECP256K1_FIND_REQUIRED)
+      MESSAGE(FATAL_ERROR "Could not find SECP256K1 library include: ${SECP256K1_INCLUDE_DIRS}, lib: ${SECP256K1_LIBRARIES}")
+   ENDIF (SECP256K1_FIND_REQUIRED)
+ENDIF (SECP256K1_FOUND)
+
+MARK_AS_ADVANCED(
+  SECP256K1_LIBRARIES
+  SECP256K1_INCLUDE_DIRS
+  )
+
@@ -0,0 +1,222 @@
+#include "address.h"
+#include "base58.h"
+
+#include <cstring>
+
+namespace {
+
+    const uint8_t OP_0 = 0x00;
+    const uint8_t OP_1 = 0x51;
+    const uint8_t OP_DUP = 0x76;
+    const uint8_t OP_EQUAL = 0x87;
+    const uint8_t OP_EQUALVERIFY = 0x88;
+    const uint8_t OP_HASH160 = 0xa9;
+    const uint8_t OP_CHECKSIG = 0xac;
+
+    struct ChainParams {
+        uint8_t pubkeyHashPrefix;
+        uint8_t scriptHashPrefix;
+        const char * hrp;
+    };
+
+    bool chainParams(const std::string & chain, ChainParams & params) {
+        if(chain == "main")
+            params = ChainParams{0x00, 0x05, "bc"};
+        else if(chain == "test" || chain == "testnet4" || chain == "signet")
+            params = ChainParams{0x6f, 0xc4, "tb"};
+        else if(chain == "regtest")
+            params = ChainParams{0x6f, 0xc4, "bcrt"};
+        else
+            return false;
+        return true;
+    }
+
+    const char BECH32_CHARSET[] = "qpzry9x8gf2tvdw0s3jn54khce6mua7l";
+
+    // the checksum constants: BIP 173's bech32 for witness version 0, BIP 350's bech32m after
+    const uint32_t BECH32_CONSTANT = 1;
+    const uint32_t BECH32M_CONSTANT = 0x2bc830a3;
+
+    uint32_t polymod(const std::vector<uint8_t> & values) {
+        static const uint32_t GENERATOR[] = {0x3b6a57b2, 0x26508e6d, 0x1ea119fa, 0x3d4233dd, 0x2a1462b3};
+        uint32_t checksum = 1;
+        for(uint8_t value : values) {
+            uint8_t top = static_cast<uint8_t>(checksum >> 25);
+            checksum = (checksum & 0x1ffffff) << 5 ^ value;
+            for(int i = 0; i < 5; ++i)
+                if((top >> i) & 1)
+                    checksum ^= GENERATOR[i];
+        }
+        return checksum;
+    }
+
+    /**
+     * Split a bech32 or bech32m string into its human-readable part and 5-bit data, checking
+     * the checksum
+     * @return false if it is not valid bech32 of either kind
+     */
+    bool decodeBech32(const std::string & text, std::string & hrp, std::vector<uint8_t> & data, uint32_t & constant) {
+        if(text.size() > 90)
+            return false;
+        bool lower = false, upper = false;
+        for(char c : text) {
+            if(c < 33 || c > 126)
+                return false;
+            lower = lower || (c >= 'a' && c <= 'z');
+            upper = upper || (c >= 'A' && c <= 'Z');
+        }
+        if(lower && upper)
+            return false;
+
+        size_t separator = text.rfind('1');
+        if(separator == std::string::npos || separator == 0 || separator + 7 > text.size())
+            return false;
+
+        hrp.clear();
+        for(size_t i = 0; i < separator; ++i)
+            hrp += static_cast<char>(text[i] >= 'A' && text[i] <= 'Z' ? text[i] - 'A' + 'a' : text[i]);
+
+        std::vector<uint8_t> values;
+        for(char c : hrp)
+            values.push_back(static_cast<uint8_t>(c >> 5));
+        values.push_back(0);
+        for(char c : hrp)
+            values.push_back(static_cast<uint8_t>(c & 31));
+
+        data.clear();
+        for(size_t i = separator + 1; i < text.size(); ++i) {
+            char c = text[i] >= 'A' && text[i] <= 'Z' ? static_cast<char>(text[i] - 'A' + 'a') : text[i];
+            const char * found = std::strchr(BECH32_CHARSET, c);
+            if(found == nullptr)
+                return false;
+            data.push_back(static_cast<uint8_t>(found - BECH32_CHARSET));
+        }
+        values.insert(values.end(), data.begin(), data.end());
+
+        constant = polymod(values);
+        if(constant != BECH32_CONSTANT && constant != BECH32M_CONSTANT)
+            return false;
+        data.resize(data.size() - 6);
+        return true;
+    }
+
+    /**
+     * Regroup 5-bit values into bytes. The padding left over must be under 5 bits, and zero.
+     */
+    bool fiveBitsToBytes(const uint8_t * values, size_t count, std::vector<uint8_t> & out) {
+        uint32_t accumulator = 0;
+        int bits = 0;
+        for(size_t i = 0; i < count; ++i) {
+            accumulator = accumulator << 5 | values[i];
+            bits += 5;
+            if(bits >= 8) {
+                bits -= 8;
+                out.push_back(static_cast<uint8_t>(accumulator >> bits));
+            }
+        }
+        return bits < 5 && (accumulator & ((1u << bits) - 1)) == 0;
+    }
+
+    std::vector<uint8_t> witnessScript(int version, const std::vector<uint8_t> & program) {
+        std::vector<uint8_t> script;
+        script.push_back(version == 0 ? OP_0 : static_cast<uint8_t>(OP_1 + version - 1));
+        script.push_back(static_cast<uint8_t>(program.size()));
+        script.insert(script.end(), program.begin(), program.end());
+        return script;
+    }
+
+    Result<Address> decodeSegwitAddress(const std::string & text, uint32_t constant, const std::vector<uint8_t> & data) {
+        typedef Result<Address> R;
+
+        if(data.empty())
+            return R::failure("Address '" + text + "' has no witness version");
+        int version = data[0];
+        if(version > 16)
+            return R::failure("Address '" + text + "' has an invalid witness version");
+        if((version == 0) != (constant == BECH32_CONSTANT))
+            return R::failure("Address '" + text + "' has the wrong checksum for witness version " + std::to_string(version));
+
+        Address address;
+        if(!fiveBitsToBytes(&data[1], data.size() - 1, address.program))
+            return R::failure("Address '" + text + "' has invalid padding");
+        size_t len = address.program.size();
+        if(len < 2 || len > 40 || (version == 0 && len != 20 && len != 32))
+            return R::failure("Address '" + text + "' has an invalid witness program length");
+
+        if(version == 0)
+            address.type = len == 20 ? AddressType::p2wpkh : AddressType::p2wsh;
+        else if(version == 1 && len == 32)
+            address.type = AddressType::p2tr;
+        else
+            address.type = AddressType::witnessUnknown;
+        address.scriptPubKey = witnessScript(version, address.program);
+        return R::success(address);
+    }
+}
+
+
+Result<Address> decodeAddress(const std::string & text, const std::string & chain) {
+    typedef Result<Address> R;
+
+    ChainParams params;
+    if(!chainParams(chain, params))
+        return R::failure("Unknown chain: " + chain);
+
+    std::string hrp;
+    std::vector<uint8_t> data;
+    uint32_t constant;
+    if(decodeBech32(text, hrp, data, constant)) {
+        if(hrp != params.hrp)
+            return R::failure("Address '" + text + "' is not for the " + chain + " chain");
+        return decodeSegwitAddress(text, constant, data);
+    }
+
+    Result<std::vector<uint8_t>> decoded = base58::decodeCheck(text);
+    if(!decoded)
+        return R::failure("Address '" + text + "' is not a valid address");
+    const std::vector<uint8_t> & payload = decoded.value();
+    if(payload.size() != 21)
+        return R::failure("Address '" + text + "' has the wrong length");
+
+    Address address;
+    address.program.assign(payload.begin() + 1, payload.end());
+    if(payload[0] == params.pubkeyHashPrefix) {
+        address.type = AddressType::p2pkh;
+        address.scriptPubKey = {OP_DUP, OP_HASH160, 20};
+        address.scriptPubKey.insert(address.scriptPubKey.end(), address.program.begin(), address.program.end());
+        address.scriptPubKey.insert(address.scriptPubKey.end(), {OP_EQUALVERIFY, OP_CHECKSIG});
+    }
+    else if(payload[0] == params.scriptHashPrefix) {
+        address.type = AddressType::p2sh;
+        address.scriptPubKey = {OP_HASH160, 20};
+        address.scriptPubKey.insert(address.scriptPubKey.end(), address.program.begin(), address.program.end());
+        address.scriptPubKey.push_back(OP_EQUAL);
+    }
+    else
+        return R::failure("Address '" + text + "' is not for the " + chain + " chain");
+    return R::success(address);
+}
+
+Result<AddressType> scriptType(const uint8_t * script, size_t len) {
+    typedef Result<AddressType> R;
+
+    if(len == 25 && script[0] == OP_DUP && script[1] == OP_HASH160 && script[2] == 20 &&
+       script[23] == OP_EQUALVERIFY && script[24] == OP_CHECKSIG)
+        return R::success(AddressType::p2pkh);
+    if(len == 23 && script[0] == OP_HASH160 && script[1] == 20 && script[22] == OP_EQUAL)
+        return R::success(AddressType::p2sh);
+
+    // a witness version, then a single push of a 2 to 40 byte program
+    if(len >= 4 && len <= 42 && (script[0] == OP_0 || (script[0] >= OP_1 && script[0] <= OP_1 + 15)) &&
+       script[1] + 2u == len) {
+        if(script[0] == OP_0 && len == 22)
+            return R::success(AddressType::p2wpkh);
+        if(script[0] == OP_0 && len == 34)
+            return R::success(AddressType::p2wsh);
+        if(script[0] == OP_1 && len == 34)
+            return R::success(AddressType::p2tr);
+        if(script[0] != OP_0)
+            return R::success(AddressType::witnessUnknown);
+    }
+    return R::failure("Not a standard address script");
+}
@@ -0,0 +1,47 @@
+#ifndef TXREF_ADDRESS_H
+#define TXREF_ADDRESS_H
+
+#include "result.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * The kinds of standard output script an address can stand for
+ */
+enum class AddressType {
+    p2pkh,          // legacy, base58: pay to a public key hash
+    p2sh,           // legacy, base58: pay to a script hash (including wrapped segwit)
+    p2wpkh,         // bech32, witness version 0 with a 20-byte key hash
+    p2wsh,          // bech32, witness version 0 with a 32-byte script hash
+    p2tr,           // bech32m, witness version 1 with a 32-byte key (taproot)
+    witnessUnknown  // bech32m, a witness version or length not yet given a meaning
+};
+
+struct Address {
+    AddressType type;
+    /** the hash, or the witness program, that the script pays to */
+    std::vector<uint8_t> program;
+    std::vector<uint8_t> scriptPubKey;
+};
+
+/**
+ * Decode a base58 (BIP 13) or bech32/bech32m (BIP 173, BIP 350) address into the output
+ * script it stands for, without asking bitcoind
+ * @param address the address
+ * @param chain the chain it must belong to, as getblockchaininfo names it: "main", "test",
+ * "testnet4", "signet" or "regtest"
+ * @return the address, or why it is not a valid address for this chain
+ */
+Result<Address> decodeAddress(const std::string & address, const std::string & chain);
+
+/**
+ * Recognize a standard output script
+ * @return the kind of address that pays to this script, or a failure for scripts that no
+ * address stands for (OP_RETURN, bare multisig, etc.)
+ */
+Result<AddressType> scriptType(const uint8_t * script, size_t len);
+
+#endif //TXREF_ADDRESS_H
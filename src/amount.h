@@ -0,0 +1,161 @@
+#ifndef TXREF_AMOUNT_H
+#define TXREF_AMOUNT_H
+
+#include "result.h"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+/**
+ * An amount of bitcoin, held as a whole number of satoshis so that arithmetic on it is exact.
+ *
+ * Amounts are parsed from, and formatted to, decimal BTC strings ("0.01154000") without going
+ * through a double, so a value read from chain.so or the command line is exactly what is sent
+ * to bitcoind.
+ */
+class Amount {
+
+public:
+    static const int64_t SATOSHIS_PER_BTC = 100000000;
+    static const int DECIMALS = 8;
+
+    /** no valid amount is more than the 21 million BTC that will ever exist */
+    static const int64_t MAX_MONEY = 21000000 * SATOSHIS_PER_BTC;
+
+    /** the most characters format() writes: a sign, 11 digits, the point and 8 decimals */
+    static const size_t MAX_CHARS = 21;
+
+    Amount() : value(0) {
+    }
+
+    static Amount fromSatoshis(int64_t satoshis) {
+        return Amount(satoshis);
+    }
+
+    /**
+     * Convert a BTC value that has already been through a double, as bitcoinapi gives them,
+     * rounding to the nearest satoshi. A double holds any amount up to MAX_MONEY closely
+     * enough that this gets back the exact number of satoshis.
+     */
+    static Amount fromBtc(double btc) {
+        return Amount(static_cast<int64_t>(std::llround(btc * SATOSHIS_PER_BTC)));
+    }
+
+    /**
+     * Parse a decimal BTC string, such as "12.34567" or "-0.001". Exponents are not accepted.
+     * @param text the characters to parse
+     * @param len the number of characters
+     * @return the amount, or why it is not valid: it is not a number, has more than 8 decimal
+     * places, or is more than MAX_MONEY either way
+     */
+    static Result<Amount> parse(const char * text, size_t len) {
+        const char * p = text;
+        const char * end = text + len;
+        bool negative = p < end && *p == '-';
+        if(negative)
+            ++p;
+
+        int64_t whole = 0;
+        const char * digits = p;
+        for(; p < end && *p >= '0' && *p <= '9'; ++p) {
+            whole = whole * 10 + (*p - '0');
+            if(whole > MAX_MONEY / SATOSHIS_PER_BTC)
+                return Result<Amount>::failure(describe(text, len) + " is more than 21000000 BTC");
+        }
+        bool haveWhole = p > digits;
+
+        int64_t fraction = 0;
+        int decimals = 0;
+        if(p < end && *p == '.') {
+            for(++p; p < end && *p >= '0' && *p <= '9'; ++p) {
+                if(++decimals > DECIMALS)
+                    return Result<Amount>::failure(describe(text, len) + " has more than 8 decimal places");
+                fraction = fraction * 10 + (*p - '0');
+            }
+        }
+        if(p != end || (!haveWhole && decimals == 0))
+            return Result<Amount>::failure(describe(text, len) + " is not a number of BTC");
+
+        for(int i = decimals; i < DECIMALS; ++i)
+            fraction *= 10;
+        int64_t satoshis = whole * SATOSHIS_PER_BTC + fraction;
+        if(satoshis > MAX_MONEY)
+            return Result<Amount>::failure(describe(text, len) + " is more than 21000000 BTC");
+        return Result<Amount>::success(Amount(negative ? -satoshis : satoshis));
+    }
+
+    static Result<Amount> parse(const std::string & text) {
+        return parse(text.data(), text.size());
+    }
+
+    int64_t satoshis() const {
+        return value;
+    }
+
+    /**
+     * Write the amount in BTC with all 8 decimal places, such as "0.01154000", as bitcoind
+     * does. No terminating NUL is written.
+     * @param first where to start writing
+     * @param last the end of the buffer; MAX_CHARS is always enough room
+     * @return one past the last character written, or null if the buffer is too small
+     */
+    char * format(char * first, char * last) const {
+        char buffer[MAX_CHARS];
+        char * p = buffer + MAX_CHARS;
+        // work on the magnitude unsigned, so that the most negative value can't overflow
+        uint64_t magnitude = value < 0 ? 0 - static_cast<uint64_t>(value) : static_cast<uint64_t>(value);
+        uint64_t whole = magnitude / SATOSHIS_PER_BTC;
+        uint64_t fraction = magnitude % SATOSHIS_PER_BTC;
+        for(int i = 0; i < DECIMALS; ++i) {
+            *--p = static_cast<char>('0' + fraction % 10);
+            fraction /= 10;
+        }
+        *--p = '.';
+        do {
+            *--p = static_cast<char>('0' + whole % 10);
+            whole /= 10;
+        } while(whole > 0);
+        if(value < 0)
+            *--p = '-';
+
+        size_t length = static_cast<size_t>(buffer + MAX_CHARS - p);
+        if(static_cast<size_t>(last - first) < length)
+            return nullptr;
+        std::memcpy(first, p, length);
+        return first + length;
+    }
+
+    std::string toString() const {
+        char buffer[MAX_CHARS];
+        return std::string(buffer, format(buffer, buffer + MAX_CHARS));
+    }
+
+    Amount operator-() const { return Amount(-value); }
+    Amount operator+(const Amount & other) const { return Amount(value + other.value); }
+    Amount operator-(const Amount & other) const { return Amount(value - other.value); }
+    Amount & operator+=(const Amount & other) { value += other.value; return *this; }
+    Amount & operator-=(const Amount & other) { value -= other.value; return *this; }
+
+    bool operator==(const Amount & other) const { return value == other.value; }
+    bool operator!=(const Amount & other) const { return value != other.value; }
+    bool operator<(const Amount & other) const { return value < other.value; }
+    bool operator<=(const Amount & other) const { return value <= other.value; }
+    bool operator>(const Amount & other) const { return value > other.value; }
+    bool operator>=(const Amount & other) const { return value >= other.value; }
+
+private:
+    explicit Amount(int64_t satoshis) : value(satoshis) {
+    }
+
+    static std::string describe(const char * text, size_t len) {
+        return "Amount '" + std::string(text, len) + "'";
+    }
+
+    int64_t value;
+};
+
+
+#endif //TXREF_AMOUNT_H
@@ -0,0 +1,89 @@
+#include "base58.h"
+#include "sha256.h"
+
+#include <cstring>
+
+namespace {
+
+    const char ALPHABET[] = "123456789ABCDEFGHJKLMNPQRSTUVWXYZabcdefghijkmnopqrstuvwxyz";
+
+    // long enough for any key or address; also keeps the quadratic conversion cheap
+    const size_t MAX_DECODED_SIZE = 128;
+
+    int digitValue(char c) {
+        const char * found = std::strchr(ALPHABET, c);
+        return c != '\0' && found != nullptr ? static_cast<int>(found - ALPHABET) : -1;
+    }
+}
+
+namespace base58 {
+
+    std::string encodeCheck(const std::vector<uint8_t> & data) {
+        std::vector<uint8_t> bytes(data);
+        uint8_t hash[sha256::DIGEST_SIZE];
+        sha256::doubleHash(data.data(), data.size(), hash);
+        bytes.insert(bytes.end(), hash, hash + 4);
+
+        size_t zeros = 0;
+        while(zeros < bytes.size() && bytes[zeros] == 0)
+            ++zeros;
+
+        // base 256 to base 58, most significant digit first; log(256)/log(58) < 1.37
+        std::vector<uint8_t> digits((bytes.size() - zeros) * 137 / 100 + 1);
+        size_t used = 0;
+        for(size_t i = zeros; i < bytes.size(); ++i) {
+            int carry = bytes[i];
+            size_t j = 0;
+            for(auto it = digits.rbegin(); (carry != 0 || j < used) && it != digits.rend(); ++it, ++j) {
+                carry += 256 * *it;
+                *it = static_cast<uint8_t>(carry % 58);
+                carry /= 58;
+            }
+            used = j;
+        }
+
+        std::string text(zeros, '1');
+        for(size_t i = digits.size() - used; i < digits.size(); ++i)
+            text += ALPHABET[digits[i]];
+        return text;
+    }
+
+    Result<std::vector<uint8_t>> decodeCheck(const std::string & text) {
+        typedef Result<std::vector<uint8_t>> R;
+
+        size_t ones = 0;
+        while(ones < text.size() && text[ones] == '1')
+            ++ones;
+        if(text.size() > MAX_DECODED_SIZE * 138 / 100)
+            return R::failure("'" + text + "' is too long");
+
+        // base 58 to base 256; log(58)/log(256) < 0.733
+        std::vector<uint8_t> bytes((text.size() - ones) * 733 / 1000 + 1);
+        size_t used = 0;
+        for(size_t i = ones; i < text.size(); ++i) {
+            int carry = digitValue(text[i]);
+            if(carry < 0)
+                return R::failure("'" + text + "' has a character that is not base58");
+            size_t j = 0;
+            for(auto it = bytes.rbegin(); (carry != 0 || j < used) && it != bytes.rend(); ++it, ++j) {
+                carry += 58 * *it;
+                *it = static_cast<uint8_t>(carry % 256);
+                carry /= 256;
+            }
+            used = j;
+        }
+
+        std::vector<uint8_t> data(ones, 0);
+        data.insert(data.end(), bytes.end() - static_cast<std::ptrdiff_t>(used), bytes.end());
+        if(data.size() < 4)
+            return R::failure("'" + text + "' is too short");
+
+        uint8_t hash[sha256::DIGEST_SIZE];
+        sha256::doubleHash(data.data(), data.size() - 4, hash);
+        if(std::memcmp(hash, &data[data.size() - 4], 4) != 0)
+            return R::failure("'" + text + "' has a bad checksum");
+        data.resize(data.size() - 4);
+        return R::success(data);
+    }
+
+}
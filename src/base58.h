@@ -0,0 +1,30 @@
+#ifndef TXREF_BASE58_H
+#define TXREF_BASE58_H
+
+#include "result.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Base58Check, as used by legacy addresses and WIF private keys: base58 with a 4-byte
+ * SHA-256d checksum on the end.
+ */
+namespace base58 {
+
+    /**
+     * Encode bytes, adding the checksum
+     */
+    std::string encodeCheck(const std::vector<uint8_t> & data);
+
+    /**
+     * Decode a Base58Check string and verify its checksum
+     * @return the bytes without the checksum, or why the string is not valid
+     */
+    Result<std::vector<uint8_t>> decodeCheck(const std::string & text);
+
+}
+
+#endif //TXREF_BASE58_H
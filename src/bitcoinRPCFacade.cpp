@@ -113,6 +113,169 @@ std::string BitcoinRPCFacade::createrawtransaction(
     return bitcoinAPI->createrawtransaction(inputs, amounts);
 }
 
+std::string BitcoinRPCFacade::getrawblock(const std::string &blockhash) const {
+    std::string command = "getblock";
+    Value params, result;
+    params.append(blockhash);
+    params.append(0);
+    result = bitcoinAPI->sendcommand(command, params);
+
+    return result.asString();
+}
+
+std::string BitcoinRPCFacade::getrawtransactioninblock(const std::string &txid, const std::string &blockhash) const {
+    // the mainnet genesis transaction can't be retrieved from bitcoind, as in getrawtransaction()
+    if(txid == "4a5e1e4baab89f3a32518a88c31bc87f618f76673e2cc77ab2127b7afdeda33b" && blockhash == block_0_hash)
+        return block_0_tx_0_hex;
+
+    std::string command = "getrawtransaction";
+    Value params, result;
+    params.append(txid);
+    params.append(0);
+    params.append(blockhash);
+    result = bitcoinAPI->sendcommand(command, params);
+
+    return result.asString();
+}
+
+blockheader_t BitcoinRPCFacade::getblockheader(const std::string &blockhash) const {
+    std::string command = "getblockheader";
+    Value params, result;
+    params.append(blockhash);
+    params.append(true);
+    result = bitcoinAPI->sendcommand(command, params);
+
+    blockheader_t ret;
+    ret.hash = result["hash"].asString();
+    ret.height = result["height"].asInt();
+    ret.confirmations = result["confirmations"].asInt();
+
+    return ret;
+}
+
+std::string BitcoinRPCFacade::getrawblockheader(const std::string &blockhash) const {
+    std::string command = "getblockheader";
+    Value params, result;
+    params.append(blockhash);
+    params.append(false);
+    result = bitcoinAPI->sendcommand(command, params);
+
+    return result.asString();
+}
+
+std::string BitcoinRPCFacade::gettxoutproof(const std::vector<std::string> &txids, const std::string &blockhash) const {
+    std::string command = "gettxoutproof";
+    Value params, result;
+    Value txidArray(Json::arrayValue);
+    for(const auto & txid : txids) {
+        txidArray.append(txid);
+    }
+    params.append(txidArray);
+    params.append(blockhash);
+    result = bitcoinAPI->sendcommand(command, params);
+
+    return result.asString();
+}
+
+mempoolacceptance_t BitcoinRPCFacade::testmempoolaccept(const std::string &hexString) const {
+    std::string command = "testmempoolaccept";
+    Value params, result;
+    Value rawTxs(Json::arrayValue);
+    rawTxs.append(hexString);
+    params.append(rawTxs);
+    result = bitcoinAPI->sendcommand(command, params);
+
+    // one result per transaction tested
+    const Value & tested = result[0];
+    mempoolacceptance_t ret;
+    ret.txid = tested["txid"].asString();
+    ret.allowed = tested["allowed"].asBool();
+    ret.rejectreason = tested["reject-reason"].asString();
+    ret.vsize = tested["vsize"].asInt();
+    ret.fee = Amount::fromBtc(tested["fees"]["base"].asDouble());
+
+    return ret;
+}
+
+std::vector<scannedutxo_t> BitcoinRPCFacade::scantxoutset(const std::vector<std::string> &descriptors) const {
+    std::string command = "scantxoutset";
+    Value params, result;
+    params.append("start");
+    Value scanObjects(Json::arrayValue);
+    for(const auto & descriptor : descriptors) {
+        scanObjects.append(descriptor);
+    }
+    params.append(scanObjects);
+    result = bitcoinAPI->sendcommand(command, params);
+
+    std::vector<scannedutxo_t> ret;
+    const Value & unspents = result["unspents"];
+    for(Json::ArrayIndex i = 0; i < unspents.size(); ++i) {
+        scannedutxo_t utxo;
+        utxo.txid = unspents[i]["txid"].asString();
+        utxo.vout = unspents[i]["vout"].asUInt();
+        utxo.scriptPubKey = unspents[i]["scriptPubKey"].asString();
+        utxo.amount = Amount::fromBtc(unspents[i]["amount"].asDouble());
+        utxo.height = unspents[i]["height"].asInt();
+        ret.push_back(utxo);
+    }
+
+    return ret;
+}
+
+std::vector<std::string> BitcoinRPCFacade::getrawmempool() const {
+    std::string command = "getrawmempool";
+    Value params, result;
+    result = bitcoinAPI->sendcommand(command, params);
+
+    std::vector<std::string> ret;
+    for(Json::ArrayIndex i = 0; i < result.size(); ++i) {
+        ret.push_back(result[i].asString());
+    }
+
+    return ret;
+}
+
+std::vector<prevoutspending_t> BitcoinRPCFacade::gettxspendingprevout(const std::vector<txout_t> &outputs) const {
+    std::string command = "gettxspendingprevout";
+    Value params, result;
+    Value outpoints(Json::arrayValue);
+    for(const auto & output : outputs) {
+        Value val;
+        val["txid"] = output.txid;
+        val["vout"] = output.n;
+        outpoints.append(val);
+    }
+    params.append(outpoints);
+    result = bitcoinAPI->sendcommand(command, params);
+
+    // one result per output, in order; "spendingtxid" is only there if the output is spent
+    std::vector<prevoutspending_t> ret;
+    for(Json::ArrayIndex i = 0; i < result.size(); ++i) {
+        prevoutspending_t spending;
+        spending.txid = result[i]["txid"].asString();
+        spending.vout = result[i]["vout"].asUInt();
+        spending.spendingtxid = result[i]["spendingtxid"].asString();
+        ret.push_back(spending);
+    }
+
+    return ret;
+}
+
+blocktip_t BitcoinRPCFacade::waitforblockheight(int height, int timeoutMs) const {
+    std::string command = "waitforblockheight";
+    Value params, result;
+    params.append(height);
+    params.append(timeoutMs);
+    result = bitcoinAPI->sendcommand(command, params);
+
+    blocktip_t ret;
+    ret.hash = result["hash"].asString();
+    ret.height = result["height"].asInt();
+
+    return ret;
+}
+
 std::string BitcoinRPCFacade::sendrawtransaction(const std::string &hexString) const {
     std::string command = "sendrawtransaction";
     Value params, result;
@@ -150,7 +313,8 @@ BitcoinRPCFacade::signrawtransactionwithkey(
         if(!input.witnessScript.empty()){
             val["witnessScript"] = input.witnessScript;
         }
-        val["amount"] = input.amount;
+        // as a string, so bitcoind gets exactly this many satoshis and not a double's rounding
+        val["amount"] = input.amount.toString();
         inputValues.append(val);
     }
 
@@ -3,6 +3,8 @@
 
 // Facade class that wraps the BitcoinApi objects
 
+#include "amount.h"
+
 #include <string>
 #include <vector>
 #include <map>
@@ -37,7 +39,7 @@ struct signrawtxinext_t {
     std::string scriptPubKey;
     std::string redeemScript;
     std::string witnessScript;
-    std::string amount;
+    Amount amount;
 };
 
 // struct for local impl of getaddressinfo()
@@ -70,6 +72,44 @@ struct btcaddressinfo_t { // not using addressinfo_t as that is already used in
 
 };
 
+// struct for local impl of testmempoolaccept()
+struct mempoolacceptance_t {
+    std::string txid;
+    bool allowed; // If the mempool would accept the transaction
+    std::string rejectreason; // Why not, when not allowed
+    int vsize; // Virtual size, when allowed
+    Amount fee; // Fee paid, when allowed
+};
+
+// struct for local impl of scantxoutset()
+struct scannedutxo_t {
+    std::string txid;
+    unsigned int vout;
+    std::string scriptPubKey; // hex
+    Amount amount;
+    int height; // Height of the block holding the transaction
+};
+
+// struct for local impl of gettxspendingprevout()
+struct prevoutspending_t {
+    std::string txid;
+    unsigned int vout;
+    std::string spendingtxid; // The mempool transaction spending the output, if any
+};
+
+// struct for local impl of waitforblockheight()
+struct blocktip_t {
+    std::string hash;
+    int height;
+};
+
+// struct for local impl of getblockheader()
+struct blockheader_t {
+    std::string hash;
+    int height;
+    int confirmations; // -1 if the block is not on the best chain
+};
+
 struct RpcConfig {
     std::string rpcuser = "";
     std::string rpcpassword ="";
@@ -103,6 +143,28 @@ public:
     virtual blockchaininfo_t getblockchaininfo() const;
     virtual std::string signrawtransactionwithkey(const std::string& rawTx, const std::vector<signrawtxinext_t> & inputs, const std::vector<std::string>& privkeys, const std::string& sighashtype) const;
     virtual btcaddressinfo_t getaddressinfo(const std::string& address) const;
+    // getblock with verbosity 0: the serialized block, hex-encoded
+    virtual std::string getrawblock(const std::string& blockhash) const;
+    // getrawtransaction with verbose=0, looked up in the given block so bitcoind doesn't need
+    // -txindex: the serialized transaction, hex-encoded
+    virtual std::string getrawtransactioninblock(const std::string& txid, const std::string& blockhash) const;
+    // what bitcoind knows of a block's place in the chain. Headers are kept when blocks are pruned.
+    virtual blockheader_t getblockheader(const std::string& blockhash) const;
+    // getblockheader with verbose=false: the serialized header, hex-encoded
+    virtual std::string getrawblockheader(const std::string& blockhash) const;
+    // proof that these transactions are in the block (a BIP 37 merkleblock), hex-encoded
+    virtual std::string gettxoutproof(const std::vector<std::string>& txids, const std::string& blockhash) const;
+    // would the mempool accept this transaction? Nothing is submitted.
+    virtual mempoolacceptance_t testmempoolaccept(const std::string& hexString) const;
+    // the confirmed unspent outputs matching output descriptors, found without a wallet
+    virtual std::vector<scannedutxo_t> scantxoutset(const std::vector<std::string>& descriptors) const;
+    // the txids of every transaction in the mempool
+    virtual std::vector<std::string> getrawmempool() const;
+    // which mempool transactions spend these outputs (bitcoind 24 and later)
+    virtual std::vector<prevoutspending_t> gettxspendingprevout(const std::vector<txout_t>& outputs) const;
+    // long-poll: returns once the chain is at least 'height' blocks long, or after 'timeoutMs'
+    // (0 waits forever), with the tip at that moment
+    virtual blocktip_t waitforblockheight(int height, int timeoutMs) const;
 
     // re-implement out-of-date bitcoinapi functions
     virtual std::string sendrawtransaction(const std::string& hexString) const;
@@ -0,0 +1,246 @@
+#include "block.h"
+#include "merkle.h"
+#include "sha256.h"
+
+#include <cstring>
+
+// txids() hands a vector of these to the hashing kernel as one run of bytes
+static_assert(sizeof(Hash256) == 32, "Hash256 should be exactly 32 bytes");
+
+namespace {
+
+    uint32_t readLE32(const uint8_t * p) {
+        return static_cast<uint32_t>(p[0]) | static_cast<uint32_t>(p[1]) << 8 |
+               static_cast<uint32_t>(p[2]) << 16 | static_cast<uint32_t>(p[3]) << 24;
+    }
+
+    /**
+     * Read a CompactSize, or return false if it runs past 'end'
+     */
+    bool readCompactSize(const uint8_t * & cursor, const uint8_t * end, uint64_t & value) {
+        if(cursor >= end)
+            return false;
+        uint8_t first = *cursor++;
+        size_t numBytes = first < 0xfd ? 0 : first == 0xfd ? 2 : first == 0xfe ? 4 : 8;
+        if(static_cast<size_t>(end - cursor) < numBytes)
+            return false;
+        value = numBytes == 0 ? first : 0;
+        for(size_t i = 0; i < numBytes; ++i)
+            value |= static_cast<uint64_t>(cursor[i]) << (8 * i);
+        cursor += numBytes;
+        return true;
+    }
+
+    /**
+     * Walks a BIP 37 partial merkle tree depth first, as bitcoind builds it, computing the root
+     * and collecting the matched txids on the way
+     */
+    class PartialMerkleTree {
+    public:
+        PartialMerkleTree(uint32_t transactionCount, const uint8_t * hashData, size_t hashCount,
+                          const uint8_t * flagData, size_t flagByteCount)
+                : numTransactions(transactionCount), hashes(hashData), numHashes(hashCount),
+                  flags(flagData), numFlagBytes(flagByteCount) {
+        }
+
+        bool extract(Hash256 & root, std::vector<std::pair<uint32_t, Hash256>> & matches) {
+            if(numTransactions == 0 || numHashes > numTransactions || numHashes > numFlagBytes * 8)
+                return false;
+            int height = 0;
+            while(width(height) > 1)
+                ++height;
+            if(!traverse(height, 0, root, matches))
+                return false;
+            // every hash and every flag byte has to have been used
+            return hashesUsed == numHashes && (bitsUsed + 7) / 8 == numFlagBytes;
+        }
+
+    private:
+        size_t width(int height) const {
+            return (numTransactions + (static_cast<size_t>(1) << height) - 1) >> height;
+        }
+
+        bool traverse(int height, uint32_t position, Hash256 & hash, std::vector<std::pair<uint32_t, Hash256>> & matches) {
+            if(bitsUsed >= numFlagBytes * 8)
+                return false;
+            bool parentOfMatch = ((flags[bitsUsed / 8] >> (bitsUsed % 8)) & 1) != 0;
+            ++bitsUsed;
+
+            if(height == 0 || !parentOfMatch) {
+                if(hashesUsed >= numHashes)
+                    return false;
+                std::memcpy(hash.data(), hashes + 32 * hashesUsed++, 32);
+                if(height == 0 && parentOfMatch)
+                    matches.emplace_back(position, hash);
+                return true;
+            }
+
+            Hash256 left, right;
+            if(!traverse(height - 1, position * 2, left, matches))
+                return false;
+            if(position * 2 + 1 < width(height - 1)) {
+                if(!traverse(height - 1, position * 2 + 1, right, matches))
+                    return false;
+                // identical siblings would let a tree prove a transaction that isn't there (CVE-2012-2459)
+                if(right == left)
+                    return false;
+            }
+            else
+                right = left;
+
+            uint8_t pair[64];
+            std::memcpy(pair, left.data(), 32);
+            std::memcpy(pair + 32, right.data(), 32);
+            sha256::doubleHash(pair, sizeof(pair), hash.data());
+            return true;
+        }
+
+        const uint32_t numTransactions;
+        const uint8_t * hashes;
+        const size_t numHashes;
+        const uint8_t * flags;
+        const size_t numFlagBytes;
+        size_t hashesUsed = 0;
+        size_t bitsUsed = 0;
+    };
+}
+
+
+BlockHeader BlockHeader::parse(const uint8_t * data) {
+    BlockHeader header;
+    header.version = static_cast<int32_t>(readLE32(data));
+    std::memcpy(header.prevHash.data(), data + 4, 32);
+    std::memcpy(header.merkleRoot.data(), data + 36, 32);
+    header.time = readLE32(data + 68);
+    header.bits = readLE32(data + 72);
+    header.nonce = readLE32(data + 76);
+    sha256::doubleHash(data, SIZE, header.hash.data());
+    return header;
+}
+
+bool BlockHeader::meetsTarget() const {
+    uint32_t exponent = bits >> 24;
+    uint32_t mantissa = bits & 0x007fffff;
+    // a negative or zero target can't be met, nor one too large for 256 bits
+    if((bits & 0x00800000) != 0 || mantissa == 0 || exponent > 32)
+        return false;
+
+    // the target as a 256-bit little-endian number, like the hash
+    Hash256 target = {};
+    for(uint32_t i = 0; i < 3; ++i) {
+        // byte i of the mantissa is byte exponent - 3 + i of the target; any below 0 are shifted out
+        if(exponent + i >= 3)
+            target[exponent + i - 3] = static_cast<uint8_t>(mantissa >> (8 * i));
+    }
+
+    for(size_t i = target.size(); i-- > 0; ) {
+        if(hash[i] != target[i])
+            return hash[i] < target[i];
+    }
+    return true;
+}
+
+Result<Block> Block::parse(const uint8_t * data, size_t len) {
+    if(len < BlockHeader::SIZE)
+        return Result<Block>::failure("Block is shorter than its header");
+
+    Block block;
+    block.blockHeader = BlockHeader::parse(data);
+
+    const uint8_t * cursor = data + BlockHeader::SIZE;
+    const uint8_t * end = data + len;
+    uint64_t numTxs;
+    if(!readCompactSize(cursor, end, numTxs))
+        return Result<Block>::failure("Block is truncated");
+    // each transaction takes at least 60 bytes, so don't trust a count that couldn't fit
+    if(numTxs > static_cast<uint64_t>(end - cursor) / 60)
+        return Result<Block>::failure("Block has more transactions than fit in it");
+
+    block.txs.reserve(static_cast<size_t>(numTxs));
+    for(uint64_t i = 0; i < numTxs; ++i) {
+        size_t consumed = 0;
+        Result<RawTransaction> tx = RawTransaction::parsePrefix(cursor, static_cast<size_t>(end - cursor), consumed);
+        if(!tx)
+            return Result<Block>::failure(tx);
+        block.txs.push_back(tx.value());
+        cursor += consumed;
+    }
+    if(cursor != end)
+        return Result<Block>::failure("Block has trailing bytes");
+
+    return Result<Block>::success(block);
+}
+
+const BlockHeader & Block::header() const {
+    return blockHeader;
+}
+
+const std::vector<RawTransaction> & Block::transactions() const {
+    return txs;
+}
+
+std::vector<Hash256> Block::txids() const {
+    // segwit transactions are hashed without their witness data, so lay those out in one
+    // buffer first; the others are hashed where they are
+    size_t strippedBytes = 0;
+    for(const RawTransaction & tx : txs)
+        if(tx.hasWitness())
+            strippedBytes += tx.nonWitnessSize();
+    std::vector<uint8_t> stripped(strippedBytes);
+
+    std::vector<const uint8_t *> data(txs.size());
+    std::vector<size_t> lens(txs.size());
+    size_t used = 0;
+    for(size_t i = 0; i < txs.size(); ++i) {
+        if(txs[i].hasWitness()) {
+            data[i] = &stripped[used];
+            lens[i] = txs[i].nonWitnessSize();
+            txs[i].writeNonWitness(&stripped[used]);
+            used += lens[i];
+        }
+        else {
+            data[i] = txs[i].bytes().data;
+            lens[i] = txs[i].bytes().size;
+        }
+    }
+
+    std::vector<Hash256> ids(txs.size());
+    if(!ids.empty())
+        sha256::doubleHashMany(data.data(), lens.data(), txs.size(), ids[0].data());
+    return ids;
+}
+
+bool Block::hasValidMerkleRoot(const std::vector<Hash256> & ids) const {
+    Hash256 root;
+    merkle::root(ids.empty() ? nullptr : ids[0].data(), ids.size(), root.data());
+    return root == blockHeader.merkleRoot;
+}
+
+Result<MerkleBlock> MerkleBlock::parse(const uint8_t * data, size_t len) {
+    if(len < BlockHeader::SIZE + 4)
+        return Result<MerkleBlock>::failure("Merkle block is shorter than its header");
+
+    MerkleBlock merkleBlock;
+    merkleBlock.header = BlockHeader::parse(data);
+    merkleBlock.numTransactions = readLE32(data + BlockHeader::SIZE);
+
+    const uint8_t * cursor = data + BlockHeader::SIZE + 4;
+    const uint8_t * end = data + len;
+    uint64_t numHashes, numFlagBytes;
+    if(!readCompactSize(cursor, end, numHashes) || numHashes > static_cast<uint64_t>(end - cursor) / 32)
+        return Result<MerkleBlock>::failure("Merkle block is truncated");
+    const uint8_t * hashes = cursor;
+    cursor += numHashes * 32;
+    if(!readCompactSize(cursor, end, numFlagBytes) || numFlagBytes != static_cast<uint64_t>(end - cursor))
+        return Result<MerkleBlock>::failure("Merkle block is truncated or has trailing bytes");
+
+    PartialMerkleTree tree(merkleBlock.numTransactions, hashes, static_cast<size_t>(numHashes),
+                           cursor, static_cast<size_t>(numFlagBytes));
+    Hash256 root;
+    if(!tree.extract(root, merkleBlock.matches))
+        return Result<MerkleBlock>::failure("Merkle block's partial merkle tree is not valid");
+    if(root != merkleBlock.header.merkleRoot)
+        return Result<MerkleBlock>::failure("Merkle block's partial merkle tree doesn't lead to its merkle root");
+
+    return Result<MerkleBlock>::success(merkleBlock);
+}
@@ -0,0 +1,101 @@
+#ifndef TXREF_BLOCK_H
+#define TXREF_BLOCK_H
+
+#include "rawTransaction.h"
+#include "result.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+/**
+ * A 32-byte hash (a txid or block hash) in internal byte order, the reverse of how it is displayed
+ */
+typedef std::array<uint8_t, 32> Hash256;
+
+struct BlockHeader {
+    static const size_t SIZE = 80;
+
+    int32_t version;
+    Hash256 prevHash;
+    Hash256 merkleRoot;
+    uint32_t time;
+    uint32_t bits;
+    uint32_t nonce;
+    /** the SHA-256d of the 80 header bytes */
+    Hash256 hash;
+
+    /**
+     * Parse a header and compute its hash
+     * @param data BlockHeader::SIZE bytes
+     */
+    static BlockHeader parse(const uint8_t * data);
+
+    /**
+     * Is the hash at or below the target that 'bits' encodes? This is the proof of work; whether
+     * 'bits' is the right difficulty for the block's height is not checked.
+     */
+    bool meetsTarget() const;
+};
+
+/**
+ * A serialized block, parsed in place: its transactions are views into the serialized bytes,
+ * as with RawTransaction::parse
+ */
+class Block {
+
+public:
+    /**
+     * Parse a serialized block
+     * @param data the serialized block. Must outlive the Block and any copies.
+     * @param len the number of bytes
+     * @return the block, or why it could not be parsed
+     */
+    static Result<Block> parse(const uint8_t * data, size_t len);
+
+    const BlockHeader & header() const;
+
+    const std::vector<RawTransaction> & transactions() const;
+
+    /**
+     * Compute the txid of every transaction, in block order. They are hashed as one batch, so
+     * this is much faster than calling RawTransaction::txid() on each.
+     */
+    std::vector<Hash256> txids() const;
+
+    /**
+     * Does the header's merkle root match these txids?
+     * @param txids the result of txids()
+     */
+    bool hasValidMerkleRoot(const std::vector<Hash256> & txids) const;
+
+private:
+    Block() = default;
+
+    BlockHeader blockHeader;
+    std::vector<RawTransaction> txs;
+};
+
+
+/**
+ * A block header with a partial merkle tree proving that some of the block's transactions are
+ * in it: a BIP 37 merkleblock, as gettxoutproof returns it
+ */
+struct MerkleBlock {
+    BlockHeader header;
+    uint32_t numTransactions;
+    /** the transactions proven, by position in the block, with their txids in internal byte order */
+    std::vector<std::pair<uint32_t, Hash256>> matches;
+
+    /**
+     * Parse a merkleblock and check that its partial merkle tree leads to the header's merkle root
+     * @param data the serialized merkleblock
+     * @param len the number of bytes
+     * @return the merkleblock, or why it could not be parsed or is not valid
+     */
+    static Result<MerkleBlock> parse(const uint8_t * data, size_t len);
+};
+
+#endif //TXREF_BLOCK_H
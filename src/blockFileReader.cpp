@@ -0,0 +1,239 @@
+#include "blockFileReader.h"
+#include "mappedFile.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <unordered_map>
+
+#include <sys/stat.h>
+
+namespace {
+
+    /**
+     * The bytes bitcoind writes before each block, which differ by chain
+     */
+    std::array<uint8_t, 4> networkMagic(const std::string & chain) {
+        if(chain == "main")
+            return {{0xf9, 0xbe, 0xb4, 0xd9}};
+        if(chain == "test")
+            return {{0x0b, 0x11, 0x09, 0x07}};
+        if(chain == "testnet4")
+            return {{0x1c, 0x16, 0x3f, 0x28}};
+        if(chain == "signet")
+            return {{0x0a, 0x03, 0xcf, 0x40}};
+        if(chain == "regtest")
+            return {{0xfa, 0xbf, 0xb5, 0xda}};
+        throw std::runtime_error("Unknown chain: " + chain);
+    }
+
+    std::string blockFileName(const std::string & blocksDir, size_t number) {
+        char name[32];
+        std::snprintf(name, sizeof(name), "/blk%05zu.dat", number);
+        return blocksDir + name;
+    }
+
+    bool fileExists(const std::string & path) {
+        struct stat st;
+        return ::stat(path.c_str(), &st) == 0;
+    }
+
+    /**
+     * The expected work to find a block with this difficulty target (2^256 / (target + 1)). A
+     * double is plenty precise to compare chains, so this avoids 256-bit arithmetic.
+     */
+    double blockWork(uint32_t bits) {
+        int exponent = static_cast<int>(bits >> 24);
+        uint32_t mantissa = bits & 0x007fffff;
+        if(mantissa == 0)
+            return 0;
+        double target = std::ldexp(static_cast<double>(mantissa), 8 * (exponent - 3));
+        return std::ldexp(1.0, 256) / (target + 1);
+    }
+
+    struct Hash256Key {
+        size_t operator()(const Hash256 & hash) const {
+            // a hash is already random, so its first bytes will do
+            size_t value;
+            std::memcpy(&value, hash.data(), sizeof(value));
+            return value;
+        }
+    };
+
+    const size_t NO_PARENT = static_cast<size_t>(-1);
+}
+
+
+BlockFileReader::BlockFileReader(const std::string & blocksDir, const std::string & chain)
+        : xorKey(), obfuscated(false) {
+    std::array<uint8_t, 4> magic = networkMagic(chain);
+
+    for(size_t number = 0; fileExists(blockFileName(blocksDir, number)); ++number)
+        files.emplace_back(new MappedFile(blockFileName(blocksDir, number), MappedFile::Access::sequential));
+    if(files.empty())
+        throw std::runtime_error("No block files found in " + blocksDir);
+
+    // bitcoind 28 and later XOR the files with a random key, unless told not to
+    std::ifstream keyFile(blocksDir + "/xor.dat", std::ios::binary);
+    if(keyFile && keyFile.read(reinterpret_cast<char *>(xorKey.data()), xorKey.size())) {
+        for(uint8_t b : xorKey)
+            obfuscated = obfuscated || b != 0;
+    }
+
+    scan(magic);
+}
+
+BlockFileReader::~BlockFileReader() = default;
+
+void BlockFileReader::scan(const std::array<uint8_t, 4> & magic) {
+    struct Candidate {
+        BlockLocation location;
+        Hash256 prevHash;
+        uint32_t bits;
+    };
+    std::vector<Candidate> candidates;
+
+    for(size_t file = 0; file < files.size(); ++file) {
+        size_t size = files[file]->size();
+        size_t pos = 0;
+        while(pos + 8 <= size) {
+            uint8_t prefix[8];
+            read(file, pos, sizeof(prefix), prefix);
+
+            if(std::memcmp(prefix, magic.data(), magic.size()) != 0) {
+                // bitcoind grows the files in chunks, so zeros mean the rest is unused
+                static const uint8_t zeros[4] = {};
+                if(std::memcmp(prefix, zeros, sizeof(zeros)) == 0)
+                    break;
+                // otherwise look for the next block, as bitcoind does when reindexing
+                ++pos;
+                continue;
+            }
+
+            size_t len = static_cast<size_t>(prefix[4]) | static_cast<size_t>(prefix[5]) << 8 |
+                         static_cast<size_t>(prefix[6]) << 16 | static_cast<size_t>(prefix[7]) << 24;
+            if(len > size - pos - 8)
+                break;  // a block only partly written before bitcoind stopped
+            if(len < BlockHeader::SIZE) {
+                ++pos;
+                continue;
+            }
+
+            uint8_t headerBytes[BlockHeader::SIZE];
+            read(file, pos + 8, sizeof(headerBytes), headerBytes);
+            BlockHeader header = BlockHeader::parse(headerBytes);
+            candidates.push_back(Candidate{BlockLocation{header.hash, file, pos + 8, len}, header.prevHash, header.bits});
+            pos += 8 + len;
+        }
+    }
+
+    // link each block to its parent; a block stored twice keeps its first copy
+    std::unordered_map<Hash256, size_t, Hash256Key> byHash;
+    byHash.reserve(candidates.size());
+    for(size_t i = 0; i < candidates.size(); ++i)
+        byHash.emplace(candidates[i].location.hash, i);
+
+    const Hash256 noHash = {};
+    std::vector<size_t> parent(candidates.size(), NO_PARENT);
+    std::vector<bool> linked(candidates.size(), false);
+    for(size_t i = 0; i < candidates.size(); ++i) {
+        if(candidates[i].prevHash == noHash) {
+            linked[i] = true;  // genesis
+            continue;
+        }
+        auto found = byHash.find(candidates[i].prevHash);
+        if(found != byHash.end()) {
+            parent[i] = found->second;
+            linked[i] = true;
+        }
+    }
+
+    // height and total work up to each block. Blocks that don't lead back to genesis are left
+    // out: their height is OFF_CHAIN.
+    const int UNVISITED = -1;
+    const int OFF_CHAIN = -2;
+    std::vector<int> height(candidates.size(), UNVISITED);
+    std::vector<double> chainWork(candidates.size(), 0);
+    std::vector<size_t> path;
+    for(size_t i = 0; i < candidates.size(); ++i) {
+        size_t at = i;
+        while(at != NO_PARENT && height[at] == UNVISITED && linked[at]) {
+            path.push_back(at);
+            at = parent[at];
+        }
+        // the walk stops at genesis, at a block already done, or at one whose parent is missing
+        bool reachesGenesis = at == NO_PARENT || height[at] >= 0;
+        for(auto it = path.rbegin(); it != path.rend(); ++it) {
+            size_t block = *it;
+            size_t above = parent[block];
+            if(!reachesGenesis)
+                height[block] = OFF_CHAIN;
+            else if(above == NO_PARENT) {
+                height[block] = 0;
+                chainWork[block] = blockWork(candidates[block].bits);
+            }
+            else {
+                height[block] = height[above] + 1;
+                chainWork[block] = chainWork[above] + blockWork(candidates[block].bits);
+            }
+        }
+        path.clear();
+    }
+
+    // the tip with the most work wins; on a tie, the one bitcoind stored first
+    size_t tip = NO_PARENT;
+    for(size_t i = 0; i < candidates.size(); ++i)
+        if(height[i] >= 0 && (tip == NO_PARENT || chainWork[i] > chainWork[tip]))
+            tip = i;
+
+    bestChain.clear();
+    if(tip == NO_PARENT)
+        return;
+    bestChain.resize(static_cast<size_t>(height[tip]) + 1);
+    for(size_t at = tip; at != NO_PARENT; at = parent[at])
+        bestChain[static_cast<size_t>(height[at])] = candidates[at].location;
+}
+
+void BlockFileReader::read(size_t file, size_t offset, size_t len, uint8_t * out) const {
+    std::memcpy(out, files[file]->data() + offset, len);
+    if(obfuscated) {
+        for(size_t i = 0; i < len; ++i)
+            out[i] ^= xorKey[(offset + i) % xorKey.size()];
+    }
+}
+
+int BlockFileReader::tipHeight() const {
+    return static_cast<int>(bestChain.size()) - 1;
+}
+
+const Hash256 & BlockFileReader::blockHash(int height) const {
+    if(height < 0 || height > tipHeight())
+        throw std::out_of_range("No block at height " + std::to_string(height));
+    return bestChain[static_cast<size_t>(height)].hash;
+}
+
+void BlockFileReader::forEachBlock(int fromHeight, int toHeight, const Visitor & visit) const {
+    if(fromHeight < 0 || toHeight > tipHeight())
+        throw std::out_of_range("Heights " + std::to_string(fromHeight) + " to " + std::to_string(toHeight) +
+                                " are not on the best chain");
+
+    std::vector<uint8_t> scratch;
+    for(int height = fromHeight; height <= toHeight; ++height) {
+        const BlockLocation & location = bestChain[static_cast<size_t>(height)];
+
+        // parse in place, unless the bytes need to be unscrambled first
+        const uint8_t * data = files[location.file]->data() + location.offset;
+        if(obfuscated) {
+            scratch.resize(location.size);
+            read(location.file, location.offset, location.size, scratch.data());
+            data = scratch.data();
+        }
+
+        Result<Block> block = Block::parse(data, location.size);
+        if(!block)
+            throw std::runtime_error("Can't parse block at height " + std::to_string(height) + ": " + block.error());
+        visit(height, block.value());
+    }
+}
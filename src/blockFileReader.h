@@ -0,0 +1,87 @@
+#ifndef TXREF_BLOCKFILEREADER_H
+#define TXREF_BLOCKFILEREADER_H
+
+#include "block.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+class MappedFile;
+
+/**
+ * Reads blocks straight from bitcoind's block files (blocks/blk*.dat), for building indexes
+ * offline without going through RPC.
+ *
+ * The files are memory-mapped. Blocks are stored in the order bitcoind received them, which
+ * includes stale blocks and blocks from before their parents, so the constructor scans every
+ * header and finds the best chain (the one with the most work). Files obfuscated with the
+ * key in blocks/xor.dat are read too.
+ *
+ * bitcoind should not be writing to the files while they are read: stop it, or copy them.
+ */
+class BlockFileReader {
+
+public:
+    typedef std::function<void(int height, const Block & block)> Visitor;
+
+    /**
+     * Scan the block files and find the best chain
+     * @param blocksDir bitcoind's blocks directory, such as ~/.bitcoin/testnet3/blocks
+     * @param chain the chain the files are for, as getblockchaininfo names it: "main", "test",
+     * "testnet4", "signet" or "regtest"
+     * @throws std::runtime_error if the chain is unknown, or there are no block files
+     */
+    BlockFileReader(const std::string & blocksDir, const std::string & chain);
+
+    ~BlockFileReader();
+
+    BlockFileReader(const BlockFileReader &) = delete;
+    BlockFileReader & operator=(const BlockFileReader &) = delete;
+
+    /**
+     * @return the height of the best chain's tip, or -1 if there are no blocks
+     */
+    int tipHeight() const;
+
+    /**
+     * @return the hash of the block at this height on the best chain
+     * @throws std::out_of_range if there is no such block
+     */
+    const Hash256 & blockHash(int height) const;
+
+    /**
+     * Parse each block on the best chain from 'fromHeight' to 'toHeight' inclusive, in height
+     * order, and hand it to 'visit'. The Block is only valid during that call.
+     * @throws std::out_of_range if the heights aren't on the best chain
+     * @throws std::runtime_error if a block can't be parsed
+     */
+    void forEachBlock(int fromHeight, int toHeight, const Visitor & visit) const;
+
+private:
+    struct BlockLocation {
+        Hash256 hash;
+        size_t file;
+        size_t offset;
+        size_t size;
+    };
+
+    std::vector<std::unique_ptr<MappedFile>> files;
+    std::array<uint8_t, 8> xorKey;
+    bool obfuscated;
+    std::vector<BlockLocation> bestChain;
+
+    void scan(const std::array<uint8_t, 4> & magic);
+
+    /**
+     * Copy bytes out of a file, undoing the obfuscation
+     */
+    void read(size_t file, size_t offset, size_t len, uint8_t * out) const;
+};
+
+
+#endif //TXREF_BLOCKFILEREADER_H
@@ -0,0 +1,68 @@
+#ifndef TXREF_BOUNDEDCACHE_H
+#define TXREF_BOUNDEDCACHE_H
+
+#include <deque>
+#include <map>
+#include <mutex>
+
+/**
+ * A thread-safe key/value cache holding at most 'capacity' entries. When full, the oldest
+ * entry is evicted first. Bulk operations walk the chain in height order, so insertion order
+ * is a good enough approximation of what will not be needed again.
+ */
+template <typename K, typename V>
+class BoundedCache {
+
+public:
+    explicit BoundedCache(size_t capacity) : capacity(capacity) {}
+
+    /**
+     * Look up a value
+     * @param key the key to look up
+     * @param value receives a copy of the value, if found
+     * @return true if found
+     */
+    bool find(const K & key, V & value) const {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = entries.find(key);
+        if(it == entries.end())
+            return false;
+        value = it->second;
+        return true;
+    }
+
+    /**
+     * Insert or replace a value, evicting the oldest entry if the cache is full
+     * @param key the key
+     * @param value the value
+     */
+    void put(const K & key, const V & value) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if(capacity == 0)
+            return;
+        auto it = entries.find(key);
+        if(it != entries.end()) {
+            it->second = value;
+            return;
+        }
+        if(entries.size() >= capacity) {
+            entries.erase(insertionOrder.front());
+            insertionOrder.pop_front();
+        }
+        entries.emplace(key, value);
+        insertionOrder.push_back(key);
+    }
+
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return entries.size();
+    }
+
+private:
+    const size_t capacity;
+    mutable std::mutex mutex;
+    std::map<K, V> entries;
+    std::deque<K> insertionOrder;
+};
+
+#endif //TXREF_BOUNDEDCACHE_H
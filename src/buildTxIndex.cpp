@@ -0,0 +1,303 @@
+#include "bitcoinRPCFacade.h"
+#include "blockFileReader.h"
+#include "txIndex.h"
+#include "txIndexBuilder.h"
+#include "hex.h"
+#include "anyoption.h"
+
+#include <bitcoinapi/bitcoinapi.h>
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <cstdlib>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+
+struct CmdlineInput {
+    std::string indexPath;
+    std::string findTxid;       // look up this txid instead of building
+    std::string blocksDir;      // read bitcoind's block files here instead of using RPC
+    std::string chain = "main"; // the chain the block files are for
+    int jobs = 8;
+    int segmentBlocks = TxIndexBuilder::DEFAULT_BLOCKS_PER_SEGMENT;
+    int toHeight = -1;
+};
+
+
+std::string find_homedir() {
+    std::string ret;
+    char * home = getenv("HOME");
+    if(home != nullptr)
+        ret.append(home);
+    return ret;
+}
+
+int convertIntegerArg(const std::string & argName, AnyOption *opt) {
+    int i;
+    try {
+        i = std::stoi(opt->getValue(argName.c_str()));
+    }
+    catch(std::invalid_argument &) {
+        std::cerr << "Error: " << argName << " '" << opt->getValue(argName.c_str())
+                  << "' is invalid. Check command line usage.\n";
+        opt->printUsage();
+        std::exit(-1);
+    }
+    catch(std::out_of_range &) {
+        std::cerr << "Error: " << argName << " '" << opt->getValue(argName.c_str())
+                  << "' is invalid. Check command line usage.\n";
+        opt->printUsage();
+        std::exit(-1);
+    }
+    return i;
+}
+
+int parseCommandLineArgs(int argc, char **argv,
+                         struct RpcConfig &rpcConfig,
+                         struct CmdlineInput &cmdlineInput) {
+
+    auto opt = std::unique_ptr<AnyOption>(new AnyOption());
+    opt->setFileDelimiterChar('=');
+
+    opt->addUsage( "" );
+    opt->addUsage( "Usage: buildTxIndex [options] <index file>" );
+    opt->addUsage( "       buildTxIndex --blocksdir <dir> [--chain <chain>] [options] <index file>" );
+    opt->addUsage( "       buildTxIndex --find <txid> <index file>" );
+    opt->addUsage( "" );
+    opt->addUsage( " -h  --help                 Print this help " );
+    opt->addUsage( " --rpcconnect [host or IP]  RPC host (default: 127.0.0.1) " );
+    opt->addUsage( " --rpcuser [user]           RPC user " );
+    opt->addUsage( " --rpcpassword [pass]       RPC password " );
+    opt->addUsage( " --rpcport [port]           RPC port (default: try both 8332 and 18332) " );
+    opt->addUsage( " --config [config_path]     Full pathname to bitcoin.conf (default: <homedir>/.bitcoin/bitcoin.conf) " );
+    opt->addUsage( " --jobs [#]                 Number of blocks fetched (or read) at once, each over its own " );
+    opt->addUsage( "                            RPC connection (default: 8) " );
+    opt->addUsage( " --segment-blocks [#]       Blocks per segment, the unit of work that is checkpointed " );
+    opt->addUsage( "                            (default: 500) " );
+    opt->addUsage( " --to-height [#]            Last block to index (default: the current tip, or the block " );
+    opt->addUsage( "                            files' last block) " );
+    opt->addUsage( " --blocksdir [dir]          Read the blocks from bitcoind's block files in dir (such as " );
+    opt->addUsage( "                            ~/.bitcoin/blocks) instead of over RPC. Stop bitcoind first. " );
+    opt->addUsage( " --chain [chain]            The chain the block files are for: main, test, testnet4, " );
+    opt->addUsage( "                            signet or regtest (default: main) " );
+    opt->addUsage( " --find [txid]              Look up a txid in an index that was already built " );
+    opt->addUsage( "" );
+    opt->addUsage( "<index file>                where to write the index of txids to block heights and positions" );
+    opt->addUsage( "" );
+    opt->addUsage( "An interrupted build picks up where it stopped when run again with the same options." );
+
+    opt->setFlag("help", 'h');
+    opt->setOption("rpcconnect");
+    opt->setOption("rpcuser");
+    opt->setOption("rpcpassword");
+    opt->setOption("rpcport");
+    opt->setCommandOption("config");
+    opt->setOption("jobs");
+    opt->setOption("segment-blocks");
+    opt->setOption("to-height");
+    opt->setOption("blocksdir");
+    opt->setOption("chain");
+    opt->setOption("find");
+
+    // parse any command line arguments--this is a first pass, mainly to get a possible
+    // "config" option that tells if the bitcoin.conf file is in a non-default location
+    opt->processCommandArgs( argc, argv );
+
+    // print usage if no options
+    if( ! opt->hasOptions()) {
+        opt->printUsage();
+        return 0;
+    }
+
+    // see if there is a bitcoin.conf file to parse. If not, continue.
+    if (opt->getValue("config") != nullptr) {
+        opt->processFile(opt->getValue("config"));
+    }
+    else {
+        std::string home = find_homedir();
+        if(!home.empty()) {
+            std::string configPath = home + "/.bitcoin/bitcoin.conf";
+            if(!opt->processFile(configPath.data())) {
+                std::cerr << "Warning: Config file " << configPath
+                          << " not readable. Perhaps try --config? Attempting to continue...\n";
+            }
+        }
+    }
+
+    // parse command line arguments AGAIN--this is because command line args should override config file
+    opt->processCommandArgs( argc, argv );
+
+
+    // print usage if help was requested
+    if (opt->getFlag("help") || opt->getFlag('h')) {
+        opt->printUsage();
+        return 0;
+    }
+
+    if(opt->getArgc() < 1) {
+        std::cerr << "Error: index file not found. Check command line usage.\n";
+        opt->printUsage();
+        return -1;
+    }
+    cmdlineInput.indexPath = opt->getArgv(0);
+
+    // a lookup doesn't need bitcoind
+    if (opt->getValue("find") != nullptr) {
+        cmdlineInput.findTxid = opt->getValue("find");
+        return 1;
+    }
+
+    if (opt->getValue("jobs") != nullptr) {
+        cmdlineInput.jobs = convertIntegerArg("jobs", opt.get());
+        if(cmdlineInput.jobs < 1) {
+            std::cerr << "Error: jobs '" << cmdlineInput.jobs << "' should be one or greater. Check command line usage.\n";
+            opt->printUsage();
+            return -1;
+        }
+    }
+
+    if (opt->getValue("segment-blocks") != nullptr) {
+        cmdlineInput.segmentBlocks = convertIntegerArg("segment-blocks", opt.get());
+        if(cmdlineInput.segmentBlocks < 1) {
+            std::cerr << "Error: segment-blocks '" << cmdlineInput.segmentBlocks << "' should be one or greater. Check command line usage.\n";
+            opt->printUsage();
+            return -1;
+        }
+    }
+
+    if (opt->getValue("to-height") != nullptr) {
+        cmdlineInput.toHeight = convertIntegerArg("to-height", opt.get());
+        if(cmdlineInput.toHeight < 0) {
+            std::cerr << "Error: to-height '" << cmdlineInput.toHeight << "' should be zero or greater. Check command line usage.\n";
+            opt->printUsage();
+            return -1;
+        }
+    }
+
+    if (opt->getValue("chain") != nullptr) {
+        cmdlineInput.chain = opt->getValue("chain");
+    }
+
+    // reading the block files doesn't need bitcoind either
+    if (opt->getValue("blocksdir") != nullptr) {
+        cmdlineInput.blocksDir = opt->getValue("blocksdir");
+        return 1;
+    }
+
+    // see if there is an rpcconnect specified. If not, use default
+    if (opt->getValue("rpcconnect") != nullptr) {
+        rpcConfig.rpcconnect = opt->getValue("rpcconnect");
+    }
+
+    // see if there is an rpcuser specified. If not, exit
+    if (opt->getValue("rpcuser") == nullptr) {
+        std::cerr << "Error: 'rpcuser' not found. Check bitcoin.conf or command line usage.\n";
+        opt->printUsage();
+        return -1;
+    }
+    rpcConfig.rpcuser = opt->getValue("rpcuser");
+
+    // see if there is an rpcpassword specified. If not, exit
+    if (opt->getValue("rpcpassword") == nullptr) {
+        std::cerr << "Error: 'rpcpassword' not found. Check bitcoin.conf or command line usage.\n";
+        opt->printUsage();
+        return -1;
+    }
+    rpcConfig.rpcpassword = opt->getValue("rpcpassword");
+
+    // will try both well known ports (8332 and 18332) if one is not specified
+    if (opt->getValue("rpcport") != nullptr) {
+        rpcConfig.rpcport = convertIntegerArg("rpcport", opt.get());
+    }
+
+    return 1;
+}
+
+/**
+ * Format a number of seconds as hours, minutes and seconds, such as "1h02m03s"
+ */
+std::string formatDuration(double seconds) {
+    long total = static_cast<long>(seconds + 0.5);
+    std::ostringstream ss;
+    if(total >= 3600)
+        ss << total / 3600 << "h" << std::setw(2) << std::setfill('0');
+    if(total >= 60)
+        ss << (total / 60) % 60 << "m" << std::setw(2) << std::setfill('0');
+    ss << total % 60 << "s";
+    return ss.str();
+}
+
+void printProgress(const TxIndexProgress & progress) {
+    double percent = progress.blocksTotal > 0 ? 100.0 * progress.blocksDone / progress.blocksTotal : 100.0;
+    std::cerr << "Indexed " << progress.blocksDone << "/" << progress.blocksTotal << " blocks ("
+              << std::fixed << std::setprecision(1) << percent << "%), "
+              << progress.transactions << " transactions, "
+              << progress.blocksPerSecond << " blocks/s";
+    if(progress.secondsLeft >= 0)
+        std::cerr << ", " << formatDuration(progress.secondsLeft) << " left";
+    std::cerr << std::endl;
+}
+
+int runFind(const CmdlineInput & cmdlineInput) {
+    Hash256 txid;
+    if(!hex::decodeHash(cmdlineInput.findTxid, txid.data())) {
+        std::cerr << "Error: " << cmdlineInput.findTxid << " is an invalid txid.\n";
+        return -1;
+    }
+
+    TxIndex index(cmdlineInput.indexPath);
+    TxIndexEntry entry;
+    if(!index.find(txid, entry)) {
+        std::cerr << "Error: transaction " << cmdlineInput.findTxid << " not found.\n";
+        return -1;
+    }
+    std::cout << "block height: " << entry.height << "\n";
+    std::cout << "transaction index: " << entry.position << "\n";
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+
+    struct RpcConfig rpcConfig;
+    struct CmdlineInput cmdlineInput;
+
+    int ret = parseCommandLineArgs(argc, argv, rpcConfig, cmdlineInput);
+    if(ret < 1) {
+        std::exit(ret);
+    }
+
+    try {
+        if(!cmdlineInput.findTxid.empty()) {
+            return runFind(cmdlineInput);
+        }
+
+        std::unique_ptr<BlockFileReader> blockFiles;
+        std::unique_ptr<TxIndexBuilder> builder;
+        if(!cmdlineInput.blocksDir.empty()) {
+            std::cerr << "Scanning the block files in " << cmdlineInput.blocksDir << std::endl;
+            blockFiles.reset(new BlockFileReader(cmdlineInput.blocksDir, cmdlineInput.chain));
+            builder.reset(new TxIndexBuilder(*blockFiles, static_cast<size_t>(cmdlineInput.jobs), cmdlineInput.segmentBlocks));
+        }
+        else {
+            builder.reset(new TxIndexBuilder(
+                    [&rpcConfig] { return std::unique_ptr<BitcoinRPCFacade>(new BitcoinRPCFacade(rpcConfig)); },
+                    static_cast<size_t>(cmdlineInput.jobs), cmdlineInput.segmentBlocks));
+        }
+
+        size_t numTransactions = builder->build(cmdlineInput.indexPath, cmdlineInput.toHeight, printProgress);
+        std::cerr << "Wrote " << numTransactions << " transactions to " << cmdlineInput.indexPath << std::endl;
+    }
+    catch(BitcoinException &e)
+    {
+        std::cerr << "Error: " << e.getCode() << " " << e.getMessage() << std::endl;
+        std::exit(-1);
+    }
+    catch(std::runtime_error &e)
+    {
+        std::cerr << "Error: " << e.what() << std::endl;
+        std::exit(-1);
+    }
+
+    return 0;
+}
@@ -0,0 +1,117 @@
+#include "bulkDidResolver.h"
+#include "domain/txrefDecoder.h"
+
+#include <bitcoinapi/bitcoinapi.h>
+
+#include <algorithm>
+#include <future>
+#include <iterator>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace {
+    const char didPrefix[] = "did:btcr:";
+
+    /**
+     * Find the block height encoded in a DID, without talking to bitcoind
+     *
+     * @param did the lowercased DID string
+     * @return the block height
+     */
+    int decodeBlockHeight(const std::string & did) {
+        if (did.find(didPrefix) != 0) {
+            throw std::runtime_error(
+                    "DID parameter not a valid BTCR DID. Should be of the form 'did:btcr:<txref>'");
+        }
+
+        DecodedTxref decoded;
+        if(decodeTxref(did, decoded) != TxrefDecodeStatus::ok) {
+            throw std::runtime_error(
+                    "DID parameter doesn't contain a valid txref. Should be of the form 'did:btcr:<txref>'");
+        }
+        return decoded.blockHeight;
+    }
+}
+
+BulkDidResolver::BulkDidResolver(
+        const BitcoinRPCFacade & b, const BitcoinRPCFacade & p, const ChainQuery & q, const MempoolSpends * m)
+        : btc(b), prefetchBtc(p), chainQuery(q), mempool(m) {
+}
+
+BulkPlan BulkDidResolver::plan(const std::vector<std::string> & dids, std::vector<DidResolution> & results) {
+
+    BulkPlan bulkPlan;
+    std::unordered_map<std::string, size_t> entryIndexes;
+
+    results.assign(dids.size(), DidResolution());
+
+    for(size_t position = 0; position < dids.size(); ++position) {
+        std::string did = dids[position];
+        std::transform(did.begin(), did.end(), did.begin(), &::tolower);
+
+        auto found = entryIndexes.find(did);
+        if(found != entryIndexes.end()) {
+            bulkPlan.entries[found->second].positions.push_back(position);
+            continue;
+        }
+
+        BulkPlan::Entry entry;
+        try {
+            entry.blockHeight = decodeBlockHeight(did);
+        }
+        catch(std::exception &e) {
+            results[position].did = dids[position];
+            results[position].error = e.what();
+            continue;
+        }
+        entry.did = did;
+        entry.positions.push_back(position);
+
+        entryIndexes.emplace(did, bulkPlan.entries.size());
+        bulkPlan.groups[entry.blockHeight].push_back(bulkPlan.entries.size());
+        bulkPlan.entries.push_back(entry);
+    }
+
+    return bulkPlan;
+}
+
+std::vector<DidResolution> BulkDidResolver::resolve(const std::vector<std::string> & dids) const {
+
+    std::vector<DidResolution> results;
+    BulkPlan bulkPlan = plan(dids, results);
+
+    // fetch a block into the (shared) cache over the prefetch connection. Errors are
+    // ignored here: they will happen again, and be reported, when the DIDs are resolved.
+    auto prefetch = [this](int height) {
+        return std::async(std::launch::async, [this, height] {
+            try {
+                prefetchBtc.getblock(prefetchBtc.getblockhash(height));
+            }
+            catch(...) {
+            }
+        });
+    };
+
+    std::future<void> nextBlock;
+    if(!bulkPlan.groups.empty())
+        nextBlock = prefetch(bulkPlan.groups.begin()->first);
+
+    for(auto group = bulkPlan.groups.begin(); group != bulkPlan.groups.end(); ++group) {
+        // wait for this group's block, then start on the one after it
+        nextBlock.wait();
+        auto following = std::next(group);
+        if(following != bulkPlan.groups.end())
+            nextBlock = prefetch(following->first);
+
+        for(size_t entryIndex : group->second) {
+            const BulkPlan::Entry & entry = bulkPlan.entries[entryIndex];
+            DidResolution resolution = resolveDid(entry.did, btc, chainQuery, mempool);
+            for(size_t position : entry.positions) {
+                results[position] = resolution;
+                results[position].did = dids[position];
+            }
+        }
+    }
+
+    return results;
+}
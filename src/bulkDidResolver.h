@@ -0,0 +1,75 @@
+#ifndef TXREF_BULKDIDRESOLVER_H
+#define TXREF_BULKDIDRESOLVER_H
+
+#include "bitcoinRPCFacade.h"
+#include "chainQuery.h"
+#include "didResolution.h"
+#include "mempoolSpends.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+/**
+ * The work needed to resolve a list of DIDs: each distinct DID once, grouped by the height of
+ * the block its txref points into
+ */
+struct BulkPlan {
+    struct Entry {
+        std::string did;                // normalized (lowercase) DID
+        int blockHeight = 0;
+        std::vector<size_t> positions;  // where this DID appears in the input
+    };
+
+    std::vector<Entry> entries;
+    std::map<int, std::vector<size_t>> groups;   // block height -> indexes into entries
+};
+
+/**
+ * Resolves many DIDs at once. All DIDs are decoded first (which needs no network access),
+ * duplicates are merged, and the rest are resolved one block at a time in height order while
+ * the next block is prefetched over a second connection. Results are returned in input order.
+ *
+ * The two facades should be CachingBitcoinRPCFacades sharing one RpcCache, so that each block
+ * is downloaded once and then served from the cache to every DID that points into it. The
+ * ChainQuery should be a CachingChainSoQuery so that shared tip chains are followed once.
+ */
+class BulkDidResolver {
+
+public:
+    /**
+     * Construct a BulkDidResolver
+     * @param btc the BitcoinRPCFacade used for resolving
+     * @param prefetchBtc the BitcoinRPCFacade used (from another thread) to prefetch blocks
+     * @param chainQuery used to follow transaction chains
+     * @param mempool if not null, used to look for pending updates (see resolveDid())
+     */
+    BulkDidResolver(const BitcoinRPCFacade & btc, const BitcoinRPCFacade & prefetchBtc, const ChainQuery & chainQuery,
+                    const MempoolSpends * mempool = nullptr);
+
+    /**
+     * Decode the given DIDs and plan their resolution. DIDs that can't be decoded get an error
+     * result right away and are left out of the plan.
+     *
+     * @param dids the DID strings
+     * @param results receives one DidResolution per input DID (only failed ones are filled in)
+     * @return the plan
+     */
+    static BulkPlan plan(const std::vector<std::string> & dids, std::vector<DidResolution> & results);
+
+    /**
+     * Resolve the given DIDs
+     * @param dids the DID strings
+     * @return one DidResolution per input DID, in input order
+     */
+    std::vector<DidResolution> resolve(const std::vector<std::string> & dids) const;
+
+private:
+    const BitcoinRPCFacade & btc;
+    const BitcoinRPCFacade & prefetchBtc;
+    const ChainQuery & chainQuery;
+    const MempoolSpends * mempool;
+};
+
+
+#endif //TXREF_BULKDIDRESOLVER_H
@@ -0,0 +1,88 @@
+#include "cachingBitcoinRPCFacade.h"
+
+#include <bitcoinapi/types.h>
+
+RpcCache::RpcCache(size_t maxBlocks, size_t maxTransactions)
+        : blockHashes(maxBlocks * 64),
+          blocks(maxBlocks),
+          rawTransactions(maxTransactions) {
+}
+
+bool RpcCache::findChainInfo(blockchaininfo_t &info) const {
+    std::lock_guard<std::mutex> lock(chainInfoMutex);
+    if(haveChainInfo)
+        info = chainInfo;
+    return haveChainInfo;
+}
+
+void RpcCache::putChainInfo(const blockchaininfo_t &info) {
+    std::lock_guard<std::mutex> lock(chainInfoMutex);
+    chainInfo = info;
+    haveChainInfo = true;
+}
+
+
+CachingBitcoinRPCFacade::CachingBitcoinRPCFacade(const BitcoinRPCFacade & d, RpcCache & c)
+        : ForwardingBitcoinRPCFacade(d), cache(c) {
+}
+
+CachingBitcoinRPCFacade::~CachingBitcoinRPCFacade() = default;
+
+getrawtransaction_t CachingBitcoinRPCFacade::getrawtransaction(const std::string &txid, int verbose) const {
+    std::shared_ptr<const getrawtransaction_t> rawTransaction;
+
+    // a verbose result also holds the hex, so it can answer a non-verbose request too
+    if(cache.rawTransactions.find(std::make_pair(txid, 1), rawTransaction) ||
+       cache.rawTransactions.find(std::make_pair(txid, verbose), rawTransaction))
+        return *rawTransaction;
+
+    rawTransaction = std::make_shared<getrawtransaction_t>(delegate.getrawtransaction(txid, verbose));
+    // an unconfirmed transaction will get a blockhash later, so don't keep its verbose form
+    if(verbose == 0 || !rawTransaction->blockhash.empty())
+        cache.rawTransactions.put(std::make_pair(txid, verbose), rawTransaction);
+    return *rawTransaction;
+}
+
+std::string CachingBitcoinRPCFacade::getrawtransactioninblock(const std::string &txid, const std::string &blockhash) const {
+    std::shared_ptr<const getrawtransaction_t> rawTransaction;
+
+    // a transaction's hex is the same whichever way it was looked up
+    if(cache.rawTransactions.find(std::make_pair(txid, 1), rawTransaction) ||
+       cache.rawTransactions.find(std::make_pair(txid, 0), rawTransaction))
+        return rawTransaction->hex;
+
+    auto found = std::make_shared<getrawtransaction_t>();
+    found->hex = delegate.getrawtransactioninblock(txid, blockhash);
+    cache.rawTransactions.put(std::make_pair(txid, 0), found);
+    return found->hex;
+}
+
+blockinfo_t CachingBitcoinRPCFacade::getblock(const std::string &blockhash) const {
+    std::shared_ptr<const blockinfo_t> blockInfo;
+    if(cache.blocks.find(blockhash, blockInfo))
+        return *blockInfo;
+
+    blockInfo = std::make_shared<blockinfo_t>(delegate.getblock(blockhash));
+    cache.blocks.put(blockhash, blockInfo);
+    return *blockInfo;
+}
+
+std::string CachingBitcoinRPCFacade::getblockhash(int blocknumber) const {
+    std::string blockhash;
+    if(cache.blockHashes.find(blocknumber, blockhash))
+        return blockhash;
+
+    blockhash = delegate.getblockhash(blocknumber);
+    cache.blockHashes.put(blocknumber, blockhash);
+    return blockhash;
+}
+
+blockchaininfo_t CachingBitcoinRPCFacade::getblockchaininfo() const {
+    blockchaininfo_t info;
+    if(cache.findChainInfo(info))
+        return info;
+
+    info = delegate.getblockchaininfo();
+    cache.putChainInfo(info);
+    return info;
+}
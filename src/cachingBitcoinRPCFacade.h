@@ -0,0 +1,74 @@
+#ifndef TXREF_CACHINGBITCOINRPCFACADE_H
+#define TXREF_CACHINGBITCOINRPCFACADE_H
+
+#include "forwardingBitcoinRPCFacade.h"
+#include "boundedCache.h"
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+
+/**
+ * Results of RPC calls that don't change for the life of a (short-lived) process: block hashes,
+ * blocks, transactions and chain info. A single RpcCache can be shared by several
+ * CachingBitcoinRPCFacades, each with their own connection, and used from several threads.
+ */
+class RpcCache {
+
+public:
+    /**
+     * Construct an RpcCache
+     * @param maxBlocks the maximum number of blocks to keep
+     * @param maxTransactions the maximum number of transactions to keep
+     */
+    explicit RpcCache(size_t maxBlocks = 16, size_t maxTransactions = 4096);
+
+    BoundedCache<int, std::string> blockHashes;
+    BoundedCache<std::string, std::shared_ptr<const blockinfo_t>> blocks;
+    BoundedCache<std::pair<std::string, int>, std::shared_ptr<const getrawtransaction_t>> rawTransactions;
+
+    /**
+     * Get the cached chain info
+     * @param info receives the chain info, if it has been cached
+     * @return true if the chain info has been cached
+     */
+    bool findChainInfo(blockchaininfo_t & info) const;
+
+    void putChainInfo(const blockchaininfo_t & info);
+
+private:
+    mutable std::mutex chainInfoMutex;
+    bool haveChainInfo = false;
+    blockchaininfo_t chainInfo;
+};
+
+/**
+ * A BitcoinRPCFacade that answers getblockhash(), getblock(), getrawtransaction(),
+ * getrawtransactioninblock() and getblockchaininfo() from an RpcCache when it can, and fills the cache when it can't.
+ * Calls whose answer can change (gettxout(), sending transactions, etc.) are always forwarded.
+ */
+class CachingBitcoinRPCFacade : public ForwardingBitcoinRPCFacade {
+
+public:
+    /**
+     * Construct a CachingBitcoinRPCFacade
+     * @param delegate the BitcoinRPCFacade to forward cache misses to. Must outlive this object.
+     * @param cache the cache to use, possibly shared with other facades. Must outlive this object.
+     */
+    CachingBitcoinRPCFacade(const BitcoinRPCFacade & delegate, RpcCache & cache);
+
+    ~CachingBitcoinRPCFacade() override;
+
+    getrawtransaction_t getrawtransaction(const std::string& txid, int verbose) const override;
+    std::string getrawtransactioninblock(const std::string& txid, const std::string& blockhash) const override;
+    blockinfo_t getblock(const std::string& blockhash) const override;
+    std::string getblockhash(int blocknumber) const override;
+    blockchaininfo_t getblockchaininfo() const override;
+
+private:
+    RpcCache & cache;
+};
+
+
+#endif //TXREF_CACHINGBITCOINRPCFACADE_H
@@ -0,0 +1,24 @@
+#include "cachingChainSoQuery.h"
+
+CachingChainSoQuery::~CachingChainSoQuery() = default;
+
+std::string CachingChainSoQuery::getLastUpdatedTxid(
+        const std::string &txid, int utxoIndex, const std::string &network) const {
+
+    Key key(txid, utxoIndex, network);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = lastUpdatedTxids.find(key);
+        if(it != lastUpdatedTxids.end())
+            return it->second;
+    }
+
+    // not holding the lock here: this recurses through the rest of the chain
+    std::string lastTxid = queries.run(key, [&] {
+        return ChainSoQuery::getLastUpdatedTxid(txid, utxoIndex, network);
+    });
+
+    std::lock_guard<std::mutex> lock(mutex);
+    lastUpdatedTxids[key] = lastTxid;
+    return lastTxid;
+}
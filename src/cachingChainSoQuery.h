@@ -0,0 +1,47 @@
+#ifndef TXREF_CACHINGCHAINSOQUERY_H
+#define TXREF_CACHINGCHAINSOQUERY_H
+
+#include "chainSoQuery.h"
+#include "singleFlight.h"
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <tuple>
+
+/**
+ * A ChainSoQuery that remembers the tip found for every (txid, output) it has visited. Since
+ * ChainSoQuery follows a transaction chain by calling getLastUpdatedTxid() for each hop, DIDs
+ * that share part of a chain only query chain.so for that part once. Threads that need the same
+ * hop at the same time share one query for it.
+ */
+class CachingChainSoQuery : public ChainSoQuery {
+
+public:
+    ~CachingChainSoQuery() override;
+
+    /**
+     * Given a transaction id and output index, follow the chain of transactions until an unspent
+     * output is found. Return that output's txid. Results are remembered for the life of this object.
+     *
+     * @param txid The transaction id
+     * @param utxoIndex The output index
+     * @param network The network being used ("main" or "test")
+     * @return The txid for the unspent output
+     */
+    std::string
+    getLastUpdatedTxid(
+            const std::string &txid,
+            int utxoIndex,
+            const std::string & network) const override;
+
+private:
+    typedef std::tuple<std::string, int, std::string> Key;
+
+    mutable std::mutex mutex;
+    mutable std::map<Key, std::string> lastUpdatedTxids;
+    mutable SingleFlight<Key, std::string> queries;
+};
+
+
+#endif //TXREF_CACHINGCHAINSOQUERY_H
@@ -1,13 +1,17 @@
 #ifndef TXREF_CHAINQUERY_H
 #define TXREF_CHAINQUERY_H
 
+#include "amount.h"
+
 #include <string>
 
 struct UnspentData {
     std::string address;
     std::string txid;
     std::string scriptPubKeyHex;
-    int64_t amountSatoshis = 0;
+    std::string redeemScript;
+    std::string witnessScript;
+    Amount amount;
     int utxoIndex = 0;
 };
 
@@ -1,6 +1,7 @@
 #include "chainSoQuery.h"
 #include "curlWrapper.h"
-#include "satoshis.h"
+#include "amount.h"
+#include "rawTransaction.h"
 
 #include <unistd.h>
 #include <sstream>
@@ -114,7 +115,10 @@ namespace {
         unspentData.txid = tx["txid"];
         unspentData.address = address;
         unspentData.scriptPubKeyHex = tx["script_hex"];
-        unspentData.amountSatoshis = btc2satoshi(atof(tx["value"].get<std::string>().data()));
+        Result<Amount> amount = Amount::parse(tx["value"].get<std::string>());
+        if (!amount)
+            throw std::runtime_error(amount.error());
+        unspentData.amount = amount.value();
         unspentData.utxoIndex = tx["output_no"];
 
         return unspentData;
@@ -213,25 +217,37 @@ int ChainSoQuery::determineNextUtxoIndex(const std::string &nextTxid, const std:
         throw std::runtime_error(ss.str());
     }
 
-    size_t numOutputs = obj["data"]["outputs"].size();
+    int nextUtxoIndex = -1;
 
-    // create set of output #s for all non OP_RETURN scripts
-    std::set<int> outputNums;
-    for (size_t i = 0; i < numOutputs; i++) {
-        nlohmann::json output = obj["data"]["outputs"][i];
-        // only insert if this is not an OP_RETURN
-        if (output["script"].get<std::string>().find("OP_RETURN", 0) == std::string::npos)
-            outputNums.insert(output["output_no"].get<int>());
+    // look at the first opcode of each script in the serialized transaction, if there is one
+    const nlohmann::json & txHex = obj["data"]["tx_hex"];
+    Result<RawTransaction> tx = txHex.is_string() ?
+            RawTransaction::fromHex(txHex.get<std::string>()) :
+            Result<RawTransaction>::failure("no tx_hex");
+    if (tx) {
+        nextUtxoIndex = didFollowedOutput(tx.value());
+    }
+    else {
+        // otherwise fall back to the disassembled scripts, which start with the opcode's name
+        std::set<int> outputNums;
+        size_t numOutputs = obj["data"]["outputs"].size();
+        for (size_t i = 0; i < numOutputs; i++) {
+            nlohmann::json output = obj["data"]["outputs"][i];
+            if (output["script"].get<std::string>().compare(0, 9, "OP_RETURN") != 0)
+                outputNums.insert(output["output_no"].get<int>());
+        }
+        //... the first non op_return output (smallest index)
+        if (!outputNums.empty())
+            nextUtxoIndex = *outputNums.begin();
     }
 
-    if (outputNums.empty()) {
+    if (nextUtxoIndex < 0) {
         std::stringstream ss;
         ss << "Child txid: " << nextTxid << " has too few output transactions. Can't follow tip.";
         throw std::runtime_error(ss.str());
     }
 
-    //... return the index of the first non op_return output (smallest index)
-    return *std::min_element(outputNums.begin(), outputNums.end());
+    return nextUtxoIndex;
 }
 
 /**
@@ -0,0 +1,49 @@
+#include "coalescingBitcoinRPCFacade.h"
+
+#include <bitcoinapi/types.h>
+
+size_t RpcFlights::coalescedCount() const {
+    return blockHashes.coalescedCount() + blocks.coalescedCount() + rawTransactions.coalescedCount() +
+           txOuts.coalescedCount() + chainInfo.coalescedCount() + rawTransactionsInBlock.coalescedCount() +
+           blockHeaders.coalescedCount();
+}
+
+
+CoalescingBitcoinRPCFacade::CoalescingBitcoinRPCFacade(const BitcoinRPCFacade & d, RpcFlights & f)
+        : ForwardingBitcoinRPCFacade(d), flights(f) {
+}
+
+CoalescingBitcoinRPCFacade::~CoalescingBitcoinRPCFacade() = default;
+
+getrawtransaction_t CoalescingBitcoinRPCFacade::getrawtransaction(const std::string &txid, int verbose) const {
+    return flights.rawTransactions.run(std::make_pair(txid, verbose), [&] {
+        return delegate.getrawtransaction(txid, verbose);
+    });
+}
+
+blockinfo_t CoalescingBitcoinRPCFacade::getblock(const std::string &blockhash) const {
+    return flights.blocks.run(blockhash, [&] { return delegate.getblock(blockhash); });
+}
+
+std::string CoalescingBitcoinRPCFacade::getblockhash(int blocknumber) const {
+    return flights.blockHashes.run(blocknumber, [&] { return delegate.getblockhash(blocknumber); });
+}
+
+utxoinfo_t CoalescingBitcoinRPCFacade::gettxout(const std::string &txid, int n) const {
+    return flights.txOuts.run(std::make_pair(txid, n), [&] { return delegate.gettxout(txid, n); });
+}
+
+blockchaininfo_t CoalescingBitcoinRPCFacade::getblockchaininfo() const {
+    return flights.chainInfo.run(0, [&] { return delegate.getblockchaininfo(); });
+}
+
+std::string CoalescingBitcoinRPCFacade::getrawtransactioninblock(const std::string &txid,
+                                                                 const std::string &blockhash) const {
+    return flights.rawTransactionsInBlock.run(std::make_pair(txid, blockhash), [&] {
+        return delegate.getrawtransactioninblock(txid, blockhash);
+    });
+}
+
+blockheader_t CoalescingBitcoinRPCFacade::getblockheader(const std::string &blockhash) const {
+    return flights.blockHeaders.run(blockhash, [&] { return delegate.getblockheader(blockhash); });
+}
@@ -0,0 +1,59 @@
+#ifndef TXREF_COALESCINGBITCOINRPCFACADE_H
+#define TXREF_COALESCINGBITCOINRPCFACADE_H
+
+#include "forwardingBitcoinRPCFacade.h"
+#include "singleFlight.h"
+
+#include <string>
+#include <utility>
+
+/**
+ * The read-only RPC calls currently in flight, keyed by method and parameters. One RpcFlights
+ * is shared by the CoalescingBitcoinRPCFacades of all connections to the same bitcoind.
+ */
+struct RpcFlights {
+    SingleFlight<int, std::string> blockHashes;
+    SingleFlight<std::string, blockinfo_t> blocks;
+    SingleFlight<std::pair<std::string, int>, getrawtransaction_t> rawTransactions;
+    SingleFlight<std::pair<std::string, int>, utxoinfo_t> txOuts;
+    SingleFlight<int, blockchaininfo_t> chainInfo;
+    SingleFlight<std::pair<std::string, std::string>, std::string> rawTransactionsInBlock;
+    SingleFlight<std::string, blockheader_t> blockHeaders;
+
+    /**
+     * @return how many calls were answered by sharing another call, over all methods
+     */
+    size_t coalescedCount() const;
+};
+
+/**
+ * A BitcoinRPCFacade that makes identical read-only calls share one request to bitcoind when
+ * they overlap in time, typically several threads missing the same cache entry at once.
+ * Calls that change anything (creating, signing and sending transactions) are just forwarded.
+ */
+class CoalescingBitcoinRPCFacade : public ForwardingBitcoinRPCFacade {
+
+public:
+    /**
+     * Construct a CoalescingBitcoinRPCFacade
+     * @param delegate the BitcoinRPCFacade to forward calls to. Must outlive this object.
+     * @param flights the calls in flight, shared with other facades. Must outlive this object.
+     */
+    CoalescingBitcoinRPCFacade(const BitcoinRPCFacade & delegate, RpcFlights & flights);
+
+    ~CoalescingBitcoinRPCFacade() override;
+
+    getrawtransaction_t getrawtransaction(const std::string& txid, int verbose) const override;
+    blockinfo_t getblock(const std::string& blockhash) const override;
+    std::string getblockhash(int blocknumber) const override;
+    utxoinfo_t gettxout(const std::string& txid, int n) const override;
+    blockchaininfo_t getblockchaininfo() const override;
+    std::string getrawtransactioninblock(const std::string& txid, const std::string& blockhash) const override;
+    blockheader_t getblockheader(const std::string& blockhash) const override;
+
+private:
+    RpcFlights & flights;
+};
+
+
+#endif //TXREF_COALESCINGBITCOINRPCFACADE_H
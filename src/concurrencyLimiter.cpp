@@ -0,0 +1,80 @@
+#include "concurrencyLimiter.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    // weight of each new sample in the smoothed latency
+    const double LATENCY_SMOOTHING = 0.1;
+    // how much the best latency is allowed to creep up per sample, so that a lasting change
+    // in the node (or network) doesn't look like overload forever
+    const double BEST_LATENCY_DRIFT = 1.001;
+}
+
+ConcurrencyLimiter::ConcurrencyLimiter() : ConcurrencyLimiter(Options()) {
+}
+
+ConcurrencyLimiter::ConcurrencyLimiter(const Options & o)
+        : options(o), limit(std::max(o.minLimit, std::min(o.initialLimit, o.maxLimit))) {
+}
+
+void ConcurrencyLimiter::acquire() {
+    std::unique_lock<std::mutex> lock(mutex);
+    slotAvailable.wait(lock, [this] { return numInFlight < static_cast<size_t>(limit); });
+    ++numInFlight;
+}
+
+void ConcurrencyLimiter::release(std::chrono::steady_clock::duration latency, bool overloaded) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        // was this call one of a full set in flight? If not, the limit isn't what held us back,
+        // and success says nothing about whether a higher one would work
+        bool saturated = numInFlight >= static_cast<size_t>(limit);
+        --numInFlight;
+        ++callsSinceDecrease;
+
+        if(overloaded) {
+            ++numOverloaded;
+            decrease();
+        }
+        else {
+            double sample = static_cast<double>(
+                    std::chrono::duration_cast<std::chrono::microseconds>(latency).count());
+            smoothedLatency = smoothedLatency == 0.0
+                    ? sample
+                    : smoothedLatency + LATENCY_SMOOTHING * (sample - smoothedLatency);
+            bestLatency = bestLatency == 0.0
+                    ? smoothedLatency
+                    : std::min(bestLatency * BEST_LATENCY_DRIFT, smoothedLatency);
+
+            if(smoothedLatency > bestLatency * options.latencyTolerance)
+                decrease();
+            else if(saturated)
+                limit = std::min(options.maxLimit, limit + 1.0 / limit);
+        }
+    }
+    slotAvailable.notify_all();
+}
+
+void ConcurrencyLimiter::decrease() {
+    if(callsSinceDecrease < static_cast<size_t>(limit))
+        return;
+    limit = std::max(options.minLimit, std::floor(limit * options.backoffRatio));
+    callsSinceDecrease = 0;
+}
+
+size_t ConcurrencyLimiter::currentLimit() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return static_cast<size_t>(limit);
+}
+
+size_t ConcurrencyLimiter::inFlight() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return numInFlight;
+}
+
+size_t ConcurrencyLimiter::overloadCount() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return numOverloaded;
+}
@@ -0,0 +1,76 @@
+#ifndef TXREF_CONCURRENCYLIMITER_H
+#define TXREF_CONCURRENCYLIMITER_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+
+/**
+ * Limits how many RPC calls are in flight at once, adjusting the limit to what bitcoind can
+ * handle (additive increase, multiplicative decrease).
+ *
+ * bitcoind serves RPC calls with 'rpcthreads' threads and queues up to 'rpcworkqueue' more.
+ * Past that it answers HTTP 503 "Work queue depth exceeded". While calls succeed without
+ * latency growing, the limit grows by about one per limit's worth of calls. When a call is
+ * rejected as overloaded, or latency grows well past the best seen, the limit is cut (at most
+ * once per limit's worth of calls, so one burst of rejections only counts once).
+ */
+class ConcurrencyLimiter {
+
+public:
+    struct Options {
+        double initialLimit = 4;
+        double minLimit = 1;
+        double maxLimit = 64;
+        double backoffRatio = 0.5;      // multiply the limit by this when overloaded
+        double latencyTolerance = 4.0;  // latency past this multiple of the best seen means overloaded
+    };
+
+    ConcurrencyLimiter();
+    explicit ConcurrencyLimiter(const Options & options);
+
+    /**
+     * Block until another call may be started
+     */
+    void acquire();
+
+    /**
+     * Report that a call started with acquire() has finished
+     * @param latency how long the call took
+     * @param overloaded true if bitcoind rejected the call for being too busy
+     */
+    void release(std::chrono::steady_clock::duration latency, bool overloaded);
+
+    /**
+     * @return the current limit on calls in flight
+     */
+    size_t currentLimit() const;
+
+    /**
+     * @return the number of calls in flight
+     */
+    size_t inFlight() const;
+
+    /**
+     * @return how many calls have been reported as overloaded
+     */
+    size_t overloadCount() const;
+
+private:
+    void decrease();
+
+    const Options options;
+
+    mutable std::mutex mutex;
+    std::condition_variable slotAvailable;
+    double limit;
+    size_t numInFlight = 0;
+    size_t numOverloaded = 0;
+    size_t callsSinceDecrease = 0;
+    double smoothedLatency = 0.0;   // exponentially weighted average, in microseconds
+    double bestLatency = 0.0;       // lowest smoothedLatency seen (creeps up slowly)
+};
+
+
+#endif //TXREF_CONCURRENCYLIMITER_H
@@ -0,0 +1,98 @@
+#include "confirmationWatcher.h"
+
+#include <bitcoinapi/types.h>
+#include <algorithm>
+#include <stdexcept>
+
+ConfirmationWatcher::ConfirmationWatcher(const BitcoinRPCFacade & rpc, int confirmationsNeeded, int timeoutMs)
+        : btc(rpc), confirmations(confirmationsNeeded), pollTimeoutMs(timeoutMs) {
+    if(confirmationsNeeded < 1)
+        throw std::invalid_argument("At least 1 confirmation must be waited for");
+
+    blockchaininfo_t info = btc.getblockchaininfo();
+    baseHeight = scannedHeight = info.blocks;
+    scannedHashes[scannedHeight] = info.bestblockhash;
+}
+
+void ConfirmationWatcher::watch(const std::string & txid) {
+    if(mined.find(txid) == mined.end())
+        unmined.insert(txid);
+}
+
+size_t ConfirmationWatcher::pending() const {
+    return unmined.size() + mined.size();
+}
+
+std::vector<ConfirmedTransaction> ConfirmationWatcher::poll() {
+    blocktip_t tip = btc.waitforblockheight(scannedHeight + 1, pollTimeoutMs);
+    scanTo(tip.height);
+    return takeConfirmed(scannedHeight);
+}
+
+void ConfirmationWatcher::waitForAll(const std::function<void(const ConfirmedTransaction &)> & confirmed) {
+    while(pending() > 0) {
+        for(const ConfirmedTransaction & transaction : poll())
+            confirmed(transaction);
+    }
+}
+
+void ConfirmationWatcher::scanTo(int tipHeight) {
+    // step back over blocks that are no longer on the best chain; what was found in them has
+    // to be found again
+    while(scannedHeight > tipHeight || btc.getblockhash(scannedHeight) != scannedHashes[scannedHeight]) {
+        // the block the watcher started from was reorganized away as well: the chains forked
+        // below it, and the new chain has to be scanned from there
+        if(scannedHeight == baseHeight) {
+            blockinfo_t base = btc.getblock(scannedHashes[scannedHeight]);
+            baseHeight = scannedHeight - 1;
+            scannedHashes[baseHeight] = base.previousblockhash;
+        }
+        for(auto it = mined.begin(); it != mined.end(); ) {
+            if(it->second.blockHeight == scannedHeight) {
+                unmined.insert(it->first);
+                it = mined.erase(it);
+            }
+            else
+                ++it;
+        }
+        scannedHashes.erase(scannedHeight);
+        --scannedHeight;
+    }
+
+    while(scannedHeight < tipHeight) {
+        int height = scannedHeight + 1;
+        std::string hash = btc.getblockhash(height);
+        blockinfo_t block = btc.getblock(hash);
+        // the chain was reorganized since the last block scanned; the next scan steps back over it
+        if(block.previousblockhash != scannedHashes[scannedHeight])
+            break;
+
+        for(size_t i = 0; i < block.tx.size() && !unmined.empty(); ++i) {
+            if(unmined.erase(block.tx[i]) == 0)
+                continue;
+            ConfirmedTransaction & transaction = mined[block.tx[i]];
+            transaction.txid = block.tx[i];
+            transaction.blockHash = hash;
+            transaction.blockHeight = height;
+            transaction.transactionIndex = static_cast<int>(i);
+        }
+        scannedHashes[height] = hash;
+        scannedHeight = height;
+    }
+}
+
+std::vector<ConfirmedTransaction> ConfirmationWatcher::takeConfirmed(int tipHeight) {
+    std::vector<ConfirmedTransaction> confirmed;
+    for(auto it = mined.begin(); it != mined.end(); ) {
+        if(tipHeight - it->second.blockHeight + 1 >= confirmations) {
+            confirmed.push_back(it->second);
+            it = mined.erase(it);
+        }
+        else
+            ++it;
+    }
+    std::sort(confirmed.begin(), confirmed.end(), [](const ConfirmedTransaction & a, const ConfirmedTransaction & b) {
+        return a.blockHeight != b.blockHeight ? a.blockHeight < b.blockHeight : a.transactionIndex < b.transactionIndex;
+    });
+    return confirmed;
+}
@@ -0,0 +1,87 @@
+#ifndef TXREF_CONFIRMATIONWATCHER_H
+#define TXREF_CONFIRMATIONWATCHER_H
+
+#include "bitcoinRPCFacade.h"
+
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+/**
+ * Where a watched transaction was mined, once it has enough confirmations
+ */
+struct ConfirmedTransaction {
+    std::string txid;
+    std::string blockHash;
+    int blockHeight = 0;
+    int transactionIndex = 0;   // position in the block, as a txref encodes it
+};
+
+/**
+ * Waits for many transactions to confirm, from one stream of blocks. Rather than polling every
+ * transaction, it long-polls bitcoind for the next block, then looks through each new block's
+ * txids once for any of the watched transactions. Blocks that are reorganized away are
+ * scanned again from where the chains forked.
+ *
+ * Transactions are looked for only in blocks mined after the watcher was constructed, so
+ * construct it before sending them.
+ */
+class ConfirmationWatcher {
+
+public:
+    // kept under the RPC client's HTTP timeout; a block still ends the wait as soon as it arrives
+    static const int DEFAULT_POLL_TIMEOUT_MS = 5000;
+
+    /**
+     * @param btc the BitcoinRPCFacade. Must outlive this object.
+     * @param confirmations how many confirmations a transaction needs, counting the block it is in
+     * @param pollTimeoutMs how long one long-poll for a new block waits before returning
+     * @throws std::invalid_argument if fewer than 1 confirmation is asked for
+     */
+    ConfirmationWatcher(const BitcoinRPCFacade & btc, int confirmations, int pollTimeoutMs = DEFAULT_POLL_TIMEOUT_MS);
+
+    /**
+     * Start watching a transaction
+     * @param txid the transaction, as bitcoind displays it
+     */
+    void watch(const std::string & txid);
+
+    /**
+     * @return how many transactions don't have enough confirmations yet
+     */
+    size_t pending() const;
+
+    /**
+     * Wait for a new block, or until the poll timeout, and scan the blocks added since the
+     * last poll
+     * @return the transactions that reached enough confirmations
+     */
+    std::vector<ConfirmedTransaction> poll();
+
+    /**
+     * Poll until every watched transaction has enough confirmations
+     * @param confirmed called with each transaction as it gets there
+     */
+    void waitForAll(const std::function<void(const ConfirmedTransaction &)> & confirmed);
+
+private:
+    void scanTo(int tipHeight);
+    std::vector<ConfirmedTransaction> takeConfirmed(int tipHeight);
+
+    const BitcoinRPCFacade & btc;
+    const int confirmations;
+    const int pollTimeoutMs;
+
+    int baseHeight;                                     // the lowest block scanned from: the tip when the
+                                                        // watcher was constructed, unless reorganized away
+    int scannedHeight;
+    std::map<int, std::string> scannedHashes;           // by height, to notice reorganizations
+    std::set<std::string> unmined;
+    std::map<std::string, ConfirmedTransaction> mined;  // by txid, waiting for more confirmations
+};
+
+
+#endif //TXREF_CONFIRMATIONWATCHER_H
@@ -1,10 +1,20 @@
+#include "address.h"
+#include "amount.h"
 #include "bitcoinRPCFacade.h"
+#include "chainQuery.h"
+#include "confirmationWatcher.h"
+#include "didIssuance.h"
 #include "encodeOpReturnData.h"
-#include "satoshis.h"
+#include "hex.h"
+#include "privateKey.h"
+#include "transactionBuilder.h"
+#include "transactionSigner.h"
 #include "txid2txref.h"
 #include "t2tSupport.h"
 #include "anyoption.h"
 #include "libtxref.h"
+#include <algorithm>
+#include <fstream>
 #include <iostream>
 #include <cstdlib>
 #include <memory>
@@ -21,18 +31,10 @@ struct CmdlineInput {
     std::string outputAddress;
     std::string privateKey;
     std::string ddoRef;
-    double fee = 0.0;
+    Amount fee;
     bool dryrun = false;
-};
-
-struct UnspentData {
-    std::string address;
-    std::string txid;
-    std::string scriptPubKeyHex;
-    std::string redeemScript;
-    std::string witnessScript;
-    int64_t amountSatoshis = 0;
-    int utxoIndex = 0;
+    std::string outputsFile;    // batch mode: file of DID addresses and amounts ("-" for stdin)
+    int waitConfirmations = 0;  // if > 0, wait for this many confirmations and print the DIDs
 };
 
 
@@ -60,21 +62,6 @@ t2t::Transaction getTransaction(const CmdlineInput &cmdlineInput, const BitcoinR
     return transaction;
 }
 
-std::string extractWitnessScript(const btcaddressinfo_t &btcaddressinfo) {
-    if(btcaddressinfo.iswitness) {
-        return btcaddressinfo.witness_program;
-    }
-    return "";
-}
-
-std::string extractRedeemScript(const btcaddressinfo_t &btcaddressinfo) {
-    if(btcaddressinfo.isscript) {
-        if(btcaddressinfo.script == "witness_v0_keyhash")
-            return btcaddressinfo.hex;
-    }
-    return "";
-}
-
 std::string find_homedir() {
     std::string ret;
     char * home = getenv("HOME");
@@ -103,24 +90,15 @@ int convertIntegerArg(const std::string & argName, AnyOption *opt) {
     return i;
 }
 
-double convertDoubleArg(int argPosition, AnyOption *opt) {
-    double d;
-    try {
-        d = std::stod(opt->getArgv(argPosition));
-    }
-    catch(std::invalid_argument &) {
-        std::cerr << "Error: argument at position " << argPosition << " '" << opt->getArgv(argPosition)
-                  << "' is invalid. Check command line usage.\n";
+Amount convertAmountArg(int argPosition, AnyOption *opt) {
+    Result<Amount> amount = Amount::parse(opt->getArgv(argPosition));
+    if(!amount) {
+        std::cerr << "Error: argument at position " << argPosition << ": " << amount.error()
+                  << ". Check command line usage.\n";
         opt->printUsage();
         std::exit(-1);
     }
-    catch(std::out_of_range &) {
-        std::cerr << "Error: argument at position " << argPosition << " '" << opt->getArgv(argPosition)
-                  << "' is invalid. Check command line usage.\n";
-        opt->printUsage();
-        std::exit(-1);
-    }
-    return d;
+    return amount.value();
 }
 
 int parseCommandLineArgs(int argc, char **argv,
@@ -132,6 +110,7 @@ int parseCommandLineArgs(int argc, char **argv,
 
     opt->addUsage( "" );
     opt->addUsage( "Usage: createBtcrDid [options] <inputXXX> <outputAddress> <private key> <fee> <ddoRef>" );
+    opt->addUsage( "       createBtcrDid [options] --outputs <file> <inputXXX> <changeAddress> <private key> <fee> <ddoRef>" );
     opt->addUsage( "" );
     opt->addUsage( " -h  --help                 Print this help " );
     opt->addUsage( " --rpcconnect [host or IP]  RPC host (default: 127.0.0.1) " );
@@ -141,12 +120,18 @@ int parseCommandLineArgs(int argc, char **argv,
     opt->addUsage( " --config [config_path]     Full pathname to bitcoin.conf (default: <homedir>/.bitcoin/bitcoin.conf) " );
     opt->addUsage( " --txoIndex [index]         Index # of which TXO to use from the input transaction (default: 0) " );
     opt->addUsage( " -n --dryrun                Do everything except submit transaction to blockchain" );
+    opt->addUsage( " --outputs [file|-]         Batch mode: issue one DID per address and amount read from file (or stdin) " );
+    opt->addUsage( " --wait-confirmations [n]   Wait until the transaction has n confirmations, then print the txrefs and DIDs " );
     opt->addUsage( "" );
     opt->addUsage( "<inputXXX>      input: (bitcoin address, txid, txref) needs at least slightly more unspent BTCs than your offered fee" );
     opt->addUsage( "<outputAddress> output bitcoin address: will receive transaction change and be the basis for your DID" );
-    opt->addUsage( "<private key>   private key in base58 (wallet import format)" );
+    opt->addUsage( "<private key>   private key in base58 (wallet import format); signs locally and is never sent to bitcoind" );
     opt->addUsage( "<fee>           fee you are willing to pay (suggestion: >0.001 BTC)" );
     opt->addUsage( "<ddoRef>        reference to a DDO you want as part of your DID (optional)" );
+    opt->addUsage( "" );
+    opt->addUsage( "In batch mode, each line of the outputs file holds an address and an amount in BTC. Each becomes" );
+    opt->addUsage( "a DID output, in order, after the OP_RETURN, and all of them share the ddoRef. What is left of the" );
+    opt->addUsage( "input after the fee goes to <changeAddress>, which is not a DID." );
 
     opt->setFlag("help", 'h');
     opt->setFlag("dryrun", 'n');
@@ -156,6 +141,8 @@ int parseCommandLineArgs(int argc, char **argv,
     opt->setOption("rpcport");
     opt->setCommandOption("config");
     opt->setOption("txoIndex");
+    opt->setOption("outputs");
+    opt->setOption("wait-confirmations");
 
     // parse any command line arguments--this is a first pass, mainly to get a possible
     // "config" option that tells if the bitcoin.conf file is in a non-default location
@@ -233,6 +220,21 @@ int parseCommandLineArgs(int argc, char **argv,
         }
     }
 
+    // batch mode reads the DID outputs from a file or stdin
+    if (opt->getValue("outputs") != nullptr) {
+        cmdlineInput.outputsFile = opt->getValue("outputs");
+    }
+
+    // should we wait for the transaction to confirm?
+    if (opt->getValue("wait-confirmations") != nullptr) {
+        cmdlineInput.waitConfirmations = convertIntegerArg("wait-confirmations", opt.get());
+        if(cmdlineInput.waitConfirmations < 1) {
+            std::cerr << "Error: wait-confirmations '" << cmdlineInput.waitConfirmations << "' should be 1 or greater. Check command line usage.\n";
+            opt->printUsage();
+            return -1;
+        }
+    }
+
     // get the positional arguments
     if(opt->getArgc() < 4) {
         std::cerr << "Error: all required arguments not found. Check command line usage.\n";
@@ -242,7 +244,12 @@ int parseCommandLineArgs(int argc, char **argv,
     cmdlineInput.query = opt->getArgv(0);
     cmdlineInput.outputAddress = opt->getArgv(1);
     cmdlineInput.privateKey = opt->getArgv(2);
-    cmdlineInput.fee = convertDoubleArg(3, opt.get());
+    cmdlineInput.fee = convertAmountArg(3, opt.get());
+    if(cmdlineInput.fee < Amount()) {
+        std::cerr << "Error: fee '" << cmdlineInput.fee.toString() << "' should be zero or greater. Check command line usage.\n";
+        opt->printUsage();
+        return -1;
+    }
     if(opt->getArgv(4) != nullptr)
         cmdlineInput.ddoRef = opt->getArgv(4);
 
@@ -251,13 +258,26 @@ int parseCommandLineArgs(int argc, char **argv,
     return 1;
 }
 
-void printAsJson(const std::string & txid) {
+void printAsJson(const std::string & txid, const std::vector<DidOutput> & didOutputs,
+                 const std::vector<uint32_t> & txoIndexes, bool batch) {
     pt::ptree root;
 
     if(!txid.empty()) {
         root.put("comment", "transaction submitted");
         root.put("txid", txid);
-        root.put("txoIndex", 1); // TODO: always 1 for now
+        if(!batch) {
+            root.put("txoIndex", txoIndexes[0]);
+        }
+        else {
+            pt::ptree dids;
+            for(size_t i = 0; i < didOutputs.size(); ++i) {
+                pt::ptree did;
+                did.put("address", didOutputs[i].address);
+                did.put("txoIndex", txoIndexes[i]);
+                dids.push_back(std::make_pair("", did));
+            }
+            root.add_child("dids", dids);
+        }
     }
     else
         root.put("error", "the network did not accept our transaction");
@@ -265,6 +285,59 @@ void printAsJson(const std::string & txid) {
     pt::write_json(std::cout, root);
 }
 
+void printConfirmedAsJson(const ConfirmedTransaction & confirmed, const std::string & chain,
+                          const std::vector<DidOutput> & didOutputs, const std::vector<uint32_t> & txoIndexes, bool batch) {
+    pt::ptree root;
+
+    root.put("comment", "transaction confirmed");
+    root.put("txid", confirmed.txid);
+    root.put("blockHeight", confirmed.blockHeight);
+    root.put("transactionIndex", confirmed.transactionIndex);
+    pt::ptree dids;
+    for(size_t i = 0; i < txoIndexes.size(); ++i) {
+        std::string txref = t2t::encodeTxref(chain, confirmed.blockHeight, confirmed.transactionIndex,
+                                             static_cast<int>(txoIndexes[i]));
+        pt::ptree did;
+        if(batch)
+            did.put("address", didOutputs[i].address);
+        did.put("txoIndex", txoIndexes[i]);
+        did.put("txref", txref);
+        did.put("did", t2t::txref2did(txref));
+        if(batch)
+            dids.push_back(std::make_pair("", did));
+        else
+            root.insert(root.end(), did.begin(), did.end());
+    }
+    if(batch)
+        root.add_child("dids", dids);
+
+    pt::write_json(std::cout, root);
+}
+
+/**
+ * Read the DID outputs for batch mode, exiting if they can't be read
+ */
+std::vector<DidOutput> readDidOutputsFile(const std::string & path, const std::string & chain) {
+    std::ifstream file;
+    if(path != "-") {
+        file.open(path);
+        if(!file) {
+            std::cerr << "Error: outputs file " << path << " not readable.\n";
+            std::exit(-1);
+        }
+    }
+    Result<std::vector<DidOutput>> outputs = readDidOutputs(path == "-" ? std::cin : file, chain);
+    if(!outputs) {
+        std::cerr << "Error: " << path << ": " << outputs.error() << ".\n";
+        std::exit(-1);
+    }
+    if(outputs.value().empty()) {
+        std::cerr << "Error: " << path << " holds no DID outputs.\n";
+        std::exit(-1);
+    }
+    return outputs.value();
+}
+
 
 int main(int argc, char *argv[]) {
 
@@ -319,73 +392,131 @@ int main(int argc, char *argv[]) {
             std::exit(-1);
         }
 
-        assert(utxoinfo.scriptPubKey.addresses.size() == 1);
-        unspentData.address = utxoinfo.scriptPubKey.addresses[0];
-        btcaddressinfo_t btcaddressinfo = btc.getaddressinfo(unspentData.address);
-        unspentData.redeemScript = extractRedeemScript(btcaddressinfo);
-        unspentData.witnessScript = extractWitnessScript(btcaddressinfo);
-
+        if(!utxoinfo.scriptPubKey.addresses.empty())
+            unspentData.address = utxoinfo.scriptPubKey.addresses[0];
         unspentData.txid = transaction.txid;
         unspentData.utxoIndex = transaction.txoIndex;
-        unspentData.amountSatoshis = btc2satoshi(utxoinfo.value);
+        unspentData.amount = Amount::fromBtc(utxoinfo.value);
         unspentData.scriptPubKeyHex = utxoinfo.scriptPubKey.hex;
 
-        // 2. compute change needed to go to outputAddress
+        // 2. decide the DID outputs. Normally the change is the one DID output; in batch mode
+        // they are read from a file, and the change follows them.
 
-        int64_t change = unspentData.amountSatoshis - btc2satoshi(cmdlineInput.fee);
+        Result<Address> outputAddress = decodeAddress(cmdlineInput.outputAddress, blockChainInfo.chain);
+        if(!outputAddress) {
+            std::cerr << "Error: " << outputAddress.error() << ".\n";
+            std::exit(-1);
+        }
+
+        bool batch = !cmdlineInput.outputsFile.empty();
+        std::vector<DidOutput> didOutputs;
+        if(batch)
+            didOutputs = readDidOutputsFile(cmdlineInput.outputsFile, blockChainInfo.chain);
+        else
+            didOutputs.push_back(DidOutput{cmdlineInput.outputAddress, outputAddress.value().scriptPubKey, Amount()});
+
+        Amount change = unspentData.amount - cmdlineInput.fee - totalAmount(didOutputs);
+        if(change < Amount() || (!batch && change == Amount())) {
+            std::cerr << "Error: the fee of " << cmdlineInput.fee.toString() << " BTC";
+            if(batch)
+                std::cerr << " and the " << totalAmount(didOutputs).toString() << " BTC sent to DID outputs";
+            std::cerr << " leaves nothing of the " << unspentData.amount.toString() << " BTC unspent output.\n";
+            std::exit(-1);
+        }
+        if(!batch)
+            didOutputs[0].amount = change;
 
         // 3. create DID transaction and submit to network
 
-        // add input txid and tx index
-        std::vector<txout_t> inputs;
-        txout_t txout = {unspentData.txid, static_cast<unsigned int>(unspentData.utxoIndex)};
-        inputs.push_back(txout);
-
-        // add output address and the change amount
-        // TODO validate output address
-        std::map<std::string, std::string> amounts;
-
-        // first output is the output address for the change
-        amounts.insert(std::make_pair(cmdlineInput.outputAddress, btc_to_string(satoshi2btc(change)) ));
-
-        // second output is the OP_RETURN
-        std::string encoded_op_return = encodeOpReturnData(cmdlineInput.ddoRef);
-        amounts.insert(std::make_pair("data", encoded_op_return));
-
-        std::string rawTransaction = btc.createrawtransaction(inputs, amounts);
-
-        // sign with private key
-        signrawtxinext_t signrawtxin;
-        signrawtxin.txid = unspentData.txid;
-        signrawtxin.n = static_cast<unsigned int>(unspentData.utxoIndex);
-        signrawtxin.scriptPubKey = unspentData.scriptPubKeyHex;
-        signrawtxin.redeemScript = unspentData.redeemScript;
-        signrawtxin.witnessScript = unspentData.witnessScript;
-        signrawtxin.amount = btc_to_string(satoshi2btc(unspentData.amountSatoshis));
-
-        std::string signedRawTransaction =
-                btc.signrawtransactionwithkey(rawTransaction,
-                        {signrawtxin},
-                        {cmdlineInput.privateKey},
-                        "ALL");
-
-        if(signedRawTransaction.empty()) {
-            std::cerr << "Error: transaction could not be signed. Check your private key.\n";
+        Result<PrivateKey> privateKey = PrivateKey::fromWif(cmdlineInput.privateKey, blockChainInfo.chain);
+        if(!privateKey) {
+            std::cerr << "Error: " << privateKey.error() << ".\n";
             std::exit(-1);
         }
 
+        std::vector<uint8_t> opReturnData;
+        std::string encodedOpReturn = encodeOpReturnData(cmdlineInput.ddoRef);
+        if(encodedOpReturn.empty() && !cmdlineInput.ddoRef.empty()) {
+            std::cerr << "Error: ddoRef is longer than " << TransactionBuilder::MAX_OP_RETURN_SIZE << " bytes.\n";
+            std::exit(-1);
+        }
+        hex::decode(encodedOpReturn, opReturnData);
+
+        Hash256 prevTxid;
+        if(!hex::decodeHash(unspentData.txid, prevTxid.data())) {
+            std::cerr << "Error: " << unspentData.txid << " is an invalid txid.\n";
+            std::exit(-1);
+        }
+
+        // the OP_RETURN is output 0, then come the DID outputs
+        TransactionBuilder builder;
+        builder.addInput(prevTxid, static_cast<uint32_t>(unspentData.utxoIndex));
+        std::vector<uint32_t> txoIndexes = addDidOutputs(builder, opReturnData, didOutputs);
+
+        if(batch) {
+            Amount dust = TransactionBuilder::dustThreshold(outputAddress.value().scriptPubKey);
+            if(change >= dust)
+                builder.addOutput(change, outputAddress.value().scriptPubKey);
+            else if(change > Amount())
+                std::cerr << "Warning: the " << change.toString() << " BTC left over is too little for a change output, "
+                          << "and is added to the fee.\n";
+        }
+
+        // sign here rather than with signrawtransactionwithkey, so the key never goes over RPC
+        std::vector<uint8_t> spentScript;
+        hex::decode(unspentData.scriptPubKeyHex, spentScript);
+        TransactionSigner signer(builder);
+        Result<AddressType> spentType = signer.signInput(0, privateKey.value(), spentScript, unspentData.amount);
+        if(!spentType) {
+            std::cerr << "Error: " << spentType.error() << ".\n";
+            std::exit(-1);
+        }
+
+        // bitcoind won't relay a transaction that is too heavy, or pays less than 1 satoshi per vbyte
+        if(builder.weight() > TransactionBuilder::MAX_STANDARD_WEIGHT) {
+            std::cerr << "Error: the transaction is " << builder.vsize() << " vbytes, more than the "
+                      << TransactionBuilder::MAX_STANDARD_WEIGHT / 4 << " bitcoind relays. Split the outputs into smaller batches.\n";
+            std::exit(-1);
+        }
+        Amount fee = unspentData.amount;
+        for(const TxOutput & output : builder.outputs())
+            fee -= output.value;
+        size_t vsize = builder.vsize();
+        if(fee.satoshis() < static_cast<int64_t>(vsize)) {
+            std::cerr << "Error: the fee of " << fee.toString() << " BTC is less than 1 satoshi per vbyte for a "
+                      << vsize << " vbyte transaction.\n";
+            std::exit(-1);
+        }
+        std::cerr << "Fee rate: " << fee.satoshis() / static_cast<int64_t>(vsize)
+                  << " satoshis per vbyte (" << vsize << " vbytes).\n";
+
+        std::string signedRawTransaction = builder.toHex();
+
         if(cmdlineInput.dryrun) {
             std::cout << "Constructing and signing the transaction was successful, but not submitted to the Bitcoin network.\n";
         }
         else {
             std::cout << "Constructing and signing the transaction was successful. Now submitting to the Bitcoin network.\n";
+            // the watcher starts from the current tip, so it has to exist before the transaction is sent
+            std::unique_ptr<ConfirmationWatcher> watcher;
+            if(cmdlineInput.waitConfirmations > 0)
+                watcher.reset(new ConfirmationWatcher(btc, cmdlineInput.waitConfirmations));
             std::string resultTxid = btc.sendrawtransaction(signedRawTransaction);
-            std::cout << "After a few minutes you can use txid2txref with the following data to compute your txref and DID:\n";
-            printAsJson(resultTxid);
+            if(!watcher) {
+                std::cout << "After a few minutes you can use txid2txref with the following data to compute your "
+                          << (batch ? "txrefs and DIDs" : "txref and DID") << ":\n";
+                printAsJson(resultTxid, didOutputs, txoIndexes, batch);
+            }
+            else {
+                printAsJson(resultTxid, didOutputs, txoIndexes, batch);
+                std::cerr << "Waiting for " << cmdlineInput.waitConfirmations << " confirmation"
+                          << (cmdlineInput.waitConfirmations > 1 ? "s" : "") << "...\n";
+                watcher->watch(resultTxid);
+                watcher->waitForAll([&](const ConfirmedTransaction & confirmed) {
+                    printConfirmedAsJson(confirmed, blockChainInfo.chain, didOutputs, txoIndexes, batch);
+                });
+            }
         }
-
-        // TODO create a DID object and print out the DID string. Warn that it isn't valid until
-        // the transaction has enough confirmations
     }
     catch(BitcoinException &e)
     {
@@ -0,0 +1,58 @@
+#include "didIssuance.h"
+#include "address.h"
+
+#include <istream>
+#include <sstream>
+
+Result<std::vector<DidOutput>> readDidOutputs(std::istream & in, const std::string & chain) {
+    typedef Result<std::vector<DidOutput>> R;
+
+    std::vector<DidOutput> outputs;
+    std::string line;
+    size_t lineNumber = 0;
+    while(std::getline(in, line)) {
+        ++lineNumber;
+        std::string where = "Line " + std::to_string(lineNumber) + ": ";
+
+        std::istringstream iss(line);
+        std::string addressStr, amountStr, extra;
+        iss >> addressStr >> amountStr >> extra;
+        if(addressStr.empty() || addressStr[0] == '#')
+            continue;
+        if(amountStr.empty() || !extra.empty())
+            return R::failure(where + "expected an address and an amount");
+
+        Result<Address> address = decodeAddress(addressStr, chain);
+        if(!address)
+            return R::failure(where + address.error());
+        Result<Amount> amount = Amount::parse(amountStr);
+        if(!amount)
+            return R::failure(where + amount.error());
+
+        DidOutput output{addressStr, address.value().scriptPubKey, amount.value()};
+        Amount dust = TransactionBuilder::dustThreshold(output.scriptPubKey);
+        if(output.amount < dust)
+            return R::failure(where + "amount " + output.amount.toString() + " is less than the " +
+                              dust.toString() + " BTC that can be sent to " + addressStr);
+        outputs.push_back(output);
+    }
+    return R::success(outputs);
+}
+
+std::vector<uint32_t> addDidOutputs(TransactionBuilder & builder, const std::vector<uint8_t> & opReturnData,
+                                    const std::vector<DidOutput> & outputs) {
+    builder.addOpReturn(opReturnData);
+    std::vector<uint32_t> txoIndexes;
+    for(const DidOutput & output : outputs) {
+        txoIndexes.push_back(static_cast<uint32_t>(builder.outputs().size()));
+        builder.addOutput(output.amount, output.scriptPubKey);
+    }
+    return txoIndexes;
+}
+
+Amount totalAmount(const std::vector<DidOutput> & outputs) {
+    Amount total;
+    for(const DidOutput & output : outputs)
+        total += output.amount;
+    return total;
+}
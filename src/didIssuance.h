@@ -0,0 +1,50 @@
+#ifndef TXREF_DIDISSUANCE_H
+#define TXREF_DIDISSUANCE_H
+
+#include "amount.h"
+#include "result.h"
+#include "transactionBuilder.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+/**
+ * An output that a DID will follow. A BTCR DID names one output of its transaction by its
+ * txoIndex, so a transaction with many of these outputs issues many DIDs at once.
+ */
+struct DidOutput {
+    std::string address;
+    std::vector<uint8_t> scriptPubKey;
+    Amount amount;
+};
+
+/**
+ * Read the outputs for batch issuance, one per line: an address, whitespace, and an amount in
+ * BTC. Blank lines and lines starting with '#' are skipped.
+ * @param in the lines to read
+ * @param chain the chain the addresses must belong to, as getblockchaininfo names it
+ * @return the outputs in order, or why the first bad line is not valid: the address is invalid,
+ * or the amount is not a number or is too small to be relayed (dust)
+ */
+Result<std::vector<DidOutput>> readDidOutputs(std::istream & in, const std::string & chain);
+
+/**
+ * Add the outputs of a DID transaction: the OP_RETURN first, then one output per DID, in order
+ * @param builder the transaction
+ * @param opReturnData the OP_RETURN payload, which all the DIDs share
+ * @param outputs the DID outputs
+ * @return the txoIndex of each DID output
+ * @throws std::invalid_argument if the OP_RETURN payload is too long
+ */
+std::vector<uint32_t> addDidOutputs(TransactionBuilder & builder, const std::vector<uint8_t> & opReturnData,
+                                    const std::vector<DidOutput> & outputs);
+
+/**
+ * @return the total of the outputs' amounts
+ */
+Amount totalAmount(const std::vector<DidOutput> & outputs);
+
+#endif //TXREF_DIDISSUANCE_H
@@ -0,0 +1,333 @@
+#include "bitcoinRPCFacade.h"
+#include "issuanceService.h"
+#include "utxoPool.h"
+#include "anyoption.h"
+
+#include <bitcoinapi/bitcoinapi.h>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+struct CmdlineInput {
+    std::string privateKey;
+    std::string inputFile = "-";    // file to read requests from ("-" for stdin)
+    int jobs = 4;
+    int split = 0;                  // split the largest coin into this many before issuing
+    int maxChain = UtxoPool::DEFAULT_MAX_CHAIN_LENGTH;
+    int refreshSeconds = 60;
+    IssuanceOptions issuanceOptions;
+};
+
+
+std::string find_homedir() {
+    std::string ret;
+    char * home = getenv("HOME");
+    if(home != nullptr)
+        ret.append(home);
+    return ret;
+}
+
+int convertIntegerArg(const std::string & argName, AnyOption *opt) {
+    int i;
+    try {
+        i = std::stoi(opt->getValue(argName.c_str()));
+    }
+    catch(std::invalid_argument &) {
+        std::cerr << "Error: " << argName << " '" << opt->getValue(argName.c_str())
+                  << "' is invalid. Check command line usage.\n";
+        opt->printUsage();
+        std::exit(-1);
+    }
+    catch(std::out_of_range &) {
+        std::cerr << "Error: " << argName << " '" << opt->getValue(argName.c_str())
+                  << "' is invalid. Check command line usage.\n";
+        opt->printUsage();
+        std::exit(-1);
+    }
+    return i;
+}
+
+int parseCommandLineArgs(int argc, char **argv,
+                         struct RpcConfig &rpcConfig,
+                         struct CmdlineInput &cmdlineInput) {
+
+    auto opt = std::unique_ptr<AnyOption>(new AnyOption());
+    opt->setFileDelimiterChar('=');
+
+    opt->addUsage( "" );
+    opt->addUsage( "Usage: didIssuer [options] <private key>" );
+    opt->addUsage( "" );
+    opt->addUsage( " -h  --help                 Print this help " );
+    opt->addUsage( " --rpcconnect [host or IP]  RPC host (default: 127.0.0.1) " );
+    opt->addUsage( " --rpcuser [user]           RPC user " );
+    opt->addUsage( " --rpcpassword [pass]       RPC password " );
+    opt->addUsage( " --rpcport [port]           RPC port (default: try both 8332 and 18332) " );
+    opt->addUsage( " --config [config_path]     Full pathname to bitcoin.conf (default: <homedir>/.bitcoin/bitcoin.conf) " );
+    opt->addUsage( " --input [file|-]           Read requests from file (default: stdin) " );
+    opt->addUsage( " --jobs [#]                 Number of DIDs issued at once, each over its own RPC connection " );
+    opt->addUsage( "                            (default: 4) " );
+    opt->addUsage( " --did-amount [BTC]         Amount sent to each DID's address (default: 0.00001) " );
+    opt->addUsage( " --fee-rate [#]             Fee rate in satoshis per vbyte (default: 2) " );
+    opt->addUsage( " --split [#]                Before issuing, split the largest coin into this many coins, " );
+    opt->addUsage( "                            each enough for one DID " );
+    opt->addUsage( " --max-chain [#]            Most unconfirmed transactions a DID transaction may hang from " );
+    opt->addUsage( "                            (default: 25, bitcoind's -limitancestorcount) " );
+    opt->addUsage( " --refresh [seconds]        How often to look for newly confirmed coins (default: 60) " );
+    opt->addUsage( "" );
+    opt->addUsage( "<private key>               private key in base58 (wallet import format) that the funding coins pay" );
+    opt->addUsage( "                            to; signs locally and is never sent to bitcoind" );
+    opt->addUsage( "" );
+    opt->addUsage( "Each input line holds an address, optionally followed by a ddoRef. Each is issued a DID in a" );
+    opt->addUsage( "transaction of its own, funded from the key's coins, and a line of JSON is written with its" );
+    opt->addUsage( "txid and txoIndex. Change goes back to the key and funds later DIDs before it confirms." );
+
+    opt->setFlag("help", 'h');
+    opt->setOption("rpcconnect");
+    opt->setOption("rpcuser");
+    opt->setOption("rpcpassword");
+    opt->setOption("rpcport");
+    opt->setCommandOption("config");
+    opt->setOption("input");
+    opt->setOption("jobs");
+    opt->setOption("did-amount");
+    opt->setOption("fee-rate");
+    opt->setOption("split");
+    opt->setOption("max-chain");
+    opt->setOption("refresh");
+
+    // parse any command line arguments--this is a first pass, mainly to get a possible
+    // "config" option that tells if the bitcoin.conf file is in a non-default location
+    opt->processCommandArgs( argc, argv );
+
+    // print usage if no options
+    if( ! opt->hasOptions()) {
+        opt->printUsage();
+        return 0;
+    }
+
+    // see if there is a bitcoin.conf file to parse. If not, continue.
+    if (opt->getValue("config") != nullptr) {
+        opt->processFile(opt->getValue("config"));
+    }
+    else {
+        std::string home = find_homedir();
+        if(!home.empty()) {
+            std::string configPath = home + "/.bitcoin/bitcoin.conf";
+            if(!opt->processFile(configPath.data())) {
+                std::cerr << "Warning: Config file " << configPath
+                          << " not readable. Perhaps try --config? Attempting to continue...\n";
+            }
+        }
+    }
+
+    // parse command line arguments AGAIN--this is because command line args should override config file
+    opt->processCommandArgs( argc, argv );
+
+
+    // print usage if help was requested
+    if (opt->getFlag("help") || opt->getFlag('h')) {
+        opt->printUsage();
+        return 0;
+    }
+
+    // see if there is an rpcconnect specified. If not, use default
+    if (opt->getValue("rpcconnect") != nullptr) {
+        rpcConfig.rpcconnect = opt->getValue("rpcconnect");
+    }
+
+    // see if there is an rpcuser specified. If not, exit
+    if (opt->getValue("rpcuser") == nullptr) {
+        std::cerr << "Error: 'rpcuser' not found. Check bitcoin.conf or command line usage.\n";
+        opt->printUsage();
+        return -1;
+    }
+    rpcConfig.rpcuser = opt->getValue("rpcuser");
+
+    // see if there is an rpcpassword specified. If not, exit
+    if (opt->getValue("rpcpassword") == nullptr) {
+        std::cerr << "Error: 'rpcpassword' not found. Check bitcoin.conf or command line usage.\n";
+        opt->printUsage();
+        return -1;
+    }
+    rpcConfig.rpcpassword = opt->getValue("rpcpassword");
+
+    // will try both well known ports (8332 and 18332) if one is not specified
+    if (opt->getValue("rpcport") != nullptr) {
+        rpcConfig.rpcport = convertIntegerArg("rpcport", opt.get());
+    }
+
+    if (opt->getValue("input") != nullptr) {
+        cmdlineInput.inputFile = opt->getValue("input");
+    }
+
+    if (opt->getValue("jobs") != nullptr) {
+        cmdlineInput.jobs = convertIntegerArg("jobs", opt.get());
+        if(cmdlineInput.jobs < 1) {
+            std::cerr << "Error: jobs '" << cmdlineInput.jobs << "' should be one or greater. Check command line usage.\n";
+            opt->printUsage();
+            return -1;
+        }
+    }
+
+    if (opt->getValue("did-amount") != nullptr) {
+        Result<Amount> didAmount = Amount::parse(opt->getValue("did-amount"));
+        if(!didAmount || didAmount.value() <= Amount()) {
+            std::cerr << "Error: did-amount '" << opt->getValue("did-amount")
+                      << "' should be an amount of BTC greater than zero. Check command line usage.\n";
+            opt->printUsage();
+            return -1;
+        }
+        cmdlineInput.issuanceOptions.didAmount = didAmount.value();
+    }
+
+    if (opt->getValue("fee-rate") != nullptr) {
+        cmdlineInput.issuanceOptions.feeRate = convertIntegerArg("fee-rate", opt.get());
+        if(cmdlineInput.issuanceOptions.feeRate < 1) {
+            std::cerr << "Error: fee-rate '" << cmdlineInput.issuanceOptions.feeRate << "' should be one or greater. Check command line usage.\n";
+            opt->printUsage();
+            return -1;
+        }
+    }
+
+    if (opt->getValue("split") != nullptr) {
+        cmdlineInput.split = convertIntegerArg("split", opt.get());
+        if(cmdlineInput.split < 1) {
+            std::cerr << "Error: split '" << cmdlineInput.split << "' should be one or greater. Check command line usage.\n";
+            opt->printUsage();
+            return -1;
+        }
+    }
+
+    if (opt->getValue("max-chain") != nullptr) {
+        cmdlineInput.maxChain = convertIntegerArg("max-chain", opt.get());
+        if(cmdlineInput.maxChain < 1) {
+            std::cerr << "Error: max-chain '" << cmdlineInput.maxChain << "' should be one or greater. Check command line usage.\n";
+            opt->printUsage();
+            return -1;
+        }
+    }
+
+    if (opt->getValue("refresh") != nullptr) {
+        cmdlineInput.refreshSeconds = convertIntegerArg("refresh", opt.get());
+        if(cmdlineInput.refreshSeconds < 1) {
+            std::cerr << "Error: refresh '" << cmdlineInput.refreshSeconds << "' should be one or greater. Check command line usage.\n";
+            opt->printUsage();
+            return -1;
+        }
+    }
+
+    if(opt->getArgc() < 1) {
+        std::cerr << "Error: private key not found. Check command line usage.\n";
+        opt->printUsage();
+        return -1;
+    }
+    cmdlineInput.privateKey = opt->getArgv(0);
+
+    return 1;
+}
+
+int main(int argc, char *argv[]) {
+
+    struct RpcConfig rpcConfig;
+    struct CmdlineInput cmdlineInput;
+
+    int ret = parseCommandLineArgs(argc, argv, rpcConfig, cmdlineInput);
+    if(ret < 1) {
+        std::exit(ret);
+    }
+
+    std::ifstream inputFile;
+    if(cmdlineInput.inputFile != "-") {
+        inputFile.open(cmdlineInput.inputFile);
+        if(!inputFile) {
+            std::cerr << "Error: input file " << cmdlineInput.inputFile << " not readable.\n";
+            std::exit(-1);
+        }
+    }
+    std::istream & in = cmdlineInput.inputFile == "-" ? std::cin : inputFile;
+
+    try {
+        BitcoinRPCFacade btc(rpcConfig);
+        blockchaininfo_t blockChainInfo = btc.getblockchaininfo();
+
+        Result<PrivateKey> privateKey = PrivateKey::fromWif(cmdlineInput.privateKey, blockChainInfo.chain);
+        if(!privateKey) {
+            std::cerr << "Error: " << privateKey.error() << ".\n";
+            std::exit(-1);
+        }
+
+        UtxoPool pool(cmdlineInput.maxChain);
+        IssuanceService service(privateKey.value(), blockChainInfo.chain, pool, cmdlineInput.issuanceOptions);
+
+        size_t numCoins = service.refresh(btc);
+        std::cerr << "Found " << numCoins << " coins worth " << pool.total().toString() << " BTC.\n";
+
+        if(cmdlineInput.split > 0) {
+            Result<std::string> txid = service.split(btc, static_cast<size_t>(cmdlineInput.split));
+            if(!txid) {
+                std::cerr << "Error: " << txid.error() << ".\n";
+                std::exit(-1);
+            }
+            std::cerr << "Split a coin into coins of " << service.coinSize().toString() << " BTC in transaction "
+                      << txid.value() << "; the pool now holds " << pool.size() << " coins.\n";
+        }
+
+        // look for newly confirmed coins in the background, so the pool can chain from them again
+        std::mutex refreshMutex;
+        std::condition_variable refreshStop;
+        bool done = false;
+        std::thread refresher([&] {
+            std::unique_lock<std::mutex> lock(refreshMutex);
+            while(!refreshStop.wait_for(lock, std::chrono::seconds(cmdlineInput.refreshSeconds), [&] { return done; })) {
+                try {
+                    service.refresh(btc);
+                }
+                catch(BitcoinException &e) {
+                    std::cerr << "Warning: refreshing the coins failed: " << e.getCode() << " " << e.getMessage() << std::endl;
+                }
+                catch(std::runtime_error &e) {
+                    std::cerr << "Warning: refreshing the coins failed: " << e.what() << std::endl;
+                }
+            }
+        });
+
+        size_t numErrors = service.serve(in, std::cout,
+                [&rpcConfig] { return std::unique_ptr<BitcoinRPCFacade>(new BitcoinRPCFacade(rpcConfig)); },
+                static_cast<size_t>(cmdlineInput.jobs));
+
+        {
+            std::lock_guard<std::mutex> lock(refreshMutex);
+            done = true;
+        }
+        refreshStop.notify_all();
+        refresher.join();
+
+        if(numErrors > 0) {
+            std::cerr << numErrors << " requests failed.\n";
+            std::exit(-1);
+        }
+    }
+    catch(BitcoinException &e)
+    {
+        std::cerr << "Error: " << e.getCode() << " " << e.getMessage() << std::endl;
+        std::exit(-1);
+    }
+    catch(std::runtime_error &e)
+    {
+        std::cerr << "Error: " << e.what() << std::endl;
+        std::exit(-1);
+    }
+    catch(std::invalid_argument &e)
+    {
+        std::cerr << "Error: " << e.what() << ".\n";
+        std::exit(-1);
+    }
+
+    return 0;
+}
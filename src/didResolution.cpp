@@ -0,0 +1,93 @@
+#include "didResolution.h"
+#include "domain/did.h"
+#include "rawTransaction.h"
+
+#include <bitcoinapi/bitcoinapi.h>
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+    /**
+     * @return the mempool transaction spending the output a DID follows out of 'tipTxid' (its
+     * first output that isn't an OP_RETURN), or "" if there is none
+     */
+    std::string pendingSpend(const BitcoinRPCFacade & btc, const MempoolSpends & mempool, const std::string & tipTxid) {
+        Result<RawTransaction> tx = RawTransaction::fromHex(btc.getrawtransaction(tipTxid, 0).hex);
+        if(!tx)
+            return "";
+        int followed = didFollowedOutput(tx.value());
+        if(followed < 0)
+            return "";
+        return mempool.spender(btc, tipTxid, followed);
+    }
+}
+
+DidResolution resolveDid(const std::string & didStr, const BitcoinRPCFacade & btc, const ChainQuery & chainQuery,
+                         const MempoolSpends * mempool) {
+
+    DidResolution resolution;
+    resolution.did = didStr;
+
+    try {
+        Result<Did> did = Did::tryCreate(didStr, btc);
+        if(!did) {
+            resolution.error = did.error();
+            return resolution;
+        }
+
+        const Txref & txref = did.value().getTxref();
+        const Txid & txid = txref.getTxid();
+
+        resolution.txref = txref.asString();
+        resolution.txid = txid.asString();
+        resolution.blockHeight = txid.blockHeight().value();
+        resolution.transactionIndex = txid.transactionIndex().value();
+        resolution.txoIndex = txref.getVout().value();
+        resolution.network = txid.isTestnet() ? "test" : "main";
+
+        // Is txo at txoIndex unspent?
+
+        utxoinfo_t utxoinfo = btc.gettxout(resolution.txid, resolution.txoIndex);
+
+        // TODO hmm, if btc.gettxout() returns anything, then it is unspent. If it returns nothing,
+        // that means it is spent, or possibly an op_return output
+
+        if(!utxoinfo.bestblock.empty() && utxoinfo.confirmations != 0) {
+            // yes: this is the latest version of the DID. From this we can construct the DID Document.
+            // gettxout looks in the mempool too, so no update is pending either.
+            resolution.tipTxid = resolution.txid;
+        }
+        else {
+            // perhaps it was spent by an update still in the mempool. Then the DID's own transaction
+            // is the latest confirmed version, and there is no chain to follow yet.
+            if(mempool != nullptr)
+                resolution.pendingTxid = mempool->spender(btc, resolution.txid, resolution.txoIndex);
+
+            if(!resolution.pendingTxid.empty()) {
+                resolution.tipTxid = resolution.txid;
+            }
+            else {
+                // no : recursively follow transaction chain until txo  with an unspent output is found
+                resolution.tipTxid =
+                        chainQuery.getLastUpdatedTxid(resolution.txid, resolution.txoIndex, resolution.network);
+                if(mempool != nullptr && resolution.tipTxid != resolution.txid)
+                    resolution.pendingTxid = pendingSpend(btc, *mempool, resolution.tipTxid);
+            }
+        }
+        resolution.mempoolChecked = mempool != nullptr;
+
+        resolution.ok = true;
+    }
+    catch(BitcoinException &e) {
+        std::stringstream ss;
+        ss << e.getCode() << " " << e.getMessage();
+        resolution.error = ss.str();
+    }
+    catch(std::exception &e) {
+        resolution.error = e.what();
+    }
+
+    return resolution;
+}
@@ -0,0 +1,47 @@
+#ifndef TXREF_DIDRESOLUTION_H
+#define TXREF_DIDRESOLUTION_H
+
+#include "bitcoinRPCFacade.h"
+#include "chainQuery.h"
+#include "mempoolSpends.h"
+
+#include <string>
+
+/**
+ * What was learned while resolving a DID: its txref, the transaction it encodes, and the
+ * last transaction in its chain that still has an unspent output (the "tip")
+ */
+struct DidResolution {
+    std::string did;
+    bool ok = false;
+    std::string error;          // set when ok is false
+
+    std::string txref;
+    std::string txid;
+    int blockHeight = 0;
+    int transactionIndex = 0;
+    int txoIndex = 0;
+    std::string network;        // "main" or "test"
+    std::string tipTxid;        // last txid with an unspent output
+    bool mempoolChecked = false;
+    std::string pendingTxid;    // an unconfirmed transaction spending the tip, if the mempool was checked
+};
+
+/**
+ * Resolve a DID: validate it against bitcoind, then follow its transaction chain to the tip.
+ * Errors are captured in the returned DidResolution instead of being thrown.
+ *
+ * If a MempoolSpends is given, the mempool is checked for a transaction spending the tip: a
+ * pending update. When the DID's own output is spent by one, the chain isn't followed at all.
+ *
+ * @param did the DID string (ex: did:btcr:xz4h-jzcl-rqpq-qjqxf09)
+ * @param btc the BitcoinRPCFacade
+ * @param chainQuery used to follow the chain when the DID's output has been spent
+ * @param mempool if not null, used to look for a pending update
+ * @return the DidResolution
+ */
+DidResolution resolveDid(const std::string & did, const BitcoinRPCFacade & btc, const ChainQuery & chainQuery,
+                         const MempoolSpends * mempool = nullptr);
+
+
+#endif //TXREF_DIDRESOLUTION_H
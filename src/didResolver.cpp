@@ -1,13 +1,26 @@
 #include "bitcoinRPCFacade.h"
 #include "chainQuery.h"
 #include "chainSoQuery.h"
+#include "cachingBitcoinRPCFacade.h"
+#include "cachingChainSoQuery.h"
+#include "didResolution.h"
+#include "mempoolSpends.h"
+#include "proofBundle.h"
+#include "proofStoreBitcoinRPCFacade.h"
+#include "bulkDidResolver.h"
+#include "resolutionEngine.h"
 #include "anyoption.h"
-#include "domain/did.h"
+#include <algorithm>
 #include <iostream>
+#include <fstream>
 #include <cstdlib>
 #include <memory>
+#include <sstream>
 #include <stdexcept>
+#include <vector>
 #include <bitcoinapi/bitcoinapi.h>
+#include <curl/curl.h>
+#include "json.hpp"
 
 
 struct TransactionData {
@@ -17,6 +30,11 @@ struct TransactionData {
     std::string ddoRef;
     double fee = 0.0;
     int txoIndex = 0;
+    std::string inputFile;
+    int jobs = 1;
+    std::string mempool;    // how to look for pending updates: "rpc", "snapshot", or "" not to
+    std::string proofStore; // directory of proofs for pruned blocks, or "" for a node that doesn't prune
+    std::string proofBundle; // file to write the resolved DID's proofs to, or "" not to
 };
 
 
@@ -63,6 +81,7 @@ int parseCommandLineArgs(int argc, char **argv,
 
     opt->addUsage( "" );
     opt->addUsage( "Usage: didResolver [options] <did>" );
+    opt->addUsage( "       didResolver [options] --input <file|->" );
     opt->addUsage( "" );
     opt->addUsage( " -h  --help                 Print this help " );
     opt->addUsage( " --rpcconnect [hostname or IP]  RPC host (default: 127.0.0.1) " );
@@ -70,6 +89,17 @@ int parseCommandLineArgs(int argc, char **argv,
     opt->addUsage( " --rpcpassword [pass]       RPC password " );
     opt->addUsage( " --rpcport [port]           RPC port (default: try both 8332 and 18332) " );
     opt->addUsage( " --config [config_path]     Full pathname to bitcoin.conf (default: <homedir>/.bitcoin/bitcoin.conf) " );
+    opt->addUsage( " --input [file|-]           Bulk mode: read DIDs from file (or stdin), one per line, and " );
+    opt->addUsage( "                            write one JSON result per line " );
+    opt->addUsage( " --jobs [#]                 Bulk mode: number of resolver threads, each with its own " );
+    opt->addUsage( "                            RPC connection (default: 1) " );
+    opt->addUsage( " --mempool [rpc|snapshot]   Report updates still in the mempool: ask bitcoind about each DID " );
+    opt->addUsage( "                            (rpc, needs bitcoind 24+), or index the whole mempool up front " );
+    opt->addUsage( "                            (snapshot, cheaper for many DIDs) " );
+    opt->addUsage( " --proof-store [dir]        For a pruned bitcoind: keep each resolved DID's transaction and " );
+    opt->addUsage( "                            its proof of inclusion in dir, and use them once its block is pruned " );
+    opt->addUsage( " --proof-bundle [file]      Write what didVerifier needs to check the DID offline to file " );
+    opt->addUsage( "                            (not in bulk mode; bitcoind needs -txindex) " );
     opt->addUsage( "" );
     opt->addUsage( "<did>                       the BTCR DID to resolve. Could be txref or txref-ext based" );
 
@@ -79,6 +109,11 @@ int parseCommandLineArgs(int argc, char **argv,
     opt->setOption("rpcpassword");
     opt->setOption("rpcport");
     opt->setCommandOption("config");
+    opt->setCommandOption("input");
+    opt->setOption("jobs");
+    opt->setOption("mempool");
+    opt->setOption("proof-store");
+    opt->setOption("proof-bundle");
 
     // "secret" testing flags
     opt->setFlag("exitAfterFollowTip", 'f');
@@ -146,12 +181,49 @@ int parseCommandLineArgs(int argc, char **argv,
         rpcConfig.rpcport = convertIntegerArg("rpcport", opt.get());
     }
 
+    if (opt->getValue("jobs") != nullptr) {
+        transactionData.jobs = convertIntegerArg("jobs", opt.get());
+        if(transactionData.jobs < 1) {
+            std::cerr << "Error: jobs '" << transactionData.jobs << "' should be one or greater. Check command line usage.\n";
+            opt->printUsage();
+            return -1;
+        }
+    }
+
+    if (opt->getValue("mempool") != nullptr) {
+        transactionData.mempool = opt->getValue("mempool");
+        if(transactionData.mempool != "rpc" && transactionData.mempool != "snapshot") {
+            std::cerr << "Error: mempool '" << transactionData.mempool << "' should be 'rpc' or 'snapshot'. Check command line usage.\n";
+            opt->printUsage();
+            return -1;
+        }
+    }
+
+    if (opt->getValue("proof-store") != nullptr) {
+        transactionData.proofStore = opt->getValue("proof-store");
+    }
+
+    if (opt->getValue("proof-bundle") != nullptr) {
+        transactionData.proofBundle = opt->getValue("proof-bundle");
+        if(opt->getValue("input") != nullptr) {
+            std::cerr << "Error: proof-bundle is for a single DID, not bulk mode. Check command line usage.\n";
+            opt->printUsage();
+            return -1;
+        }
+    }
+
     // check for some "secret" arguments that are used to test some operations
     if (opt->getFlag("exitAfterFollowTip") || opt->getFlag('f')) {
         testing::exitAfterFollowTip = true;
     }
 
 
+    // in bulk mode, the DIDs come from the input file instead of the command line
+    if (opt->getValue("input") != nullptr) {
+        transactionData.inputFile = opt->getValue("input");
+        return 1;
+    }
+
     // get the positional arguments
     if(opt->getArgc() < 1) {
         std::cerr << "Error: all required arguments not found. Check command line usage." << std::endl;
@@ -167,6 +239,196 @@ int parseCommandLineArgs(int argc, char **argv,
 }
 
 
+/**
+ * Make what resolution uses to look for pending updates
+ *
+ * @param btc the BitcoinRPCFacade, used to take a snapshot
+ * @param mode "rpc", "snapshot", or "" not to look
+ * @return the MempoolSpends, or null if the mempool isn't to be checked
+ */
+std::unique_ptr<MempoolSpends> makeMempoolSpends(const BitcoinRPCFacade & btc, const std::string & mode) {
+    if(mode == "rpc")
+        return std::unique_ptr<MempoolSpends>(new RpcMempoolSpends());
+    if(mode == "snapshot") {
+        std::unique_ptr<MempoolSnapshot> snapshot(new MempoolSnapshot(MempoolSnapshot::take(btc)));
+        std::cerr << "Mempool snapshot: " << snapshot->size() << " outputs spent by unconfirmed transactions" << std::endl;
+        return std::unique_ptr<MempoolSpends>(snapshot.release());
+    }
+    return nullptr;
+}
+
+/**
+ * Keep the transactions of resolved DIDs in the proof store, while bitcoind still has their
+ * blocks. DIDs whose transactions are already kept cost nothing.
+ *
+ * @param store the proof store
+ * @param btc the BitcoinRPCFacade
+ * @param resolutions the resolved DIDs
+ */
+void keepProofs(ProofStore & store, const BitcoinRPCFacade & btc, const std::vector<DidResolution> & resolutions) {
+    size_t kept = 0;
+    for(const DidResolution & resolution : resolutions) {
+        if(!resolution.ok)
+            continue;
+        try {
+            if(store.keepFrom(btc, resolution.txid, resolution.blockHeight))
+                ++kept;
+        }
+        catch(BitcoinException &e) {
+            std::cerr << "Warning: could not keep the proof for " << resolution.did << ": "
+                      << e.getCode() << " " << e.getMessage() << std::endl;
+        }
+    }
+    std::cerr << "Proof store: " << kept << " transactions added, " << store.size() << " kept" << std::endl;
+}
+
+/**
+ * Resolve every DID in the given file (or stdin, if "-"), writing one line of JSON per DID
+ *
+ * @param rpcConfig how to connect to bitcoind
+ * @param inputFile the file name, or "-" for stdin
+ * @param jobs the number of resolver threads
+ * @param mempoolMode how to look for pending updates (see makeMempoolSpends())
+ * @param proofStore if not null, used for blocks bitcoind has pruned, and given the proofs of newly resolved DIDs
+ * @return the process exit code
+ */
+int runBulk(const RpcConfig & rpcConfig, const std::string & inputFile, int jobs, const std::string & mempoolMode,
+            ProofStore * proofStore) {
+
+    std::ifstream file;
+    if(inputFile != "-") {
+        file.open(inputFile);
+        if(!file) {
+            std::cerr << "Error: could not open input file '" << inputFile << "'." << std::endl;
+            return -1;
+        }
+    }
+    std::istream & in = inputFile == "-" ? std::cin : file;
+
+    std::vector<std::string> dids;
+    std::string line;
+    while(std::getline(in, line)) {
+        std::istringstream iss(line);
+        std::string did;
+        if(iss >> did)
+            dids.push_back(did);
+    }
+
+    // chain.so is queried from several threads at once, so curl has to be set up beforehand
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+
+    RpcCache cache;
+    CachingChainSoQuery chainQuery;
+    std::vector<DidResolution> resolutions;
+    std::unique_ptr<MempoolSpends> mempool;
+    if(!mempoolMode.empty())
+        mempool = makeMempoolSpends(BitcoinRPCFacade(rpcConfig), mempoolMode);
+
+    if(jobs > 1) {
+        // let the number of RPC calls in flight find its own level, up to one per thread
+        ConcurrencyLimiter::Options limiterOptions;
+        limiterOptions.initialLimit = std::min(limiterOptions.initialLimit, static_cast<double>(jobs));
+        limiterOptions.maxLimit = jobs;
+        ConcurrencyLimiter limiter(limiterOptions);
+
+        // each worker's connection, under its proof store layer if there is one
+        std::vector<std::unique_ptr<BitcoinRPCFacade>> connections;
+        ResolutionEngine engine(
+                [&rpcConfig, &connections, proofStore] {
+                    std::unique_ptr<BitcoinRPCFacade> connection(new BitcoinRPCFacade(rpcConfig));
+                    if(proofStore == nullptr)
+                        return connection;
+                    connections.push_back(std::move(connection));
+                    return std::unique_ptr<BitcoinRPCFacade>(new ProofStoreBitcoinRPCFacade(*connections.back(), *proofStore));
+                },
+                cache, chainQuery, static_cast<size_t>(jobs), &limiter, mempool.get());
+        resolutions = engine.resolve(dids);
+
+        std::cerr << "RPC concurrency limit: " << limiter.currentLimit() << " ("
+                  << limiter.overloadCount() << " calls rejected by bitcoind as overloaded, "
+                  << engine.coalescedCount() << " calls shared between threads)" << std::endl;
+
+        if(proofStore != nullptr) {
+            BitcoinRPCFacade btc(rpcConfig);
+            CachingBitcoinRPCFacade cachingBtc(btc, cache);
+            keepProofs(*proofStore, cachingBtc, resolutions);
+        }
+    }
+    else {
+        // one connection resolves while the other prefetches the next block into the shared cache
+        BitcoinRPCFacade btc(rpcConfig);
+        BitcoinRPCFacade prefetchBtc(rpcConfig);
+        std::unique_ptr<BitcoinRPCFacade> storeBtc, storePrefetchBtc;
+        if(proofStore != nullptr) {
+            storeBtc.reset(new ProofStoreBitcoinRPCFacade(btc, *proofStore));
+            storePrefetchBtc.reset(new ProofStoreBitcoinRPCFacade(prefetchBtc, *proofStore));
+        }
+        CachingBitcoinRPCFacade cachingBtc(storeBtc ? *storeBtc : btc, cache);
+        CachingBitcoinRPCFacade cachingPrefetchBtc(storePrefetchBtc ? *storePrefetchBtc : prefetchBtc, cache);
+
+        BulkDidResolver resolver(cachingBtc, cachingPrefetchBtc, chainQuery, mempool.get());
+        resolutions = resolver.resolve(dids);
+
+        if(proofStore != nullptr)
+            keepProofs(*proofStore, cachingBtc, resolutions);
+    }
+
+    size_t numErrors = 0;
+    for(const DidResolution & resolution : resolutions) {
+        nlohmann::json record;
+        record["did"] = resolution.did;
+        if(resolution.ok) {
+            record["txref"] = resolution.txref;
+            record["txid"] = resolution.txid;
+            record["network"] = resolution.network;
+            record["block-height"] = resolution.blockHeight;
+            record["transaction-index"] = resolution.transactionIndex;
+            record["txo-index"] = resolution.txoIndex;
+            record["last-txid"] = resolution.tipTxid;
+            if(resolution.mempoolChecked) {
+                if(resolution.pendingTxid.empty())
+                    record["pending-txid"] = nullptr;
+                else
+                    record["pending-txid"] = resolution.pendingTxid;
+            }
+        }
+        else {
+            record["error"] = resolution.error;
+            ++numErrors;
+        }
+        std::cout << record.dump() << "\n";
+    }
+
+    if(numErrors > 0) {
+        std::cerr << "Warning: " << numErrors << " DIDs could not be resolved." << std::endl;
+    }
+    return 0;
+}
+
+
+/**
+ * Write the proofs of a resolved DID's chain, for didVerifier to check without a bitcoin node
+ * @param path the file to write
+ * @param btc the BitcoinRPCFacade
+ * @param resolution the DID's resolution
+ * @throws std::runtime_error if the bundle can't be built or written
+ */
+void writeProofBundle(const std::string & path, const BitcoinRPCFacade & btc, const DidResolution & resolution) {
+    Result<ProofBundle> bundle = ProofBundle::build(btc, resolution.did, resolution.tipTxid);
+    if(!bundle)
+        throw std::runtime_error("Error: could not build the proof bundle: " + bundle.error());
+
+    std::vector<uint8_t> bytes = bundle.value().serialize();
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char *>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    file.close();
+    if(!file)
+        throw std::runtime_error("Error: could not write proof bundle file '" + path + "'.");
+    std::cout << "Proof bundle written to " << path << ": " << bundle.value().numTransactions()
+              << " transactions, " << bundle.value().numHeaders() << " headers, " << bytes.size() << " bytes\n";
+}
+
+
 int main(int argc, char *argv[]) {
 
     struct RpcConfig rpcConfig;
@@ -179,46 +441,50 @@ int main(int argc, char *argv[]) {
 
     try {
 
-        BitcoinRPCFacade btc(rpcConfig);
+        std::unique_ptr<ProofStore> proofStore;
+        if(!transactionData.proofStore.empty())
+            proofStore.reset(new ProofStore(transactionData.proofStore));
 
-        // create Did
-        Did did(transactionData.inputString, btc);
+        if(!transactionData.inputFile.empty()) {
+            std::exit(runBulk(rpcConfig, transactionData.inputFile, transactionData.jobs, transactionData.mempool,
+                              proofStore.get()));
+        }
 
-        auto pTxref = did.getTxref();
+        BitcoinRPCFacade rpcBtc(rpcConfig);
+        std::unique_ptr<BitcoinRPCFacade> storeBtc;
+        if(proofStore)
+            storeBtc.reset(new ProofStoreBitcoinRPCFacade(rpcBtc, *proofStore));
+        const BitcoinRPCFacade & btc = storeBtc ? *storeBtc : rpcBtc;
+        ChainSoQuery chainQuery;
+        std::unique_ptr<MempoolSpends> mempool = makeMempoolSpends(btc, transactionData.mempool);
+
+        DidResolution resolution = resolveDid(transactionData.inputString, btc, chainQuery, mempool.get());
+        if(!resolution.ok) {
+            std::cerr << resolution.error << std::endl;
+            std::exit(-1);
+        }
+        if(proofStore)
+            keepProofs(*proofStore, btc, {resolution});
 
         std::cout << "Valid txref found:\n";
-        std::cout << "  txref: " << pTxref->asString() << "\n";
-        std::cout << "  txid: " << pTxref->getTxid()->asString() << "\n";
-        std::cout << "  block height: " << pTxref->getTxid()->blockHeight()->value() << "\n";
-        std::cout << "  transaction index: " << pTxref->getTxid()->transactionIndex()->value() << "\n";
-        std::cout << "  txoIndex: " << pTxref->getVout()->value() << "\n";
-
-
-        // 4) Is txo at txoIndex unspent?
-
-        utxoinfo_t utxoinfo = btc.gettxout(pTxref->getTxid()->asString(), pTxref->getVout()->value());
-
-        // TODO hmm, if btc.gettxout() returns anything, then it is unspent. If it returns nothing,
-        // that means it is spent, or possibly an op_return output
-
-        std::string txidForDID;
-
-        if(!utxoinfo.bestblock.empty() && utxoinfo.confirmations != 0) {
-            // yes: this is the latest version of the DID. From this we can construct the DID Document
-            std::cout << "Last txid with unspent output: " << pTxref->getTxid()->asString() << "\n";
-            txidForDID = pTxref->getTxid()->asString();
-        }
-        else {
-            // no : recursively follow transaction chain until txo  with an unspent output is found
-            ChainQuery *q = new ChainSoQuery();
-            std::string lastTxid =
-                    q->getLastUpdatedTxid(
-                            pTxref->getTxid()->asString(),
-                            pTxref->getVout()->value(),
-                            pTxref->getTxid()->isTestnet() ? "test" :"main");
-            std::cout << "Last txid with unspent output: " << lastTxid << "\n";
-            txidForDID = lastTxid;
+        std::cout << "  txref: " << resolution.txref << "\n";
+        std::cout << "  txid: " << resolution.txid << "\n";
+        std::cout << "  block height: " << resolution.blockHeight << "\n";
+        std::cout << "  transaction index: " << resolution.transactionIndex << "\n";
+        std::cout << "  txoIndex: " << resolution.txoIndex << "\n";
+
+        // 4) Is txo at txoIndex unspent? If not, follow the transaction chain until a txo with an
+        //    unspent output is found. (see resolveDid())
+
+        std::cout << "Last txid with unspent output: " << resolution.tipTxid << "\n";
+        if(resolution.mempoolChecked) {
+            std::cout << "Pending update in the mempool: "
+                      << (resolution.pendingTxid.empty() ? "none" : resolution.pendingTxid) << "\n";
         }
+        std::string txidForDID = resolution.tipTxid;
+
+        if(!transactionData.proofBundle.empty())
+            writeProofBundle(transactionData.proofBundle, btc, resolution);
 
         if(testing::exitAfterFollowTip) {
             exit(0);
@@ -0,0 +1,200 @@
+#include "didRotation.h"
+#include "address.h"
+#include "encodeOpReturnData.h"
+#include "hex.h"
+#include "privateKey.h"
+#include "rawTransaction.h"
+#include "transactionBuilder.h"
+#include "transactionSigner.h"
+
+#include <bitcoinapi/bitcoinapi.h>
+#include <algorithm>
+#include <atomic>
+#include <istream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+Result<std::vector<RotationRequest>> readRotationRequests(std::istream & in) {
+    typedef Result<std::vector<RotationRequest>> R;
+
+    std::vector<RotationRequest> requests;
+    std::string line;
+    size_t lineNumber = 0;
+    while(std::getline(in, line)) {
+        ++lineNumber;
+
+        std::istringstream iss(line);
+        RotationRequest request;
+        std::string extra;
+        iss >> request.did >> request.privateKey >> request.newAddress >> request.ddoRef >> extra;
+        if(request.did.empty() || request.did[0] == '#')
+            continue;
+        if(request.newAddress.empty() || !extra.empty())
+            return R::failure("Line " + std::to_string(lineNumber) +
+                              ": expected a DID, a private key, a new address and optionally a ddoRef");
+        request.line = lineNumber;
+        requests.push_back(request);
+    }
+    return R::success(requests);
+}
+
+Result<TipOutput> findTipOutput(const BitcoinRPCFacade & btc, const DidResolution & resolution) {
+    typedef Result<TipOutput> R;
+
+    if(!resolution.ok)
+        return R::failure(resolution.error);
+
+    TipOutput tip;
+    tip.txid = resolution.tipTxid;
+    if(resolution.tipTxid == resolution.txid) {
+        tip.vout = static_cast<uint32_t>(resolution.txoIndex);
+    }
+    else {
+        // resolution followed the chain here through the first output that isn't an OP_RETURN
+        Result<RawTransaction> tx = RawTransaction::fromHex(btc.getrawtransaction(tip.txid, 0).hex);
+        if(!tx)
+            return R::failure("Can't read tip transaction " + tip.txid + ": " + tx.error());
+        int followed = didFollowedOutput(tx.value());
+        if(followed < 0)
+            return R::failure("Tip transaction " + tip.txid + " has no output to follow");
+        tip.vout = static_cast<uint32_t>(followed);
+    }
+
+    utxoinfo_t utxoinfo = btc.gettxout(tip.txid, static_cast<int>(tip.vout));
+    if(utxoinfo.bestblock.empty() && utxoinfo.confirmations == 0)
+        return R::failure("The tip output " + tip.txid + ":" + std::to_string(tip.vout) +
+                          " has been spent, perhaps by a rotation that hasn't confirmed yet");
+    tip.amount = Amount::fromBtc(utxoinfo.value);
+    if(!hex::decode(utxoinfo.scriptPubKey.hex, tip.scriptPubKey))
+        return R::failure("bitcoind returned an invalid scriptPubKey for " + tip.txid);
+    return R::success(tip);
+}
+
+DidRotator::DidRotator(const std::string & chain, int64_t feeRate, bool dryrun)
+        : chainName(chain), satoshisPerVbyte(feeRate), dryrunOnly(dryrun) {
+    if(feeRate < 1)
+        throw std::invalid_argument("The fee rate must be at least 1 satoshi per vbyte");
+}
+
+RotationRecord DidRotator::rotate(const BitcoinRPCFacade & btc, const RotationRequest & request,
+                                  const DidResolution & resolution) const {
+    RotationRecord record;
+    record.line = request.line;
+    record.did = request.did;
+
+    Result<PrivateKey> key = PrivateKey::fromWif(request.privateKey, chainName);
+    if(!key) {
+        record.error = key.error();
+        return record;
+    }
+    Result<Address> newAddress = decodeAddress(request.newAddress, chainName);
+    if(!newAddress) {
+        record.error = newAddress.error();
+        return record;
+    }
+    std::vector<uint8_t> opReturnData;
+    std::string encodedOpReturn = encodeOpReturnData(request.ddoRef);
+    if(encodedOpReturn.empty() && !request.ddoRef.empty()) {
+        record.error = "ddoRef is longer than " + std::to_string(TransactionBuilder::MAX_OP_RETURN_SIZE) + " bytes";
+        return record;
+    }
+    hex::decode(encodedOpReturn, opReturnData);
+
+    // only errors from the RPC layer are thrown from here
+    try {
+        Result<TipOutput> tip = findTipOutput(btc, resolution);
+        if(!tip) {
+            record.error = tip.error();
+            return record;
+        }
+        record.previousTip = tip.value().txid;
+
+        Hash256 prevTxid;
+        if(!hex::decodeHash(tip.value().txid, prevTxid.data())) {
+            record.error = "Invalid tip txid: " + tip.value().txid;
+            return record;
+        }
+
+        // as when the DID was created: any OP_RETURN first, then the output the DID follows
+        auto build = [&](const Amount & value) {
+            TransactionBuilder builder;
+            builder.addInput(prevTxid, tip.value().vout);
+            if(!request.ddoRef.empty())
+                builder.addOpReturn(opReturnData);
+            builder.addOutput(value, newAddress.value().scriptPubKey);
+            return builder;
+        };
+
+        Result<AddressType> spentType = scriptType(tip.value().scriptPubKey.data(), tip.value().scriptPubKey.size());
+        if(!spentType) {
+            record.error = "Can't spend the tip output: " + spentType.error();
+            return record;
+        }
+        // the output's value goes into the signature hash, so the fee is settled before signing
+        size_t vsize = build(tip.value().amount).estimateSignedVsize({spentType.value()});
+        record.fee = Amount::fromSatoshis(static_cast<int64_t>(vsize) * satoshisPerVbyte);
+        Amount remaining = tip.value().amount - record.fee;
+        Amount dust = TransactionBuilder::dustThreshold(newAddress.value().scriptPubKey);
+        if(remaining < dust) {
+            record.error = "The tip output's " + tip.value().amount.toString() + " BTC doesn't cover the fee of " +
+                           record.fee.toString() + " BTC and leave " + dust.toString() + " BTC for the new output";
+            return record;
+        }
+
+        TransactionBuilder rotation = build(remaining);
+        record.txoIndex = static_cast<uint32_t>(rotation.outputs().size() - 1);
+        TransactionSigner signer(rotation);
+        Result<AddressType> signedType = signer.signInput(0, key.value(), tip.value().scriptPubKey, tip.value().amount);
+        if(!signedType) {
+            record.error = signedType.error();
+            return record;
+        }
+
+        std::string rawTransaction = rotation.toHex();
+        mempoolacceptance_t acceptance = btc.testmempoolaccept(rawTransaction);
+        if(!acceptance.allowed) {
+            record.error = "The mempool would not accept the transaction: " + acceptance.rejectreason;
+            return record;
+        }
+        record.txid = dryrunOnly ? hex::encodeHash(rotation.txid().data()) : btc.sendrawtransaction(rawTransaction);
+        record.ok = true;
+    }
+    catch(BitcoinException &e) {
+        std::stringstream ss;
+        ss << e.getCode() << " " << e.getMessage();
+        record.error = ss.str();
+    }
+    catch(std::exception &e) {
+        record.error = e.what();
+    }
+    return record;
+}
+
+std::vector<RotationRecord> DidRotator::rotateAll(const std::vector<RotationRequest> & requests,
+                                                  const std::vector<DidResolution> & resolutions,
+                                                  const FacadeFactory & facadeFactory, size_t jobs) const {
+    if(requests.size() != resolutions.size())
+        throw std::invalid_argument("Every rotation request needs a resolution");
+
+    size_t numJobs = std::max<size_t>(1, std::min(jobs, requests.size()));
+    std::vector<std::unique_ptr<BitcoinRPCFacade>> facades;
+    for(size_t i = 0; i < numJobs; ++i)
+        facades.push_back(facadeFactory());
+
+    // each worker takes the next request; the records are written in place, so stay in order
+    std::vector<RotationRecord> records(requests.size());
+    std::atomic<size_t> next(0);
+    auto worker = [&](const BitcoinRPCFacade & btc) {
+        for(size_t i = next++; i < requests.size(); i = next++)
+            records[i] = rotate(btc, requests[i], resolutions[i]);
+    };
+
+    std::vector<std::thread> threads;
+    for(const auto & facade : facades)
+        threads.emplace_back(worker, std::cref(*facade));
+    for(auto & thread : threads)
+        thread.join();
+
+    return records;
+}
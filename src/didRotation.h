@@ -0,0 +1,113 @@
+#ifndef TXREF_DIDROTATION_H
+#define TXREF_DIDROTATION_H
+
+#include "amount.h"
+#include "bitcoinRPCFacade.h"
+#include "didResolution.h"
+#include "result.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * A DID to rotate to a new key: its tip output is spent to 'newAddress', which the DID follows
+ * from then on
+ */
+struct RotationRequest {
+    size_t line = 0;            // line number in the input, starting at 1
+    std::string did;
+    std::string privateKey;     // WIF of the key the DID's tip output pays to
+    std::string newAddress;
+    std::string ddoRef;         // optional: put in an OP_RETURN alongside the new output
+};
+
+struct RotationRecord {
+    size_t line = 0;
+    std::string did;
+    bool ok = false;
+    std::string previousTip;    // the txid that was the DID's tip
+    std::string txid;           // the new tip
+    uint32_t txoIndex = 0;      // the output of the new tip the DID follows
+    Amount fee;
+    std::string error;
+};
+
+/**
+ * The unspent output at a DID's tip, which a rotation spends
+ */
+struct TipOutput {
+    std::string txid;
+    uint32_t vout;
+    Amount amount;
+    std::vector<uint8_t> scriptPubKey;
+};
+
+/**
+ * Read rotation requests, one per line: a DID, its current private key, its new address and
+ * optionally a ddoRef, separated by whitespace. Blank lines and lines starting with '#' are
+ * skipped.
+ * @return the requests in order, or why the first bad line is not valid
+ */
+Result<std::vector<RotationRequest>> readRotationRequests(std::istream & in);
+
+/**
+ * Find the unspent output at a resolved DID's tip: the DID's own output if it was never
+ * spent, and otherwise the first output of the tip transaction that isn't an OP_RETURN, which
+ * is the one resolution follows.
+ * @return the output, or why there is none: the DID didn't resolve, or the output has been
+ * spent since, such as by a rotation waiting in the mempool
+ */
+Result<TipOutput> findTipOutput(const BitcoinRPCFacade & btc, const DidResolution & resolution);
+
+/**
+ * Rotates the keys of many DIDs. Every DID gets a transaction of its own, spending its tip to
+ * its new address: a DID follows the first output of the transaction that spends it that
+ * isn't an OP_RETURN, so DIDs sharing a transaction would all end up following the same
+ * output. The fee is taken from the tip's value.
+ */
+class DidRotator {
+
+public:
+    typedef std::function<std::unique_ptr<BitcoinRPCFacade>()> FacadeFactory;
+
+    /**
+     * @param chain the chain keys and addresses must belong to, as getblockchaininfo names it
+     * @param feeRate the fee rate, in satoshis per vbyte
+     * @param dryrun check transactions with testmempoolaccept, but don't send them
+     * @throws std::invalid_argument if the fee rate isn't positive
+     */
+    DidRotator(const std::string & chain, int64_t feeRate, bool dryrun);
+
+    /**
+     * Rotate one DID. Errors are captured in the record instead of being thrown.
+     * @param btc the BitcoinRPCFacade
+     * @param request the DID, its key and its new address
+     * @param resolution the DID, resolved to its current tip
+     * @return the record of the rotation
+     */
+    RotationRecord rotate(const BitcoinRPCFacade & btc, const RotationRequest & request,
+                          const DidResolution & resolution) const;
+
+    /**
+     * Rotate many DIDs, up to 'jobs' at once, each worker using its own BitcoinRPCFacade
+     * @param requests the rotations
+     * @param resolutions the requests' DIDs, resolved, in the same order
+     * @return one record per request, in input order
+     */
+    std::vector<RotationRecord> rotateAll(const std::vector<RotationRequest> & requests,
+                                          const std::vector<DidResolution> & resolutions,
+                                          const FacadeFactory & facadeFactory, size_t jobs) const;
+
+private:
+    std::string chainName;
+    int64_t satoshisPerVbyte;
+    bool dryrunOnly;
+};
+
+
+#endif //TXREF_DIDROTATION_H
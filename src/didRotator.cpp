@@ -0,0 +1,274 @@
+#include "bitcoinRPCFacade.h"
+#include "cachingBitcoinRPCFacade.h"
+#include "cachingChainSoQuery.h"
+#include "concurrencyLimiter.h"
+#include "didRotation.h"
+#include "resolutionEngine.h"
+#include "anyoption.h"
+#include "json.hpp"
+
+#include <bitcoinapi/bitcoinapi.h>
+#include <curl/curl.h>
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+struct CmdlineInput {
+    std::string inputFile = "-";    // file to read requests from ("-" for stdin)
+    int jobs = 4;
+    int feeRate = 2;                // satoshis per vbyte
+    bool dryrun = false;
+};
+
+
+std::string find_homedir() {
+    std::string ret;
+    char * home = getenv("HOME");
+    if(home != nullptr)
+        ret.append(home);
+    return ret;
+}
+
+int convertIntegerArg(const std::string & argName, AnyOption *opt) {
+    int i;
+    try {
+        i = std::stoi(opt->getValue(argName.c_str()));
+    }
+    catch(std::invalid_argument &) {
+        std::cerr << "Error: " << argName << " '" << opt->getValue(argName.c_str())
+                  << "' is invalid. Check command line usage.\n";
+        opt->printUsage();
+        std::exit(-1);
+    }
+    catch(std::out_of_range &) {
+        std::cerr << "Error: " << argName << " '" << opt->getValue(argName.c_str())
+                  << "' is invalid. Check command line usage.\n";
+        opt->printUsage();
+        std::exit(-1);
+    }
+    return i;
+}
+
+int parseCommandLineArgs(int argc, char **argv,
+                         struct RpcConfig &rpcConfig,
+                         struct CmdlineInput &cmdlineInput) {
+
+    auto opt = std::unique_ptr<AnyOption>(new AnyOption());
+    opt->setFileDelimiterChar('=');
+
+    opt->addUsage( "" );
+    opt->addUsage( "Usage: didRotator [options] --input <file|->" );
+    opt->addUsage( "" );
+    opt->addUsage( " -h  --help                 Print this help " );
+    opt->addUsage( " --rpcconnect [host or IP]  RPC host (default: 127.0.0.1) " );
+    opt->addUsage( " --rpcuser [user]           RPC user " );
+    opt->addUsage( " --rpcpassword [pass]       RPC password " );
+    opt->addUsage( " --rpcport [port]           RPC port (default: try both 8332 and 18332) " );
+    opt->addUsage( " --config [config_path]     Full pathname to bitcoin.conf (default: <homedir>/.bitcoin/bitcoin.conf) " );
+    opt->addUsage( " --input [file|-]           Read rotation requests from file (default: stdin) " );
+    opt->addUsage( " --jobs [#]                 Number of DIDs resolved and rotated at once, each over its own " );
+    opt->addUsage( "                            RPC connection (default: 4) " );
+    opt->addUsage( " --fee-rate [#]             Fee rate in satoshis per vbyte, taken from each tip (default: 2) " );
+    opt->addUsage( " -n --dryrun                Check every transaction with testmempoolaccept, but send none " );
+    opt->addUsage( "" );
+    opt->addUsage( "Each input line holds a DID, the private key (WIF) its tip output pays to, the new address" );
+    opt->addUsage( "and optionally a ddoRef. Each DID's tip is spent to its new address in a transaction of its" );
+    opt->addUsage( "own, and a line of JSON is written with the new tip, in input order." );
+
+    opt->setFlag("help", 'h');
+    opt->setOption("rpcconnect");
+    opt->setOption("rpcuser");
+    opt->setOption("rpcpassword");
+    opt->setOption("rpcport");
+    opt->setCommandOption("config");
+    opt->setOption("input");
+    opt->setOption("jobs");
+    opt->setOption("fee-rate");
+    opt->setFlag("dryrun", 'n');
+
+    // parse any command line arguments--this is a first pass, mainly to get a possible
+    // "config" option that tells if the bitcoin.conf file is in a non-default location
+    opt->processCommandArgs( argc, argv );
+
+    // print usage if no options
+    if( ! opt->hasOptions()) {
+        opt->printUsage();
+        return 0;
+    }
+
+    // see if there is a bitcoin.conf file to parse. If not, continue.
+    if (opt->getValue("config") != nullptr) {
+        opt->processFile(opt->getValue("config"));
+    }
+    else {
+        std::string home = find_homedir();
+        if(!home.empty()) {
+            std::string configPath = home + "/.bitcoin/bitcoin.conf";
+            if(!opt->processFile(configPath.data())) {
+                std::cerr << "Warning: Config file " << configPath
+                          << " not readable. Perhaps try --config? Attempting to continue...\n";
+            }
+        }
+    }
+
+    // parse command line arguments AGAIN--this is because command line args should override config file
+    opt->processCommandArgs( argc, argv );
+
+
+    // print usage if help was requested
+    if (opt->getFlag("help") || opt->getFlag('h')) {
+        opt->printUsage();
+        return 0;
+    }
+
+    // see if there is an rpcconnect specified. If not, use default
+    if (opt->getValue("rpcconnect") != nullptr) {
+        rpcConfig.rpcconnect = opt->getValue("rpcconnect");
+    }
+
+    // see if there is an rpcuser specified. If not, exit
+    if (opt->getValue("rpcuser") == nullptr) {
+        std::cerr << "Error: 'rpcuser' not found. Check bitcoin.conf or command line usage.\n";
+        opt->printUsage();
+        return -1;
+    }
+    rpcConfig.rpcuser = opt->getValue("rpcuser");
+
+    // see if there is an rpcpassword specified. If not, exit
+    if (opt->getValue("rpcpassword") == nullptr) {
+        std::cerr << "Error: 'rpcpassword' not found. Check bitcoin.conf or command line usage.\n";
+        opt->printUsage();
+        return -1;
+    }
+    rpcConfig.rpcpassword = opt->getValue("rpcpassword");
+
+    // will try both well known ports (8332 and 18332) if one is not specified
+    if (opt->getValue("rpcport") != nullptr) {
+        rpcConfig.rpcport = convertIntegerArg("rpcport", opt.get());
+    }
+
+    if (opt->getValue("input") != nullptr) {
+        cmdlineInput.inputFile = opt->getValue("input");
+    }
+
+    if (opt->getValue("jobs") != nullptr) {
+        cmdlineInput.jobs = convertIntegerArg("jobs", opt.get());
+        if(cmdlineInput.jobs < 1) {
+            std::cerr << "Error: jobs '" << cmdlineInput.jobs << "' should be one or greater. Check command line usage.\n";
+            opt->printUsage();
+            return -1;
+        }
+    }
+
+    if (opt->getValue("fee-rate") != nullptr) {
+        cmdlineInput.feeRate = convertIntegerArg("fee-rate", opt.get());
+        if(cmdlineInput.feeRate < 1) {
+            std::cerr << "Error: fee-rate '" << cmdlineInput.feeRate << "' should be one or greater. Check command line usage.\n";
+            opt->printUsage();
+            return -1;
+        }
+    }
+
+    if (opt->getFlag("dryrun") || opt->getFlag('n')) {
+        cmdlineInput.dryrun = true;
+    }
+
+    return 1;
+}
+
+int main(int argc, char *argv[]) {
+
+    struct RpcConfig rpcConfig;
+    struct CmdlineInput cmdlineInput;
+
+    int ret = parseCommandLineArgs(argc, argv, rpcConfig, cmdlineInput);
+    if(ret < 1) {
+        std::exit(ret);
+    }
+
+    std::ifstream inputFile;
+    if(cmdlineInput.inputFile != "-") {
+        inputFile.open(cmdlineInput.inputFile);
+        if(!inputFile) {
+            std::cerr << "Error: input file " << cmdlineInput.inputFile << " not readable.\n";
+            std::exit(-1);
+        }
+    }
+    std::istream & in = cmdlineInput.inputFile == "-" ? std::cin : inputFile;
+
+    Result<std::vector<RotationRequest>> requests = readRotationRequests(in);
+    if(!requests) {
+        std::cerr << "Error: " << requests.error() << ".\n";
+        std::exit(-1);
+    }
+
+    try {
+        BitcoinRPCFacade btc(rpcConfig);
+        blockchaininfo_t blockChainInfo = btc.getblockchaininfo();
+        DidRotator rotator(blockChainInfo.chain, cmdlineInput.feeRate, cmdlineInput.dryrun);
+
+        // chain.so is queried from several threads at once, so curl has to be set up beforehand
+        curl_global_init(CURL_GLOBAL_DEFAULT);
+
+        std::vector<std::string> dids;
+        for(const RotationRequest & request : requests.value())
+            dids.push_back(request.did);
+
+        // 1. find every DID's current tip, in parallel
+        size_t jobs = static_cast<size_t>(cmdlineInput.jobs);
+        auto facadeFactory = [&rpcConfig] { return std::unique_ptr<BitcoinRPCFacade>(new BitcoinRPCFacade(rpcConfig)); };
+        RpcCache cache;
+        CachingChainSoQuery chainQuery;
+        ConcurrencyLimiter::Options limiterOptions;
+        limiterOptions.initialLimit = std::min(limiterOptions.initialLimit, static_cast<double>(jobs));
+        limiterOptions.maxLimit = cmdlineInput.jobs;
+        ConcurrencyLimiter limiter(limiterOptions);
+        std::vector<DidResolution> resolutions;
+        {
+            ResolutionEngine engine(facadeFactory, cache, chainQuery, jobs, &limiter);
+            resolutions = engine.resolve(dids);
+        }
+
+        // 2. spend each tip to its new address
+        std::vector<RotationRecord> records = rotator.rotateAll(requests.value(), resolutions, facadeFactory, jobs);
+
+        size_t numErrors = 0;
+        for(const RotationRecord & rotation : records) {
+            nlohmann::json record;
+            record["line"] = rotation.line;
+            record["did"] = rotation.did;
+            if(rotation.ok) {
+                record["previous-txid"] = rotation.previousTip;
+                record["txid"] = rotation.txid;
+                record["txo-index"] = rotation.txoIndex;
+                record["fee"] = rotation.fee.toString();
+            }
+            else {
+                record["error"] = rotation.error;
+                ++numErrors;
+            }
+            std::cout << record.dump() << "\n";
+        }
+
+        if(numErrors > 0) {
+            std::cerr << "Warning: " << numErrors << " DIDs could not be rotated." << std::endl;
+            std::exit(-1);
+        }
+    }
+    catch(BitcoinException &e)
+    {
+        std::cerr << "Error: " << e.getCode() << " " << e.getMessage() << std::endl;
+        std::exit(-1);
+    }
+    catch(std::runtime_error &e)
+    {
+        std::cerr << "Error: " << e.what() << std::endl;
+        std::exit(-1);
+    }
+
+    return 0;
+}
@@ -0,0 +1,489 @@
+#include "didVerification.h"
+#include "fileUtil.h"
+#include "hex.h"
+#include "secp256k1Context.h"
+#include "sha256.h"
+#include "workStealingPool.h"
+#include "json.hpp"
+
+#include <bitcoinapi/bitcoinapi.h>
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+namespace {
+
+    const char SIGNING_KEY[] = "#keys-1";
+
+    Hash256 sha256Of(const std::string & data) {
+        Hash256 hash;
+        sha256::Hasher().write(reinterpret_cast<const uint8_t *>(data.data()), data.size()).finalize(hash.data());
+        return hash;
+    }
+
+    bool parsePublicKey(const std::vector<uint8_t> & serialized, secp256k1_pubkey & key) {
+        return secp256k1_ec_pubkey_parse(secp256k1Context(), &key, serialized.data(), serialized.size()) == 1;
+    }
+
+    /**
+     * @return a key's id with the DID in front, if it is only a fragment like "#keys-1"
+     */
+    std::string fullKeyId(const std::string & id, const std::string & did) {
+        return !id.empty() && id[0] == '#' ? did + id : id;
+    }
+
+    /**
+     * Split a scriptSig into the data it pushes
+     * @return false if it does anything but push data
+     */
+    bool scriptPushes(const ByteView & script, std::vector<ByteView> & pushes) {
+        size_t pos = 0;
+        while(pos < script.size) {
+            uint8_t opcode = script.data[pos++];
+            size_t len;
+            if(opcode >= 1 && opcode <= 75) {
+                len = opcode;
+            }
+            else if(opcode == 0x4c && pos + 1 <= script.size) {
+                len = script.data[pos];
+                pos += 1;
+            }
+            else if(opcode == 0x4d && pos + 2 <= script.size) {
+                len = script.data[pos] | static_cast<size_t>(script.data[pos + 1]) << 8;
+                pos += 2;
+            }
+            else {
+                return false;
+            }
+            if(len > script.size - pos)
+                return false;
+            pushes.push_back(ByteView{script.data + pos, len});
+            pos += len;
+        }
+        return true;
+    }
+
+    /**
+     * @return an object's member, or null if it has none by that name
+     */
+    const nlohmann::json & member(const nlohmann::json & object, const char * name) {
+        static const nlohmann::json none;
+        if(!object.is_object())
+            return none;
+        auto found = object.find(name);
+        return found == object.end() ? none : *found;
+    }
+
+    bool stringMember(const nlohmann::json & object, const char * name, std::string & value) {
+        const nlohmann::json & found = member(object, name);
+        if(!found.is_string())
+            return false;
+        value = found.get<std::string>();
+        return true;
+    }
+
+    VerificationRequest readDocument(const std::string & path) {
+        std::ifstream file(path, std::ios::binary);
+        if(!file)
+            throw std::runtime_error("Can't read DID document: " + path);
+        std::string json((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+        VerificationRequest request;
+        request.source = path;
+        Result<DidDocument> document = parseDidDocument(json);
+        if(document) {
+            request.parsed = true;
+            request.document = document.value();
+        }
+        else {
+            request.error = document.error();
+        }
+        return request;
+    }
+}
+
+
+Result<DidDocument> parseDidDocument(const std::string & json) {
+    typedef Result<DidDocument> R;
+
+    nlohmann::json doc;
+    try {
+        doc = nlohmann::json::parse(json);
+    }
+    catch(nlohmann::json::exception & e) {
+        return R::failure(std::string("Not valid JSON: ") + e.what());
+    }
+
+    DidDocument document;
+    if(!doc.is_object() || !stringMember(doc, "id", document.did))
+        return R::failure("Not a DID document: it has no id");
+    document.hash = sha256Of(json);
+
+    // public keys by id
+    std::map<std::string, std::vector<uint8_t>> keys;
+    for(const nlohmann::json & key : member(doc, "publicKey")) {
+        std::string id, publicKeyHex;
+        if(!stringMember(key, "id", id) || !stringMember(key, "publicKeyHex", publicKeyHex))
+            continue;
+        std::vector<uint8_t> serialized;
+        secp256k1_pubkey parsed;
+        if(!hex::decode(publicKeyHex, serialized) || !parsePublicKey(serialized, parsed))
+            return R::failure("Public key " + id + " is not valid");
+        keys[fullKeyId(id, document.did)] = serialized;
+    }
+
+    const std::string signingKeyId = document.did + SIGNING_KEY;
+    auto signingKey = keys.find(signingKeyId);
+    if(signingKey == keys.end())
+        return R::failure(std::string("The document has no ") + SIGNING_KEY + " public key");
+    document.signingKey = signingKey->second;
+
+    bool authenticates = false;
+    for(const nlohmann::json & entry : member(doc, "authentication")) {
+        std::string reference;
+        if(entry.is_string())
+            reference = entry.get<std::string>();
+        else
+            stringMember(entry, "publicKey", reference);
+        if(fullKeyId(reference, document.did) == signingKeyId)
+            authenticates = true;
+    }
+    if(!authenticates)
+        return R::failure(std::string("The document's authentication doesn't use ") + SIGNING_KEY);
+
+    nlohmann::json proofs = member(doc, "proof");
+    if(proofs.is_object())
+        proofs = nlohmann::json::array({proofs});
+    for(const nlohmann::json & proof : proofs) {
+        DocumentSignature signature;
+        std::string signatureHex;
+        if(!stringMember(proof, "creator", signature.creator) || !stringMember(proof, "signatureValue", signatureHex))
+            return R::failure("A proof has no creator or signatureValue");
+        auto key = keys.find(fullKeyId(signature.creator, document.did));
+        if(key == keys.end())
+            return R::failure("A proof's creator " + signature.creator + " is not one of the document's public keys");
+        signature.publicKey = key->second;
+        if(!hex::decode(signatureHex, signature.signature))
+            return R::failure("The signatureValue of " + signature.creator + "'s proof is not hex");
+        document.signatures.push_back(signature);
+    }
+    if(document.signatures.empty())
+        return R::failure("The document has no proof to verify");
+
+    // nlohmann::json keeps object keys sorted, so this serializes the same however it was written
+    doc.erase("proof");
+    document.signedHash = sha256Of(doc.dump());
+    return R::success(document);
+}
+
+Result<std::vector<uint8_t>> signingPublicKey(const RawTransaction & tx, size_t input) {
+    typedef Result<std::vector<uint8_t>> R;
+
+    if(input >= tx.inputs().size())
+        return R::failure("The transaction has no input " + std::to_string(input));
+    const TxInputView & in = tx.inputs()[input];
+
+    if(!in.witness.empty()) {
+        // p2wpkh: <signature> <public key>
+        if(in.witness.size() != 2 || in.witness[1].size != 33)
+            return R::failure("Input " + std::to_string(input) + " has a witness that isn't p2wpkh");
+        return R::success(std::vector<uint8_t>(in.witness[1].data, in.witness[1].data + in.witness[1].size));
+    }
+
+    // p2pkh: <signature> <public key>
+    std::vector<ByteView> pushes;
+    if(!scriptPushes(in.scriptSig, pushes) || pushes.size() != 2 ||
+       (pushes[1].size != 33 && pushes[1].size != 65))
+        return R::failure("Input " + std::to_string(input) + " has a scriptSig that isn't p2pkh");
+    return R::success(std::vector<uint8_t>(pushes[1].data, pushes[1].data + pushes[1].size));
+}
+
+bool samePublicKey(const std::vector<uint8_t> & a, const std::vector<uint8_t> & b) {
+    const secp256k1_context * context = secp256k1Context();
+    secp256k1_pubkey keyA, keyB;
+    if(!parsePublicKey(a, keyA) || !parsePublicKey(b, keyB))
+        return false;
+
+    uint8_t compressedA[33], compressedB[33];
+    size_t lenA = sizeof(compressedA), lenB = sizeof(compressedB);
+    secp256k1_ec_pubkey_serialize(context, compressedA, &lenA, &keyA, SECP256K1_EC_COMPRESSED);
+    secp256k1_ec_pubkey_serialize(context, compressedB, &lenB, &keyB, SECP256K1_EC_COMPRESSED);
+    return std::equal(compressedA, compressedA + lenA, compressedB);
+}
+
+Result<std::vector<uint8_t>> findTipSigningKey(const BitcoinRPCFacade & btc, const DidResolution & resolution) {
+    typedef Result<std::vector<uint8_t>> R;
+
+    if(!resolution.ok)
+        return R::failure(resolution.error);
+
+    if(resolution.tipTxid == resolution.txid) {
+        std::string blockhash = btc.getblockhash(resolution.blockHeight);
+        Result<RawTransaction> tx = RawTransaction::fromHex(btc.getrawtransactioninblock(resolution.txid, blockhash));
+        if(!tx)
+            return R::failure("Can't read DID transaction " + resolution.txid + ": " + tx.error());
+        return signingPublicKey(tx.value(), 0);
+    }
+
+    Result<RawTransaction> tx = RawTransaction::fromHex(btc.getrawtransaction(resolution.tipTxid, 0).hex);
+    if(!tx)
+        return R::failure("Can't read tip transaction " + resolution.tipTxid + ": " + tx.error());
+
+    // the input spending what resolution followed: the DID's own output, or the first output
+    // of an update that isn't an OP_RETURN
+    const std::vector<TxInputView> & inputs = tx.value().inputs();
+    for(size_t i = 0; i < inputs.size(); ++i) {
+        if(isNullPrevout(inputs[i]))
+            continue;
+        std::string prevTxid = hex::encodeHash(inputs[i].prevTxid.data);
+        int followed = resolution.txoIndex;
+        if(prevTxid != resolution.txid) {
+            // needs -txindex; an error here is the node's, and is left to the caller
+            Result<RawTransaction> prevTx = RawTransaction::fromHex(btc.getrawtransaction(prevTxid, 0).hex);
+            if(!prevTx)
+                continue;
+            followed = didFollowedOutput(prevTx.value());
+        }
+        if(static_cast<int>(inputs[i].prevIndex) == followed)
+            return signingPublicKey(tx.value(), i);
+    }
+    return R::failure("Can't find the input of tip transaction " + resolution.tipTxid + " that spends the DID");
+}
+
+
+size_t SignatureBatch::add(const std::vector<uint8_t> & publicKey, const Hash256 & hash, const std::vector<uint8_t> & signature) {
+    auto key = std::find(keys.begin(), keys.end(), publicKey);
+    if(key == keys.end())
+        key = keys.insert(keys.end(), publicKey);
+
+    Item item;
+    item.key = static_cast<size_t>(key - keys.begin());
+    item.hash = hash;
+    item.signature = signature;
+    items.push_back(item);
+    return items.size() - 1;
+}
+
+std::vector<bool> SignatureBatch::verify() const {
+    const secp256k1_context * context = secp256k1Context();
+
+    std::vector<secp256k1_pubkey> parsedKeys(keys.size());
+    std::vector<bool> validKeys(keys.size());
+    for(size_t i = 0; i < keys.size(); ++i)
+        validKeys[i] = parsePublicKey(keys[i], parsedKeys[i]);
+
+    // the same document can be listed twice, or signed twice by one key
+    std::map<std::pair<size_t, std::vector<uint8_t>>, bool> verified;
+    std::vector<bool> results(items.size());
+    for(size_t i = 0; i < items.size(); ++i) {
+        const Item & item = items[i];
+        std::vector<uint8_t> message(item.hash.begin(), item.hash.end());
+        message.insert(message.end(), item.signature.begin(), item.signature.end());
+        auto seen = verified.find(std::make_pair(item.key, message));
+        if(seen != verified.end()) {
+            results[i] = seen->second;
+            continue;
+        }
+
+        secp256k1_ecdsa_signature signature;
+        bool valid = validKeys[item.key] &&
+                     secp256k1_ecdsa_signature_parse_der(context, &signature, item.signature.data(), item.signature.size()) == 1;
+        if(valid) {
+            // secp256k1_ecdsa_verify only takes a low S, which documents signed outside bitcoin needn't have
+            secp256k1_ecdsa_signature_normalize(context, &signature, &signature);
+            valid = secp256k1_ecdsa_verify(context, &signature, item.hash.data(), &parsedKeys[item.key]) == 1;
+        }
+        verified[std::make_pair(item.key, message)] = valid;
+        results[i] = valid;
+    }
+    return results;
+}
+
+size_t SignatureBatch::size() const {
+    return items.size();
+}
+
+
+bool VerificationCache::contains(const Hash256 & documentHash, const std::string & tipTxid) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return verified.count(std::make_pair(hex::encode(documentHash.data(), documentHash.size()), tipTxid)) != 0;
+}
+
+void VerificationCache::add(const Hash256 & documentHash, const std::string & tipTxid) {
+    std::lock_guard<std::mutex> lock(mutex);
+    verified.insert(std::make_pair(hex::encode(documentHash.data(), documentHash.size()), tipTxid));
+}
+
+/*
+ * One line per verified document: "<SHA-256 of the document, hex> <tip txid>"
+ */
+void VerificationCache::load(const std::string & path) {
+    std::ifstream file(path);
+    if(!file)
+        return;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    std::string documentHash, tipTxid;
+    while(file >> documentHash >> tipTxid) {
+        if(documentHash.size() != 64 || !hex::isValid(documentHash) || tipTxid.size() != 64 || !hex::isValid(tipTxid))
+            throw std::runtime_error("Verification cache file is not valid: " + path);
+        verified.insert(std::make_pair(documentHash, tipTxid));
+    }
+    if(!file.eof())
+        throw std::runtime_error("Verification cache file is not valid: " + path);
+}
+
+void VerificationCache::save(const std::string & path) const {
+    std::ostringstream ss;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for(const auto & entry : verified)
+            ss << entry.first << " " << entry.second << "\n";
+    }
+
+    if(!replaceFile(path, ss.str()))
+        throw std::runtime_error("Can't write verification cache file: " + path);
+}
+
+size_t VerificationCache::size() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return verified.size();
+}
+
+
+std::vector<VerificationRequest> readDocuments(const std::string & path) {
+    struct stat info;
+    if(::stat(path.c_str(), &info) != 0)
+        throw std::runtime_error("Can't read DID documents: " + path);
+    if(!S_ISDIR(info.st_mode))
+        return {readDocument(path)};
+
+    DIR * listing = ::opendir(path.c_str());
+    if(listing == nullptr)
+        throw std::runtime_error("Can't read DID document directory: " + path);
+    std::vector<std::string> names;
+    while(struct dirent * entry = ::readdir(listing)) {
+        std::string name = entry->d_name;
+        if(hasSuffix(name, ".json") || hasSuffix(name, ".jsonld") || hasSuffix(name, ".did.txt"))
+            names.push_back(name);
+    }
+    ::closedir(listing);
+    std::sort(names.begin(), names.end());
+
+    std::vector<VerificationRequest> requests;
+    for(const std::string & name : names)
+        requests.push_back(readDocument(path + "/" + name));
+    return requests;
+}
+
+
+DidVerifier::DidVerifier(VerificationCache * cache, size_t batchSize)
+        : verificationCache(cache), signaturesPerBatch(std::max<size_t>(1, batchSize)) {
+}
+
+std::vector<VerificationRecord> DidVerifier::verifyAll(const std::vector<VerificationRequest> & requests,
+                                                       const std::vector<DidResolution> & resolutions,
+                                                       const FacadeFactory & facadeFactory, size_t jobs) const {
+    if(requests.size() != resolutions.size())
+        throw std::invalid_argument("Every document needs a resolution");
+
+    std::vector<VerificationRecord> records(requests.size());
+    if(requests.empty())
+        return records;
+
+    size_t numJobs = std::max<size_t>(1, std::min(jobs, requests.size()));
+    std::vector<std::unique_ptr<BitcoinRPCFacade>> facades;
+    for(size_t i = 0; i < numJobs; ++i)
+        facades.push_back(facadeFactory());
+    WorkStealingPool pool(numJobs);
+
+    // 1. check each document's #keys-1 against the key that signed its DID's tip
+    std::vector<char> needsSignatures(requests.size(), 0);
+    for(size_t i = 0; i < requests.size(); ++i) {
+        pool.submit([&, i](size_t worker) {
+            const VerificationRequest & request = requests[i];
+            const DidResolution & resolution = resolutions[i];
+            VerificationRecord & record = records[i];
+            record.source = request.source;
+            if(!request.parsed) {
+                record.error = request.error;
+                return;
+            }
+            const DidDocument & document = request.document;
+            record.did = document.did;
+            record.signatures = document.signatures.size();
+            if(!resolution.ok) {
+                record.error = resolution.error;
+                return;
+            }
+            record.tipTxid = resolution.tipTxid;
+
+            if(verificationCache != nullptr && verificationCache->contains(document.hash, resolution.tipTxid)) {
+                record.ok = record.cached = true;
+                return;
+            }
+            try {
+                Result<std::vector<uint8_t>> tipKey = findTipSigningKey(*facades[worker], resolution);
+                if(!tipKey)
+                    record.error = tipKey.error();
+                else if(!samePublicKey(tipKey.value(), document.signingKey))
+                    record.error = std::string("The DID's tip was signed by ") + hex::encode(tipKey.value().data(), tipKey.value().size()) +
+                                   ", not by the document's " + SIGNING_KEY;
+                else
+                    needsSignatures[i] = 1;
+            }
+            catch(BitcoinException & e) {
+                record.error = std::to_string(e.getCode()) + " " + e.getMessage();
+            }
+            catch(std::exception & e) {
+                record.error = e.what();
+            }
+        });
+    }
+    pool.wait();
+
+    // 2. verify the signatures of those that passed, a batch per task; a document's signatures
+    // all go in one batch
+    struct Batch {
+        SignatureBatch signatures;
+        std::vector<size_t> documents;
+        std::vector<bool> valid;
+    };
+    std::vector<Batch> batches;
+    for(size_t i = 0; i < requests.size(); ++i) {
+        if(!needsSignatures[i])
+            continue;
+        if(batches.empty() || batches.back().signatures.size() >= signaturesPerBatch)
+            batches.emplace_back();
+        Batch & batch = batches.back();
+        batch.documents.push_back(i);
+        for(const DocumentSignature & signature : requests[i].document.signatures)
+            batch.signatures.add(signature.publicKey, requests[i].document.signedHash, signature.signature);
+    }
+    for(Batch & batch : batches)
+        pool.submit([&batch](size_t) { batch.valid = batch.signatures.verify(); });
+    pool.wait();
+
+    for(const Batch & batch : batches) {
+        size_t position = 0;
+        for(size_t i : batch.documents) {
+            const DidDocument & document = requests[i].document;
+            VerificationRecord & record = records[i];
+            for(const DocumentSignature & signature : document.signatures) {
+                if(!batch.valid[position++] && record.error.empty())
+                    record.error = "The signature by " + signature.creator + " is not valid";
+            }
+            record.ok = record.error.empty();
+            if(record.ok && verificationCache != nullptr)
+                verificationCache->add(document.hash, record.tipTxid);
+        }
+    }
+    return records;
+}
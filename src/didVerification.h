@@ -0,0 +1,205 @@
+#ifndef TXREF_DIDVERIFICATION_H
+#define TXREF_DIDVERIFICATION_H
+
+#include "bitcoinRPCFacade.h"
+#include "block.h"
+#include "didResolution.h"
+#include "rawTransaction.h"
+#include "result.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * A signature in a DID document's "proof" array: "creator" names one of the document's public
+ * keys, and "signatureValue" is a hex-encoded DER ECDSA signature of the document's signed hash
+ */
+struct DocumentSignature {
+    std::string creator;
+    std::vector<uint8_t> publicKey;
+    std::vector<uint8_t> signature;
+};
+
+/**
+ * The parts of a DID document that verification needs
+ */
+struct DidDocument {
+    std::string did;                    // its "id"
+    Hash256 hash;                       // SHA-256 of the document as read, for the VerificationCache
+    std::vector<uint8_t> signingKey;    // the #keys-1 public key, which must have signed the DID's tip
+    Hash256 signedHash;                 // what each signature signs (see parseDidDocument())
+    std::vector<DocumentSignature> signatures;
+};
+
+/**
+ * Parse a DID document. Its #keys-1 public key (publicKeyHex) must be in the "publicKey" array
+ * and referenced from the "authentication" array.
+ *
+ * The signatures in "proof" (one object, or an array of them, not empty) sign the SHA-256 of
+ * the document without its "proof", serialized as compact JSON with its object keys sorted.
+ *
+ * @param json the document
+ * @return the document, or why it is not a valid one
+ */
+Result<DidDocument> parseDidDocument(const std::string & json);
+
+/**
+ * Find the public key that signed a transaction input: the last push of a p2pkh scriptSig, or
+ * the second witness item of a p2wpkh (or p2sh-wrapped p2wpkh) input
+ * @param tx the transaction
+ * @param input the input
+ * @return the serialized public key, or why the input doesn't show one
+ */
+Result<std::vector<uint8_t>> signingPublicKey(const RawTransaction & tx, size_t input);
+
+/**
+ * Are these the same secp256k1 public key, whether compressed or not?
+ */
+bool samePublicKey(const std::vector<uint8_t> & a, const std::vector<uint8_t> & b);
+
+/**
+ * ECDSA signatures to be verified together. libsecp256k1 has no batch verification for ECDSA,
+ * so a batch saves what it can around the verifications: each public key is parsed once however
+ * many signatures it made, and a signature seen twice is verified once. High-S signatures are
+ * accepted.
+ */
+class SignatureBatch {
+
+public:
+    /**
+     * @return the position of the signature in the batch, for the results of verify()
+     */
+    size_t add(const std::vector<uint8_t> & publicKey, const Hash256 & hash, const std::vector<uint8_t> & signature);
+
+    /**
+     * @return for each signature added, whether it is valid
+     */
+    std::vector<bool> verify() const;
+
+    size_t size() const;
+
+private:
+    struct Item {
+        size_t key;         // into keys
+        Hash256 hash;
+        std::vector<uint8_t> signature;
+    };
+
+    std::vector<std::vector<uint8_t>> keys;
+    std::vector<Item> items;
+};
+
+/**
+ * The documents already verified against their DID's tip: as long as neither the document nor
+ * the tip has changed, it need not be verified again. Can be kept in a file between runs, and
+ * used from several threads.
+ */
+class VerificationCache {
+
+public:
+    bool contains(const Hash256 & documentHash, const std::string & tipTxid) const;
+
+    void add(const Hash256 & documentHash, const std::string & tipTxid);
+
+    /**
+     * Add the entries in a file written by save(). A missing file is an empty cache.
+     * @throws std::runtime_error if the file is not valid
+     */
+    void load(const std::string & path);
+
+    /**
+     * @throws std::runtime_error if the file can't be written
+     */
+    void save(const std::string & path) const;
+
+    size_t size() const;
+
+private:
+    mutable std::mutex mutex;
+    std::set<std::pair<std::string, std::string>> verified;     // document hash, tip txid
+};
+
+/**
+ * Find the public key that signed a DID's tip: for the DID's own transaction, its first
+ * input's; for an update, the key of the input spending the output of the previous transaction
+ * that the DID followed. For an update, bitcoind needs -txindex.
+ * @param btc the BitcoinRPCFacade
+ * @param resolution the DID, resolved to its tip
+ * @return the serialized public key, or why it can't be found
+ * @throws BitcoinException if bitcoind can't return a transaction
+ */
+Result<std::vector<uint8_t>> findTipSigningKey(const BitcoinRPCFacade & btc, const DidResolution & resolution);
+
+/**
+ * A document to verify
+ */
+struct VerificationRequest {
+    std::string source;         // where the document came from, such as its file
+    bool parsed = false;
+    DidDocument document;       // if parsed
+    std::string error;          // if not
+};
+
+/**
+ * Read the DID documents in a directory: its files named *.json, *.jsonld or *.did.txt, in name
+ * order. A path to a file reads that one document.
+ * @param path the directory or file
+ * @return a request per document, including those that don't parse
+ * @throws std::runtime_error if the path can't be read
+ */
+std::vector<VerificationRequest> readDocuments(const std::string & path);
+
+struct VerificationRecord {
+    std::string source;
+    std::string did;
+    bool ok = false;
+    std::string tipTxid;
+    size_t signatures = 0;      // in the document, all verified
+    bool cached = false;        // verified on an earlier run, against the same tip
+    std::string error;
+};
+
+/**
+ * Verifies many DID documents against their DIDs' tips. For each document, the public key that
+ * signed the tip transaction has to be its #keys-1, and every signature in it has to be valid.
+ * The tips are fetched in parallel, then the documents' signatures are verified in batches,
+ * also in parallel.
+ */
+class DidVerifier {
+
+public:
+    typedef std::function<std::unique_ptr<BitcoinRPCFacade>()> FacadeFactory;
+
+    /**
+     * @param cache if not null, documents in it are not verified again, and documents that
+     * verify are added to it
+     * @param batchSize the number of signatures in a batch
+     */
+    explicit DidVerifier(VerificationCache * cache = nullptr, size_t batchSize = 256);
+
+    /**
+     * Verify many documents, up to 'jobs' at once, each worker using its own BitcoinRPCFacade.
+     * Errors are captured in the records instead of being thrown.
+     * @param requests the documents
+     * @param resolutions the documents' DIDs, resolved, in the same order. Those of documents
+     * that didn't parse are ignored.
+     * @return one record per request, in input order
+     */
+    std::vector<VerificationRecord> verifyAll(const std::vector<VerificationRequest> & requests,
+                                              const std::vector<DidResolution> & resolutions,
+                                              const FacadeFactory & facadeFactory, size_t jobs) const;
+
+private:
+    VerificationCache * verificationCache;
+    size_t signaturesPerBatch;
+};
+
+
+#endif //TXREF_DIDVERIFICATION_H
@@ -1,12 +1,22 @@
 #include "bitcoinRPCFacade.h"
+#include "cachingChainSoQuery.h"
+#include "didVerification.h"
 #include "encodeOpReturnData.h"
 #include "anyoption.h"
-#include "libtxref.h"
+#include "proofBundle.h"
+#include "resolutionEngine.h"
+#include "domain/txrefDecoder.h"
+#include <algorithm>
 #include <iostream>
+#include <fstream>
+#include <iterator>
 #include <cstdlib>
 #include <memory>
 #include <stdexcept>
+#include <vector>
 #include <bitcoinapi/bitcoinapi.h>
+#include <curl/curl.h>
+#include "json.hpp"
 
 
 struct TransactionData {
@@ -16,6 +26,10 @@ struct TransactionData {
     std::string ddoRef;
     double fee = 0.0;
     int txoIndex = 0;
+    std::string proofBundle;    // file of proofs to check the DID with, or "" to ask bitcoind
+    std::string documents;      // directory (or file) of DID documents to verify
+    int jobs = 1;
+    std::string cacheFile;      // documents verified on earlier runs, or "" not to keep them
 };
 
 
@@ -53,7 +67,8 @@ int parseCommandLineArgs(int argc, char **argv, struct RpcConfig &config, struct
     opt->setFileDelimiterChar('=');
 
     opt->addUsage( "" );
-    opt->addUsage( "Usage: createBtcrDid [options] <inputXXX> <changeAddress> <network> <WIF> <fee> <ddoRef>" );
+    opt->addUsage( "Usage: didVerifier [options] --documents <dir|file>" );
+    opt->addUsage( "       didVerifier --proof-bundle <file> <did>" );
     opt->addUsage( "" );
     opt->addUsage( " -h  --help                 Print this help " );
     opt->addUsage( " --rpcconnect [hostname or IP]  RPC host (default: 127.0.0.1) " );
@@ -61,6 +76,13 @@ int parseCommandLineArgs(int argc, char **argv, struct RpcConfig &config, struct
     opt->addUsage( " --rpcpassword [pass]       RPC password " );
     opt->addUsage( " --rpcport [port]           RPC port (default: try both 8332 and 18332) " );
     opt->addUsage( " --config [config_path]     Full pathname to bitcoin.conf (default: <homedir>/.bitcoin/bitcoin.conf) " );
+    opt->addUsage( " --proof-bundle [file]      Verify the DID offline, from a bundle written by didResolver " );
+    opt->addUsage( "                            --proof-bundle. No bitcoind is needed. " );
+    opt->addUsage( " --documents [dir|file]     Verify the DID documents in dir (*.json, *.jsonld, *.did.txt) " );
+    opt->addUsage( "                            against their DIDs' tips, writing one JSON result per line " );
+    opt->addUsage( " --jobs [#]                 Number of threads, each with its own RPC connection (default: 1) " );
+    opt->addUsage( " --cache [file]             Skip documents verified on an earlier run against the same tip, " );
+    opt->addUsage( "                            and add the ones verified now " );
     opt->addUsage( "" );
     opt->addUsage( "<did>                       the BTCR DID to verify. Could be txref or txref-ext based" );
 
@@ -70,6 +92,10 @@ int parseCommandLineArgs(int argc, char **argv, struct RpcConfig &config, struct
     opt->setOption("rpcpassword");
     opt->setOption("rpcport");
     opt->setCommandOption("config");
+    opt->setOption("proof-bundle");
+    opt->setOption("documents");
+    opt->setOption("jobs");
+    opt->setOption("cache");
 
     // parse any command line arguments--this is a first pass, mainly to get a possible
     // "config" option that tells if the bitcoin.conf file is in a non-default location
@@ -107,32 +133,62 @@ int parseCommandLineArgs(int argc, char **argv, struct RpcConfig &config, struct
         return 0;
     }
 
+    if (opt->getValue("proof-bundle") != nullptr) {
+        transactionData.proofBundle = opt->getValue("proof-bundle");
+    }
+
     // see if there is an rpcconnect specified. If not, use default
     if (opt->getValue("rpcconnect") != nullptr) {
         config.rpcconnect = opt->getValue("rpcconnect");
     }
 
-    // see if there is an rpcuser specified. If not, exit
-    if (opt->getValue("rpcuser") == nullptr) {
+    // see if there is an rpcuser specified. If not, exit, unless bitcoind isn't needed
+    if (opt->getValue("rpcuser") == nullptr && transactionData.proofBundle.empty()) {
         std::cerr << "'rpcuser' not found. Check bitcoin.conf or command line usage." << std::endl;
         opt->printUsage();
         return -1;
     }
-    config.rpcuser = opt->getValue("rpcuser");
+    if (opt->getValue("rpcuser") != nullptr)
+        config.rpcuser = opt->getValue("rpcuser");
 
-    // see if there is an rpcpassword specified. If not, exit
-    if (opt->getValue("rpcpassword") == nullptr) {
+    // see if there is an rpcpassword specified. If not, exit, unless bitcoind isn't needed
+    if (opt->getValue("rpcpassword") == nullptr && transactionData.proofBundle.empty()) {
         std::cerr << "'rpcpassword' not found. Check bitcoin.conf or command line usage." << std::endl;
         opt->printUsage();
         return -1;
     }
-    config.rpcpassword = opt->getValue("rpcpassword");
+    if (opt->getValue("rpcpassword") != nullptr)
+        config.rpcpassword = opt->getValue("rpcpassword");
 
     // will try both well known ports (8332 and 18332) if one is not specified
     if (opt->getValue("rpcport") != nullptr) {
         config.rpcport = convertIntegerArg("rpcport", opt.get());
     }
 
+    if (opt->getValue("jobs") != nullptr) {
+        transactionData.jobs = convertIntegerArg("jobs", opt.get());
+        if(transactionData.jobs < 1) {
+            std::cerr << "Error: jobs '" << transactionData.jobs << "' should be one or greater. Check command line usage.\n";
+            opt->printUsage();
+            return -1;
+        }
+    }
+
+    if (opt->getValue("cache") != nullptr) {
+        transactionData.cacheFile = opt->getValue("cache");
+    }
+
+    // the documents name their DIDs
+    if (opt->getValue("documents") != nullptr) {
+        transactionData.documents = opt->getValue("documents");
+        if(!transactionData.proofBundle.empty()) {
+            std::cerr << "Error: give either documents or proof-bundle, not both. Check command line usage.\n";
+            opt->printUsage();
+            return -1;
+        }
+        return 1;
+    }
+
     // get the positional arguments
     if(opt->getArgc() < 1) {
         std::cerr << "Error: all required arguments not found. Check command line usage." << std::endl;
@@ -147,6 +203,131 @@ int parseCommandLineArgs(int argc, char **argv, struct RpcConfig &config, struct
 }
 
 
+/**
+ * Verify a DID from a proof bundle, without a bitcoin node
+ * @param did the DID, which has to be the one the bundle is for
+ * @param path the bundle's file
+ * @return the exit status
+ */
+int verifyProofBundle(const std::string & did, const std::string & path) {
+    std::ifstream file(path, std::ios::binary);
+    if(!file) {
+        std::cerr << "Error: could not open proof bundle file '" << path << "'." << std::endl;
+        return -1;
+    }
+    std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    Result<ProofBundle> bundle = ProofBundle::parse(bytes.data(), bytes.size());
+    if(!bundle) {
+        std::cerr << "Error: " << bundle.error() << std::endl;
+        return -1;
+    }
+
+    // the same txref, however it is written
+    DecodedTxref requested, bundled;
+    TxrefDecodeStatus status = decodeTxref(did, requested);
+    if(status != TxrefDecodeStatus::ok) {
+        std::cerr << "Error: '" << did << "' is not a valid DID: " << describe(status) << std::endl;
+        return -1;
+    }
+    if(decodeTxref(bundle.value().getDid(), bundled) != TxrefDecodeStatus::ok ||
+       std::string(requested.chain) != bundled.chain || requested.blockHeight != bundled.blockHeight ||
+       requested.transactionIndex != bundled.transactionIndex || requested.txoIndex != bundled.txoIndex) {
+        std::cerr << "Error: the proof bundle is for " << bundle.value().getDid() << ", not " << did << std::endl;
+        return -1;
+    }
+
+    Result<VerifiedDid> verified = bundle.value().verify();
+    if(!verified) {
+        std::cerr << "Error: the proof bundle does not verify: " << verified.error() << std::endl;
+        return -1;
+    }
+    const VerifiedDid & result = verified.value();
+    std::cout << "Proof bundle verified:\n";
+    std::cout << "  txid: " << result.txid << "\n";
+    std::cout << "  block height: " << result.blockHeight << "\n";
+    std::cout << "  transaction index: " << result.transactionIndex << "\n";
+    std::cout << "  txoIndex: " << result.txoIndex << "\n";
+    std::cout << "  transactions in chain: " << result.numTransactions << "\n";
+    std::cout << "Last txid when the bundle was made: " << result.tipTxid << "\n";
+    std::cout << "  in block " << result.tipBlockHash << " at height " << result.tipBlockHeight << "\n";
+    std::cout << "Check that block against a trusted source: the bundle can't show it is on the best chain, "
+                 "or that the last txid's output is still unspent.\n";
+    return 0;
+}
+
+
+/**
+ * Verify DID documents against the chain, writing one line of JSON per document:
+ *
+ * 1) parse each document, and find its DID (its id), its #keys-1 public key, and its signatures
+ * 2) resolve the DIDs in parallel, following each one's chain to its tip (as didResolver --jobs)
+ * 3) extract the public key that signed each tip transaction, and check it is #keys-1
+ * 4) verify the documents' signatures, in batches spread over the threads
+ *
+ * @param rpcConfig how to connect to bitcoind
+ * @param transactionData the documents, threads and cache file
+ * @return the process exit code
+ */
+int verifyDocuments(const RpcConfig & rpcConfig, const TransactionData & transactionData) {
+    std::vector<VerificationRequest> requests = readDocuments(transactionData.documents);
+
+    VerificationCache cache;
+    if(!transactionData.cacheFile.empty())
+        cache.load(transactionData.cacheFile);
+
+    // chain.so is queried from several threads at once, so curl has to be set up beforehand
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+
+    std::vector<std::string> dids;
+    for(const VerificationRequest & request : requests)
+        dids.push_back(request.parsed ? request.document.did : "");
+
+    size_t jobs = static_cast<size_t>(transactionData.jobs);
+    auto facadeFactory = [&rpcConfig] { return std::unique_ptr<BitcoinRPCFacade>(new BitcoinRPCFacade(rpcConfig)); };
+    RpcCache rpcCache;
+    CachingChainSoQuery chainQuery;
+    ConcurrencyLimiter::Options limiterOptions;
+    limiterOptions.initialLimit = std::min(limiterOptions.initialLimit, static_cast<double>(jobs));
+    limiterOptions.maxLimit = transactionData.jobs;
+    ConcurrencyLimiter limiter(limiterOptions);
+    std::vector<DidResolution> resolutions;
+    {
+        ResolutionEngine engine(facadeFactory, rpcCache, chainQuery, jobs, &limiter);
+        resolutions = engine.resolve(dids);
+    }
+
+    DidVerifier verifier(transactionData.cacheFile.empty() ? nullptr : &cache);
+    std::vector<VerificationRecord> records = verifier.verifyAll(requests, resolutions, facadeFactory, jobs);
+
+    size_t numErrors = 0, numCached = 0;
+    for(const VerificationRecord & verification : records) {
+        nlohmann::json record;
+        record["file"] = verification.source;
+        if(!verification.did.empty())
+            record["did"] = verification.did;
+        if(verification.ok) {
+            record["last-txid"] = verification.tipTxid;
+            record["signatures"] = verification.signatures;
+            record["cached"] = verification.cached;
+            if(verification.cached)
+                ++numCached;
+        }
+        else {
+            record["error"] = verification.error;
+            ++numErrors;
+        }
+        std::cout << record.dump() << "\n";
+    }
+
+    if(!transactionData.cacheFile.empty())
+        cache.save(transactionData.cacheFile);
+    std::cerr << "Verified " << records.size() - numErrors << " of " << records.size() << " documents ("
+              << numCached << " unchanged since an earlier run)" << std::endl;
+    return numErrors > 0 ? -1 : 0;
+}
+
+
 int main(int argc, char *argv[]) {
 
     struct RpcConfig rpcConfig;
@@ -158,27 +339,17 @@ int main(int argc, char *argv[]) {
     }
 
 
-    try {
-
-        BitcoinRPCFacade btc(rpcConfig);
-
-        blockchaininfo_t blockChainInfo = btc.getblockchaininfo();
-
-        // 0. Determine InputType
-
-        txref::InputParam inputParam = txref::classifyInputString(transactionData.inputString);
+    if (!transactionData.proofBundle.empty()) {
+        std::exit(verifyProofBundle(transactionData.inputString, transactionData.proofBundle));
+    }
 
-            // skeleton of a diddo verifier:
-    //
-    // 1) verify that diddo is valid json-ld (how?)
-    // 2) extract txref from diddo (id field?)
-    // 3) decode txref to find block height, transaction index, and txo index
-    // 4) follow txo chain if necessary (as in didResolver) to find the last unspent output
-    // 5) Extract the hex-encoded public key that signed the transaction and verify it matches
-    //    the #keys-1 key in the authentication array
-    // 6) verify any signatures embeded in the other parts of the diddo
-    // 7) what else do we need to verify? urls? endpoints? references to x? what else can be signed?
+    if (transactionData.documents.empty()) {
+        std::cerr << "Error: nothing to verify: give --documents or --proof-bundle. Check command line usage." << std::endl;
+        std::exit(-1);
+    }
 
+    try {
+        std::exit(verifyDocuments(rpcConfig, transactionData));
     }
     catch(BitcoinException &e)
     {
@@ -1,38 +1,44 @@
 #include "did.h"
-#include "libtxref.h"
 #include <algorithm>
-#include <stdexcept>
+#include <type_traits>
+
+static_assert(std::is_trivially_copyable<Did>::value, "Did should be a plain value");
 
 namespace {
     const char schemeAndMethod[] = "did:btcr:";
+}
 
-    void validateDidString(const std::string &did) {
-        if (did.find(schemeAndMethod) != 0) {
-            throw std::runtime_error(
-                    "DID parameter not a valid BTCR DID. Should be of the form 'did:btcr:<txref>'");
-        }
-    }
+Did::Did(const std::string &did, const BitcoinRPCFacade & btc)
+        : Did(tryCreate(did, btc).value()) {
+}
+
+Did::Did(const Txref & t)
+        : txref(t) {
 }
 
-Did::Did(const std::string &did, const BitcoinRPCFacade & btc) {
+Result<Did> Did::tryCreate(const std::string &did, const BitcoinRPCFacade & btc) {
     // ensure lowercase
     std::string localDid = did;
     std::transform(localDid.begin(), localDid.end(), localDid.begin(), &::tolower);
 
-    validateDidString(localDid);
-
-    localDid.erase(0, sizeof(schemeAndMethod)-1);
-
-    txref::InputParam inputParam = txref::classifyInputString(localDid);
+    if (localDid.find(schemeAndMethod) != 0) {
+        return Result<Did>::failure(
+                "DID parameter not a valid BTCR DID. Should be of the form 'did:btcr:<txref>'");
+    }
 
-    if(inputParam != txref::InputParam::txref && inputParam != txref::InputParam::txrefext) {
-        throw std::runtime_error(
+    DecodedTxref decoded;
+    if(decodeTxref(localDid, decoded) != TxrefDecodeStatus::ok) {
+        return Result<Did>::failure(
                 "DID parameter doesn't contain a valid txref. Should be of the form 'did:btcr:<txref>'");
     }
 
-    txref = std::make_shared<Txref>(localDid, btc);
+    Result<Txref> foundTxref = Txref::tryCreate(decoded, btc);
+    if(!foundTxref)
+        return Result<Did>::failure(foundTxref);
+
+    return Result<Did>::success(Did(foundTxref.value()));
 }
 
-const std::shared_ptr<Txref> &Did::getTxref() const {
+const Txref &Did::getTxref() const {
     return txref;
 }
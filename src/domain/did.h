@@ -4,11 +4,13 @@
 
 #include "txref.h"
 #include "../bitcoinRPCFacade.h"
-#include <memory>
+#include "../result.h"
 #include <string>
 
 /**
  * This class represents a DID (decentralized identifier)
+ *
+ * A Did is a value type holding its Txref inline.
  */
 class Did {
 
@@ -21,14 +23,26 @@ public:
      */
     Did(const std::string & didStr, const BitcoinRPCFacade & btc);
 
+    /**
+     * Create a DID from a did string, like Did(const std::string &, const BitcoinRPCFacade &),
+     * but return a failure instead of throwing if the DID is not valid or can't be found.
+     * Errors from the BitcoinRPCFacade itself are still thrown.
+     * @param didStr the did string
+     * @param btc the BitcoinRPCFacade
+     * @return the Did, or why it could not be created
+     */
+    static Result<Did> tryCreate(const std::string & didStr, const BitcoinRPCFacade & btc);
+
     /**
      * Get the Txref associated with this Did
      * @return the Txref
      */
-    const std::shared_ptr<Txref> &getTxref() const;
+    const Txref &getTxref() const;
 
 private:
-    std::shared_ptr<Txref> txref;
+    explicit Did(const Txref & txref);
+
+    Txref txref;
 };
 
 
@@ -1,59 +1,97 @@
 #include "txid.h"
-#include <algorithm>
-#include <memory>
+#include "../hex.h"
+#include <cstring>
 #include <stdexcept>
+#include <type_traits>
 #include <bitcoinapi/types.h>
 #include <iostream>
 
-Txid::Txid(const std::string & inTxidStr, const BitcoinRPCFacade & btc) {
-    // lowercase for consistency
-    std::string t = inTxidStr;
-    std::transform(t.begin(), t.end(), t.begin(), &::tolower);
+static_assert(std::is_trivially_copyable<Txid>::value, "Txid should be a plain value");
+
+namespace {
+    // hex decoding accepts either case; encoding again gives the lowercase form bitcoind uses
+    std::string lowercaseTxid(const std::string & txidStr) {
+        uint8_t bytes[32];
+        hex::decode(txidStr.data(), txidStr.size(), bytes);
+        return hex::encode(bytes, sizeof(bytes));
+    }
+}
+
+Txid::Txid(const std::string & inTxidStr, const BitcoinRPCFacade & btc)
+        : Txid(tryCreate(inTxidStr, btc).value()) {
+}
 
-    if(!isInputStringValid(t))
+Txid::Txid(const std::string & inTxidStr, const BlockHeight & blockHeight,
+           const TransactionIndex & transactionIndex, bool testnet)
+        : height(blockHeight), index(transactionIndex), testnet(testnet) {
+    if(!isInputStringValid(inTxidStr))
         throw std::runtime_error("input string not valid");
 
+    hex::decode(inTxidStr.data(), inTxidStr.size(), txidBytes.data());
+}
+
+Result<Txid> Txid::tryCreate(const std::string & inTxidStr, const BitcoinRPCFacade & btc) {
+    if(!isInputStringValid(inTxidStr))
+        return Result<Txid>::failure("input string not valid");
+
+    // lowercase for consistency
+    std::string t = lowercaseTxid(inTxidStr);
+
     if(!existsInNetwork(t, btc))
-        throw std::runtime_error("txid does not exist");
+        return Result<Txid>::failure("txid does not exist");
 
-    extractTransactionDetails(t, btc);
+    return extractTransactionDetails(t, btc);
+}
+
+Result<Txid> Txid::tryCreate(const std::string & inTxidStr, const blockinfo_t & block, const BitcoinRPCFacade & btc) {
+    if(!isInputStringValid(inTxidStr))
+        return Result<Txid>::failure("input string not valid");
 
-    txidStr = t;
+    return findInBlock(lowercaseTxid(inTxidStr), block, btc);
 }
 
 /**
  * Test for validity of the txid input string
  *
- * Tests to see if the input string is exactly 64 characters long and contains only digits
- * and hex chars
+ * Tests to see if the input string is exactly 64 characters long and contains only hex
+ * digits, in either case
  *
  * @param inTxidStr the string to test
  * @return true if it is a valid txid string
  */
-bool Txid::isInputStringValid(const std::string & inTxidStr) const {
-    return inTxidStr.length() == 64 &&
-            inTxidStr.find_first_not_of("0123456789abcdef") == std::string::npos;
+bool Txid::isInputStringValid(const std::string & inTxidStr) {
+    return inTxidStr.length() == 64 && hex::isValid(inTxidStr);
 }
 
-bool Txid::existsInNetwork(const std::string & inTxidStr, const BitcoinRPCFacade & btc) const {
+bool Txid::existsInNetwork(const std::string & inTxidStr, const BitcoinRPCFacade & btc) {
     // use txid to call getrawtransaction
     getrawtransaction_t rawTransaction = btc.getrawtransaction(inTxidStr, 0);
     return !rawTransaction.hex.empty();
 }
 
 std::string Txid::asString() const {
-    return txidStr;
+    return hex::encode(txidBytes.data(), txidBytes.size());
+}
+
+const std::array<uint8_t, 32> & Txid::bytes() const {
+    return txidBytes;
+}
+
+BlockHeight Txid::blockHeight() const {
+    return height;
 }
 
-std::shared_ptr<BlockHeight> Txid::blockHeight() const {
-    return pBlockHeight;
+TransactionIndex Txid::transactionIndex() const {
+    return index;
 }
 
-std::shared_ptr<TransactionIndex> Txid::transactionIndex() const {
-    return pTransactionIndex;
+size_t Txid::hash() const {
+    size_t h;
+    std::memcpy(&h, txidBytes.data(), sizeof(h));
+    return h;
 }
 
-void Txid::extractTransactionDetails(const std::string & inTxidStr, const BitcoinRPCFacade & btc) {
+Result<Txid> Txid::extractTransactionDetails(const std::string & inTxidStr, const BitcoinRPCFacade & btc) {
 
     // use txid to call getrawtransaction to find the blockhash
     getrawtransaction_t rawTransaction = btc.getrawtransaction(inTxidStr, 1);
@@ -61,30 +99,36 @@ void Txid::extractTransactionDetails(const std::string & inTxidStr, const Bitcoi
 
     // use blockhash to call getblock to find the block height
     blockinfo_t blockInfo = btc.getblock(blockHash);
-    int blockHeight = blockInfo.height;
 
-    pBlockHeight = std::make_shared<BlockHeight>(blockHeight);
+    return findInBlock(inTxidStr, blockInfo, btc);
+}
+
+Result<Txid> Txid::findInBlock(const std::string & inTxidStr, const blockinfo_t & blockInfo, const BitcoinRPCFacade & btc) {
+
+    if (blockInfo.height < 0) {
+        return Result<Txid>::failure("Could not find the block for transaction " + inTxidStr);
+    }
 
     // TODO warn if #confirmations are too low
 
     // determine what network we are on
     blockchaininfo_t blockChainInfo = btc.getblockchaininfo();
-    testnet = blockChainInfo.chain == "test";
+    bool testnet = blockChainInfo.chain == "test";
 
     // go through block's transaction array to find transaction index
-    std::vector<std::string> blockTransactions = blockInfo.tx;
+    const std::vector<std::string> & blockTransactions = blockInfo.tx;
     std::vector<std::string>::size_type blockIndex;
     for (blockIndex = 0; blockIndex < blockTransactions.size(); ++blockIndex) {
-        std::string blockTxid = blockTransactions.at(blockIndex);
-        if (blockTxid == inTxidStr)
+        if (blockTransactions[blockIndex] == inTxidStr)
             break;
     }
 
     if (blockIndex == blockTransactions.size()) {
-        throw std::runtime_error("Could not find transaction " + inTxidStr + "within the block");
+        return Result<Txid>::failure("Could not find transaction " + inTxidStr + "within the block");
     }
 
-    pTransactionIndex = std::make_shared<TransactionIndex>(blockIndex);
+    return Result<Txid>::success(Txid(inTxidStr, BlockHeight(blockInfo.height),
+                                      TransactionIndex(static_cast<int>(blockIndex)), testnet));
 
 }
 
@@ -93,13 +137,12 @@ bool Txid::isTestnet() const {
 }
 
 bool Txid::operator==(const Txid &rhs) const {
-    return *pBlockHeight == *rhs.pBlockHeight &&
-           *pTransactionIndex == *rhs.pTransactionIndex &&
+    return height == rhs.height &&
+           index == rhs.index &&
            testnet == rhs.testnet &&
-           txidStr == rhs.txidStr;
+           txidBytes == rhs.txidBytes;
 }
 
 bool Txid::operator!=(const Txid &rhs) const {
     return !(rhs == *this);
 }
-
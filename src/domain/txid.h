@@ -4,12 +4,20 @@
 
 #include "blockHeight.h"
 #include "../bitcoinRPCFacade.h"
+#include "../result.h"
 #include "transactionIndex.h"
-#include <memory>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <string>
 
 /**
  * This class represents a TXID (transaction ID)
+ *
+ * A Txid is a small value type: the txid is kept as 32 raw bytes, and its block height,
+ * transaction index and network are held inline, so Txids can be copied freely and used
+ * as keys in unordered containers.
  */
 class Txid {
 
@@ -23,21 +31,64 @@ public:
      */
     Txid(const std::string & inTxidStr, const BitcoinRPCFacade & btc);
 
+    /**
+     * Construct a Txid from details that are already known, without asking the network.
+     * @param inTxidStr the hexadecimal txid string
+     * @param blockHeight the height of the block containing the transaction
+     * @param transactionIndex the position of the transaction within its block
+     * @param testnet true if the transaction is in bitcoin testnet
+     */
+    Txid(const std::string & inTxidStr, const BlockHeight & blockHeight,
+         const TransactionIndex & transactionIndex, bool testnet);
+
+    /**
+     * Create a Txid from the txid string, like Txid(const std::string &, const BitcoinRPCFacade &),
+     * but return a failure instead of throwing if the txid is not valid or can't be found.
+     * Errors from the BitcoinRPCFacade itself are still thrown.
+     * @param inTxidStr the hexadecimal txid string
+     * @param btc the BitcoinRPCFacade
+     * @return the Txid, or why it could not be created
+     */
+    static Result<Txid> tryCreate(const std::string & inTxidStr, const BitcoinRPCFacade & btc);
+
+    /**
+     * Create a Txid for a transaction in a block that has already been fetched. The
+     * transaction itself is not looked up, so this works on a bitcoind without -txindex.
+     * @param inTxidStr the hexadecimal txid string
+     * @param block the block containing the transaction
+     * @param btc the BitcoinRPCFacade, to find out which network the block is in
+     * @return the Txid, or why it could not be created
+     */
+    static Result<Txid> tryCreate(const std::string & inTxidStr, const blockinfo_t & block, const BitcoinRPCFacade & btc);
+
     /**
      * Get this Txid as a string
-     * @return this Txid as a string
+     * @return this Txid as a lowercase hexadecimal string
      */
     std::string asString() const;
 
+    /**
+     * Get the raw bytes of this Txid, in the same order as its string form
+     * @return the 32 bytes of this Txid
+     */
+    const std::array<uint8_t, 32> & bytes() const;
+
     /**
      * Is this Txid in bitcoin mainnet or testnet?
      * @return true if Txid is in bitcoin testnet
      */
     bool isTestnet() const;
 
-    std::shared_ptr<BlockHeight> blockHeight() const;
+    BlockHeight blockHeight() const;
+
+    TransactionIndex transactionIndex() const;
 
-    std::shared_ptr<TransactionIndex> transactionIndex() const;
+    /**
+     * Get a hash value for this Txid. The txid is itself a hash, so some of its bytes
+     * are used as they are.
+     * @return the hash value
+     */
+    size_t hash() const;
 
     bool operator==(const Txid &rhs) const;
 
@@ -48,12 +99,12 @@ private:
     /**
      * Checks the validity of the txid string.
      *
-     * Validity means: must be 64 lowercase hexadecimal characters.
+     * Validity means: must be 64 hexadecimal characters, in either case.
      *
      * @param inTxidStr the txid string to check
      * @return true if valid
      */
-    bool isInputStringValid(const std::string & inTxidStr) const;
+    static bool isInputStringValid(const std::string & inTxidStr);
 
     /**
      * Checks if the txid really exists in the bitcoin network
@@ -62,24 +113,43 @@ private:
      * @param btc the BitcoinRPCFacade
      * @return true if exists
      */
-    bool existsInNetwork(const std::string & inTxidStr, const BitcoinRPCFacade & btc) const;
+    static bool existsInNetwork(const std::string & inTxidStr, const BitcoinRPCFacade & btc);
 
     /**
-     * Get full transaction data from bitcoin network and initialize other class members
+     * Get full transaction data from bitcoin network and create the Txid from it
      *
      * @param inTxidStr the txid string
      * @param btc the BitcoinRPCFacade
+     * @return the Txid, or why it could not be created
      */
-    void extractTransactionDetails(const std::string & inTxidStr, const BitcoinRPCFacade &btc);
+    static Result<Txid> extractTransactionDetails(const std::string & inTxidStr, const BitcoinRPCFacade &btc);
 
+    /**
+     * Find the transaction in its block and create the Txid from it
+     *
+     * @param inTxidStr the lowercase txid string
+     * @param blockInfo the block containing the transaction
+     * @param btc the BitcoinRPCFacade
+     * @return the Txid, or why it could not be created
+     */
+    static Result<Txid> findInBlock(const std::string & inTxidStr, const blockinfo_t & blockInfo, const BitcoinRPCFacade & btc);
 
-    std::shared_ptr<BlockHeight> pBlockHeight;
-    std::shared_ptr<TransactionIndex> pTransactionIndex;
 
+    std::array<uint8_t, 32> txidBytes;
+    BlockHeight height;
+    TransactionIndex index;
     bool testnet;
-    std::string txidStr;
 
 };
 
+namespace std {
+    template <>
+    struct hash<Txid> {
+        size_t operator()(const Txid & txid) const {
+            return txid.hash();
+        }
+    };
+}
+
 
 #endif //BTCR_DID_TXID_H
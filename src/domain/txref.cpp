@@ -1,82 +1,115 @@
 #include "libtxref.h"
 #include "txref.h"
-#include <memory>
+#include "../rawTransaction.h"
+#include <sstream>
 #include <stdexcept>
+#include <type_traits>
 #include <bitcoinapi/types.h>
-#include <iostream>
+
+static_assert(std::is_trivially_copyable<Txref>::value, "Txref should be a plain value");
 
 Txref::Txref(const Txid & t, const Vout & v, const BitcoinRPCFacade & btc)
-{
-    // make copies of passed in parameters
-    txid = std::make_shared<Txid>(t);
-    vout = std::make_shared<Vout>(v);
+        : Txref(tryCreate(t, v, btc).value()) {
+}
 
-    if(!verifyVoutForTxid(btc)) {
-        throw std::runtime_error("vout provided is too large for this transaction");
-    }
+Txref::Txref(const std::string &t, const BitcoinRPCFacade &btc)
+        : Txref(tryCreate(t, btc).value()) {
+}
 
-    // call txref encode with block height, transaction index, and vout to get txref string
-    if (txid->isTestnet()) {
-        txrefStr = txref::encodeTestnet(
-                txid->blockHeight()->value(),
-                txid->transactionIndex()->value(),
-                vout->value(),
-                true); // TODO forceExtended = true for now
-    } else {
-        txrefStr = txref::encode(
-                txid->blockHeight()->value(),
-                txid->transactionIndex()->value(),
-                vout->value(),
-                true); // TODO forceExtended = true for now
-    }
+Txref::Txref(const DecodedTxref & decoded, const BitcoinRPCFacade & btc)
+        : Txref(tryCreate(decoded, btc).value()) {
+}
+
+Txref::Txref(const Txid & t, const Vout & v, bool e)
+        : txid(t), vout(v), extended(e) {
 }
 
-Txref::Txref(const std::string &t, const BitcoinRPCFacade &btc) {
+Result<Txref> Txref::tryCreate(const Txid & t, const Vout & v, const BitcoinRPCFacade & btc) {
+    if(!verifyVoutForTxid(t, v, btc)) {
+        return Result<Txref>::failure("vout provided is too large for this transaction");
+    }
+
+    return Result<Txref>::success(Txref(t, v, true)); // TODO forceExtended = true for now
+}
 
-    // make copies of passed in parameters
-    txrefStr = t;
+Result<Txref> Txref::tryCreate(const std::string &t, const BitcoinRPCFacade &btc) {
+    DecodedTxref decoded;
+    TxrefDecodeStatus status = decodeTxref(t, decoded);
+    if(status != TxrefDecodeStatus::ok)
+        return Result<Txref>::failure(describe(status));
 
-    txref::DecodedResult decodedResult = txref::decode(txrefStr);
+    return tryCreate(decoded, btc);
+}
 
+Result<Txref> Txref::tryCreate(const DecodedTxref & decoded, const BitcoinRPCFacade &btc) {
 
     // get block hash for block
-    std::string blockHash = btc.getblockhash(decodedResult.blockHeight);
+    std::string blockHash = btc.getblockhash(decoded.blockHeight);
 
     // use block hash to get the block info
     blockinfo_t blockInfo = btc.getblock(blockHash);
 
     // get the txid from the transaction
-    std::string txidStr;
-    try {
-        txidStr = blockInfo.tx.at(
-                static_cast<unsigned long>(decodedResult.transactionIndex));
-    }
-    catch (std::out_of_range &) {
-        std::cerr << "Error: Could not find transaction " << txrefStr
-                  << " within the block." << std::endl;
-        std::exit(-1);
+    auto transactionIndex = static_cast<std::vector<std::string>::size_type>(decoded.transactionIndex);
+    if (transactionIndex >= blockInfo.tx.size()) {
+        std::stringstream ss;
+        ss << "Could not find transaction " << decoded.transactionIndex
+           << " within block " << decoded.blockHeight << ".";
+        return Result<Txref>::failure(ss.str());
     }
 
-    txid = std::make_shared<Txid>(txidStr, btc);
-    vout = std::make_shared<Vout>(decodedResult.txoIndex);
+    // the block is already at hand, so the transaction needn't be looked up (which needs -txindex)
+    Result<Txid> foundTxid = Txid::tryCreate(blockInfo.tx[transactionIndex], blockInfo, btc);
+    if(!foundTxid)
+        return Result<Txref>::failure(foundTxid);
 
+    return Result<Txref>::success(Txref(foundTxid.value(), Vout(decoded.txoIndex), decoded.extended));
 }
 
-std::string Txref::asString() {
-    return txrefStr;
+std::string Txref::asString() const {
+    // call txref encode with block height, transaction index, and vout to get txref string
+    if (txid.isTestnet()) {
+        return txref::encodeTestnet(
+                txid.blockHeight().value(),
+                txid.transactionIndex().value(),
+                vout.value(),
+                extended);
+    }
+    return txref::encode(
+            txid.blockHeight().value(),
+            txid.transactionIndex().value(),
+            vout.value(),
+            extended);
 }
 
-bool Txref::verifyVoutForTxid(const BitcoinRPCFacade & btc) {
-    // use txid to call getrawtransaction to find the blockhash
-    getrawtransaction_t rawTransaction = btc.getrawtransaction(txid->asString(), 1);
-    return rawTransaction.vout.size() >= static_cast<std::vector<vout_t>::size_type >(vout->value());
+bool Txref::verifyVoutForTxid(const Txid & t, const Vout & v, const BitcoinRPCFacade & btc) {
+    // look the transaction up in its block, so bitcoind doesn't need -txindex, and parse the
+    // serialized transaction ourselves rather than have bitcoind decode it to JSON
+    std::string blockHash = btc.getblockhash(t.blockHeight().value());
+    Result<RawTransaction> parsed = RawTransaction::fromHex(btc.getrawtransactioninblock(t.asString(), blockHash));
+    if(!parsed)
+        return false;
+    return static_cast<size_t>(v.value()) < parsed.value().outputs().size();
 }
 
-const std::shared_ptr<Txid> &Txref::getTxid() const {
+const Txid &Txref::getTxid() const {
     return txid;
 }
 
-const std::shared_ptr<Vout> &Txref::getVout() const {
+const Vout &Txref::getVout() const {
     return vout;
 }
 
+bool Txref::isExtended() const {
+    return extended;
+}
+
+bool Txref::operator==(const Txref &rhs) const {
+    return txid == rhs.txid &&
+           vout == rhs.vout &&
+           extended == rhs.extended;
+}
+
+bool Txref::operator!=(const Txref &rhs) const {
+    return !(rhs == *this);
+}
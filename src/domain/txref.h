@@ -5,11 +5,15 @@
 #include "txid.h"
 #include "blockHeight.h"
 #include "transactionIndex.h"
+#include "txrefDecoder.h"
 #include "../bitcoinRPCFacade.h"
-#include <memory>
+#include <string>
 
 /**
  * This class represents a TXREF: a transaction reference ...
+ *
+ * A Txref is a value type holding its Txid and Vout inline. Its string form is encoded
+ * from them when asked for.
  */
 class Txref {
 
@@ -31,34 +35,89 @@ public:
      */
     Txref(const std::string & txref, const BitcoinRPCFacade & btc);
 
+    /**
+     * Construct a Txref from the fields of a decoded txref string. Use BitcoinRPCFacade to
+     * find the transaction and validate its existence.
+     * @param decoded the fields decoded from a txref string
+     * @param btc the BitcoinRPCFacade
+     */
+    Txref(const DecodedTxref & decoded, const BitcoinRPCFacade & btc);
+
+    /**
+     * Construct a Txref from a Txid and Vout that have already been validated.
+     * @param txid the Txid for the transaction
+     * @param vout the Vout for the output being referenced
+     * @param extended true to use the extended (txref-ext) encoding
+     */
+    Txref(const Txid & txid, const Vout & vout, bool extended);
+
+    /**
+     * Create a Txref from a Txid and Vout, like Txref(const Txid &, const Vout &, const BitcoinRPCFacade &),
+     * but return a failure instead of throwing if the Vout is not in the transaction.
+     * @param txid the Txid for the transaction
+     * @param vout the Vout for the output being referenced
+     * @param btc the BitcoinRPCFacade
+     * @return the Txref, or why it could not be created
+     */
+    static Result<Txref> tryCreate(const Txid & txid, const Vout & vout, const BitcoinRPCFacade & btc);
+
+    /**
+     * Create a Txref from a txref string, like Txref(const std::string &, const BitcoinRPCFacade &),
+     * but return a failure instead of throwing if the txref is not valid or can't be found.
+     * Errors from the BitcoinRPCFacade itself are still thrown.
+     * @param txref the txref string
+     * @param btc the BitcoinRPCFacade
+     * @return the Txref, or why it could not be created
+     */
+    static Result<Txref> tryCreate(const std::string & txref, const BitcoinRPCFacade & btc);
+
+    /**
+     * Create a Txref from the fields of a decoded txref string, like
+     * Txref(const DecodedTxref &, const BitcoinRPCFacade &), but return a failure instead of
+     * throwing if the transaction can't be found.
+     * @param decoded the fields decoded from a txref string
+     * @param btc the BitcoinRPCFacade
+     * @return the Txref, or why it could not be created
+     */
+    static Result<Txref> tryCreate(const DecodedTxref & decoded, const BitcoinRPCFacade & btc);
+
     /**
      * Get this Txref as a string
      * @return this Txref as a string
      */
-    std::string asString();
+    std::string asString() const;
 
     /**
      * Get the Txid associated with this Txref
      * @return the Txid
      */
-    const std::shared_ptr<Txid> &getTxid() const;
+    const Txid & getTxid() const;
 
     /**
      * Get the Vout associated with this Txref
      * @return the Vout
      */
-    const std::shared_ptr<Vout> &getVout() const;
+    const Vout & getVout() const;
 
-private:
-    std::shared_ptr<Txid> txid;
-    std::shared_ptr<Vout> vout;
+    /**
+     * Is this Txref encoded as a txref-ext?
+     * @return true if extended
+     */
+    bool isExtended() const;
 
-    std::string txrefStr;
+    bool operator==(const Txref &rhs) const;
+
+    bool operator!=(const Txref &rhs) const;
+
+private:
+    Txid txid;
+    Vout vout;
+    bool extended;
 
     /**
-     * Verify that the transaction referred to by the Txid has enough Vouts
+     * Verify that the transaction referred to by the Txid has an output at this Vout
      */
-    bool verifyVoutForTxid(const BitcoinRPCFacade & btc);
+    static bool verifyVoutForTxid(const Txid & txid, const Vout & vout, const BitcoinRPCFacade & btc);
 };
 
 
@@ -0,0 +1,170 @@
+#include "txrefDecoder.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+namespace {
+    const char didScheme[] = "did:btcr:";
+
+    // a txref is a magic code, 8 data characters (11 when extended with a txo index), then
+    // a 6 character checksum
+    const size_t shortLength = 15;
+    const size_t extendedLength = 18;
+
+    // bech32m checksum constant, as used by libtxref
+    const uint32_t checksumConstant = 0x2bc830a3;
+
+    struct Network {
+        const char * hrp;
+        const char * chain;
+        uint8_t magicCode;
+        uint8_t magicCodeExtended;
+    };
+
+    const Network networks[] = {
+            {"tx", "main", 3, 4},
+            {"txtest", "test", 6, 7},
+            {"txrt", "regtest", 0, 1}
+    };
+
+    /**
+     * Maps a bech32 character (either case) to its 5-bit value, or -1
+     */
+    int charValue(char c) {
+        static const char charset[] = "qpzry9x8gf2tvdw0s3jn54khce6mua7l";
+        if(c >= 'A' && c <= 'Z')
+            c = static_cast<char>(c - 'A' + 'a');
+        const char * found = std::strchr(charset, c);
+        return c != '\0' && found != nullptr ? static_cast<int>(found - charset) : -1;
+    }
+
+    char toLower(char c) {
+        return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+    }
+
+    bool equalsIgnoringCase(const char * str, size_t len, const char * lower) {
+        size_t i = 0;
+        for(; i < len && lower[i] != '\0'; ++i) {
+            if(toLower(str[i]) != lower[i])
+                return false;
+        }
+        return i == len && lower[i] == '\0';
+    }
+
+    uint32_t polymodStep(uint32_t chk, uint8_t value) {
+        static const uint32_t generator[] = {0x3b6a57b2, 0x26508e6d, 0x1ea119fa, 0x3d4233dd, 0x2a1462b3};
+        uint32_t top = chk >> 25;
+        chk = (chk & 0x1ffffff) << 5 ^ value;
+        for(int i = 0; i < 5; ++i) {
+            if((top >> i) & 1)
+                chk ^= generator[i];
+        }
+        return chk;
+    }
+
+    uint32_t checksum(const char * hrp, const uint8_t * data, size_t len) {
+        uint32_t chk = 1;
+        for(const char * p = hrp; *p != '\0'; ++p)
+            chk = polymodStep(chk, static_cast<uint8_t>(*p >> 5));
+        chk = polymodStep(chk, 0);
+        for(const char * p = hrp; *p != '\0'; ++p)
+            chk = polymodStep(chk, static_cast<uint8_t>(*p & 0x1f));
+        for(size_t i = 0; i < len; ++i)
+            chk = polymodStep(chk, data[i]);
+        return chk;
+    }
+}
+
+TxrefDecodeStatus decodeTxref(const char * str, size_t len, DecodedTxref & decoded) {
+
+    const char * begin = str;
+    const char * end = str + len;
+
+    const size_t schemeLength = sizeof(didScheme) - 1;
+    if(len >= schemeLength && equalsIgnoringCase(begin, schemeLength, didScheme))
+        begin += schemeLength;
+
+    // an hrp, if present, ends with the separator '1', which can't appear in the data
+    const Network * hrpNetwork = nullptr;
+    const char * separator = std::find(begin, end, '1');
+    if(separator != end) {
+        for(const Network & network : networks) {
+            if(equalsIgnoringCase(begin, static_cast<size_t>(separator - begin), network.hrp))
+                hrpNetwork = &network;
+        }
+        if(hrpNetwork == nullptr)
+            return TxrefDecodeStatus::badHrp;
+        begin = separator + 1;
+        if(begin != end && *begin == ':')
+            ++begin;
+    }
+
+    uint8_t data[extendedLength];
+    size_t dataLength = 0;
+    for(const char * p = begin; p != end; ++p) {
+        if(*p == '-')
+            continue;
+        if(end - p >= 3 && std::memcmp(p, "\xe2\x80\x91", 3) == 0) {
+            p += 2;
+            continue;
+        }
+        int value = charValue(*p);
+        if(value < 0)
+            return TxrefDecodeStatus::badCharacter;
+        if(dataLength == extendedLength)
+            return TxrefDecodeStatus::badLength;
+        data[dataLength++] = static_cast<uint8_t>(value);
+    }
+
+    if(dataLength != shortLength && dataLength != extendedLength)
+        return TxrefDecodeStatus::badLength;
+
+    // the magic code tells us the network, and whether the txref is extended
+    const Network * network = nullptr;
+    for(const Network & n : networks) {
+        if(data[0] == n.magicCode || data[0] == n.magicCodeExtended)
+            network = &n;
+    }
+    if(network == nullptr)
+        return TxrefDecodeStatus::badMagicCode;
+    if(hrpNetwork != nullptr && hrpNetwork != network)
+        return TxrefDecodeStatus::badHrp;
+
+    bool extended = data[0] == network->magicCodeExtended;
+    if(extended != (dataLength == extendedLength))
+        return TxrefDecodeStatus::badLength;
+
+    if(checksum(network->hrp, data, dataLength) != checksumConstant)
+        return TxrefDecodeStatus::badChecksum;
+
+    if(data[1] & 1)
+        return TxrefDecodeStatus::badVersion;
+
+    decoded.blockHeight = data[1] >> 1 | data[2] << 4 | data[3] << 9 | data[4] << 14 | data[5] << 19;
+    decoded.transactionIndex = data[6] | data[7] << 5 | data[8] << 10;
+    decoded.txoIndex = extended ? data[9] | data[10] << 5 | data[11] << 10 : 0;
+    decoded.chain = network->chain;
+    decoded.extended = extended;
+
+    return TxrefDecodeStatus::ok;
+}
+
+const char * describe(TxrefDecodeStatus status) {
+    switch(status) {
+        case TxrefDecodeStatus::ok:
+            return "ok";
+        case TxrefDecodeStatus::badHrp:
+            return "txref has an unknown or mismatched hrp";
+        case TxrefDecodeStatus::badCharacter:
+            return "txref contains an invalid character";
+        case TxrefDecodeStatus::badLength:
+            return "txref has the wrong length";
+        case TxrefDecodeStatus::badChecksum:
+            return "txref checksum is not valid";
+        case TxrefDecodeStatus::badMagicCode:
+            return "txref has an unknown magic code";
+        case TxrefDecodeStatus::badVersion:
+            return "txref has an unsupported version";
+    }
+    return "unknown txref decode status";
+}
@@ -0,0 +1,62 @@
+#ifndef BTCR_DID_TXREFDECODER_H
+#define BTCR_DID_TXREFDECODER_H
+
+#include <cstddef>
+#include <string>
+
+/**
+ * The fields encoded within a txref
+ */
+struct DecodedTxref {
+    int blockHeight = 0;
+    int transactionIndex = 0;
+    int txoIndex = 0;
+    /** bitcoind's name for the chain: "main", "test" or "regtest" */
+    const char * chain = "";
+    bool extended = false;
+};
+
+/**
+ * Reasons a txref could not be decoded
+ */
+enum class TxrefDecodeStatus {
+    ok,
+    badHrp,
+    badCharacter,
+    badLength,
+    badChecksum,
+    badMagicCode,
+    badVersion
+};
+
+/**
+ * Decode the block height, transaction index and txo index from a txref, without asking
+ * the network and without allocating.
+ *
+ * Accepts a bare txref ("8z4h-jz7l-qpqq-xkh8-xa"), one with its hrp ("txtest1:8z4h-jz7l-qpqq-xkh8-xa"),
+ * or either of those as a DID ("did:btcr:8z4h-jz7l-qpqq-xkh8-xa"). Case is ignored, and '-' and
+ * U+2011 (non-breaking hyphen) separators are skipped. The checksum is verified.
+ *
+ * @param str the txref or DID characters
+ * @param len the number of characters
+ * @param decoded where to put the decoded fields
+ * @return TxrefDecodeStatus::ok, or the reason the txref is not valid
+ */
+TxrefDecodeStatus decodeTxref(const char * str, size_t len, DecodedTxref & decoded);
+
+/**
+ * Decode the fields from a txref string. See decodeTxref(const char *, size_t, DecodedTxref &)
+ */
+inline TxrefDecodeStatus decodeTxref(const std::string & str, DecodedTxref & decoded) {
+    return decodeTxref(str.data(), str.size(), decoded);
+}
+
+/**
+ * Describe a TxrefDecodeStatus
+ *
+ * @param status the status
+ * @return a static description of the status
+ */
+const char * describe(TxrefDecodeStatus status);
+
+#endif //BTCR_DID_TXREFDECODER_H
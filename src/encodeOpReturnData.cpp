@@ -1,7 +1,5 @@
 #include "encodeOpReturnData.h"
-
-#include <sstream>
-#include <iomanip>
+#include "hex.h"
 
 namespace {
     const int MAX_OP_RETURN_LENGTH = 80;
@@ -12,11 +10,5 @@ std::string encodeOpReturnData(const std::string &data) {
     if(data.length() > MAX_OP_RETURN_LENGTH) {
         return "";
     }
-    std::stringstream ss;
-    ss << std::hex << std::setfill('0');
-    for (char c : data)
-    {
-        ss << std::setw(2) << static_cast<unsigned>(c);
-    }
-    return ss.str();
+    return hex::encode(data);
 }
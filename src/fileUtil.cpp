@@ -0,0 +1,20 @@
+#include "fileUtil.h"
+
+#include <cstdio>
+#include <fstream>
+
+bool hasSuffix(const std::string & name, const std::string & suffix) {
+    return name.size() > suffix.size() && name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+bool replaceFile(const std::string & path, const std::string & contents) {
+    std::string temporaryPath = path + ".tmp";
+    std::ofstream file(temporaryPath, std::ios::trunc);
+    file << contents;
+    file.close();
+    if(!file || std::rename(temporaryPath.c_str(), path.c_str()) != 0) {
+        std::remove(temporaryPath.c_str());
+        return false;
+    }
+    return true;
+}
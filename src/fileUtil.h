@@ -0,0 +1,21 @@
+#ifndef TXREF_FILEUTIL_H
+#define TXREF_FILEUTIL_H
+
+#include <string>
+
+/**
+ * Does this file name end with the suffix, and have something before it?
+ */
+bool hasSuffix(const std::string & name, const std::string & suffix);
+
+/**
+ * Replace a file's contents. They are written aside, then renamed over the old file, so the
+ * file is never left half written.
+ * @param path the file's path
+ * @param contents what the file will hold
+ * @return false if the file couldn't be written; it then still holds what it did before
+ */
+bool replaceFile(const std::string & path, const std::string & contents);
+
+
+#endif //TXREF_FILEUTIL_H
@@ -0,0 +1,95 @@
+#include "forwardingBitcoinRPCFacade.h"
+
+#include <bitcoinapi/types.h>
+
+ForwardingBitcoinRPCFacade::ForwardingBitcoinRPCFacade(const BitcoinRPCFacade & d)
+        : delegate(d) {
+}
+
+ForwardingBitcoinRPCFacade::~ForwardingBitcoinRPCFacade() = default;
+
+getrawtransaction_t ForwardingBitcoinRPCFacade::getrawtransaction(const std::string &txid, int verbose) const {
+    return delegate.getrawtransaction(txid, verbose);
+}
+
+blockinfo_t ForwardingBitcoinRPCFacade::getblock(const std::string &blockhash) const {
+    return delegate.getblock(blockhash);
+}
+
+std::string ForwardingBitcoinRPCFacade::getblockhash(int blocknumber) const {
+    return delegate.getblockhash(blocknumber);
+}
+
+utxoinfo_t ForwardingBitcoinRPCFacade::gettxout(const std::string &txid, int n) const {
+    return delegate.gettxout(txid, n);
+}
+
+std::string ForwardingBitcoinRPCFacade::createrawtransaction(
+        const std::vector<txout_t> &inputs,
+        const std::map<std::string, double> &amounts) const {
+    return delegate.createrawtransaction(inputs, amounts);
+}
+
+std::string ForwardingBitcoinRPCFacade::createrawtransaction(
+        const std::vector<txout_t> &inputs,
+        const std::map<std::string, std::string> &amounts) const {
+    return delegate.createrawtransaction(inputs, amounts);
+}
+
+blockchaininfo_t ForwardingBitcoinRPCFacade::getblockchaininfo() const {
+    return delegate.getblockchaininfo();
+}
+
+std::string ForwardingBitcoinRPCFacade::signrawtransactionwithkey(
+        const std::string &rawTx, const std::vector<signrawtxinext_t> &inputs,
+        const std::vector<std::string> &privkeys, const std::string &sighashtype) const {
+    return delegate.signrawtransactionwithkey(rawTx, inputs, privkeys, sighashtype);
+}
+
+btcaddressinfo_t ForwardingBitcoinRPCFacade::getaddressinfo(const std::string &address) const {
+    return delegate.getaddressinfo(address);
+}
+
+std::string ForwardingBitcoinRPCFacade::getrawblock(const std::string &blockhash) const {
+    return delegate.getrawblock(blockhash);
+}
+
+std::string ForwardingBitcoinRPCFacade::getrawtransactioninblock(const std::string &txid, const std::string &blockhash) const {
+    return delegate.getrawtransactioninblock(txid, blockhash);
+}
+
+blockheader_t ForwardingBitcoinRPCFacade::getblockheader(const std::string &blockhash) const {
+    return delegate.getblockheader(blockhash);
+}
+
+std::string ForwardingBitcoinRPCFacade::getrawblockheader(const std::string &blockhash) const {
+    return delegate.getrawblockheader(blockhash);
+}
+
+std::string ForwardingBitcoinRPCFacade::gettxoutproof(const std::vector<std::string> &txids, const std::string &blockhash) const {
+    return delegate.gettxoutproof(txids, blockhash);
+}
+
+mempoolacceptance_t ForwardingBitcoinRPCFacade::testmempoolaccept(const std::string &hexString) const {
+    return delegate.testmempoolaccept(hexString);
+}
+
+std::vector<scannedutxo_t> ForwardingBitcoinRPCFacade::scantxoutset(const std::vector<std::string> &descriptors) const {
+    return delegate.scantxoutset(descriptors);
+}
+
+std::vector<std::string> ForwardingBitcoinRPCFacade::getrawmempool() const {
+    return delegate.getrawmempool();
+}
+
+std::vector<prevoutspending_t> ForwardingBitcoinRPCFacade::gettxspendingprevout(const std::vector<txout_t> &outputs) const {
+    return delegate.gettxspendingprevout(outputs);
+}
+
+blocktip_t ForwardingBitcoinRPCFacade::waitforblockheight(int height, int timeoutMs) const {
+    return delegate.waitforblockheight(height, timeoutMs);
+}
+
+std::string ForwardingBitcoinRPCFacade::sendrawtransaction(const std::string &hexString) const {
+    return delegate.sendrawtransaction(hexString);
+}
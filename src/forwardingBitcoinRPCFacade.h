@@ -0,0 +1,51 @@
+#ifndef TXREF_FORWARDINGBITCOINRPCFACADE_H
+#define TXREF_FORWARDINGBITCOINRPCFACADE_H
+
+#include "bitcoinRPCFacade.h"
+
+/**
+ * A BitcoinRPCFacade that forwards every call to another BitcoinRPCFacade. This is meant to
+ * be subclassed by facades that add behavior (caching, throttling, etc.) around an existing
+ * connection, and only need to override the calls they care about.
+ */
+class ForwardingBitcoinRPCFacade : public BitcoinRPCFacade {
+
+public:
+    /**
+     * Construct a ForwardingBitcoinRPCFacade
+     * @param delegate the BitcoinRPCFacade to forward calls to. Must outlive this object.
+     */
+    explicit ForwardingBitcoinRPCFacade(const BitcoinRPCFacade & delegate);
+
+    ~ForwardingBitcoinRPCFacade() override;
+
+    getrawtransaction_t getrawtransaction(const std::string& txid, int verbose) const override;
+    blockinfo_t getblock(const std::string& blockhash) const override;
+    std::string getblockhash(int blocknumber) const override;
+    utxoinfo_t gettxout(const std::string& txid, int n) const override;
+
+    std::string createrawtransaction(const std::vector<txout_t>& inputs, const std::map<std::string, double>& amounts) const override;
+    std::string createrawtransaction(const std::vector<txout_t>& inputs, const std::map<std::string, std::string>& amounts) const override;
+
+    blockchaininfo_t getblockchaininfo() const override;
+    std::string signrawtransactionwithkey(const std::string& rawTx, const std::vector<signrawtxinext_t> & inputs, const std::vector<std::string>& privkeys, const std::string& sighashtype) const override;
+    btcaddressinfo_t getaddressinfo(const std::string& address) const override;
+    std::string getrawblock(const std::string& blockhash) const override;
+    std::string getrawtransactioninblock(const std::string& txid, const std::string& blockhash) const override;
+    blockheader_t getblockheader(const std::string& blockhash) const override;
+    std::string getrawblockheader(const std::string& blockhash) const override;
+    std::string gettxoutproof(const std::vector<std::string>& txids, const std::string& blockhash) const override;
+    mempoolacceptance_t testmempoolaccept(const std::string& hexString) const override;
+    std::vector<scannedutxo_t> scantxoutset(const std::vector<std::string>& descriptors) const override;
+    std::vector<std::string> getrawmempool() const override;
+    std::vector<prevoutspending_t> gettxspendingprevout(const std::vector<txout_t>& outputs) const override;
+    blocktip_t waitforblockheight(int height, int timeoutMs) const override;
+
+    std::string sendrawtransaction(const std::string& hexString) const override;
+
+protected:
+    const BitcoinRPCFacade & delegate;
+};
+
+
+#endif //TXREF_FORWARDINGBITCOINRPCFACADE_H
@@ -0,0 +1,299 @@
+#include "hex.h"
+
+#include <algorithm>
+#include <atomic>
+#include <stdexcept>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define HEX_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+    const char lowercaseDigits[] = "0123456789abcdef";
+
+    /**
+     * Value of each hex digit, or 0xff for anything else
+     */
+    struct DigitTable {
+        uint8_t values[256];
+
+        DigitTable() {
+            for(int c = 0; c < 256; ++c)
+                values[c] = 0xff;
+            for(int i = 0; i < 10; ++i)
+                values['0' + i] = static_cast<uint8_t>(i);
+            for(int i = 0; i < 6; ++i) {
+                values['a' + i] = static_cast<uint8_t>(10 + i);
+                values['A' + i] = static_cast<uint8_t>(10 + i);
+            }
+        }
+    };
+
+    const DigitTable digitTable;
+
+    void encodeScalar(const uint8_t * data, size_t len, char * out) {
+        for(size_t i = 0; i < len; ++i) {
+            out[2 * i] = lowercaseDigits[data[i] >> 4];
+            out[2 * i + 1] = lowercaseDigits[data[i] & 0x0f];
+        }
+    }
+
+    // 'out' may be null, to only validate
+    bool decodeScalar(const char * hex, size_t len, uint8_t * out) {
+        uint8_t bad = 0;
+        for(size_t i = 0; i + 1 < len; i += 2) {
+            uint8_t hi = digitTable.values[static_cast<uint8_t>(hex[i])];
+            uint8_t lo = digitTable.values[static_cast<uint8_t>(hex[i + 1])];
+            bad |= (hi | lo) & 0xf0;
+            if(out)
+                out[i / 2] = static_cast<uint8_t>(hi << 4 | (lo & 0x0f));
+        }
+        return bad == 0;
+    }
+
+#ifdef HEX_X86_KERNELS
+
+    // Nibbles (0-15 in each byte) to lowercase hex digits: '0' + n, plus 39 more for 10-15
+    __attribute__((target("sse2")))
+    __m128i nibblesToDigits128(__m128i nibbles) {
+        __m128i letters = _mm_and_si128(_mm_cmpgt_epi8(nibbles, _mm_set1_epi8(9)), _mm_set1_epi8('a' - '0' - 10));
+        return _mm_add_epi8(_mm_add_epi8(nibbles, _mm_set1_epi8('0')), letters);
+    }
+
+    __attribute__((target("sse2")))
+    void encodeSse2(const uint8_t * data, size_t len, char * out) {
+        const __m128i lowNibble = _mm_set1_epi8(0x0f);
+        size_t i = 0;
+        for(; i + 16 <= len; i += 16) {
+            __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+            __m128i hi = nibblesToDigits128(_mm_and_si128(_mm_srli_epi16(bytes, 4), lowNibble));
+            __m128i lo = nibblesToDigits128(_mm_and_si128(bytes, lowNibble));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out + 2 * i), _mm_unpacklo_epi8(hi, lo));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out + 2 * i + 16), _mm_unpackhi_epi8(hi, lo));
+        }
+        encodeScalar(data + i, len - i, out + 2 * i);
+    }
+
+    /**
+     * Hex digits (either case) to their values. 'valid' gets 0xff in each byte that was a hex digit.
+     */
+    __attribute__((target("sse2")))
+    __m128i digitsToNibbles128(__m128i chars, __m128i & valid) {
+        __m128i lower = _mm_or_si128(chars, _mm_set1_epi8(0x20));
+        __m128i isDigit = _mm_and_si128(_mm_cmpgt_epi8(chars, _mm_set1_epi8('0' - 1)),
+                                        _mm_cmplt_epi8(chars, _mm_set1_epi8('9' + 1)));
+        __m128i isLetter = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)),
+                                         _mm_cmplt_epi8(lower, _mm_set1_epi8('f' + 1)));
+        valid = _mm_or_si128(isDigit, isLetter);
+        return _mm_or_si128(_mm_and_si128(isDigit, _mm_sub_epi8(chars, _mm_set1_epi8('0'))),
+                            _mm_and_si128(isLetter, _mm_sub_epi8(lower, _mm_set1_epi8('a' - 10))));
+    }
+
+    // Pairs of nibbles (high one first) in each 16-bit lane, to a byte value in that lane
+    __attribute__((target("sse2")))
+    __m128i joinNibbles128(__m128i nibbles) {
+        __m128i hi = _mm_slli_epi16(_mm_and_si128(nibbles, _mm_set1_epi16(0x00ff)), 4);
+        return _mm_or_si128(hi, _mm_srli_epi16(nibbles, 8));
+    }
+
+    __attribute__((target("sse2")))
+    bool decodeSse2(const char * hex, size_t len, uint8_t * out) {
+        size_t i = 0;
+        for(; i + 32 <= len; i += 32) {
+            __m128i valid1, valid2;
+            __m128i first = digitsToNibbles128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(hex + i)), valid1);
+            __m128i second = digitsToNibbles128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(hex + i + 16)), valid2);
+            if(_mm_movemask_epi8(_mm_and_si128(valid1, valid2)) != 0xffff)
+                return false;
+            if(out)
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i / 2),
+                                 _mm_packus_epi16(joinNibbles128(first), joinNibbles128(second)));
+        }
+        return decodeScalar(hex + i, len - i, out ? out + i / 2 : nullptr);
+    }
+
+    __attribute__((target("avx2")))
+    __m256i nibblesToDigits256(__m256i nibbles) {
+        __m256i letters = _mm256_and_si256(_mm256_cmpgt_epi8(nibbles, _mm256_set1_epi8(9)), _mm256_set1_epi8('a' - '0' - 10));
+        return _mm256_add_epi8(_mm256_add_epi8(nibbles, _mm256_set1_epi8('0')), letters);
+    }
+
+    __attribute__((target("avx2")))
+    void encodeAvx2(const uint8_t * data, size_t len, char * out) {
+        const __m256i lowNibble = _mm256_set1_epi8(0x0f);
+        size_t i = 0;
+        for(; i + 32 <= len; i += 32) {
+            __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+            __m256i hi = nibblesToDigits256(_mm256_and_si256(_mm256_srli_epi16(bytes, 4), lowNibble));
+            __m256i lo = nibblesToDigits256(_mm256_and_si256(bytes, lowNibble));
+            // unpack works within each 128-bit lane, so put the lanes back in order
+            __m256i interleavedLo = _mm256_unpacklo_epi8(hi, lo);
+            __m256i interleavedHi = _mm256_unpackhi_epi8(hi, lo);
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + 2 * i),
+                                _mm256_permute2x128_si256(interleavedLo, interleavedHi, 0x20));
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + 2 * i + 32),
+                                _mm256_permute2x128_si256(interleavedLo, interleavedHi, 0x31));
+        }
+        encodeSse2(data + i, len - i, out + 2 * i);
+    }
+
+    __attribute__((target("avx2")))
+    __m256i digitsToNibbles256(__m256i chars, __m256i & valid) {
+        __m256i lower = _mm256_or_si256(chars, _mm256_set1_epi8(0x20));
+        __m256i isDigit = _mm256_and_si256(_mm256_cmpgt_epi8(chars, _mm256_set1_epi8('0' - 1)),
+                                           _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), chars));
+        __m256i isLetter = _mm256_and_si256(_mm256_cmpgt_epi8(lower, _mm256_set1_epi8('a' - 1)),
+                                            _mm256_cmpgt_epi8(_mm256_set1_epi8('f' + 1), lower));
+        valid = _mm256_or_si256(isDigit, isLetter);
+        return _mm256_or_si256(_mm256_and_si256(isDigit, _mm256_sub_epi8(chars, _mm256_set1_epi8('0'))),
+                               _mm256_and_si256(isLetter, _mm256_sub_epi8(lower, _mm256_set1_epi8('a' - 10))));
+    }
+
+    __attribute__((target("avx2")))
+    __m256i joinNibbles256(__m256i nibbles) {
+        __m256i hi = _mm256_slli_epi16(_mm256_and_si256(nibbles, _mm256_set1_epi16(0x00ff)), 4);
+        return _mm256_or_si256(hi, _mm256_srli_epi16(nibbles, 8));
+    }
+
+    __attribute__((target("avx2")))
+    bool decodeAvx2(const char * hex, size_t len, uint8_t * out) {
+        size_t i = 0;
+        for(; i + 64 <= len; i += 64) {
+            __m256i valid1, valid2;
+            __m256i first = digitsToNibbles256(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(hex + i)), valid1);
+            __m256i second = digitsToNibbles256(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(hex + i + 32)), valid2);
+            if(_mm256_movemask_epi8(_mm256_and_si256(valid1, valid2)) != -1)
+                return false;
+            if(out) {
+                // pack works within each 128-bit lane, so put the 64-bit quarters back in order
+                __m256i packed = _mm256_packus_epi16(joinNibbles256(first), joinNibbles256(second));
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i / 2), _mm256_permute4x64_epi64(packed, 0xd8));
+            }
+        }
+        return decodeSse2(hex + i, len - i, out ? out + i / 2 : nullptr);
+    }
+
+#endif
+
+    typedef void (*EncodeFunction)(const uint8_t *, size_t, char *);
+    typedef bool (*DecodeFunction)(const char *, size_t, uint8_t *);
+
+    hex::Kernel bestKernel() {
+#ifdef HEX_X86_KERNELS
+        __builtin_cpu_init();
+        if(__builtin_cpu_supports("avx2"))
+            return hex::Kernel::avx2;
+        if(__builtin_cpu_supports("sse2"))
+            return hex::Kernel::sse2;
+#endif
+        return hex::Kernel::scalar;
+    }
+
+    std::atomic<hex::Kernel> & activeKernel() {
+        static std::atomic<hex::Kernel> kernel(bestKernel());
+        return kernel;
+    }
+
+    EncodeFunction encodeFunction() {
+        switch(activeKernel().load(std::memory_order_relaxed)) {
+#ifdef HEX_X86_KERNELS
+            case hex::Kernel::avx2:
+                return encodeAvx2;
+            case hex::Kernel::sse2:
+                return encodeSse2;
+#endif
+            default:
+                return encodeScalar;
+        }
+    }
+
+    DecodeFunction decodeFunction() {
+        switch(activeKernel().load(std::memory_order_relaxed)) {
+#ifdef HEX_X86_KERNELS
+            case hex::Kernel::avx2:
+                return decodeAvx2;
+            case hex::Kernel::sse2:
+                return decodeSse2;
+#endif
+            default:
+                return decodeScalar;
+        }
+    }
+}
+
+namespace hex {
+
+    bool isSupported(Kernel kernel) {
+        // each kernel needs a subset of the instructions the next one needs
+        return static_cast<int>(kernel) <= static_cast<int>(bestKernel());
+    }
+
+    Kernel currentKernel() {
+        return activeKernel().load();
+    }
+
+    void setKernel(Kernel kernel) {
+        if(!isSupported(kernel))
+            throw std::invalid_argument(std::string("hex kernel not supported by this CPU: ") + kernelName(kernel));
+        activeKernel().store(kernel);
+    }
+
+    const char * kernelName(Kernel kernel) {
+        switch(kernel) {
+            case Kernel::scalar:
+                return "scalar";
+            case Kernel::sse2:
+                return "sse2";
+            case Kernel::avx2:
+                return "avx2";
+        }
+        return "unknown";
+    }
+
+    void encode(const uint8_t * data, size_t len, char * out) {
+        encodeFunction()(data, len, out);
+    }
+
+    std::string encode(const uint8_t * data, size_t len) {
+        std::string out(2 * len, '\0');
+        encode(data, len, &out[0]);
+        return out;
+    }
+
+    std::string encode(const std::string & bytes) {
+        return encode(reinterpret_cast<const uint8_t *>(bytes.data()), bytes.size());
+    }
+
+    bool decode(const char * hex, size_t len, uint8_t * out) {
+        return len % 2 == 0 && decodeFunction()(hex, len, out);
+    }
+
+    bool decode(const std::string & hex, std::vector<uint8_t> & out) {
+        out.resize(hex.size() / 2);
+        if(!decode(hex.data(), hex.size(), out.data())) {
+            out.clear();
+            return false;
+        }
+        return true;
+    }
+
+    bool isValid(const char * hex, size_t len) {
+        return len % 2 == 0 && decodeFunction()(hex, len, nullptr);
+    }
+
+    std::string encodeHash(const uint8_t * hash) {
+        uint8_t reversed[32];
+        std::reverse_copy(hash, hash + 32, reversed);
+        return encode(reversed, sizeof(reversed));
+    }
+
+    bool decodeHash(const std::string & displayed, uint8_t * out) {
+        if(displayed.size() != 64 || !decode(displayed.data(), displayed.size(), out))
+            return false;
+        std::reverse(out, out + 32);
+        return true;
+    }
+
+}
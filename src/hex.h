@@ -0,0 +1,99 @@
+#ifndef TXREF_HEX_H
+#define TXREF_HEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Hexadecimal encoding, decoding and validation, shared by everything that handles txids,
+ * raw transactions and OP_RETURN payloads.
+ *
+ * On x86 the work is done 16 (SSE2) or 32 (AVX2) bytes at a time, using the best kernel the
+ * CPU supports, with a scalar fallback elsewhere and for the tail of each input.
+ */
+namespace hex {
+
+    enum class Kernel {
+        scalar,
+        sse2,
+        avx2
+    };
+
+    /**
+     * Can this CPU run the given kernel?
+     */
+    bool isSupported(Kernel kernel);
+
+    /**
+     * The kernel in use. Starts as the best one this CPU supports.
+     */
+    Kernel currentKernel();
+
+    /**
+     * Use a particular kernel, for testing and benchmarking
+     * @param kernel the kernel to use
+     * @throws std::invalid_argument if this CPU can't run it
+     */
+    void setKernel(Kernel kernel);
+
+    const char * kernelName(Kernel kernel);
+
+    /**
+     * Encode bytes as lowercase hex
+     * @param data the bytes to encode
+     * @param len the number of bytes
+     * @param out receives 2 * len characters (not null-terminated)
+     */
+    void encode(const uint8_t * data, size_t len, char * out);
+
+    std::string encode(const uint8_t * data, size_t len);
+
+    std::string encode(const std::string & bytes);
+
+    /**
+     * Decode hex (either case) into bytes
+     * @param hex the hex characters
+     * @param len the number of characters
+     * @param out receives len / 2 bytes
+     * @return false if len is odd or a character is not a hex digit. 'out' may then have been
+     * partly written.
+     */
+    bool decode(const char * hex, size_t len, uint8_t * out);
+
+    /**
+     * Decode a hex string (either case) into bytes
+     * @param hex the hex string
+     * @param out receives the bytes
+     * @return false if the string is not valid hex
+     */
+    bool decode(const std::string & hex, std::vector<uint8_t> & out);
+
+    /**
+     * Is this valid hex: an even number of hex digits, in either case?
+     */
+    bool isValid(const char * hex, size_t len);
+
+    inline bool isValid(const std::string & hex) {
+        return isValid(hex.data(), hex.size());
+    }
+
+    /**
+     * Encode a 32 byte hash, such as a txid or block hash, as bitcoind displays it: in the
+     * reverse of its internal byte order
+     * @param hash the hash in internal byte order
+     */
+    std::string encodeHash(const uint8_t * hash);
+
+    /**
+     * Decode a hash as bitcoind displays it into internal byte order
+     * @param displayed the hash as displayed
+     * @param out receives 32 bytes
+     * @return false if it isn't 64 hex digits. 'out' may then have been partly written.
+     */
+    bool decodeHash(const std::string & displayed, uint8_t * out);
+
+}
+
+#endif //TXREF_HEX_H
@@ -0,0 +1,349 @@
+#include "issuanceService.h"
+#include "address.h"
+#include "encodeOpReturnData.h"
+#include "hex.h"
+#include "ripemd160.h"
+#include "transactionSigner.h"
+#include "json.hpp"
+
+#include <bitcoinapi/bitcoinapi.h>
+#include <algorithm>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+
+    // a p2wpkh output: an 8-byte value, the script's length, and 22 bytes of script
+    const size_t P2WPKH_OUTPUT_SIZE = 31;
+
+    // a p2wsh or p2tr output: the largest a DID's address pays to
+    const size_t LARGEST_OUTPUT_SCRIPT_SIZE = 34;
+
+    bool canSign(const std::vector<uint8_t> & scriptPubKey) {
+        Result<AddressType> type = scriptType(scriptPubKey.data(), scriptPubKey.size());
+        return type && (type.value() == AddressType::p2pkh || type.value() == AddressType::p2sh ||
+                        type.value() == AddressType::p2wpkh);
+    }
+
+    Amount times(const Amount & amount, size_t n) {
+        return Amount::fromSatoshis(amount.satoshis() * static_cast<int64_t>(n));
+    }
+
+    bool contains(const std::string & s, const char * part) {
+        return s.find(part) != std::string::npos;
+    }
+}
+
+IssuanceService::IssuanceService(const PrivateKey & fundingKey, const std::string & chain, UtxoPool & pool,
+                                 const IssuanceOptions & options)
+        : key(fundingKey), chainName(chain), coins(pool), issuanceOptions(options) {
+    if(!key.isCompressed())
+        throw std::invalid_argument("The funding key must be compressed, for change to be paid to it with segwit");
+    if(options.feeRate < 1)
+        throw std::invalid_argument("The fee rate must be at least 1 satoshi per vbyte");
+
+    uint8_t keyHash[ripemd160::DIGEST_SIZE];
+    ripemd160::hash160(key.publicKey().data(), key.publicKey().size(), keyHash);
+    changeScript = {0x00, ripemd160::DIGEST_SIZE};
+    changeScript.insert(changeScript.end(), keyHash, keyHash + ripemd160::DIGEST_SIZE);
+
+    // the heaviest DID transaction without change: a p2pkh input, the longest OP_RETURN, and
+    // the largest kind of DID output
+    TransactionBuilder largest;
+    largest.addInput(Hash256(), 0);
+    largest.addOpReturn(std::vector<uint8_t>(TransactionBuilder::MAX_OP_RETURN_SIZE));
+    largest.addOutput(options.didAmount, std::vector<uint8_t>(LARGEST_OUTPUT_SCRIPT_SIZE));
+    largestFee = feeFor(largest.estimateSignedVsize({AddressType::p2pkh}));
+}
+
+const std::vector<uint8_t> & IssuanceService::fundingScript() const {
+    return changeScript;
+}
+
+std::string IssuanceService::fundingDescriptor() const {
+    return "combo(" + hex::encode(key.publicKey().data(), key.publicKey().size()) + ")";
+}
+
+Amount IssuanceService::coinSize() const {
+    return issuanceOptions.didAmount + largestFee;
+}
+
+Amount IssuanceService::feeFor(size_t vsize) const {
+    return Amount::fromSatoshis(static_cast<int64_t>(vsize) * issuanceOptions.feeRate);
+}
+
+size_t IssuanceService::refresh(const BitcoinRPCFacade & btc) {
+    std::vector<PoolCoin> confirmed;
+    for(const scannedutxo_t & utxo : btc.scantxoutset({fundingDescriptor()})) {
+        PoolCoin coin;
+        if(!hex::decodeHash(utxo.txid, coin.txid.data()))
+            throw std::runtime_error("scantxoutset returned an invalid txid: " + utxo.txid);
+        coin.vout = utxo.vout;
+        coin.amount = utxo.amount;
+        coin.unconfirmedDepth = 0;
+        // combo() also finds bare public key outputs, which aren't signed for here
+        if(!hex::decode(utxo.scriptPubKey, coin.scriptPubKey) || !canSign(coin.scriptPubKey))
+            continue;
+
+        // the scan doesn't see the mempool, where this output may already have been spent
+        if(!coins.contains(coin)) {
+            utxoinfo_t unspent = btc.gettxout(utxo.txid, static_cast<int>(utxo.vout));
+            if(unspent.bestblock.empty() && unspent.confirmations == 0)
+                continue;
+        }
+        confirmed.push_back(coin);
+    }
+    coins.refresh(confirmed);
+    return coins.size();
+}
+
+Result<std::string> IssuanceService::split(const BitcoinRPCFacade & btc, size_t count) {
+    typedef Result<std::string> R;
+
+    PoolCoin coin;
+    if(!coins.takeLargest(coin))
+        return R::failure("No funding coin can be spent");
+
+    TransactionBuilder builder;
+    builder.addInput(coin.txid, coin.vout);
+    Result<AddressType> spentType = scriptType(coin.scriptPubKey.data(), coin.scriptPubKey.size());
+    size_t baseVsize = builder.estimateSignedVsize({spentType.value()});
+
+    // every coin, and the change, is a p2wpkh output; two bytes more pay for the output count
+    // growing past 252
+    Amount size = coinSize();
+    size_t maxByWeight = (TransactionBuilder::MAX_STANDARD_WEIGHT / 4 - baseVsize - 2) / P2WPKH_OUTPUT_SIZE - 1;
+    size_t made = 0;
+    while(made < count && made < maxByWeight &&
+          coin.amount >= times(size, made + 1) + feeFor(baseVsize + 2 + P2WPKH_OUTPUT_SIZE * (made + 2)))
+        ++made;
+    if(made == 0) {
+        coins.release(coin);
+        return R::failure("The largest coin, of " + coin.amount.toString() + " BTC, is too small to split into coins of " +
+                          size.toString() + " BTC");
+    }
+
+    for(size_t i = 0; i < made; ++i)
+        builder.addOutput(size, changeScript);
+    Amount change = coin.amount - times(size, made) - feeFor(baseVsize + 2 + P2WPKH_OUTPUT_SIZE * (made + 1));
+    if(change >= TransactionBuilder::dustThreshold(changeScript))
+        builder.addOutput(change, changeScript);
+
+    TransactionSigner signer(builder);
+    Result<AddressType> signedType = signer.signInput(0, key, coin.scriptPubKey, coin.amount);
+    if(!signedType) {
+        coins.release(coin);
+        return R::failure(signedType.error());
+    }
+
+    std::vector<PoolCoin> created;
+    Hash256 txid = builder.txid();
+    for(size_t i = 0; i < builder.outputs().size(); ++i) {
+        const TxOutput & output = builder.outputs()[i];
+        created.push_back(PoolCoin{txid, static_cast<uint32_t>(i), output.value, output.scriptPubKey, coin.unconfirmedDepth + 1});
+    }
+
+    bool retry = false;
+    return submit(btc, builder, coin, created, retry);
+}
+
+IssuanceRecord IssuanceService::issue(const BitcoinRPCFacade & btc, const std::string & address, const std::string & ddoRef) {
+    IssuanceRecord record;
+    record.address = address;
+
+    Result<Address> didAddress = decodeAddress(address, chainName);
+    if(!didAddress) {
+        record.error = didAddress.error();
+        return record;
+    }
+    Amount dust = TransactionBuilder::dustThreshold(didAddress.value().scriptPubKey);
+    if(issuanceOptions.didAmount < dust) {
+        record.error = "The DID amount of " + issuanceOptions.didAmount.toString() + " BTC is less than the " +
+                       dust.toString() + " BTC that can be sent to " + address;
+        return record;
+    }
+
+    std::vector<uint8_t> opReturnData;
+    std::string encodedOpReturn = encodeOpReturnData(ddoRef);
+    if(encodedOpReturn.empty() && !ddoRef.empty()) {
+        record.error = "ddoRef is longer than " + std::to_string(TransactionBuilder::MAX_OP_RETURN_SIZE) + " bytes";
+        return record;
+    }
+    hex::decode(encodedOpReturn, opReturnData);
+
+    // only errors from the RPC layer are thrown from here
+    try {
+        for(;;) {
+            PoolCoin coin;
+            if(!coins.take(coinSize(), coin)) {
+                record.error = "No funding coin of " + coinSize().toString() + " BTC or more is left. "
+                               "Split a larger one, or wait for change to confirm";
+                return record;
+            }
+
+            // output 0 is the OP_RETURN, output 1 the DID, and output 2 any change
+            TransactionBuilder builder;
+            builder.addInput(coin.txid, coin.vout);
+            builder.addOpReturn(opReturnData);
+            builder.addOutput(issuanceOptions.didAmount, didAddress.value().scriptPubKey);
+            Result<AddressType> spentType = scriptType(coin.scriptPubKey.data(), coin.scriptPubKey.size());
+            size_t vsize = builder.estimateSignedVsize({spentType.value()});
+
+            Amount change = coin.amount - issuanceOptions.didAmount - feeFor(vsize + P2WPKH_OUTPUT_SIZE);
+            bool hasChange = change >= TransactionBuilder::dustThreshold(changeScript);
+            if(hasChange)
+                builder.addOutput(change, changeScript);
+
+            TransactionSigner signer(builder);
+            Result<AddressType> signedType = signer.signInput(0, key, coin.scriptPubKey, coin.amount);
+            if(!signedType) {
+                coins.release(coin);
+                record.error = signedType.error();
+                return record;
+            }
+
+            // the txid is only final once the scriptSig is filled in
+            std::vector<PoolCoin> created;
+            if(hasChange)
+                created.push_back(PoolCoin{builder.txid(), 2, change, changeScript, coin.unconfirmedDepth + 1});
+
+            bool retry = false;
+            Result<std::string> txid = submit(btc, builder, coin, created, retry);
+            if(!txid && retry)
+                continue;
+            if(!txid) {
+                record.error = txid.error();
+                return record;
+            }
+            record.txid = txid.value();
+            record.txoIndex = 1;
+            record.fee = coin.amount - issuanceOptions.didAmount - (hasChange ? change : Amount());
+            record.ok = true;
+            return record;
+        }
+    }
+    catch(BitcoinException &e) {
+        std::stringstream ss;
+        ss << e.getCode() << " " << e.getMessage();
+        record.error = ss.str();
+    }
+    catch(std::exception &e) {
+        record.error = e.what();
+    }
+    return record;
+}
+
+Result<std::string> IssuanceService::submit(const BitcoinRPCFacade & btc, const TransactionBuilder & builder,
+                                            const PoolCoin & coin, const std::vector<PoolCoin> & created, bool & retry) {
+    typedef Result<std::string> R;
+
+    std::string rawTransaction = builder.toHex();
+    mempoolacceptance_t acceptance;
+    try {
+        acceptance = btc.testmempoolaccept(rawTransaction);
+    }
+    catch(...) {
+        coins.release(coin);
+        throw;
+    }
+
+    if(!acceptance.allowed) {
+        const std::string & reason = acceptance.rejectreason;
+        if(contains(reason, "too-long-mempool-chain")) {
+            // the coin can be spent again once its unconfirmed ancestors confirm
+            coins.hold(coin);
+            retry = true;
+        }
+        else if(contains(reason, "missing-inputs") || contains(reason, "missingorspent") ||
+                contains(reason, "txn-mempool-conflict")) {
+            // spent by someone else, or hung from a transaction that left the mempool
+            coins.discard(coin);
+            retry = true;
+        }
+        else {
+            coins.release(coin);
+        }
+        return R::failure("The mempool would not accept the transaction: " + reason);
+    }
+
+    std::string txid;
+    try {
+        txid = btc.sendrawtransaction(rawTransaction);
+    }
+    catch(...) {
+        coins.release(coin);
+        throw;
+    }
+    coins.spent(coin, created);
+    return R::success(txid);
+}
+
+size_t IssuanceService::serve(std::istream & in, std::ostream & out, const FacadeFactory & facadeFactory, size_t jobs) {
+    size_t numJobs = jobs > 0 ? jobs : 1;
+
+    // create all connections up front, so any connection problem is reported before
+    // we start reading input
+    std::vector<std::unique_ptr<BitcoinRPCFacade>> facades;
+    for(size_t i = 0; i < numJobs; ++i)
+        facades.push_back(facadeFactory());
+
+    std::mutex inMutex;
+    std::mutex outMutex;
+    size_t lineNumber = 0;
+    size_t numErrors = 0;
+
+    auto worker = [&](const BitcoinRPCFacade & btc) {
+        for(;;) {
+            std::string line, address, ddoRef;
+            size_t thisLine;
+            {
+                std::lock_guard<std::mutex> lock(inMutex);
+                if(!std::getline(in, line))
+                    return;
+                thisLine = ++lineNumber;
+            }
+            std::istringstream iss(line);
+            iss >> address >> ddoRef;
+            if(address.empty())
+                continue;
+
+            IssuanceRecord record = issue(btc, address, ddoRef);
+            record.line = thisLine;
+            std::string json = formatRecord(record);
+
+            std::lock_guard<std::mutex> lock(outMutex);
+            if(!record.ok)
+                ++numErrors;
+            out << json;
+            out.flush();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for(const auto & facade : facades)
+        threads.emplace_back(worker, std::cref(*facade));
+    for(auto & thread : threads)
+        thread.join();
+
+    return numErrors;
+}
+
+std::string IssuanceService::formatRecord(const IssuanceRecord & record) {
+    nlohmann::json root;
+
+    root["line"] = record.line;
+    root["address"] = record.address;
+    if(record.ok) {
+        root["txid"] = record.txid;
+        root["txo-index"] = record.txoIndex;
+        root["fee"] = record.fee.toString();
+    }
+    else {
+        root["error"] = record.error;
+    }
+
+    return root.dump() + "\n";
+}
@@ -0,0 +1,133 @@
+#ifndef TXREF_ISSUANCESERVICE_H
+#define TXREF_ISSUANCESERVICE_H
+
+#include "amount.h"
+#include "bitcoinRPCFacade.h"
+#include "privateKey.h"
+#include "result.h"
+#include "transactionBuilder.h"
+#include "utxoPool.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct IssuanceOptions {
+    Amount didAmount = Amount::fromSatoshis(1000);  // sent to each DID's address
+    int64_t feeRate = 2;                             // satoshis per vbyte
+};
+
+struct IssuanceRecord {
+    size_t line = 0;            // line number in the input, starting at 1
+    std::string address;
+    bool ok = false;
+    std::string txid;
+    uint32_t txoIndex = 0;      // the output the DID follows
+    Amount fee;
+    std::string error;
+};
+
+/**
+ * Issues DIDs one transaction each, funded from a pool of coins paying to one key, instead of
+ * from an unspent output picked by hand. The change of every transaction goes back to the pool
+ * and is spent again before it confirms, so many DIDs can be issued at once. Transactions are
+ * built and signed locally, checked with testmempoolaccept, and only then sent.
+ *
+ * issue() may be called from many threads, each with its own BitcoinRPCFacade.
+ */
+class IssuanceService {
+
+public:
+    typedef std::function<std::unique_ptr<BitcoinRPCFacade>()> FacadeFactory;
+
+    /**
+     * @param fundingKey the key the pool's coins pay to
+     * @param chain the chain DID addresses must belong to, as getblockchaininfo names it
+     * @param pool where coins are taken from, and change goes back to
+     * @param options the amount sent to each DID, and the fee rate
+     * @throws std::invalid_argument if the key is uncompressed, which segwit change can't pay
+     * to, or the fee rate isn't positive
+     */
+    IssuanceService(const PrivateKey & fundingKey, const std::string & chain, UtxoPool & pool,
+                    const IssuanceOptions & options);
+
+    /**
+     * @return the p2wpkh script that change and split coins pay to
+     */
+    const std::vector<uint8_t> & fundingScript() const;
+
+    /**
+     * @return the output descriptor for every script the funding key can spend, for scantxoutset
+     */
+    std::string fundingDescriptor() const;
+
+    /**
+     * @return what a coin must be worth to fund one DID transaction with the longest ddoRef
+     */
+    Amount coinSize() const;
+
+    /**
+     * Bring the pool up to date with the funding key's confirmed unspent outputs
+     * @return the number of coins in the pool
+     */
+    size_t refresh(const BitcoinRPCFacade & btc);
+
+    /**
+     * Split the pool's largest coin into up to 'count' coins of coinSize(), so that many
+     * transactions can be funded at once without chaining off one another. Fewer are made if the
+     * coin isn't worth that many, or the transaction would be too heavy to relay.
+     * @return the txid of the split, or why it wasn't made
+     */
+    Result<std::string> split(const BitcoinRPCFacade & btc, size_t count);
+
+    /**
+     * Issue a DID: send a transaction whose output 0 is an OP_RETURN with the ddoRef, and whose
+     * output 1 pays to the DID's address. Errors are captured in the record instead of being
+     * thrown.
+     * @param btc the BitcoinRPCFacade
+     * @param address where the DID output pays to
+     * @param ddoRef where the DID document can be found, if not at the default location
+     * @return the record of the issuance
+     */
+    IssuanceRecord issue(const BitcoinRPCFacade & btc, const std::string & address, const std::string & ddoRef);
+
+    /**
+     * Read issuance requests from 'in', one per line: an address, optionally followed by
+     * whitespace and a ddoRef. Blank lines are skipped. Up to 'jobs' DIDs are issued at once,
+     * each worker using its own BitcoinRPCFacade, and one JSON record per line is written to
+     * 'out' as each finishes.
+     * @return the number of requests that failed
+     */
+    size_t serve(std::istream & in, std::ostream & out, const FacadeFactory & facadeFactory, size_t jobs);
+
+    /**
+     * Format a record as a single line of JSON (NDJSON), including the trailing newline
+     */
+    static std::string formatRecord(const IssuanceRecord & record);
+
+private:
+    PrivateKey key;
+    std::string chainName;
+    UtxoPool & coins;
+    IssuanceOptions issuanceOptions;
+    std::vector<uint8_t> changeScript;
+    Amount largestFee;
+
+    Amount feeFor(size_t vsize) const;
+
+    /**
+     * Check the transaction with testmempoolaccept, then send it. The coin goes back to the
+     * pool if it isn't sent, and is replaced by 'created' if it is.
+     * @param retry set if the coin was put aside, and another may do
+     * @return the txid, or why the transaction wasn't sent
+     */
+    Result<std::string> submit(const BitcoinRPCFacade & btc, const TransactionBuilder & builder,
+                               const PoolCoin & coin, const std::vector<PoolCoin> & created, bool & retry);
+};
+
+
+#endif //TXREF_ISSUANCESERVICE_H
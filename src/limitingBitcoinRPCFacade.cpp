@@ -0,0 +1,139 @@
+#include "limitingBitcoinRPCFacade.h"
+
+#include <bitcoinapi/bitcoinapi.h>
+#include <thread>
+
+namespace {
+    // first pause before retrying a rejected call; doubled for each further retry
+    const std::chrono::milliseconds FIRST_RETRY_PAUSE(10);
+}
+
+bool isOverloadedMessage(const std::string & message) {
+    return message.find("Work queue depth exceeded") != std::string::npos ||
+           message.find("Service Unavailable") != std::string::npos;
+}
+
+LimitingBitcoinRPCFacade::LimitingBitcoinRPCFacade(
+        const BitcoinRPCFacade & d, ConcurrencyLimiter & l, int r)
+        : ForwardingBitcoinRPCFacade(d), limiter(l), maxRetries(r) {
+}
+
+LimitingBitcoinRPCFacade::~LimitingBitcoinRPCFacade() = default;
+
+template <typename R, typename Call>
+R LimitingBitcoinRPCFacade::limited(Call call) const {
+    std::chrono::milliseconds pause = FIRST_RETRY_PAUSE;
+
+    for(int attempt = 0; ; ++attempt) {
+        limiter.acquire();
+        auto start = std::chrono::steady_clock::now();
+        try {
+            R result = call();
+            limiter.release(std::chrono::steady_clock::now() - start, false);
+            return result;
+        }
+        catch(BitcoinException &e) {
+            bool overloaded = isOverloadedMessage(e.getMessage());
+            limiter.release(std::chrono::steady_clock::now() - start, overloaded);
+            if(!overloaded || attempt >= maxRetries)
+                throw;
+        }
+        catch(...) {
+            limiter.release(std::chrono::steady_clock::now() - start, false);
+            throw;
+        }
+
+        // bitcoind rejects overloaded calls before running them, so they are safe to retry
+        std::this_thread::sleep_for(pause);
+        pause *= 2;
+    }
+}
+
+getrawtransaction_t LimitingBitcoinRPCFacade::getrawtransaction(const std::string &txid, int verbose) const {
+    return limited<getrawtransaction_t>([&] { return delegate.getrawtransaction(txid, verbose); });
+}
+
+blockinfo_t LimitingBitcoinRPCFacade::getblock(const std::string &blockhash) const {
+    return limited<blockinfo_t>([&] { return delegate.getblock(blockhash); });
+}
+
+std::string LimitingBitcoinRPCFacade::getblockhash(int blocknumber) const {
+    return limited<std::string>([&] { return delegate.getblockhash(blocknumber); });
+}
+
+utxoinfo_t LimitingBitcoinRPCFacade::gettxout(const std::string &txid, int n) const {
+    return limited<utxoinfo_t>([&] { return delegate.gettxout(txid, n); });
+}
+
+std::string LimitingBitcoinRPCFacade::createrawtransaction(
+        const std::vector<txout_t> &inputs,
+        const std::map<std::string, double> &amounts) const {
+    return limited<std::string>([&] { return delegate.createrawtransaction(inputs, amounts); });
+}
+
+std::string LimitingBitcoinRPCFacade::createrawtransaction(
+        const std::vector<txout_t> &inputs,
+        const std::map<std::string, std::string> &amounts) const {
+    return limited<std::string>([&] { return delegate.createrawtransaction(inputs, amounts); });
+}
+
+blockchaininfo_t LimitingBitcoinRPCFacade::getblockchaininfo() const {
+    return limited<blockchaininfo_t>([&] { return delegate.getblockchaininfo(); });
+}
+
+std::string LimitingBitcoinRPCFacade::signrawtransactionwithkey(
+        const std::string &rawTx, const std::vector<signrawtxinext_t> &inputs,
+        const std::vector<std::string> &privkeys, const std::string &sighashtype) const {
+    return limited<std::string>([&] {
+        return delegate.signrawtransactionwithkey(rawTx, inputs, privkeys, sighashtype);
+    });
+}
+
+btcaddressinfo_t LimitingBitcoinRPCFacade::getaddressinfo(const std::string &address) const {
+    return limited<btcaddressinfo_t>([&] { return delegate.getaddressinfo(address); });
+}
+
+std::string LimitingBitcoinRPCFacade::getrawblock(const std::string &blockhash) const {
+    return limited<std::string>([&] { return delegate.getrawblock(blockhash); });
+}
+
+std::string LimitingBitcoinRPCFacade::getrawtransactioninblock(const std::string &txid, const std::string &blockhash) const {
+    return limited<std::string>([&] { return delegate.getrawtransactioninblock(txid, blockhash); });
+}
+
+blockheader_t LimitingBitcoinRPCFacade::getblockheader(const std::string &blockhash) const {
+    return limited<blockheader_t>([&] { return delegate.getblockheader(blockhash); });
+}
+
+std::string LimitingBitcoinRPCFacade::getrawblockheader(const std::string &blockhash) const {
+    return limited<std::string>([&] { return delegate.getrawblockheader(blockhash); });
+}
+
+std::string LimitingBitcoinRPCFacade::gettxoutproof(const std::vector<std::string> &txids, const std::string &blockhash) const {
+    return limited<std::string>([&] { return delegate.gettxoutproof(txids, blockhash); });
+}
+
+mempoolacceptance_t LimitingBitcoinRPCFacade::testmempoolaccept(const std::string &hexString) const {
+    return limited<mempoolacceptance_t>([&] { return delegate.testmempoolaccept(hexString); });
+}
+
+std::vector<scannedutxo_t> LimitingBitcoinRPCFacade::scantxoutset(const std::vector<std::string> &descriptors) const {
+    return limited<std::vector<scannedutxo_t>>([&] { return delegate.scantxoutset(descriptors); });
+}
+
+std::vector<std::string> LimitingBitcoinRPCFacade::getrawmempool() const {
+    return limited<std::vector<std::string>>([&] { return delegate.getrawmempool(); });
+}
+
+std::vector<prevoutspending_t> LimitingBitcoinRPCFacade::gettxspendingprevout(const std::vector<txout_t> &outputs) const {
+    return limited<std::vector<prevoutspending_t>>([&] { return delegate.gettxspendingprevout(outputs); });
+}
+
+blocktip_t LimitingBitcoinRPCFacade::waitforblockheight(int height, int timeoutMs) const {
+    // not limited: a long-poll would hold its slot for the whole wait
+    return delegate.waitforblockheight(height, timeoutMs);
+}
+
+std::string LimitingBitcoinRPCFacade::sendrawtransaction(const std::string &hexString) const {
+    return limited<std::string>([&] { return delegate.sendrawtransaction(hexString); });
+}
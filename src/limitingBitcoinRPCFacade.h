@@ -0,0 +1,68 @@
+#ifndef TXREF_LIMITINGBITCOINRPCFACADE_H
+#define TXREF_LIMITINGBITCOINRPCFACADE_H
+
+#include "forwardingBitcoinRPCFacade.h"
+#include "concurrencyLimiter.h"
+
+/**
+ * A BitcoinRPCFacade that passes every call through a ConcurrencyLimiter. Several of these
+ * (one per RPC connection) share one limiter, which then caps the calls in flight to bitcoind
+ * across all of them. Calls rejected because bitcoind's work queue is full are reported to
+ * the limiter and retried after a short pause.
+ */
+class LimitingBitcoinRPCFacade : public ForwardingBitcoinRPCFacade {
+
+public:
+    /**
+     * Construct a LimitingBitcoinRPCFacade
+     * @param delegate the BitcoinRPCFacade to forward calls to. Must outlive this object.
+     * @param limiter the limiter shared by all connections to the same bitcoind
+     * @param maxRetries how many times to retry a call rejected as overloaded
+     */
+    LimitingBitcoinRPCFacade(const BitcoinRPCFacade & delegate, ConcurrencyLimiter & limiter, int maxRetries = 5);
+
+    ~LimitingBitcoinRPCFacade() override;
+
+    getrawtransaction_t getrawtransaction(const std::string& txid, int verbose) const override;
+    blockinfo_t getblock(const std::string& blockhash) const override;
+    std::string getblockhash(int blocknumber) const override;
+    utxoinfo_t gettxout(const std::string& txid, int n) const override;
+
+    std::string createrawtransaction(const std::vector<txout_t>& inputs, const std::map<std::string, double>& amounts) const override;
+    std::string createrawtransaction(const std::vector<txout_t>& inputs, const std::map<std::string, std::string>& amounts) const override;
+
+    blockchaininfo_t getblockchaininfo() const override;
+    std::string signrawtransactionwithkey(const std::string& rawTx, const std::vector<signrawtxinext_t> & inputs, const std::vector<std::string>& privkeys, const std::string& sighashtype) const override;
+    btcaddressinfo_t getaddressinfo(const std::string& address) const override;
+    std::string getrawblock(const std::string& blockhash) const override;
+    std::string getrawtransactioninblock(const std::string& txid, const std::string& blockhash) const override;
+    blockheader_t getblockheader(const std::string& blockhash) const override;
+    std::string getrawblockheader(const std::string& blockhash) const override;
+    std::string gettxoutproof(const std::vector<std::string>& txids, const std::string& blockhash) const override;
+    mempoolacceptance_t testmempoolaccept(const std::string& hexString) const override;
+    std::vector<scannedutxo_t> scantxoutset(const std::vector<std::string>& descriptors) const override;
+    std::vector<std::string> getrawmempool() const override;
+    std::vector<prevoutspending_t> gettxspendingprevout(const std::vector<txout_t>& outputs) const override;
+    blocktip_t waitforblockheight(int height, int timeoutMs) const override;
+
+    std::string sendrawtransaction(const std::string& hexString) const override;
+
+private:
+    template <typename R, typename Call>
+    R limited(Call call) const;
+
+    ConcurrencyLimiter & limiter;
+    const int maxRetries;
+};
+
+/**
+ * Did bitcoind reject a call because it is too busy? That comes back as an HTTP 503 with the
+ * body "Work queue depth exceeded".
+ *
+ * @param message the BitcoinException message
+ * @return true if the call was rejected for being overloaded
+ */
+bool isOverloadedMessage(const std::string & message);
+
+
+#endif //TXREF_LIMITINGBITCOINRPCFACADE_H
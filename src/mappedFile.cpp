@@ -0,0 +1,45 @@
+#include "mappedFile.h"
+
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::MappedFile(const std::string & path, Access access) : contents(nullptr), length(0) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if(fd < 0)
+        throw std::runtime_error("Can't open file: " + path);
+
+    struct stat st;
+    if(::fstat(fd, &st) != 0) {
+        ::close(fd);
+        throw std::runtime_error("Can't read file: " + path);
+    }
+    length = static_cast<size_t>(st.st_size);
+
+    if(length > 0) {
+        void * mapped = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(mapped == MAP_FAILED) {
+            ::close(fd);
+            throw std::runtime_error("Can't map file: " + path);
+        }
+        ::madvise(mapped, length, access == Access::sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+        contents = static_cast<const uint8_t *>(mapped);
+    }
+    ::close(fd);
+}
+
+MappedFile::~MappedFile() {
+    if(contents)
+        ::munmap(const_cast<uint8_t *>(contents), length);
+}
+
+const uint8_t * MappedFile::data() const {
+    return contents;
+}
+
+size_t MappedFile::size() const {
+    return length;
+}
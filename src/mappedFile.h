@@ -0,0 +1,46 @@
+#ifndef TXREF_MAPPEDFILE_H
+#define TXREF_MAPPEDFILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * A whole file memory-mapped read-only, for reading block files and indexes larger than
+ * memory. The mapping is private, so the file must not be truncated while it is mapped.
+ */
+class MappedFile {
+
+public:
+    /**
+     * How the file will be read, as a hint for the kernel's read-ahead
+     */
+    enum class Access { sequential, random };
+
+    /**
+     * Map a file
+     * @param path the file's path
+     * @param access how the file will be read
+     * @throws std::runtime_error if the file can't be opened or mapped
+     */
+    MappedFile(const std::string & path, Access access);
+
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile & operator=(const MappedFile &) = delete;
+
+    /**
+     * @return the file's contents, or null if it is empty
+     */
+    const uint8_t * data() const;
+
+    size_t size() const;
+
+private:
+    const uint8_t * contents;
+    size_t length;
+};
+
+
+#endif //TXREF_MAPPEDFILE_H
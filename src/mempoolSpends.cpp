@@ -0,0 +1,60 @@
+#include "mempoolSpends.h"
+#include "hex.h"
+#include "rawTransaction.h"
+
+#include <bitcoinapi/bitcoinapi.h>
+#include <algorithm>
+
+namespace {
+
+    std::string outpoint(const std::string & txid, int vout) {
+        return txid + ":" + std::to_string(vout);
+    }
+}
+
+MempoolSpends::~MempoolSpends() = default;
+
+RpcMempoolSpends::~RpcMempoolSpends() = default;
+
+std::string RpcMempoolSpends::spender(const BitcoinRPCFacade & btc, const std::string & txid, int vout) const {
+    txout_t output;
+    output.txid = txid;
+    output.n = static_cast<unsigned int>(vout);
+    std::vector<prevoutspending_t> spending = btc.gettxspendingprevout({output});
+    return spending.empty() ? "" : spending[0].spendingtxid;
+}
+
+MempoolSnapshot::~MempoolSnapshot() = default;
+
+MempoolSnapshot MempoolSnapshot::take(const BitcoinRPCFacade & btc) {
+    MempoolSnapshot snapshot;
+    for(const std::string & txid : btc.getrawmempool()) {
+        std::string hexString;
+        try {
+            hexString = btc.getrawtransaction(txid, 0).hex;
+        }
+        catch(BitcoinException &) {
+            // confirmed or evicted since getrawmempool
+            continue;
+        }
+        Result<RawTransaction> tx = RawTransaction::fromHex(hexString);
+        if(!tx)
+            continue;
+        for(const TxInputView & input : tx.value().inputs())
+            snapshot.add(hex::encodeHash(input.prevTxid.data), static_cast<int>(input.prevIndex), txid);
+    }
+    return snapshot;
+}
+
+void MempoolSnapshot::add(const std::string & txid, int vout, const std::string & spendingTxid) {
+    spenders[outpoint(txid, vout)] = spendingTxid;
+}
+
+std::string MempoolSnapshot::spender(const BitcoinRPCFacade &, const std::string & txid, int vout) const {
+    auto found = spenders.find(outpoint(txid, vout));
+    return found == spenders.end() ? "" : found->second;
+}
+
+size_t MempoolSnapshot::size() const {
+    return spenders.size();
+}
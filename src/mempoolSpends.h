@@ -0,0 +1,76 @@
+#ifndef TXREF_MEMPOOLSPENDS_H
+#define TXREF_MEMPOOLSPENDS_H
+
+#include "bitcoinRPCFacade.h"
+
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+
+/**
+ * Finds unconfirmed transactions that spend an output, so a DID update waiting in the mempool
+ * can be seen without asking chain.so
+ */
+class MempoolSpends {
+public:
+    virtual ~MempoolSpends();
+
+    /**
+     * @param btc the BitcoinRPCFacade of the calling thread
+     * @param txid the transaction, as bitcoind displays it
+     * @param vout the output
+     * @return the txid of the mempool transaction spending the output, or "" if none does
+     */
+    virtual std::string spender(const BitcoinRPCFacade & btc, const std::string & txid, int vout) const = 0;
+};
+
+/**
+ * Asks bitcoind about each output with gettxspendingprevout, which needs bitcoind 24 or later.
+ * One call per output, but always current.
+ */
+class RpcMempoolSpends : public MempoolSpends {
+public:
+    ~RpcMempoolSpends() override;
+
+    std::string spender(const BitcoinRPCFacade & btc, const std::string & txid, int vout) const override;
+};
+
+/**
+ * The whole mempool at one moment, indexed by the outputs its transactions spend. Taking it
+ * costs a getrawmempool and a getrawtransaction per mempool transaction, after which checking
+ * any number of outputs needs no RPC calls at all, from any number of threads. Works with any
+ * bitcoind. Transactions that arrive after the snapshot are not seen.
+ */
+class MempoolSnapshot : public MempoolSpends {
+public:
+    ~MempoolSnapshot() override;
+
+    /**
+     * Take a snapshot of the mempool. Transactions that leave the mempool while it is being
+     * read are skipped.
+     * @param btc the BitcoinRPCFacade
+     * @return the snapshot
+     */
+    static MempoolSnapshot take(const BitcoinRPCFacade & btc);
+
+    /**
+     * Record that a transaction spends an output
+     * @param txid the spent output's transaction
+     * @param vout the spent output
+     * @param spendingTxid the spending transaction
+     */
+    void add(const std::string & txid, int vout, const std::string & spendingTxid);
+
+    std::string spender(const BitcoinRPCFacade & btc, const std::string & txid, int vout) const override;
+
+    /**
+     * @return the number of outputs spent by transactions in the snapshot
+     */
+    size_t size() const;
+
+private:
+    std::unordered_map<std::string, std::string> spenders;  // "txid:vout" -> spending txid
+};
+
+
+#endif //TXREF_MEMPOOLSPENDS_H
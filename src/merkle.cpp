@@ -0,0 +1,67 @@
+#include "merkle.h"
+#include "sha256.h"
+
+#include <cstring>
+#include <vector>
+
+namespace merkle {
+
+    void root(const uint8_t * hashes, size_t count, uint8_t * out) {
+        if(count == 0) {
+            std::memset(out, 0, sha256::DIGEST_SIZE);
+            return;
+        }
+
+        // room for one more hash, in case the first level needs its last one repeated
+        std::vector<uint8_t> level(hashes, hashes + count * sha256::DIGEST_SIZE);
+        level.resize((count + 1) * sha256::DIGEST_SIZE);
+
+        while(count > 1) {
+            if(count % 2 == 1) {
+                std::memcpy(&level[count * sha256::DIGEST_SIZE], &level[(count - 1) * sha256::DIGEST_SIZE], sha256::DIGEST_SIZE);
+                ++count;
+            }
+            // hash each pair in place; the whole level goes to the kernel at once
+            count /= 2;
+            sha256::doubleHash64(level.data(), count, level.data());
+        }
+        std::memcpy(out, level.data(), sha256::DIGEST_SIZE);
+    }
+
+    std::vector<uint8_t> branch(const uint8_t * hashes, size_t count, uint32_t index) {
+        std::vector<uint8_t> siblings;
+        std::vector<uint8_t> level(hashes, hashes + count * sha256::DIGEST_SIZE);
+        level.resize((count + 1) * sha256::DIGEST_SIZE);
+
+        while(count > 1) {
+            if(count % 2 == 1) {
+                std::memcpy(&level[count * sha256::DIGEST_SIZE], &level[(count - 1) * sha256::DIGEST_SIZE], sha256::DIGEST_SIZE);
+                ++count;
+            }
+            const uint8_t * sibling = &level[(index ^ 1) * sha256::DIGEST_SIZE];
+            siblings.insert(siblings.end(), sibling, sibling + sha256::DIGEST_SIZE);
+            count /= 2;
+            index >>= 1;
+            sha256::doubleHash64(level.data(), count, level.data());
+        }
+        return siblings;
+    }
+
+    void rootFromBranch(const uint8_t * leaf, const uint8_t * branch, size_t branchLength, uint32_t index, uint8_t * out) {
+        uint8_t pair[2 * sha256::DIGEST_SIZE];
+        std::memcpy(out, leaf, sha256::DIGEST_SIZE);
+        for(size_t i = 0; i < branchLength; ++i, index >>= 1) {
+            const uint8_t * sibling = branch + i * sha256::DIGEST_SIZE;
+            if(index & 1) {
+                std::memcpy(pair, sibling, sha256::DIGEST_SIZE);
+                std::memcpy(pair + sha256::DIGEST_SIZE, out, sha256::DIGEST_SIZE);
+            }
+            else {
+                std::memcpy(pair, out, sha256::DIGEST_SIZE);
+                std::memcpy(pair + sha256::DIGEST_SIZE, sibling, sha256::DIGEST_SIZE);
+            }
+            sha256::doubleHash(pair, sizeof(pair), out);
+        }
+    }
+
+}
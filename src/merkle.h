@@ -0,0 +1,44 @@
+#ifndef TXREF_MERKLE_H
+#define TXREF_MERKLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Bitcoin merkle trees, over hashes in their internal (not displayed) byte order
+ */
+namespace merkle {
+
+    /**
+     * Compute a merkle root: hash pairs of hashes with SHA-256d, repeating the last hash of a
+     * level that has an odd number of them, until one is left
+     * @param hashes count * 32 bytes
+     * @param count the number of hashes
+     * @param out receives 32 bytes; all zeros if there are no hashes
+     */
+    void root(const uint8_t * hashes, size_t count, uint8_t * out);
+
+    /**
+     * Compute the root that a merkle branch leads to, to check a proof that a transaction is
+     * in a block
+     * @param leaf the 32-byte hash the branch starts from
+     * @param branch branchLength * 32 bytes: the sibling hashes from the leaf up
+     * @param branchLength the number of hashes in the branch
+     * @param index the leaf's position in the tree; each bit says which side its sibling is on
+     * @param out receives 32 bytes
+     */
+    void rootFromBranch(const uint8_t * leaf, const uint8_t * branch, size_t branchLength, uint32_t index, uint8_t * out);
+
+    /**
+     * Compute the merkle branch of one hash: the proof that rootFromBranch() checks
+     * @param hashes count * 32 bytes
+     * @param count the number of hashes
+     * @param index the position of the hash to prove; must be less than count
+     * @return the sibling hashes from the leaf up, 32 bytes each
+     */
+    std::vector<uint8_t> branch(const uint8_t * hashes, size_t count, uint32_t index);
+
+}
+
+#endif //TXREF_MERKLE_H
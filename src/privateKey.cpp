@@ -0,0 +1,112 @@
+#include "privateKey.h"
+#include "base58.h"
+#include "secp256k1Context.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+
+    const uint8_t WIF_MAINNET = 0x80;
+    const uint8_t WIF_TESTNET = 0xef;
+    const uint8_t WIF_COMPRESSED = 0x01;
+
+    // the largest DER signature: two 33-byte integers with their headers
+    const size_t MAX_DER_SIZE = 72;
+
+    /**
+     * Clear memory in a way the compiler won't optimize away
+     */
+    void secureClear(uint8_t * data, size_t len) {
+        volatile uint8_t * p = data;
+        while(len-- > 0)
+            *p++ = 0;
+    }
+}
+
+
+Result<PrivateKey> PrivateKey::fromWif(const std::string & wif, const std::string & chain) {
+    typedef Result<PrivateKey> R;
+
+    uint8_t prefix;
+    if(chain == "main")
+        prefix = WIF_MAINNET;
+    else if(chain == "test" || chain == "testnet4" || chain == "signet" || chain == "regtest")
+        prefix = WIF_TESTNET;
+    else
+        return R::failure("Unknown chain '" + chain + "'");
+
+    Result<std::vector<uint8_t>> decoded = base58::decodeCheck(wif);
+    if(!decoded)
+        return R::failure("Private key is not a valid WIF key");
+    // a reference, so the decoded bytes themselves are wiped below
+    std::vector<uint8_t> & payload = decoded.value();
+
+    // a prefix, the secret, and a trailing 0x01 if the public key is compressed
+    bool compressed = payload.size() == 1 + SIZE + 1 && payload.back() == WIF_COMPRESSED;
+    R result = R::failure("Private key is not a valid WIF key");
+    if(compressed || payload.size() == 1 + SIZE) {
+        if(payload[0] != prefix)
+            result = R::failure("Private key is not for the " + chain + " chain");
+        else
+            result = fromSecret(&payload[1], compressed);
+    }
+
+    secureClear(payload.data(), payload.size());
+    return result;
+}
+
+Result<PrivateKey> PrivateKey::fromSecret(const uint8_t * secret, bool compressed) {
+    const secp256k1_context * context = secp256k1Context();
+    secp256k1_pubkey pubkey;
+    if(!secp256k1_ec_seckey_verify(context, secret) || !secp256k1_ec_pubkey_create(context, &pubkey, secret))
+        return Result<PrivateKey>::failure("Private key is out of range");
+
+    std::vector<uint8_t> serialized(compressed ? 33 : 65);
+    size_t len = serialized.size();
+    secp256k1_ec_pubkey_serialize(context, serialized.data(), &len, &pubkey,
+                                  compressed ? SECP256K1_EC_COMPRESSED : SECP256K1_EC_UNCOMPRESSED);
+    return Result<PrivateKey>::success(PrivateKey(secret, compressed, serialized));
+}
+
+PrivateKey::PrivateKey(const uint8_t * secret, bool compressed, const std::vector<uint8_t> & serializedPublicKey)
+        : compressedKey(compressed), publicKeyBytes(serializedPublicKey) {
+    std::copy(secret, secret + SIZE, secretKey.begin());
+}
+
+PrivateKey::PrivateKey(const PrivateKey & other)
+        : secretKey(other.secretKey), compressedKey(other.compressedKey), publicKeyBytes(other.publicKeyBytes) {
+}
+
+PrivateKey & PrivateKey::operator=(const PrivateKey & other) {
+    secretKey = other.secretKey;
+    compressedKey = other.compressedKey;
+    publicKeyBytes = other.publicKeyBytes;
+    return *this;
+}
+
+PrivateKey::~PrivateKey() {
+    secureClear(secretKey.data(), secretKey.size());
+}
+
+bool PrivateKey::isCompressed() const {
+    return compressedKey;
+}
+
+const std::vector<uint8_t> & PrivateKey::publicKey() const {
+    return publicKeyBytes;
+}
+
+std::vector<uint8_t> PrivateKey::sign(const uint8_t * hash) const {
+    const secp256k1_context * context = secp256k1Context();
+    secp256k1_ecdsa_signature signature;
+    // a null nonce function means RFC 6979; libsecp256k1 always produces a low S
+    if(!secp256k1_ecdsa_sign(context, &signature, hash, secretKey.data(), nullptr, nullptr))
+        throw std::runtime_error("Can't sign with this private key");
+
+    std::vector<uint8_t> der(MAX_DER_SIZE);
+    size_t len = der.size();
+    secp256k1_ecdsa_signature_serialize_der(context, der.data(), &len, &signature);
+    der.resize(len);
+    return der;
+}
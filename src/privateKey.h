@@ -0,0 +1,67 @@
+#ifndef TXREF_PRIVATEKEY_H
+#define TXREF_PRIVATEKEY_H
+
+#include "result.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * A secp256k1 private key, which signs in-process so that it never has to be sent to bitcoind.
+ *
+ * The secret is wiped from memory when the key is destroyed. Error messages never include it.
+ */
+class PrivateKey {
+
+public:
+    static const size_t SIZE = 32;
+
+    /**
+     * Decode a key in Wallet Import Format, as bitcoind's dumpprivkey gives it
+     * @param wif the key
+     * @param chain the chain it must belong to, as getblockchaininfo names it
+     * @return the key, or why it is not a valid key for this chain
+     */
+    static Result<PrivateKey> fromWif(const std::string & wif, const std::string & chain);
+
+    /**
+     * @param secret SIZE bytes
+     * @param compressed whether the public key is used in its 33-byte compressed form
+     * @return the key, or a failure if the secret is zero or not less than the curve order
+     */
+    static Result<PrivateKey> fromSecret(const uint8_t * secret, bool compressed);
+
+    PrivateKey(const PrivateKey & other);
+
+    PrivateKey & operator=(const PrivateKey & other);
+
+    ~PrivateKey();
+
+    bool isCompressed() const;
+
+    /**
+     * @return the public key, serialized as it appears in scripts: 33 bytes if compressed, else 65
+     */
+    const std::vector<uint8_t> & publicKey() const;
+
+    /**
+     * Sign a 32-byte hash with ECDSA. The nonce is derived from the key and hash (RFC 6979) and
+     * the signature has a low S, as bitcoind requires for relay.
+     * @param hash the hash to sign
+     * @return the DER-encoded signature, without a sighash type
+     */
+    std::vector<uint8_t> sign(const uint8_t * hash) const;
+
+private:
+    PrivateKey(const uint8_t * secret, bool compressed, const std::vector<uint8_t> & serializedPublicKey);
+
+    std::array<uint8_t, SIZE> secretKey;
+    bool compressedKey;
+    std::vector<uint8_t> publicKeyBytes;
+};
+
+
+#endif //TXREF_PRIVATEKEY_H
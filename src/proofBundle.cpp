@@ -0,0 +1,410 @@
+#include "proofBundle.h"
+#include "domain/txrefDecoder.h"
+#include "hex.h"
+#include "rawTransaction.h"
+
+#include <bitcoinapi/bitcoinapi.h>
+#include <algorithm>
+#include <map>
+
+namespace {
+
+    // "BTCRPB", then the format version
+    const uint8_t MAGIC[] = {'B', 'T', 'C', 'R', 'P', 'B', 0, 1};
+
+    void writeCompactSize(std::vector<uint8_t> & out, uint64_t value) {
+        int len = 0;
+        if(value < 0xfd) {
+            out.push_back(static_cast<uint8_t>(value));
+        }
+        else if(value <= 0xffff) {
+            out.push_back(0xfd);
+            len = 2;
+        }
+        else if(value <= 0xffffffff) {
+            out.push_back(0xfe);
+            len = 4;
+        }
+        else {
+            out.push_back(0xff);
+            len = 8;
+        }
+        for(int i = 0; i < len; ++i)
+            out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+
+    void writeBytes(std::vector<uint8_t> & out, const std::vector<uint8_t> & bytes) {
+        writeCompactSize(out, bytes.size());
+        out.insert(out.end(), bytes.begin(), bytes.end());
+    }
+
+    /**
+     * Reads the serialized bundle front to back, never past its end
+     */
+    class Reader {
+    public:
+        Reader(const uint8_t * d, size_t l) : data(d), len(l) {}
+
+        bool read(uint8_t * out, size_t count) {
+            if(count > len - pos)
+                return false;
+            std::copy(data + pos, data + pos + count, out);
+            pos += count;
+            return true;
+        }
+
+        bool readLE32(uint32_t & value) {
+            uint8_t bytes[4];
+            if(!read(bytes, 4))
+                return false;
+            value = 0;
+            for(int i = 0; i < 4; ++i)
+                value |= static_cast<uint32_t>(bytes[i]) << (8 * i);
+            return true;
+        }
+
+        bool readCompactSize(uint64_t & value) {
+            uint8_t first;
+            if(!read(&first, 1))
+                return false;
+            int size = first == 0xfd ? 2 : first == 0xfe ? 4 : first == 0xff ? 8 : 0;
+            if(size == 0) {
+                value = first;
+                return true;
+            }
+            uint8_t bytes[8];
+            if(!read(bytes, static_cast<size_t>(size)))
+                return false;
+            value = 0;
+            for(int i = 0; i < size; ++i)
+                value |= static_cast<uint64_t>(bytes[i]) << (8 * i);
+            return true;
+        }
+
+        /**
+         * Read a count of items of at least minSize bytes each, refusing one the rest of the
+         * data couldn't hold
+         */
+        bool readCount(size_t & count, size_t minSize) {
+            uint64_t value;
+            if(!readCompactSize(value) || value > remaining() / minSize)
+                return false;
+            count = static_cast<size_t>(value);
+            return true;
+        }
+
+        bool readBytes(std::vector<uint8_t> & bytes) {
+            size_t count;
+            if(!readCount(count, 1))
+                return false;
+            bytes.resize(count);
+            return read(bytes.data(), count);
+        }
+
+        size_t remaining() const {
+            return len - pos;
+        }
+
+    private:
+        const uint8_t * data;
+        size_t len;
+        size_t pos = 0;
+    };
+
+    /**
+     * @return the output a DID follows out of a transaction in its chain: the txref's own for
+     * the DID's transaction, the first that isn't OP_RETURN for the ones after it, or -1 if
+     * there isn't one
+     */
+    int followedOutput(const RawTransaction & tx, bool isDidTransaction, int txoIndex) {
+        if(isDidTransaction)
+            return txoIndex < static_cast<int>(tx.outputs().size()) ? txoIndex : -1;
+        return didFollowedOutput(tx);
+    }
+
+    bool spends(const RawTransaction & tx, const Hash256 & prevTxid, int prevIndex) {
+        for(const TxInputView & input : tx.inputs()) {
+            if(static_cast<int>(input.prevIndex) == prevIndex &&
+               std::equal(prevTxid.begin(), prevTxid.end(), input.prevTxid.data))
+                return true;
+        }
+        return false;
+    }
+
+    /**
+     * A transaction in the DID's chain while the bundle is built
+     */
+    struct ChainTransaction {
+        std::string txid;
+        std::string blockhash;
+        int height;
+        std::vector<uint8_t> raw;
+    };
+
+    /**
+     * Follows a DID's chain backward, from its tip to the DID's own transaction
+     */
+    class ChainWalk {
+    public:
+        ChainWalk(const BitcoinRPCFacade & b, const std::string & txid, const std::string & blockhash, int height, int txo)
+                : btc(b), didTxid(txid), didBlockhash(blockhash), didHeight(height), txoIndex(txo) {}
+
+        /**
+         * Walk back from a transaction. An update can have other inputs besides the one
+         * spending the DID's output, so each input spending an output the DID could follow is
+         * tried in turn.
+         * @param txid where to start
+         * @return true if the DID's transaction was reached, with chain() leading to it
+         */
+        bool from(const std::string & txid) {
+            if(visited++ == ProofBundle::MAX_TRANSACTIONS)
+                return false;
+
+            ChainTransaction link;
+            link.txid = txid;
+            if(txid == didTxid) {
+                link.blockhash = didBlockhash;
+                link.height = didHeight;
+                hex::decode(btc.getrawtransactioninblock(txid, didBlockhash), link.raw);
+            }
+            else {
+                getrawtransaction_t rawTransaction = btc.getrawtransaction(txid, 1);
+                // unconfirmed
+                if(rawTransaction.blockhash.empty())
+                    return false;
+                // older than the DID's block, and so not in its chain. Heights rather than
+                // confirmations, which change as blocks arrive during the walk.
+                link.height = btc.getblock(rawTransaction.blockhash).height;
+                if(link.height < didHeight)
+                    return false;
+                link.blockhash = rawTransaction.blockhash;
+                hex::decode(rawTransaction.hex, link.raw);
+            }
+            Result<RawTransaction> tx = RawTransaction::parse(link.raw.data(), link.raw.size());
+            if(!tx)
+                return false;
+            transactions.push_back(link);
+            if(txid == didTxid)
+                return true;
+
+            for(const TxInputView & input : tx.value().inputs()) {
+                if(isNullPrevout(input))
+                    continue;
+                std::string prevTxid = hex::encodeHash(input.prevTxid.data);
+                int followed = txoIndex;
+                if(prevTxid != didTxid) {
+                    Result<RawTransaction> prevTx = RawTransaction::fromHex(btc.getrawtransaction(prevTxid, 0).hex);
+                    if(!prevTx)
+                        continue;
+                    followed = didFollowedOutput(prevTx.value());
+                }
+                if(static_cast<int>(input.prevIndex) == followed && from(prevTxid))
+                    return true;
+            }
+            transactions.pop_back();
+            return false;
+        }
+
+        /**
+         * @return the DID's chain, tip first
+         */
+        const std::vector<ChainTransaction> & chain() const {
+            return transactions;
+        }
+
+        bool gaveUp() const {
+            return visited > ProofBundle::MAX_TRANSACTIONS;
+        }
+
+    private:
+        const BitcoinRPCFacade & btc;
+        const std::string didTxid;
+        const std::string didBlockhash;
+        const int didHeight;
+        const int txoIndex;
+        size_t visited = 0;
+        std::vector<ChainTransaction> transactions;
+    };
+}
+
+const size_t ProofBundle::MAX_TRANSACTIONS;
+
+Result<ProofBundle> ProofBundle::build(const BitcoinRPCFacade & btc, const std::string & did, const std::string & tipTxid) {
+    DecodedTxref decoded;
+    TxrefDecodeStatus status = decodeTxref(did, decoded);
+    if(status != TxrefDecodeStatus::ok)
+        return Result<ProofBundle>::failure(std::string("Not a valid DID: ") + describe(status));
+
+    try {
+        std::string didBlockhash = btc.getblockhash(decoded.blockHeight);
+        blockinfo_t didBlock = btc.getblock(didBlockhash);
+        if(decoded.transactionIndex >= static_cast<int>(didBlock.tx.size()))
+            return Result<ProofBundle>::failure("The DID's block has no transaction at its index");
+        const std::string & didTxid = didBlock.tx[static_cast<size_t>(decoded.transactionIndex)];
+
+        ChainWalk walk(btc, didTxid, didBlockhash, decoded.blockHeight, decoded.txoIndex);
+        if(!walk.from(tipTxid)) {
+            if(walk.gaveUp())
+                return Result<ProofBundle>::failure("Gave up following the DID's chain back after " +
+                                                    std::to_string(MAX_TRANSACTIONS) + " transactions");
+            return Result<ProofBundle>::failure("Can't follow the DID's chain back from " + tipTxid);
+        }
+        std::vector<ChainTransaction> chain(walk.chain().rbegin(), walk.chain().rend());
+
+        ProofBundle bundle;
+        bundle.did = did;
+        bundle.firstHeight = static_cast<uint32_t>(decoded.blockHeight);
+        int lastHeight = decoded.blockHeight;
+        for(const ChainTransaction & link : chain) {
+            lastHeight = std::max(lastHeight, link.height);
+            Link proven;
+            proven.rawTransaction = link.raw;
+            if(!hex::decode(btc.gettxoutproof({link.txid}, link.blockhash), proven.merkleBlock))
+                return Result<ProofBundle>::failure("bitcoind returned an invalid proof for " + link.txid);
+            bundle.links.push_back(proven);
+        }
+        for(int height = decoded.blockHeight; height <= lastHeight; ++height) {
+            std::array<uint8_t, BlockHeader::SIZE> header;
+            std::string headerHex = btc.getrawblockheader(btc.getblockhash(height));
+            if(headerHex.size() != 2 * BlockHeader::SIZE || !hex::decode(headerHex.data(), headerHex.size(), header.data()))
+                return Result<ProofBundle>::failure("bitcoind returned an invalid header at height " + std::to_string(height));
+            bundle.headers.push_back(header);
+        }
+        return Result<ProofBundle>::success(bundle);
+    }
+    catch(BitcoinException & e) {
+        return Result<ProofBundle>::failure(std::to_string(e.getCode()) + " " + e.getMessage());
+    }
+}
+
+Result<ProofBundle> ProofBundle::parse(const uint8_t * data, size_t len) {
+    Reader reader(data, len);
+    uint8_t magic[sizeof(MAGIC)];
+    if(!reader.read(magic, sizeof(magic)) || !std::equal(magic, magic + sizeof(magic), MAGIC))
+        return Result<ProofBundle>::failure("Not a proof bundle, or not one of this version");
+
+    ProofBundle bundle;
+    std::vector<uint8_t> did;
+    size_t numHeaders, numLinks;
+    if(!reader.readBytes(did) || !reader.readLE32(bundle.firstHeight) || !reader.readCount(numHeaders, BlockHeader::SIZE))
+        return Result<ProofBundle>::failure("Proof bundle is truncated");
+    bundle.did.assign(did.begin(), did.end());
+    bundle.headers.resize(numHeaders);
+    for(auto & header : bundle.headers)
+        reader.read(header.data(), header.size());
+
+    if(!reader.readCount(numLinks, 2))
+        return Result<ProofBundle>::failure("Proof bundle is truncated");
+    bundle.links.resize(numLinks);
+    for(Link & link : bundle.links) {
+        if(!reader.readBytes(link.merkleBlock) || !reader.readBytes(link.rawTransaction))
+            return Result<ProofBundle>::failure("Proof bundle is truncated");
+    }
+    if(reader.remaining() != 0)
+        return Result<ProofBundle>::failure("Proof bundle has trailing data");
+    return Result<ProofBundle>::success(bundle);
+}
+
+std::vector<uint8_t> ProofBundle::serialize() const {
+    std::vector<uint8_t> out(MAGIC, MAGIC + sizeof(MAGIC));
+    writeBytes(out, std::vector<uint8_t>(did.begin(), did.end()));
+    for(int i = 0; i < 4; ++i)
+        out.push_back(static_cast<uint8_t>(firstHeight >> (8 * i)));
+    writeCompactSize(out, headers.size());
+    for(const auto & header : headers)
+        out.insert(out.end(), header.begin(), header.end());
+    writeCompactSize(out, links.size());
+    for(const Link & link : links) {
+        writeBytes(out, link.merkleBlock);
+        writeBytes(out, link.rawTransaction);
+    }
+    return out;
+}
+
+Result<VerifiedDid> ProofBundle::verify() const {
+    DecodedTxref decoded;
+    TxrefDecodeStatus status = decodeTxref(did, decoded);
+    if(status != TxrefDecodeStatus::ok)
+        return Result<VerifiedDid>::failure(std::string("Not a valid DID: ") + describe(status));
+    if(static_cast<int64_t>(firstHeight) != decoded.blockHeight)
+        return Result<VerifiedDid>::failure("The headers don't start at the DID's block");
+    if(headers.empty() || links.empty())
+        return Result<VerifiedDid>::failure("The bundle has no headers or no transactions");
+
+    // the headers have to be a chain, each with its proof of work
+    std::map<Hash256, size_t> headerIndex;
+    Hash256 prevHash = {};
+    for(size_t i = 0; i < headers.size(); ++i) {
+        BlockHeader header = BlockHeader::parse(headers[i].data());
+        if(!header.meetsTarget())
+            return Result<VerifiedDid>::failure("Header at height " + std::to_string(firstHeight + i) + " doesn't meet its target");
+        if(i > 0 && header.prevHash != prevHash)
+            return Result<VerifiedDid>::failure("Header at height " + std::to_string(firstHeight + i) + " doesn't follow the one before");
+        headerIndex[header.hash] = i;
+        prevHash = header.hash;
+    }
+
+    VerifiedDid verified;
+    verified.did = did;
+    verified.blockHeight = decoded.blockHeight;
+    verified.transactionIndex = decoded.transactionIndex;
+    verified.txoIndex = decoded.txoIndex;
+
+    Hash256 previousTxid = {};
+    int previousFollowed = -1;
+    for(size_t i = 0; i < links.size(); ++i) {
+        const Link & link = links[i];
+        std::string which = "Transaction " + std::to_string(i) + " of the DID's chain";
+
+        Result<MerkleBlock> merkleBlock = MerkleBlock::parse(link.merkleBlock.data(), link.merkleBlock.size());
+        if(!merkleBlock)
+            return Result<VerifiedDid>::failure(which + ": " + merkleBlock.error());
+        auto found = headerIndex.find(merkleBlock.value().header.hash);
+        if(found == headerIndex.end())
+            return Result<VerifiedDid>::failure(which + " is in a block outside the headers");
+        size_t height = firstHeight + found->second;
+
+        Result<RawTransaction> tx = RawTransaction::parse(link.rawTransaction.data(), link.rawTransaction.size());
+        if(!tx)
+            return Result<VerifiedDid>::failure(which + ": " + tx.error());
+        Hash256 txid = tx.value().txid();
+        const auto & matches = merkleBlock.value().matches;
+        auto match = std::find_if(matches.begin(), matches.end(),
+                                  [&txid](const std::pair<uint32_t, Hash256> & m) { return m.second == txid; });
+        if(match == matches.end())
+            return Result<VerifiedDid>::failure(which + " is not proven to be in its block");
+
+        if(i == 0) {
+            // the DID's own transaction is where the txref says
+            if(found->second != 0 || static_cast<int>(match->first) != decoded.transactionIndex)
+                return Result<VerifiedDid>::failure(which + " is not the one the txref names");
+            verified.txid = hex::encodeHash(txid.data());
+        }
+        else if(!spends(tx.value(), previousTxid, previousFollowed)) {
+            return Result<VerifiedDid>::failure(which + " doesn't spend the output the DID follows");
+        }
+
+        previousTxid = txid;
+        previousFollowed = followedOutput(tx.value(), i == 0, decoded.txoIndex);
+        if(previousFollowed < 0 && i + 1 < links.size())
+            return Result<VerifiedDid>::failure(which + " has no output for the DID to follow");
+
+        verified.tipTxid = hex::encodeHash(txid.data());
+        verified.tipBlockHeight = static_cast<int>(height);
+        verified.tipBlockHash = hex::encodeHash(merkleBlock.value().header.hash.data());
+    }
+    verified.numTransactions = links.size();
+    return Result<VerifiedDid>::success(verified);
+}
+
+const std::string & ProofBundle::getDid() const {
+    return did;
+}
+
+size_t ProofBundle::numHeaders() const {
+    return headers.size();
+}
+
+size_t ProofBundle::numTransactions() const {
+    return links.size();
+}
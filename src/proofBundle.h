@@ -0,0 +1,97 @@
+#ifndef TXREF_PROOFBUNDLE_H
+#define TXREF_PROOFBUNDLE_H
+
+#include "bitcoinRPCFacade.h"
+#include "block.h"
+#include "result.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * What a verified ProofBundle shows about a DID
+ */
+struct VerifiedDid {
+    std::string did;
+    std::string txid;           // the DID's own transaction
+    int blockHeight = 0;
+    int transactionIndex = 0;
+    int txoIndex = 0;
+    std::string tipTxid;        // the last transaction in the DID's chain when the bundle was made
+    int tipBlockHeight = 0;
+    std::string tipBlockHash;
+    size_t numTransactions = 0; // in the chain, from the DID's own to the tip
+};
+
+/**
+ * Everything needed to check a resolved DID without a bitcoin node: the headers from the
+ * DID's block to its tip's block, and for each transaction in the DID's chain, the
+ * transaction itself and the merkle proof (from gettxoutproof) that it is in its block.
+ *
+ * Verifying takes SHA-256d alone. The headers have to link up and meet their targets, each
+ * proof has to lead to its header's merkle root, the first transaction has to be at the
+ * place the txref names, and each later one has to spend the output the DID follows out of
+ * the one before. Whether the last header is on the best chain, and whether the tip is still
+ * unspent, can't be known offline; the tip's block hash is reported so it can be checked
+ * against a trusted source.
+ *
+ * The serialized form is binary: an 8-byte header, the DID, the height of the first header,
+ * the 80-byte headers, then each transaction's merkleblock and serialized form, with
+ * CompactSize counts and lengths.
+ */
+class ProofBundle {
+
+public:
+    // the most transactions that will be looked at while following the chain back from the tip
+    static const size_t MAX_TRANSACTIONS = 1000;
+
+    /**
+     * Build the bundle for a resolved DID. This walks the DID's chain back from the tip, so
+     * bitcoind needs -txindex.
+     * @param btc the BitcoinRPCFacade
+     * @param did the DID
+     * @param tipTxid the last transaction in its chain, as resolveDid() finds it
+     * @return the bundle, or why it could not be built
+     */
+    static Result<ProofBundle> build(const BitcoinRPCFacade & btc, const std::string & did, const std::string & tipTxid);
+
+    /**
+     * Read a serialized bundle. Nothing is verified but its structure.
+     * @param data the serialized bundle
+     * @param len the number of bytes
+     * @return the bundle, or why it could not be read
+     */
+    static Result<ProofBundle> parse(const uint8_t * data, size_t len);
+
+    std::vector<uint8_t> serialize() const;
+
+    /**
+     * @return what the bundle shows, or why it doesn't hold up
+     */
+    Result<VerifiedDid> verify() const;
+
+    const std::string & getDid() const;
+
+    size_t numHeaders() const;
+
+    size_t numTransactions() const;
+
+private:
+    struct Link {
+        std::vector<uint8_t> merkleBlock;
+        std::vector<uint8_t> rawTransaction;
+    };
+
+    ProofBundle() = default;
+
+    std::string did;
+    uint32_t firstHeight = 0;
+    std::vector<std::array<uint8_t, BlockHeader::SIZE>> headers;
+    std::vector<Link> links;    // from the DID's own transaction to the tip
+};
+
+
+#endif //TXREF_PROOFBUNDLE_H
@@ -0,0 +1,314 @@
+#include "proofStoreBitcoinRPCFacade.h"
+#include "fileUtil.h"
+#include "hex.h"
+#include "merkle.h"
+#include "rawTransaction.h"
+
+#include <bitcoinapi/bitcoinapi.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+namespace {
+
+    const char FILE_SUFFIX[] = ".proofs";
+
+    void writeLE32(uint8_t * p, uint32_t value) {
+        for(int i = 0; i < 4; ++i)
+            p[i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+
+    /**
+     * Serialize the header of a block from the fields getblock reports
+     */
+    bool serializeHeader(const blockinfo_t & block, uint8_t * header) {
+        if(block.bits.size() != 8 || !hex::isValid(block.bits))
+            return false;
+        writeLE32(header, static_cast<uint32_t>(block.version));
+        // the genesis block has no previous block, and getblock reports no hash for it
+        if(block.previousblockhash.empty())
+            std::memset(header + 4, 0, 32);
+        else if(!hex::decodeHash(block.previousblockhash, header + 4))
+            return false;
+        if(!hex::decodeHash(block.merkleroot, header + 36))
+            return false;
+        writeLE32(header + 68, block.time);
+        writeLE32(header + 72, static_cast<uint32_t>(std::stoul(block.bits, nullptr, 16)));
+        writeLE32(header + 76, block.nonce);
+        return true;
+    }
+
+    /**
+     * Is this serialized transaction the one with this txid?
+     */
+    bool isTransaction(const std::string & rawTransactionHex, const std::string & txid) {
+        Result<RawTransaction> parsed = RawTransaction::fromHex(rawTransactionHex);
+        return parsed && hex::encodeHash(parsed.value().txid().data()) == txid;
+    }
+}
+
+
+ProofStore::ProofStore(const std::string & dir) : directory(dir) {
+    if(::mkdir(directory.c_str(), 0755) != 0 && errno != EEXIST)
+        throw std::runtime_error("Can't create proof store directory: " + directory);
+
+    DIR * listing = ::opendir(directory.c_str());
+    if(listing == nullptr)
+        throw std::runtime_error("Can't read proof store directory: " + directory);
+    std::vector<std::string> names;
+    while(struct dirent * entry = ::readdir(listing)) {
+        if(hasSuffix(entry->d_name, FILE_SUFFIX))
+            names.emplace_back(entry->d_name);
+    }
+    ::closedir(listing);
+
+    for(const std::string & name : names)
+        load(name);
+}
+
+bool ProofStore::keep(const blockinfo_t & block, const std::string & txid, const std::string & rawTransactionHex) {
+    StoredBlock stored;
+    if(!serializeHeader(block, stored.header.data()))
+        return false;
+    BlockHeader header = BlockHeader::parse(stored.header.data());
+    if(hex::encodeHash(header.hash.data()) != block.hash)
+        return false;
+
+    auto found = std::find(block.tx.begin(), block.tx.end(), txid);
+    if(found == block.tx.end() || !isTransaction(rawTransactionHex, txid))
+        return false;
+
+    std::vector<uint8_t> txids(block.tx.size() * 32);
+    for(size_t i = 0; i < block.tx.size(); ++i) {
+        if(!hex::decodeHash(block.tx[i], &txids[32 * i]))
+            return false;
+    }
+
+    StoredTransaction transaction;
+    transaction.index = static_cast<uint32_t>(found - block.tx.begin());
+    transaction.branch = merkle::branch(txids.data(), block.tx.size(), transaction.index);
+    transaction.hex = rawTransactionHex;
+
+    uint8_t root[32];
+    merkle::rootFromBranch(&txids[32 * transaction.index], transaction.branch.data(), transaction.branch.size() / 32,
+                           transaction.index, root);
+    if(!std::equal(root, root + 32, header.merkleRoot.begin()))
+        return false;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto inserted = blocks.emplace(block.hash, stored);
+    StoredBlock & storedBlock = inserted.first->second;
+    if(inserted.second) {
+        storedBlock.height = block.height;
+        storedBlock.transactionCount = static_cast<uint32_t>(block.tx.size());
+    }
+    storedBlock.transactions[txid] = transaction;
+    blockOfTransaction[txid] = block.hash;
+    save(block.hash, storedBlock);
+    return true;
+}
+
+bool ProofStore::keepFrom(const BitcoinRPCFacade & btc, const std::string & txid, int blockHeight) {
+    if(hasTransaction(txid))
+        return false;
+
+    std::string blockhash = btc.getblockhash(blockHeight);
+    blockinfo_t block = btc.getblock(blockhash);
+    std::string rawTransactionHex = btc.getrawtransactioninblock(txid, blockhash);
+    return keep(block, txid, rawTransactionHex);
+}
+
+bool ProofStore::hasTransaction(const std::string & txid) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return blockOfTransaction.find(txid) != blockOfTransaction.end();
+}
+
+bool ProofStore::findBlock(const std::string & blockhash, blockinfo_t & block) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto found = blocks.find(blockhash);
+    if(found == blocks.end())
+        return false;
+
+    const StoredBlock & stored = found->second;
+    BlockHeader header = BlockHeader::parse(stored.header.data());
+    char bits[9];
+    std::snprintf(bits, sizeof(bits), "%08x", header.bits);
+
+    block = blockinfo_t();
+    block.hash = blockhash;
+    block.height = stored.height;
+    block.version = header.version;
+    block.merkleroot = hex::encodeHash(header.merkleRoot.data());
+    block.time = header.time;
+    block.nonce = header.nonce;
+    block.bits = bits;
+    if(stored.height > 0)
+        block.previousblockhash = hex::encodeHash(header.prevHash.data());
+    block.tx.resize(stored.transactionCount);
+    for(const auto & transaction : stored.transactions)
+        block.tx[transaction.second.index] = transaction.first;
+    return true;
+}
+
+bool ProofStore::findTransaction(const std::string & txid, std::string & blockhash, std::string & rawTransactionHex) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto found = blockOfTransaction.find(txid);
+    if(found == blockOfTransaction.end())
+        return false;
+    blockhash = found->second;
+    rawTransactionHex = blocks.at(blockhash).transactions.at(txid).hex;
+    return true;
+}
+
+size_t ProofStore::size() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return blockOfTransaction.size();
+}
+
+/*
+ * A block's file is one line per field:
+ *   header <80 bytes, hex>
+ *   height <height>
+ *   transactions <number of transactions in the block>
+ *   tx <index> <txid> <merkle branch, hex, or - if the block has one transaction> <raw transaction, hex>
+ * with one "tx" line per kept transaction.
+ */
+void ProofStore::load(const std::string & name) {
+    std::string path = directory + "/" + name;
+    std::string blockhash = name.substr(0, name.size() - std::strlen(FILE_SUFFIX));
+    std::runtime_error invalid("Proof store file is not valid: " + path);
+
+    std::ifstream file(path);
+    if(!file)
+        throw std::runtime_error("Can't read proof store file: " + path);
+
+    StoredBlock stored;
+    std::string field, headerHex;
+    if(!(file >> field >> headerHex) || field != "header" ||
+       headerHex.size() != 2 * BlockHeader::SIZE || !hex::decode(headerHex.data(), headerHex.size(), stored.header.data()))
+        throw invalid;
+    if(!(file >> field >> stored.height) || field != "height")
+        throw invalid;
+    if(!(file >> field >> stored.transactionCount) || field != "transactions")
+        throw invalid;
+
+    BlockHeader header = BlockHeader::parse(stored.header.data());
+    if(hex::encodeHash(header.hash.data()) != blockhash)
+        throw invalid;
+
+    // every kept transaction has to lead to the header's merkle root
+    std::string txid, branchHex;
+    StoredTransaction transaction;
+    while(file >> field >> transaction.index >> txid >> branchHex >> transaction.hex) {
+        uint8_t leaf[32], root[32];
+        transaction.branch.clear();
+        if(field != "tx" || transaction.index >= stored.transactionCount || !hex::decodeHash(txid, leaf) ||
+           (branchHex != "-" && !hex::decode(branchHex, transaction.branch)) || transaction.branch.size() % 32 != 0 ||
+           !isTransaction(transaction.hex, txid))
+            throw invalid;
+        merkle::rootFromBranch(leaf, transaction.branch.data(), transaction.branch.size() / 32, transaction.index, root);
+        if(!std::equal(root, root + 32, header.merkleRoot.begin()))
+            throw invalid;
+        stored.transactions[txid] = transaction;
+    }
+    if(!file.eof())
+        throw invalid;
+
+    for(const auto & kept : stored.transactions)
+        blockOfTransaction[kept.first] = blockhash;
+    blocks[blockhash] = stored;
+}
+
+void ProofStore::save(const std::string & blockhash, const StoredBlock & block) const {
+    std::ostringstream ss;
+    ss << "header " << hex::encode(block.header.data(), block.header.size()) << "\n"
+       << "height " << block.height << "\n"
+       << "transactions " << block.transactionCount << "\n";
+    for(const auto & kept : block.transactions) {
+        const StoredTransaction & transaction = kept.second;
+        ss << "tx " << transaction.index << " " << kept.first << " "
+           << (transaction.branch.empty() ? "-" : hex::encode(transaction.branch.data(), transaction.branch.size()))
+           << " " << transaction.hex << "\n";
+    }
+
+    std::string path = directory + "/" + blockhash + FILE_SUFFIX;
+    if(!replaceFile(path, ss.str()))
+        throw std::runtime_error("Can't write proof store file: " + path);
+}
+
+
+ProofStoreBitcoinRPCFacade::ProofStoreBitcoinRPCFacade(const BitcoinRPCFacade & d, const ProofStore & s)
+        : ForwardingBitcoinRPCFacade(d), store(s) {
+}
+
+ProofStoreBitcoinRPCFacade::~ProofStoreBitcoinRPCFacade() = default;
+
+getrawtransaction_t ProofStoreBitcoinRPCFacade::getrawtransaction(const std::string &txid, int verbose) const {
+    try {
+        return delegate.getrawtransaction(txid, verbose);
+    }
+    catch(BitcoinException &) {
+        // a pruned node has no -txindex, so only mempool transactions can be found by txid
+        getrawtransaction_t rawTransaction;
+        if(!store.findTransaction(txid, rawTransaction.blockhash, rawTransaction.hex))
+            throw;
+        int confirmations = storedBlockConfirmations(rawTransaction.blockhash);
+        if(confirmations < 0)
+            throw;
+        rawTransaction.txid = txid;
+        rawTransaction.confirmations = static_cast<unsigned int>(confirmations);
+        Result<RawTransaction> parsed = RawTransaction::fromHex(rawTransaction.hex);
+        if(parsed)
+            rawTransaction.vout.resize(parsed.value().outputs().size());
+        return rawTransaction;
+    }
+}
+
+blockinfo_t ProofStoreBitcoinRPCFacade::getblock(const std::string &blockhash) const {
+    try {
+        return delegate.getblock(blockhash);
+    }
+    catch(BitcoinException &) {
+        // "Block not available (pruned data)"
+        blockinfo_t block;
+        if(!store.findBlock(blockhash, block))
+            throw;
+        block.confirmations = storedBlockConfirmations(blockhash);
+        if(block.confirmations < 0)
+            throw;
+        return block;
+    }
+}
+
+std::string ProofStoreBitcoinRPCFacade::getrawtransactioninblock(const std::string &txid, const std::string &blockhash) const {
+    try {
+        return delegate.getrawtransactioninblock(txid, blockhash);
+    }
+    catch(BitcoinException &) {
+        std::string storedBlockhash, rawTransactionHex;
+        if(!store.findTransaction(txid, storedBlockhash, rawTransactionHex) || storedBlockhash != blockhash ||
+           storedBlockConfirmations(blockhash) < 0)
+            throw;
+        return rawTransactionHex;
+    }
+}
+
+int ProofStoreBitcoinRPCFacade::storedBlockConfirmations(const std::string &blockhash) const {
+    blockinfo_t block;
+    if(!store.findBlock(blockhash, block))
+        throw std::runtime_error("Block is not in the proof store: " + blockhash);
+
+    // the headers are never pruned, so bitcoind still knows where the block is, if anywhere.
+    // No hash covers the height in the store, so it has to match too.
+    blockheader_t header = delegate.getblockheader(blockhash);
+    if(header.height != block.height)
+        throw std::runtime_error("Proof store has block " + blockhash + " at the wrong height");
+    return header.confirmations;
+}
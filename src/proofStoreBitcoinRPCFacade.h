@@ -0,0 +1,144 @@
+#ifndef TXREF_PROOFSTOREBITCOINRPCFACADE_H
+#define TXREF_PROOFSTOREBITCOINRPCFACADE_H
+
+#include "forwardingBitcoinRPCFacade.h"
+#include "block.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * A directory of what is needed to resolve DIDs after bitcoind has pruned their blocks: for
+ * each kept transaction, its block's header, its position in the block with the merkle branch
+ * proving it, and its serialized form. A block is a few hundred bytes however many
+ * transactions it has.
+ *
+ * Each block's proofs are one file, named by the block hash, replaced whole when a transaction
+ * is added. Everything is read when the store is opened, and checked with SHA-256d alone: each
+ * header against its block hash, each transaction against its txid, and each txid's merkle
+ * branch against its header. No hash covers a block's height, which ProofStoreBitcoinRPCFacade
+ * checks against bitcoind. A ProofStore can be used from several threads.
+ */
+class ProofStore {
+
+public:
+    /**
+     * Open a store, creating its directory if needed
+     * @param directory the store's directory
+     * @throws std::runtime_error if the directory can't be made or read, or a file in it is
+     * not valid
+     */
+    explicit ProofStore(const std::string & directory);
+
+    ProofStore(const ProofStore &) = delete;
+    ProofStore & operator=(const ProofStore &) = delete;
+
+    /**
+     * Keep a transaction from a block
+     * @param block the block, as getblock returns it
+     * @param txid the transaction, as bitcoind displays it
+     * @param rawTransactionHex the serialized transaction, hex-encoded
+     * @return false if the block's header doesn't hash to its hash, its txids don't lead to
+     * its merkle root, the transaction isn't in it, or the serialized transaction doesn't hash
+     * to the txid
+     * @throws std::runtime_error if the store can't be written
+     */
+    bool keep(const blockinfo_t & block, const std::string & txid, const std::string & rawTransactionHex);
+
+    /**
+     * Fetch a transaction and its block from bitcoind and keep them, unless already kept. This
+     * has to happen before bitcoind prunes the block.
+     * @param btc the BitcoinRPCFacade
+     * @param txid the transaction, as bitcoind displays it
+     * @param blockHeight the height of its block
+     * @return true if the transaction was added to the store
+     */
+    bool keepFrom(const BitcoinRPCFacade & btc, const std::string & txid, int blockHeight);
+
+    bool hasTransaction(const std::string & txid) const;
+
+    /**
+     * Rebuild what getblock returns for a block in the store. Only the kept transactions'
+     * txids are known; the rest of 'tx' is empty strings. 'confirmations' is not set.
+     * @param blockhash the block's hash
+     * @param block receives the block, if found
+     * @return true if found
+     */
+    bool findBlock(const std::string & blockhash, blockinfo_t & block) const;
+
+    /**
+     * @param txid the transaction, as bitcoind displays it
+     * @param blockhash receives the hash of the block it is in, if found
+     * @param rawTransactionHex receives the serialized transaction, if found
+     * @return true if found
+     */
+    bool findTransaction(const std::string & txid, std::string & blockhash, std::string & rawTransactionHex) const;
+
+    /**
+     * @return the number of transactions kept
+     */
+    size_t size() const;
+
+private:
+    struct StoredTransaction {
+        uint32_t index;
+        std::vector<uint8_t> branch;
+        std::string hex;
+    };
+
+    struct StoredBlock {
+        std::array<uint8_t, BlockHeader::SIZE> header;
+        int height;
+        uint32_t transactionCount;
+        std::map<std::string, StoredTransaction> transactions;  // by txid
+    };
+
+    void load(const std::string & name);
+    void save(const std::string & blockhash, const StoredBlock & block) const;
+
+    const std::string directory;
+    mutable std::mutex mutex;
+    std::map<std::string, StoredBlock> blocks;              // by block hash
+    std::map<std::string, std::string> blockOfTransaction;  // txid -> block hash
+};
+
+/**
+ * A BitcoinRPCFacade for a pruned bitcoind: getblock(), getrawtransaction() and
+ * getrawtransactioninblock() are answered from a ProofStore when bitcoind can't answer them,
+ * as long as bitcoind's header for the block still puts it on the best chain, at the height
+ * the store has. Everything else is forwarded; a pruned node still has the headers and the
+ * UTXO set.
+ */
+class ProofStoreBitcoinRPCFacade : public ForwardingBitcoinRPCFacade {
+
+public:
+    /**
+     * Construct a ProofStoreBitcoinRPCFacade
+     * @param delegate the BitcoinRPCFacade to forward calls to. Must outlive this object.
+     * @param store the store to fall back to, possibly shared with other facades. Must outlive this object.
+     */
+    ProofStoreBitcoinRPCFacade(const BitcoinRPCFacade & delegate, const ProofStore & store);
+
+    ~ProofStoreBitcoinRPCFacade() override;
+
+    getrawtransaction_t getrawtransaction(const std::string& txid, int verbose) const override;
+    blockinfo_t getblock(const std::string& blockhash) const override;
+    std::string getrawtransactioninblock(const std::string& txid, const std::string& blockhash) const override;
+
+private:
+    /**
+     * @return the confirmations of a block in the store, -1 if it is no longer on the best chain
+     * @throws std::runtime_error if the store has the block at another height than bitcoind
+     */
+    int storedBlockConfirmations(const std::string& blockhash) const;
+
+    const ProofStore & store;
+};
+
+
+#endif //TXREF_PROOFSTOREBITCOINRPCFACADE_H
@@ -0,0 +1,278 @@
+#include "rawTransaction.h"
+#include "hex.h"
+#include "sha256.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+    const uint8_t OP_RETURN = 0x6a;
+
+    /**
+     * Reads little-endian integers, CompactSize counts and byte runs from a buffer, remembering
+     * the first problem it runs into. Once something has gone wrong, everything reads as zero.
+     */
+    class Reader {
+    public:
+        Reader(const uint8_t * data, size_t len) : start(data), end(data + len), cursor(data) {}
+
+        size_t remaining() const {
+            return static_cast<size_t>(end - cursor);
+        }
+
+        bool failed() const {
+            return !problem.empty();
+        }
+
+        const std::string & error() const {
+            return problem;
+        }
+
+        void fail(const std::string & message) {
+            if(problem.empty())
+                problem = message;
+            cursor = end;
+        }
+
+        size_t offset() const {
+            return static_cast<size_t>(cursor - start);
+        }
+
+        uint8_t peek(size_t ahead) const {
+            return ahead < remaining() ? cursor[ahead] : 0;
+        }
+
+        uint64_t readLE(size_t numBytes) {
+            if(remaining() < numBytes) {
+                fail("Raw transaction is truncated");
+                return 0;
+            }
+            uint64_t value = 0;
+            for(size_t i = 0; i < numBytes; ++i)
+                value |= static_cast<uint64_t>(cursor[i]) << (8 * i);
+            cursor += numBytes;
+            return value;
+        }
+
+        /**
+         * Read a CompactSize, rejecting non-canonical encodings as bitcoind does
+         */
+        uint64_t readCompactSize() {
+            uint8_t first = static_cast<uint8_t>(readLE(1));
+            uint64_t value;
+            uint64_t minimum;
+            if(first < 0xfd)
+                return first;
+            else if(first == 0xfd) {
+                value = readLE(2);
+                minimum = 0xfd;
+            }
+            else if(first == 0xfe) {
+                value = readLE(4);
+                minimum = 0x10000;
+            }
+            else {
+                value = readLE(8);
+                minimum = 0x100000000;
+            }
+            if(!failed() && value < minimum)
+                fail("Raw transaction has a non-canonical CompactSize");
+            return value;
+        }
+
+        /**
+         * Read a count of things that each take at least 'minBytes' bytes. A count that could
+         * not fit in what is left is rejected before anything gets allocated for it.
+         */
+        size_t readCount(size_t minBytes) {
+            uint64_t count = readCompactSize();
+            if(count > remaining() / minBytes) {
+                fail("Raw transaction is truncated");
+                return 0;
+            }
+            return static_cast<size_t>(count);
+        }
+
+        ByteView readBytes(size_t numBytes) {
+            if(remaining() < numBytes) {
+                fail("Raw transaction is truncated");
+                return ByteView{cursor, 0};
+            }
+            ByteView view{cursor, numBytes};
+            cursor += numBytes;
+            return view;
+        }
+
+        ByteView readVarBytes() {
+            return readBytes(readCount(1));
+        }
+
+    private:
+        const uint8_t * start;
+        const uint8_t * end;
+        const uint8_t * cursor;
+        std::string problem;
+    };
+
+    // prevout (32 + 4), empty scriptSig (1), sequence (4)
+    const size_t MIN_INPUT_SIZE = 41;
+    // value (8), empty scriptPubKey (1)
+    const size_t MIN_OUTPUT_SIZE = 9;
+}
+
+
+bool isOpReturn(const ByteView & script) {
+    return script.size > 0 && script.data[0] == OP_RETURN;
+}
+
+bool isNullPrevout(const TxInputView & input) {
+    return input.prevIndex == 0xffffffff &&
+           std::all_of(input.prevTxid.data, input.prevTxid.data + input.prevTxid.size, [](uint8_t b) { return b == 0; });
+}
+
+int didFollowedOutput(const RawTransaction & tx) {
+    const std::vector<TxOutputView> & outputs = tx.outputs();
+    for(size_t i = 0; i < outputs.size(); ++i) {
+        if(!isOpReturn(outputs[i].scriptPubKey))
+            return static_cast<int>(i);
+    }
+    return -1;
+}
+
+Result<RawTransaction> RawTransaction::parse(const uint8_t * data, size_t len) {
+    size_t consumed = 0;
+    Result<RawTransaction> result = parsePrefix(data, len, consumed);
+    if(result && consumed != len)
+        return Result<RawTransaction>::failure("Raw transaction has trailing bytes");
+    return result;
+}
+
+Result<RawTransaction> RawTransaction::parsePrefix(const uint8_t * data, size_t len, size_t & consumed) {
+    Reader reader(data, len);
+    RawTransaction tx;
+
+    tx.txVersion = static_cast<int32_t>(static_cast<uint32_t>(reader.readLE(4)));
+
+    // BIP 144: a zero marker where the input count would be, then a flag byte
+    if(reader.peek(0) == 0x00 && reader.remaining() >= 2) {
+        uint8_t flag = reader.peek(1);
+        if(flag != 0x01)
+            return Result<RawTransaction>::failure("Raw transaction has an unknown segwit flag");
+        reader.readLE(2);
+        tx.segwit = true;
+    }
+
+    size_t numInputs = reader.readCount(MIN_INPUT_SIZE);
+    tx.txInputs.reserve(numInputs);
+    for(size_t i = 0; i < numInputs; ++i) {
+        TxInputView input;
+        input.prevTxid = reader.readBytes(32);
+        input.prevIndex = static_cast<uint32_t>(reader.readLE(4));
+        input.scriptSig = reader.readVarBytes();
+        input.sequence = static_cast<uint32_t>(reader.readLE(4));
+        tx.txInputs.push_back(input);
+    }
+
+    size_t numOutputs = reader.readCount(MIN_OUTPUT_SIZE);
+    tx.txOutputs.reserve(numOutputs);
+    for(size_t i = 0; i < numOutputs; ++i) {
+        TxOutputView output;
+        output.value = static_cast<int64_t>(reader.readLE(8));
+        output.scriptPubKey = reader.readVarBytes();
+        tx.txOutputs.push_back(output);
+    }
+
+    if(tx.segwit) {
+        tx.witnessOffset = reader.offset();
+        bool anyWitness = false;
+        for(TxInputView & input : tx.txInputs) {
+            size_t numItems = reader.readCount(1);
+            input.witness.reserve(numItems);
+            for(size_t i = 0; i < numItems; ++i)
+                input.witness.push_back(reader.readVarBytes());
+            anyWitness = anyWitness || numItems > 0;
+        }
+        if(!reader.failed() && !anyWitness)
+            reader.fail("Raw transaction has a segwit marker but no witness data");
+    }
+
+    tx.txLockTime = static_cast<uint32_t>(reader.readLE(4));
+
+    if(reader.failed())
+        return Result<RawTransaction>::failure(reader.error());
+    if(tx.txInputs.empty())
+        return Result<RawTransaction>::failure("Raw transaction has no inputs");
+
+    consumed = reader.offset();
+    tx.serialized = ByteView{data, consumed};
+    return Result<RawTransaction>::success(tx);
+}
+
+Result<RawTransaction> RawTransaction::fromHex(const std::string & hexString) {
+    std::shared_ptr<std::vector<uint8_t>> bytes = std::make_shared<std::vector<uint8_t>>();
+    if(!hex::decode(hexString, *bytes))
+        return Result<RawTransaction>::failure("Raw transaction is not valid hex");
+
+    Result<RawTransaction> result = parse(bytes->data(), bytes->size());
+    if(!result)
+        return result;
+
+    RawTransaction tx = result.value();
+    tx.storage = bytes;
+    return Result<RawTransaction>::success(tx);
+}
+
+int32_t RawTransaction::version() const {
+    return txVersion;
+}
+
+uint32_t RawTransaction::lockTime() const {
+    return txLockTime;
+}
+
+bool RawTransaction::hasWitness() const {
+    return segwit;
+}
+
+const std::vector<TxInputView> & RawTransaction::inputs() const {
+    return txInputs;
+}
+
+const std::vector<TxOutputView> & RawTransaction::outputs() const {
+    return txOutputs;
+}
+
+ByteView RawTransaction::bytes() const {
+    return serialized;
+}
+
+size_t RawTransaction::nonWitnessSize() const {
+    // without the marker and flag, then up to where the witness data starts, then the lock time
+    return segwit ? witnessOffset - 2 + 4 : serialized.size;
+}
+
+void RawTransaction::writeNonWitness(uint8_t * out) const {
+    if(!segwit) {
+        std::memcpy(out, serialized.data, serialized.size);
+        return;
+    }
+    std::memcpy(out, serialized.data, 4);
+    std::memcpy(out + 4, serialized.data + 6, witnessOffset - 6);
+    std::memcpy(out + 4 + witnessOffset - 6, serialized.data + serialized.size - 4, 4);
+}
+
+std::array<uint8_t, 32> RawTransaction::txid() const {
+    std::array<uint8_t, 32> out;
+    if(!segwit) {
+        sha256::doubleHash(serialized.data, serialized.size, out.data());
+        return out;
+    }
+    // leave out the marker and flag after the version, and the witness data before the lock time
+    sha256::Hasher()
+            .write(serialized.data, 4)
+            .write(serialized.data + 6, witnessOffset - 6)
+            .write(serialized.data + serialized.size - 4, 4)
+            .finalizeDouble(out.data());
+    return out;
+}
@@ -0,0 +1,141 @@
+#ifndef TXREF_RAWTRANSACTION_H
+#define TXREF_RAWTRANSACTION_H
+
+#include "result.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * A read-only view of bytes inside a serialized transaction. It does not own them.
+ */
+struct ByteView {
+    const uint8_t * data;
+    size_t size;
+};
+
+struct TxInputView {
+    /** the txid of the output being spent, in serialized (reversed) byte order */
+    ByteView prevTxid;
+    uint32_t prevIndex;
+    ByteView scriptSig;
+    uint32_t sequence;
+    /** the witness stack items; empty unless the transaction has witness data */
+    std::vector<ByteView> witness;
+};
+
+struct TxOutputView {
+    /** the value in satoshis */
+    int64_t value;
+    ByteView scriptPubKey;
+};
+
+/**
+ * Does this script start with OP_RETURN, making the output provably unspendable?
+ */
+bool isOpReturn(const ByteView & script);
+
+/**
+ * Is this a coinbase's input, spending no output at all?
+ */
+bool isNullPrevout(const TxInputView & input);
+
+class RawTransaction;
+
+/**
+ * Which output does a DID's chain follow out of an update transaction? Its first output that
+ * isn't an OP_RETURN.
+ * @return the output's index, or -1 if every output is an OP_RETURN
+ */
+int didFollowedOutput(const RawTransaction & tx);
+
+/**
+ * A serialized bitcoin transaction, parsed in place. Understands both the legacy and the
+ * segwit (BIP 144) serializations.
+ *
+ * This reads what getrawtransaction returns with verbose=0, or the body of a binary REST
+ * request, without asking bitcoind to decode it for us. Inputs, outputs and scripts are
+ * views into the serialized bytes, so nothing is copied.
+ */
+class RawTransaction {
+
+public:
+    /**
+     * Parse a serialized transaction
+     * @param data the serialized transaction. Must outlive the RawTransaction and any copies.
+     * @param len the number of bytes
+     * @return the transaction, or why it could not be parsed
+     */
+    static Result<RawTransaction> parse(const uint8_t * data, size_t len);
+
+    /**
+     * Parse a serialized transaction at the start of a buffer that holds more after it, such as
+     * the rest of a block
+     * @param data the buffer. Must outlive the RawTransaction and any copies.
+     * @param len the number of bytes in the buffer
+     * @param consumed receives the length of the transaction
+     * @return the transaction, or why it could not be parsed
+     */
+    static Result<RawTransaction> parsePrefix(const uint8_t * data, size_t len, size_t & consumed);
+
+    /**
+     * Parse a hex-encoded serialized transaction, as returned by getrawtransaction. The
+     * RawTransaction (and its copies) keep the decoded bytes alive.
+     * @param hex the hex string
+     * @return the transaction, or why it could not be parsed
+     */
+    static Result<RawTransaction> fromHex(const std::string & hex);
+
+    int32_t version() const;
+
+    uint32_t lockTime() const;
+
+    bool hasWitness() const;
+
+    const std::vector<TxInputView> & inputs() const;
+
+    const std::vector<TxOutputView> & outputs() const;
+
+    /**
+     * @return the whole serialized transaction
+     */
+    ByteView bytes() const;
+
+    /**
+     * Compute the txid: the SHA-256d of the transaction without its witness data
+     * @return the txid in internal byte order, the reverse of how it is displayed
+     */
+    std::array<uint8_t, 32> txid() const;
+
+    /**
+     * @return the length of the transaction without its witness data, which is what the txid
+     * is computed over
+     */
+    size_t nonWitnessSize() const;
+
+    /**
+     * Write the transaction without its witness data
+     * @param out receives nonWitnessSize() bytes
+     */
+    void writeNonWitness(uint8_t * out) const;
+
+private:
+    RawTransaction() = default;
+
+    std::shared_ptr<const std::vector<uint8_t>> storage;
+    ByteView serialized = {nullptr, 0};
+    // where the witness data starts, in a segwit serialization
+    size_t witnessOffset = 0;
+    int32_t txVersion = 0;
+    uint32_t txLockTime = 0;
+    bool segwit = false;
+    std::vector<TxInputView> txInputs;
+    std::vector<TxOutputView> txOutputs;
+};
+
+
+#endif //TXREF_RAWTRANSACTION_H
@@ -0,0 +1,78 @@
+#include "resolutionEngine.h"
+#include "bulkDidResolver.h"
+#include "limitingBitcoinRPCFacade.h"
+
+#include <bitcoinapi/bitcoinapi.h>
+
+ResolutionEngine::ResolutionEngine(
+        const FacadeFactory & facadeFactory,
+        RpcCache & cache,
+        const ChainQuery & q,
+        size_t numThreads,
+        ConcurrencyLimiter * limiter,
+        const MempoolSpends * m)
+        : chainQuery(q), mempool(m), pool(numThreads) {
+
+    for(size_t i = 0; i < pool.size(); ++i) {
+        connections.push_back(facadeFactory());
+        const BitcoinRPCFacade * connection = connections.back().get();
+
+        // cache -> coalesce -> limit -> bitcoind: workers waiting on another worker's call
+        // don't take up a slot in the limiter
+        if(limiter != nullptr) {
+            decorators.emplace_back(new LimitingBitcoinRPCFacade(*connection, *limiter));
+            connection = decorators.back().get();
+        }
+        decorators.emplace_back(new CoalescingBitcoinRPCFacade(*connection, flights));
+        connection = decorators.back().get();
+
+        facades.emplace_back(new CachingBitcoinRPCFacade(*connection, cache));
+    }
+}
+
+ResolutionEngine::~ResolutionEngine() = default;
+
+size_t ResolutionEngine::coalescedCount() const {
+    return flights.coalescedCount();
+}
+
+std::vector<DidResolution> ResolutionEngine::resolve(const std::vector<std::string> & dids) {
+
+    std::vector<DidResolution> results;
+    BulkPlan bulkPlan = BulkDidResolver::plan(dids, results);
+
+    // each entry writes only to its own positions in 'results', so no locking is needed
+    auto resolveEntry = [this, &bulkPlan, &results, &dids](size_t entryIndex, size_t workerIndex) {
+        const BulkPlan::Entry & entry = bulkPlan.entries[entryIndex];
+        DidResolution resolution = resolveDid(entry.did, *facades[workerIndex], chainQuery, mempool);
+        for(size_t position : entry.positions) {
+            results[position] = resolution;
+            results[position].did = dids[position];
+        }
+    };
+
+    for(const auto & group : bulkPlan.groups) {
+        int height = group.first;
+        const std::vector<size_t> & entryIndexes = group.second;
+
+        pool.submit([this, height, &entryIndexes, resolveEntry](size_t workerIndex) {
+            // get the block into the cache once, before its DIDs are spread around. Errors are
+            // ignored here: they will happen again, and be reported, when the DIDs are resolved.
+            try {
+                const BitcoinRPCFacade & btc = *facades[workerIndex];
+                btc.getblock(btc.getblockhash(height));
+            }
+            catch(...) {
+            }
+
+            for(size_t entryIndex : entryIndexes) {
+                pool.submit([entryIndex, resolveEntry](size_t worker) {
+                    resolveEntry(entryIndex, worker);
+                });
+            }
+        });
+    }
+
+    pool.wait();
+    return results;
+}
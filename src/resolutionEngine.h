@@ -0,0 +1,82 @@
+#ifndef TXREF_RESOLUTIONENGINE_H
+#define TXREF_RESOLUTIONENGINE_H
+
+#include "bitcoinRPCFacade.h"
+#include "cachingBitcoinRPCFacade.h"
+#include "chainQuery.h"
+#include "coalescingBitcoinRPCFacade.h"
+#include "concurrencyLimiter.h"
+#include "didResolution.h"
+#include "mempoolSpends.h"
+#include "workStealingPool.h"
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * Resolves many DIDs in parallel on a WorkStealingPool.
+ *
+ * The domain objects and BitcoinRPCFacade are not thread-safe, so every worker gets its own RPC
+ * connection (made by the FacadeFactory), wrapped in a CachingBitcoinRPCFacade. All of those
+ * share one RpcCache, so a block fetched by one worker is available to all of them. The
+ * ChainQuery is shared by all workers and must be thread-safe (like CachingChainSoQuery).
+ *
+ * Each block's DIDs are queued together on one worker, which fetches the block and then
+ * resolves them; idle workers steal DIDs from busy ones.
+ *
+ * When several workers miss the cache for the same block or transaction at once, they share
+ * one RPC call for it.
+ *
+ * If a ConcurrencyLimiter is given, every worker's RPC calls go through it, so the number of
+ * calls in flight adapts to what bitcoind can take rather than being fixed by the thread count.
+ */
+class ResolutionEngine {
+
+public:
+    typedef std::function<std::unique_ptr<BitcoinRPCFacade>()> FacadeFactory;
+
+    /**
+     * Construct a ResolutionEngine. All RPC connections are made here.
+     * @param facadeFactory makes one BitcoinRPCFacade per worker thread
+     * @param cache the cache shared by all workers
+     * @param chainQuery used to follow transaction chains, from all workers at once
+     * @param numThreads the number of worker threads
+     * @param limiter if not null, limits RPC calls in flight across all workers
+     * @param mempool if not null, used from all workers to look for pending updates (see resolveDid())
+     */
+    ResolutionEngine(
+            const FacadeFactory & facadeFactory,
+            RpcCache & cache,
+            const ChainQuery & chainQuery,
+            size_t numThreads,
+            ConcurrencyLimiter * limiter = nullptr,
+            const MempoolSpends * mempool = nullptr);
+
+    ~ResolutionEngine();
+
+    /**
+     * Resolve the given DIDs
+     * @param dids the DID strings
+     * @return one DidResolution per input DID, in input order
+     */
+    std::vector<DidResolution> resolve(const std::vector<std::string> & dids);
+
+    /**
+     * @return how many RPC calls were saved by sharing another worker's identical call
+     */
+    size_t coalescedCount() const;
+
+private:
+    RpcFlights flights;
+    std::vector<std::unique_ptr<BitcoinRPCFacade>> connections;
+    std::vector<std::unique_ptr<BitcoinRPCFacade>> decorators;      // limiting and coalescing layers
+    std::vector<std::unique_ptr<CachingBitcoinRPCFacade>> facades;  // one per worker
+    const ChainQuery & chainQuery;
+    const MempoolSpends * mempool;
+    WorkStealingPool pool;
+};
+
+
+#endif //TXREF_RESOLUTIONENGINE_H
@@ -0,0 +1,116 @@
+#ifndef TXREF_RESULT_H
+#define TXREF_RESULT_H
+
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+/**
+ * Either a value or an error message. Used where invalid input is ordinary, so a caller working
+ * through many inputs can check each result instead of catching an exception per bad one.
+ *
+ * T does not need a default constructor.
+ */
+template <typename T>
+class Result {
+
+public:
+    static Result success(const T & value) {
+        return Result(value);
+    }
+
+    static Result failure(const std::string & error) {
+        return Result(error, ErrorTag());
+    }
+
+    /**
+     * Convert a failure of another type into a failure of this type
+     */
+    template <typename U>
+    static Result failure(const Result<U> & other) {
+        return Result(other.error(), ErrorTag());
+    }
+
+    Result(const Result & other) : isOk(other.isOk), errorMessage(other.errorMessage) {
+        if(isOk)
+            new (&storage) T(other.get());
+    }
+
+    Result & operator=(const Result & other) {
+        if(this != &other) {
+            destroy();
+            isOk = other.isOk;
+            errorMessage = other.errorMessage;
+            if(isOk)
+                new (&storage) T(other.get());
+        }
+        return *this;
+    }
+
+    ~Result() {
+        destroy();
+    }
+
+    bool ok() const {
+        return isOk;
+    }
+
+    explicit operator bool() const {
+        return isOk;
+    }
+
+    /**
+     * Get the value
+     * @return the value
+     * @throws std::runtime_error with the error message, if this is a failure
+     */
+    const T & value() const {
+        if(!isOk)
+            throw std::runtime_error(errorMessage);
+        return get();
+    }
+
+    /**
+     * Get the value, to modify it in place
+     * @return the value
+     * @throws std::runtime_error with the error message, if this is a failure
+     */
+    T & value() {
+        if(!isOk)
+            throw std::runtime_error(errorMessage);
+        return *reinterpret_cast<T *>(&storage);
+    }
+
+    /**
+     * Get the error message
+     * @return the error message, or an empty string if this is a success
+     */
+    const std::string & error() const {
+        return errorMessage;
+    }
+
+private:
+    struct ErrorTag {};
+
+    explicit Result(const T & value) : isOk(true) {
+        new (&storage) T(value);
+    }
+
+    Result(const std::string & error, ErrorTag) : isOk(false), errorMessage(error) {}
+
+    const T & get() const {
+        return *reinterpret_cast<const T *>(&storage);
+    }
+
+    void destroy() {
+        if(isOk)
+            reinterpret_cast<T *>(&storage)->~T();
+    }
+
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+    bool isOk;
+    std::string errorMessage;
+};
+
+#endif //TXREF_RESULT_H
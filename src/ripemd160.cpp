@@ -0,0 +1,117 @@
+#include "ripemd160.h"
+#include "sha256.h"
+
+#include <cstring>
+
+namespace {
+
+    // message word used by each of the 80 steps, on the left and right lines
+    const uint8_t LEFT_WORDS[80] = {
+            0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+            7, 4, 13, 1, 10, 6, 15, 3, 12, 0, 9, 5, 2, 14, 11, 8,
+            3, 10, 14, 4, 9, 15, 8, 1, 2, 7, 0, 6, 13, 11, 5, 12,
+            1, 9, 11, 10, 0, 8, 12, 4, 13, 3, 7, 15, 14, 5, 6, 2,
+            4, 0, 5, 9, 7, 12, 2, 10, 14, 1, 3, 8, 11, 6, 15, 13};
+
+    const uint8_t RIGHT_WORDS[80] = {
+            5, 14, 7, 0, 9, 2, 11, 4, 13, 6, 15, 8, 1, 10, 3, 12,
+            6, 11, 3, 7, 0, 13, 5, 10, 14, 15, 8, 12, 4, 9, 1, 2,
+            15, 5, 1, 3, 7, 14, 6, 9, 11, 8, 12, 2, 10, 0, 4, 13,
+            8, 6, 4, 1, 3, 11, 15, 0, 5, 12, 2, 13, 9, 7, 10, 14,
+            12, 15, 10, 4, 1, 5, 8, 7, 6, 2, 13, 14, 0, 3, 9, 11};
+
+    // left rotation applied by each step
+    const uint8_t LEFT_SHIFTS[80] = {
+            11, 14, 15, 12, 5, 8, 7, 9, 11, 13, 14, 15, 6, 7, 9, 8,
+            7, 6, 8, 13, 11, 9, 7, 15, 7, 12, 15, 9, 11, 7, 13, 12,
+            11, 13, 6, 7, 14, 9, 13, 15, 14, 8, 13, 6, 5, 12, 7, 5,
+            11, 12, 14, 15, 14, 15, 9, 8, 9, 14, 5, 6, 8, 6, 5, 12,
+            9, 15, 5, 11, 6, 8, 13, 12, 5, 12, 13, 14, 11, 8, 5, 6};
+
+    const uint8_t RIGHT_SHIFTS[80] = {
+            8, 9, 9, 11, 13, 15, 15, 5, 7, 7, 8, 11, 14, 14, 12, 6,
+            9, 13, 15, 7, 12, 8, 9, 11, 7, 7, 12, 7, 6, 15, 13, 11,
+            9, 7, 15, 11, 8, 6, 6, 14, 12, 13, 5, 14, 13, 13, 7, 5,
+            15, 5, 8, 11, 14, 14, 6, 14, 6, 9, 12, 9, 12, 5, 15, 8,
+            8, 5, 12, 9, 12, 5, 14, 6, 8, 13, 6, 5, 15, 13, 11, 11};
+
+    const uint32_t LEFT_CONSTANTS[5] = {0x00000000, 0x5a827999, 0x6ed9eba1, 0x8f1bbcdc, 0xa953fd4e};
+    const uint32_t RIGHT_CONSTANTS[5] = {0x50a28be6, 0x5c4dd124, 0x6d703ef3, 0x7a6d76e9, 0x00000000};
+
+    inline uint32_t rotl(uint32_t x, int n) {
+        return (x << n) | (x >> (32 - n));
+    }
+
+    /**
+     * The boolean function for one of the five rounds
+     */
+    inline uint32_t f(int round, uint32_t x, uint32_t y, uint32_t z) {
+        switch(round) {
+            case 0: return x ^ y ^ z;
+            case 1: return (x & y) | (~x & z);
+            case 2: return (x | ~y) ^ z;
+            case 3: return (x & z) | (y & ~z);
+            default: return x ^ (y | ~z);
+        }
+    }
+
+    void compress(uint32_t * state, const uint8_t * block) {
+        uint32_t x[16];
+        for(int i = 0; i < 16; ++i)
+            x[i] = static_cast<uint32_t>(block[4 * i]) | static_cast<uint32_t>(block[4 * i + 1]) << 8 |
+                   static_cast<uint32_t>(block[4 * i + 2]) << 16 | static_cast<uint32_t>(block[4 * i + 3]) << 24;
+
+        uint32_t al = state[0], bl = state[1], cl = state[2], dl = state[3], el = state[4];
+        uint32_t ar = al, br = bl, cr = cl, dr = dl, er = el;
+        for(int j = 0; j < 80; ++j) {
+            int round = j / 16;
+            uint32_t t = rotl(al + f(round, bl, cl, dl) + x[LEFT_WORDS[j]] + LEFT_CONSTANTS[round], LEFT_SHIFTS[j]) + el;
+            al = el; el = dl; dl = rotl(cl, 10); cl = bl; bl = t;
+            // the right line runs the rounds in reverse order
+            t = rotl(ar + f(4 - round, br, cr, dr) + x[RIGHT_WORDS[j]] + RIGHT_CONSTANTS[round], RIGHT_SHIFTS[j]) + er;
+            ar = er; er = dr; dr = rotl(cr, 10); cr = br; br = t;
+        }
+
+        uint32_t t = state[1] + cl + dr;
+        state[1] = state[2] + dl + er;
+        state[2] = state[3] + el + ar;
+        state[3] = state[4] + al + br;
+        state[4] = state[0] + bl + cr;
+        state[0] = t;
+    }
+}
+
+namespace ripemd160 {
+
+    void hash(const uint8_t * data, size_t len, uint8_t * out) {
+        uint32_t state[5] = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0};
+
+        size_t whole = len - len % 64;
+        for(size_t i = 0; i < whole; i += 64)
+            compress(state, data + i);
+
+        // the last partial block, a 1 bit, and the length in bits, little-endian
+        uint8_t tail[128] = {};
+        size_t remaining = len - whole;
+        if(remaining > 0)
+            std::memcpy(tail, data + whole, remaining);
+        tail[remaining] = 0x80;
+        size_t tailSize = remaining < 56 ? 64 : 128;
+        uint64_t bits = static_cast<uint64_t>(len) * 8;
+        for(int i = 0; i < 8; ++i)
+            tail[tailSize - 8 + static_cast<size_t>(i)] = static_cast<uint8_t>(bits >> (8 * i));
+        for(size_t i = 0; i < tailSize; i += 64)
+            compress(state, tail + i);
+
+        for(int i = 0; i < 5; ++i)
+            for(int j = 0; j < 4; ++j)
+                out[4 * i + j] = static_cast<uint8_t>(state[i] >> (8 * j));
+    }
+
+    void hash160(const uint8_t * data, size_t len, uint8_t * out) {
+        uint8_t digest[sha256::DIGEST_SIZE];
+        sha256::hash(data, len, digest);
+        hash(digest, sizeof(digest), out);
+    }
+
+}
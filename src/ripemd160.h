@@ -0,0 +1,29 @@
+#ifndef TXREF_RIPEMD160_H
+#define TXREF_RIPEMD160_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * RIPEMD-160, and HASH160 (SHA-256 then RIPEMD-160), which bitcoin uses to turn a public key or
+ * a script into the 20-byte hash that p2pkh, p2sh and p2wpkh outputs pay to.
+ */
+namespace ripemd160 {
+
+    const size_t DIGEST_SIZE = 20;
+
+    /**
+     * RIPEMD-160 of a buffer
+     * @param out receives DIGEST_SIZE bytes
+     */
+    void hash(const uint8_t * data, size_t len, uint8_t * out);
+
+    /**
+     * RIPEMD-160 of the SHA-256 of a buffer
+     * @param out receives DIGEST_SIZE bytes
+     */
+    void hash160(const uint8_t * data, size_t len, uint8_t * out);
+
+}
+
+#endif //TXREF_RIPEMD160_H
@@ -0,0 +1,33 @@
+#include "secp256k1Context.h"
+
+#include <random>
+#include <stdexcept>
+
+namespace {
+
+    secp256k1_context * createContext() {
+        secp256k1_context * context = secp256k1_context_create(SECP256K1_CONTEXT_SIGN | SECP256K1_CONTEXT_VERIFY);
+        if(context == nullptr)
+            throw std::runtime_error("Can't create a secp256k1 context");
+
+        std::random_device random;
+        unsigned char seed[32];
+        for(size_t i = 0; i < sizeof(seed); i += 4) {
+            unsigned int value = random();
+            for(size_t j = 0; j < 4; ++j)
+                seed[i + j] = static_cast<unsigned char>(value >> (8 * j));
+        }
+        if(!secp256k1_context_randomize(context, seed)) {
+            secp256k1_context_destroy(context);
+            throw std::runtime_error("Can't randomize the secp256k1 context");
+        }
+        return context;
+    }
+}
+
+const secp256k1_context * secp256k1Context() {
+    // initialized once even if first used from several threads at once; never destroyed, as
+    // signing may still be going on in other threads while the process exits
+    static const secp256k1_context * context = createContext();
+    return context;
+}
@@ -0,0 +1,16 @@
+#ifndef TXREF_SECP256K1CONTEXT_H
+#define TXREF_SECP256K1CONTEXT_H
+
+#include <secp256k1.h>
+
+/**
+ * The libsecp256k1 context shared by everything in the process that signs or verifies.
+ *
+ * Creating a context builds its precomputed tables, which costs far more than a signature, so
+ * it is done once, on first use, and the context is then only read. Reading a context from
+ * many threads at once is safe. It is randomized when created, as libsecp256k1 recommends, to
+ * protect signing against side-channel attacks.
+ */
+const secp256k1_context * secp256k1Context();
+
+#endif //TXREF_SECP256K1CONTEXT_H
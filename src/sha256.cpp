@@ -0,0 +1,515 @@
+#include "sha256.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define SHA256_X86_KERNELS 1
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+namespace {
+
+    const uint32_t K[64] = {
+            0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+            0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+            0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+            0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+            0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+            0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+            0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+            0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+    };
+
+    const uint32_t IV[8] = {
+            0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+
+    uint32_t readBE32(const uint8_t * p) {
+        return static_cast<uint32_t>(p[0]) << 24 | static_cast<uint32_t>(p[1]) << 16 |
+               static_cast<uint32_t>(p[2]) << 8 | static_cast<uint32_t>(p[3]);
+    }
+
+    void writeBE32(uint8_t * p, uint32_t value) {
+        p[0] = static_cast<uint8_t>(value >> 24);
+        p[1] = static_cast<uint8_t>(value >> 16);
+        p[2] = static_cast<uint8_t>(value >> 8);
+        p[3] = static_cast<uint8_t>(value);
+    }
+
+    void writeBE64(uint8_t * p, uint64_t value) {
+        writeBE32(p, static_cast<uint32_t>(value >> 32));
+        writeBE32(p + 4, static_cast<uint32_t>(value));
+    }
+
+    uint32_t rotr(uint32_t x, int n) {
+        return (x >> n) | (x << (32 - n));
+    }
+
+    void transformScalar(uint32_t * state, const uint8_t * blocks, size_t numBlocks) {
+        for(; numBlocks > 0; --numBlocks, blocks += 64) {
+            uint32_t w[64];
+            for(int t = 0; t < 16; ++t)
+                w[t] = readBE32(blocks + 4 * t);
+            for(int t = 16; t < 64; ++t) {
+                uint32_t s0 = rotr(w[t - 15], 7) ^ rotr(w[t - 15], 18) ^ (w[t - 15] >> 3);
+                uint32_t s1 = rotr(w[t - 2], 17) ^ rotr(w[t - 2], 19) ^ (w[t - 2] >> 10);
+                w[t] = w[t - 16] + s0 + w[t - 7] + s1;
+            }
+
+            uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+            uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+            for(int t = 0; t < 64; ++t) {
+                uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + K[t] + w[t];
+                uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+                h = g;
+                g = f;
+                f = e;
+                e = d + t1;
+                d = c;
+                c = b;
+                b = a;
+                a = t1 + t2;
+            }
+            state[0] += a;
+            state[1] += b;
+            state[2] += c;
+            state[3] += d;
+            state[4] += e;
+            state[5] += f;
+            state[6] += g;
+            state[7] += h;
+        }
+    }
+
+    /**
+     * A message laid out as SHA-256 blocks: its whole blocks are read in place, and the last one
+     * or two, which hold the padding and length, come from 'tail'
+     */
+    struct PaddedMessage {
+        const uint8_t * data;
+        size_t wholeBlocks;
+        size_t numBlocks;
+        uint8_t tail[128];
+
+        void reset(const uint8_t * message, size_t len) {
+            data = message;
+            wholeBlocks = len / 64;
+            size_t rest = len % 64;
+            size_t tailBlocks = rest + 9 <= 64 ? 1 : 2;
+            numBlocks = wholeBlocks + tailBlocks;
+            std::memset(tail, 0, sizeof(tail));
+            if(rest > 0)
+                std::memcpy(tail, message + 64 * wholeBlocks, rest);
+            tail[rest] = 0x80;
+            writeBE64(tail + 64 * tailBlocks - 8, static_cast<uint64_t>(len) * 8);
+        }
+
+        const uint8_t * block(size_t k) const {
+            return k < wholeBlocks ? data + 64 * k : tail + 64 * (k - wholeBlocks);
+        }
+    };
+
+#ifdef SHA256_X86_KERNELS
+
+    /**
+     * The SHA extensions do four rounds per pair of sha256rnds2, and keep the state as ABEF and
+     * CDGH rather than ABCD and EFGH
+     */
+    __attribute__((target("sha,sse4.1")))
+    void transformShaNi(uint32_t * state, const uint8_t * blocks, size_t numBlocks) {
+        const __m128i byteSwap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+        __m128i dcba = _mm_loadu_si128(reinterpret_cast<const __m128i *>(state));
+        __m128i hgfe = _mm_loadu_si128(reinterpret_cast<const __m128i *>(state + 4));
+        __m128i cdab = _mm_shuffle_epi32(dcba, 0xb1);
+        __m128i efgh = _mm_shuffle_epi32(hgfe, 0x1b);
+        __m128i abef = _mm_alignr_epi8(cdab, efgh, 8);
+        __m128i cdgh = _mm_blend_epi16(efgh, cdab, 0xf0);
+
+        for(; numBlocks > 0; --numBlocks, blocks += 64) {
+            __m128i abefSaved = abef;
+            __m128i cdghSaved = cdgh;
+            __m128i w[16];
+
+            for(int i = 0; i < 16; ++i) {
+                if(i < 4) {
+                    w[i] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(blocks + 16 * i)), byteSwap);
+                }
+                else {
+                    __m128i next = _mm_sha256msg1_epu32(w[i - 4], w[i - 3]);
+                    next = _mm_add_epi32(next, _mm_alignr_epi8(w[i - 1], w[i - 2], 4));
+                    w[i] = _mm_sha256msg2_epu32(next, w[i - 1]);
+                }
+                __m128i roundInput = _mm_add_epi32(w[i], _mm_loadu_si128(reinterpret_cast<const __m128i *>(K + 4 * i)));
+                cdgh = _mm_sha256rnds2_epu32(cdgh, abef, roundInput);
+                abef = _mm_sha256rnds2_epu32(abef, cdgh, _mm_shuffle_epi32(roundInput, 0x0e));
+            }
+
+            abef = _mm_add_epi32(abef, abefSaved);
+            cdgh = _mm_add_epi32(cdgh, cdghSaved);
+        }
+
+        __m128i feba = _mm_shuffle_epi32(abef, 0x1b);
+        __m128i dchg = _mm_shuffle_epi32(cdgh, 0xb1);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(state), _mm_blend_epi16(feba, dchg, 0xf0));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(state + 4), _mm_alignr_epi8(dchg, feba, 8));
+    }
+
+    template <int n>
+    __attribute__((target("avx2")))
+    __m256i rotr8(__m256i x) {
+        return _mm256_or_si256(_mm256_srli_epi32(x, n), _mm256_slli_epi32(x, 32 - n));
+    }
+
+    __attribute__((target("avx2")))
+    __m256i xor3(__m256i x, __m256i y, __m256i z) {
+        return _mm256_xor_si256(_mm256_xor_si256(x, y), z);
+    }
+
+    /**
+     * One block for each of eight messages, one per lane. 'w' holds the first 16 message words
+     * and is overwritten.
+     */
+    __attribute__((target("avx2")))
+    void transform8(__m256i * state, __m256i * w) {
+        __m256i a = state[0], b = state[1], c = state[2], d = state[3];
+        __m256i e = state[4], f = state[5], g = state[6], h = state[7];
+
+        for(int t = 0; t < 64; ++t) {
+            if(t >= 16) {
+                __m256i w15 = w[(t - 15) & 15];
+                __m256i w2 = w[(t - 2) & 15];
+                __m256i s0 = xor3(rotr8<7>(w15), rotr8<18>(w15), _mm256_srli_epi32(w15, 3));
+                __m256i s1 = xor3(rotr8<17>(w2), rotr8<19>(w2), _mm256_srli_epi32(w2, 10));
+                // w[t & 15] still holds w[t - 16]
+                w[t & 15] = _mm256_add_epi32(_mm256_add_epi32(w[t & 15], s0), _mm256_add_epi32(w[(t - 7) & 15], s1));
+            }
+            __m256i ch = _mm256_xor_si256(_mm256_and_si256(e, f), _mm256_andnot_si256(e, g));
+            __m256i maj = _mm256_or_si256(_mm256_and_si256(a, b), _mm256_and_si256(c, _mm256_or_si256(a, b)));
+            __m256i t1 = _mm256_add_epi32(_mm256_add_epi32(h, xor3(rotr8<6>(e), rotr8<11>(e), rotr8<25>(e))),
+                                          _mm256_add_epi32(_mm256_add_epi32(ch, _mm256_set1_epi32(static_cast<int>(K[t]))), w[t & 15]));
+            __m256i t2 = _mm256_add_epi32(xor3(rotr8<2>(a), rotr8<13>(a), rotr8<22>(a)), maj);
+            h = g;
+            g = f;
+            f = e;
+            e = _mm256_add_epi32(d, t1);
+            d = c;
+            c = b;
+            b = a;
+            a = _mm256_add_epi32(t1, t2);
+        }
+
+        state[0] = _mm256_add_epi32(state[0], a);
+        state[1] = _mm256_add_epi32(state[1], b);
+        state[2] = _mm256_add_epi32(state[2], c);
+        state[3] = _mm256_add_epi32(state[3], d);
+        state[4] = _mm256_add_epi32(state[4], e);
+        state[5] = _mm256_add_epi32(state[5], f);
+        state[6] = _mm256_add_epi32(state[6], g);
+        state[7] = _mm256_add_epi32(state[7], h);
+    }
+
+    __attribute__((target("avx2")))
+    void resetState8(__m256i * state) {
+        for(int j = 0; j < 8; ++j)
+            state[j] = _mm256_set1_epi32(static_cast<int>(IV[j]));
+    }
+
+    /**
+     * SHA-256d of up to eight messages at once. Lanes past 'count', and lanes whose message has
+     * already ended, hash a block of zeros that is thrown away.
+     */
+    __attribute__((target("avx2")))
+    void doubleHash8(const uint8_t * const * data, const size_t * lens, size_t count, uint8_t * const * out) {
+        static const uint8_t zeroBlock[64] = {};
+
+        PaddedMessage messages[8];
+        size_t maxBlocks = 0;
+        for(size_t lane = 0; lane < 8; ++lane) {
+            if(lane < count) {
+                messages[lane].reset(data[lane], lens[lane]);
+                maxBlocks = std::max(maxBlocks, messages[lane].numBlocks);
+            }
+            else
+                messages[lane].numBlocks = 0;
+        }
+
+        __m256i state[8];
+        __m256i firstDigest[8];
+        __m256i w[16];
+        resetState8(state);
+        for(int j = 0; j < 8; ++j)
+            firstDigest[j] = _mm256_setzero_si256();
+
+        for(size_t k = 0; k < maxBlocks; ++k) {
+            const uint8_t * blocks[8];
+            int finished[8];
+            bool anyFinished = false;
+            for(size_t lane = 0; lane < 8; ++lane) {
+                blocks[lane] = k < messages[lane].numBlocks ? messages[lane].block(k) : zeroBlock;
+                finished[lane] = k + 1 == messages[lane].numBlocks ? -1 : 0;
+                anyFinished = anyFinished || finished[lane];
+            }
+            for(int t = 0; t < 16; ++t)
+                w[t] = _mm256_set_epi32(
+                        static_cast<int>(readBE32(blocks[7] + 4 * t)), static_cast<int>(readBE32(blocks[6] + 4 * t)),
+                        static_cast<int>(readBE32(blocks[5] + 4 * t)), static_cast<int>(readBE32(blocks[4] + 4 * t)),
+                        static_cast<int>(readBE32(blocks[3] + 4 * t)), static_cast<int>(readBE32(blocks[2] + 4 * t)),
+                        static_cast<int>(readBE32(blocks[1] + 4 * t)), static_cast<int>(readBE32(blocks[0] + 4 * t)));
+            transform8(state, w);
+
+            // keep the state of each lane whose message just ended
+            if(anyFinished) {
+                __m256i mask = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(finished));
+                for(int j = 0; j < 8; ++j)
+                    firstDigest[j] = _mm256_blendv_epi8(firstDigest[j], state[j], mask);
+            }
+        }
+
+        // the first digest's words are the second hash's first message words, then the padding
+        for(int j = 0; j < 8; ++j)
+            w[j] = firstDigest[j];
+        w[8] = _mm256_set1_epi32(static_cast<int>(0x80000000));
+        for(int j = 9; j < 15; ++j)
+            w[j] = _mm256_setzero_si256();
+        w[15] = _mm256_set1_epi32(256);
+        resetState8(state);
+        transform8(state, w);
+
+        uint32_t words[8][8];
+        for(int j = 0; j < 8; ++j)
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(words[j]), state[j]);
+        for(size_t lane = 0; lane < count; ++lane)
+            for(int j = 0; j < 8; ++j)
+                writeBE32(out[lane] + 4 * j, words[j][lane]);
+    }
+
+#endif
+
+    typedef void (*TransformFunction)(uint32_t *, const uint8_t *, size_t);
+
+    bool cpuHasShaNi() {
+#ifdef SHA256_X86_KERNELS
+        unsigned int eax, ebx, ecx, edx;
+        if(!__get_cpuid(1, &eax, &ebx, &ecx, &edx) || !(ecx & bit_SSE4_1))
+            return false;
+        return __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) && (ebx & bit_SHA);
+#else
+        return false;
+#endif
+    }
+
+    bool cpuHasAvx2() {
+#ifdef SHA256_X86_KERNELS
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2");
+#else
+        return false;
+#endif
+    }
+
+    sha256::Kernel bestSha256Kernel() {
+        if(cpuHasShaNi())
+            return sha256::Kernel::shani;
+        if(cpuHasAvx2())
+            return sha256::Kernel::avx2;
+        return sha256::Kernel::scalar;
+    }
+
+    std::atomic<sha256::Kernel> & activeSha256Kernel() {
+        static std::atomic<sha256::Kernel> kernel(bestSha256Kernel());
+        return kernel;
+    }
+
+    // the AVX2 kernel only helps with many buffers; a single one is hashed with portable code
+    TransformFunction transformFunction() {
+#ifdef SHA256_X86_KERNELS
+        if(activeSha256Kernel().load(std::memory_order_relaxed) == sha256::Kernel::shani)
+            return transformShaNi;
+#endif
+        return transformScalar;
+    }
+
+    /**
+     * SHA-256d of one 64-byte input. Its padding is always the same, so this skips the Hasher's
+     * bookkeeping, which costs as much as the compressions for inputs this small.
+     */
+    void doubleHash64With(TransformFunction transform, const uint8_t * in, uint8_t * out) {
+        // 0x80, zeros, then the length: 512 bits for the input, 256 for the first digest
+        static const uint8_t inputPadding[64] = {0x80, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                                                 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                                                 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                                                 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0x02, 0x00};
+        uint32_t state[8];
+        std::memcpy(state, IV, sizeof(state));
+        transform(state, in, 1);
+        transform(state, inputPadding, 1);
+
+        uint8_t second[64] = {};
+        for(int j = 0; j < 8; ++j)
+            writeBE32(second + 4 * j, state[j]);
+        second[32] = 0x80;
+        second[62] = 0x01;
+        std::memcpy(state, IV, sizeof(state));
+        transform(state, second, 1);
+        for(int j = 0; j < 8; ++j)
+            writeBE32(out + 4 * j, state[j]);
+    }
+
+    bool useEightWay() {
+#ifdef SHA256_X86_KERNELS
+        return activeSha256Kernel().load(std::memory_order_relaxed) == sha256::Kernel::avx2;
+#else
+        return false;
+#endif
+    }
+}
+
+namespace sha256 {
+
+    bool isSupported(Kernel kernel) {
+        switch(kernel) {
+            case Kernel::scalar:
+                return true;
+            case Kernel::avx2:
+                return cpuHasAvx2();
+            case Kernel::shani:
+                return cpuHasShaNi();
+        }
+        return false;
+    }
+
+    Kernel currentKernel() {
+        return activeSha256Kernel().load();
+    }
+
+    void setKernel(Kernel kernel) {
+        if(!isSupported(kernel))
+            throw std::invalid_argument(std::string("sha256 kernel not supported by this CPU: ") + kernelName(kernel));
+        activeSha256Kernel().store(kernel);
+    }
+
+    const char * kernelName(Kernel kernel) {
+        switch(kernel) {
+            case Kernel::scalar:
+                return "scalar";
+            case Kernel::avx2:
+                return "avx2";
+            case Kernel::shani:
+                return "shani";
+        }
+        return "unknown";
+    }
+
+    Hasher::Hasher() : bytesWritten(0) {
+        std::memcpy(state, IV, sizeof(state));
+    }
+
+    Hasher & Hasher::write(const uint8_t * data, size_t len) {
+        TransformFunction transform = transformFunction();
+        size_t used = bytesWritten % 64;
+        bytesWritten += len;
+
+        if(used > 0) {
+            size_t n = std::min(64 - used, len);
+            std::memcpy(buffer + used, data, n);
+            data += n;
+            len -= n;
+            if(used + n < 64)
+                return *this;
+            transform(state, buffer, 1);
+        }
+
+        size_t numBlocks = len / 64;
+        if(numBlocks > 0)
+            transform(state, data, numBlocks);
+        if(len % 64 > 0)
+            std::memcpy(buffer, data + 64 * numBlocks, len % 64);
+        return *this;
+    }
+
+    void Hasher::finalize(uint8_t * out) {
+        static const uint8_t padding[64] = {0x80};
+        uint8_t length[8];
+        writeBE64(length, bytesWritten * 8);
+        // pad to 8 bytes short of a whole block, then append the length in bits
+        write(padding, 1 + ((119 - bytesWritten % 64) % 64));
+        write(length, sizeof(length));
+        for(int j = 0; j < 8; ++j)
+            writeBE32(out + 4 * j, state[j]);
+    }
+
+    void Hasher::finalizeDouble(uint8_t * out) {
+        uint8_t first[DIGEST_SIZE];
+        finalize(first);
+        Hasher().write(first, sizeof(first)).finalize(out);
+    }
+
+    void hash(const uint8_t * data, size_t len, uint8_t * out) {
+        Hasher().write(data, len).finalize(out);
+    }
+
+    void doubleHash(const uint8_t * data, size_t len, uint8_t * out) {
+        Hasher().write(data, len).finalizeDouble(out);
+    }
+
+    void doubleHashMany(const uint8_t * const * data, const size_t * lens, size_t count, uint8_t * out) {
+#ifdef SHA256_X86_KERNELS
+        if(useEightWay()) {
+            // lanes of a group run until the longest message ends, so group similar lengths
+            std::vector<size_t> order(count);
+            for(size_t i = 0; i < count; ++i)
+                order[i] = i;
+            std::stable_sort(order.begin(), order.end(), [lens](size_t x, size_t y) { return lens[x] / 64 < lens[y] / 64; });
+
+            for(size_t first = 0; first < count; first += 8) {
+                size_t n = std::min<size_t>(8, count - first);
+                const uint8_t * groupData[8];
+                size_t groupLens[8];
+                uint8_t * groupOut[8];
+                for(size_t lane = 0; lane < n; ++lane) {
+                    size_t i = order[first + lane];
+                    groupData[lane] = data[i];
+                    groupLens[lane] = lens[i];
+                    groupOut[lane] = out + DIGEST_SIZE * i;
+                }
+                doubleHash8(groupData, groupLens, n, groupOut);
+            }
+            return;
+        }
+#endif
+        for(size_t i = 0; i < count; ++i)
+            doubleHash(data[i], lens[i], out + DIGEST_SIZE * i);
+    }
+
+    void doubleHash64(const uint8_t * in, size_t count, uint8_t * out) {
+        // each input is read before anything is written over it, so 'out' may be 'in'
+#ifdef SHA256_X86_KERNELS
+        if(useEightWay()) {
+            for(size_t first = 0; first < count; first += 8) {
+                size_t n = std::min<size_t>(8, count - first);
+                const uint8_t * groupData[8];
+                size_t groupLens[8];
+                uint8_t * groupOut[8];
+                for(size_t lane = 0; lane < n; ++lane) {
+                    groupData[lane] = in + 64 * (first + lane);
+                    groupLens[lane] = 64;
+                    groupOut[lane] = out + DIGEST_SIZE * (first + lane);
+                }
+                doubleHash8(groupData, groupLens, n, groupOut);
+            }
+            return;
+        }
+#endif
+        TransformFunction transform = transformFunction();
+        for(size_t i = 0; i < count; ++i)
+            doubleHash64With(transform, in + 64 * i, out + DIGEST_SIZE * i);
+    }
+
+}
@@ -0,0 +1,104 @@
+#ifndef TXREF_SHA256_H
+#define TXREF_SHA256_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * SHA-256 and SHA-256d (SHA-256 applied twice, as bitcoin uses for txids, block hashes and
+ * merkle trees).
+ *
+ * On x86 a single buffer is hashed with the SHA extensions (SHA-NI) when the CPU has them.
+ * Many independent buffers can also be hashed at once: the AVX2 kernel works on eight of them
+ * in parallel, one per 32-bit lane. Everything falls back to portable code elsewhere.
+ */
+namespace sha256 {
+
+    const size_t DIGEST_SIZE = 32;
+
+    enum class Kernel {
+        scalar,
+        avx2,
+        shani
+    };
+
+    /**
+     * Can this CPU run the given kernel?
+     */
+    bool isSupported(Kernel kernel);
+
+    /**
+     * The kernel in use. Starts as the best one this CPU supports.
+     */
+    Kernel currentKernel();
+
+    /**
+     * Use a particular kernel, for testing and benchmarking
+     * @param kernel the kernel to use
+     * @throws std::invalid_argument if this CPU can't run it
+     */
+    void setKernel(Kernel kernel);
+
+    const char * kernelName(Kernel kernel);
+
+    /**
+     * An incremental SHA-256, for input that isn't in one piece
+     */
+    class Hasher {
+
+    public:
+        Hasher();
+
+        Hasher & write(const uint8_t * data, size_t len);
+
+        /**
+         * Finish the hash. The Hasher must not be used again afterwards.
+         * @param out receives DIGEST_SIZE bytes
+         */
+        void finalize(uint8_t * out);
+
+        /**
+         * Finish the hash, and hash the result again
+         * @param out receives DIGEST_SIZE bytes
+         */
+        void finalizeDouble(uint8_t * out);
+
+    private:
+        uint32_t state[8];
+        uint8_t buffer[64];
+        uint64_t bytesWritten;
+    };
+
+    /**
+     * SHA-256 of a buffer
+     * @param out receives DIGEST_SIZE bytes
+     */
+    void hash(const uint8_t * data, size_t len, uint8_t * out);
+
+    /**
+     * SHA-256d of a buffer
+     * @param out receives DIGEST_SIZE bytes
+     */
+    void doubleHash(const uint8_t * data, size_t len, uint8_t * out);
+
+    /**
+     * SHA-256d of many independent buffers. The AVX2 kernel hashes eight at a time, grouping
+     * buffers of similar length together.
+     * @param data a pointer to each buffer
+     * @param lens the length of each buffer
+     * @param count the number of buffers
+     * @param out receives count * DIGEST_SIZE bytes, one digest per buffer, in order
+     */
+    void doubleHashMany(const uint8_t * const * data, const size_t * lens, size_t count, uint8_t * out);
+
+    /**
+     * SHA-256d of consecutive 64-byte inputs, such as pairs of hashes in one level of a merkle tree
+     * @param in count * 64 bytes
+     * @param count the number of inputs
+     * @param out receives count * DIGEST_SIZE bytes. May be the same as 'in'.
+     */
+    void doubleHash64(const uint8_t * in, size_t count, uint8_t * out);
+
+}
+
+#endif //TXREF_SHA256_H
@@ -0,0 +1,72 @@
+#ifndef TXREF_SINGLEFLIGHT_H
+#define TXREF_SINGLEFLIGHT_H
+
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <future>
+#include <map>
+#include <mutex>
+
+/**
+ * Makes concurrent requests for the same key share one call. The first caller for a key runs
+ * the call; callers that arrive while it is running wait for it and get the same result (or
+ * the same exception). Nothing is kept once the call finishes; this is not a cache.
+ */
+template <typename K, typename V>
+class SingleFlight {
+
+public:
+    /**
+     * Get the value for 'key', calling 'call' unless a call for the same key is already running
+     * @param key identifies the request
+     * @param call produces the value
+     * @return the value
+     */
+    V run(const K & key, const std::function<V()> & call) {
+        std::promise<V> promise;
+        std::shared_future<V> result;
+        bool leader = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = inFlight.find(key);
+            if(it != inFlight.end()) {
+                result = it->second;
+                ++numCoalesced;
+            }
+            else {
+                result = promise.get_future().share();
+                inFlight.emplace(key, result);
+                leader = true;
+            }
+        }
+
+        if(leader) {
+            try {
+                promise.set_value(call());
+            }
+            catch(...) {
+                promise.set_exception(std::current_exception());
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            inFlight.erase(key);
+        }
+
+        return result.get();
+    }
+
+    /**
+     * @return how many requests were answered by sharing another request's call
+     */
+    size_t coalescedCount() const {
+        return numCoalesced;
+    }
+
+private:
+    std::mutex mutex;
+    std::map<K, std::shared_future<V>> inFlight;
+    std::atomic<size_t> numCoalesced{0};
+};
+
+
+#endif //TXREF_SINGLEFLIGHT_H
@@ -0,0 +1,248 @@
+#include "t2tBatch.h"
+#include "t2tSupport.h"
+#include "libtxref.h"
+#include "json.hpp"
+
+#include <bitcoinapi/bitcoinapi.h>
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+
+    // how many results may be waiting to be written, per worker, before we stop reading input
+    const size_t WINDOW_PER_JOB = 16;
+
+    /**
+     * Split a line into its query and (optional) txoIndex parts
+     *
+     * @param line the input line
+     * @param query receives the txid or txref
+     * @param txoIndexStr receives the txoIndex string, if any
+     * @return true if anything besides whitespace was found in the line
+     */
+    bool splitLine(const std::string & line, std::string & query, std::string & txoIndexStr) {
+        std::istringstream iss(line);
+        iss >> query >> txoIndexStr;
+        return !query.empty();
+    }
+
+    struct WorkItem {
+        size_t sequence;    // position among the non-blank input lines, used for ordering
+        size_t lineNumber;
+        std::string line;
+    };
+
+    /**
+     * Shared state between the input reader and the worker threads
+     */
+    struct BatchState {
+        std::mutex mutex;
+        std::condition_variable workAvailable;
+        std::condition_variable spaceAvailable;
+
+        std::deque<WorkItem> work;               // lines waiting to be processed
+        bool inputDone = false;
+
+        std::map<size_t, std::string> pending;   // finished records waiting for their turn (ordered mode)
+        size_t nextSequence = 0;                 // next sequence # to hand out
+        size_t nextToEmit = 0;                   // next sequence # to be written
+        size_t numErrors = 0;
+    };
+
+}
+
+namespace t2t {
+
+    BatchRecord processLine(
+            const BitcoinRPCFacade & btc,
+            const std::string & line,
+            size_t lineNumber,
+            int defaultTxoIndex) {
+
+        BatchRecord record;
+        record.line = lineNumber;
+
+        std::string txoIndexStr;
+        splitLine(line, record.query, txoIndexStr);
+
+        int txoIndex = defaultTxoIndex;
+        if(!txoIndexStr.empty()) {
+            try {
+                txoIndex = std::stoi(txoIndexStr);
+            }
+            catch(std::logic_error &) {
+                record.error = "txoIndex '" + txoIndexStr + "' is invalid.";
+                return record;
+            }
+            if(txoIndex < 0) {
+                record.error = "txoIndex '" + txoIndexStr + "' should be zero or greater.";
+                return record;
+            }
+        }
+
+        txref::InputParam inputParam = txref::classifyInputString(record.query);
+
+        if(inputParam != txref::InputParam::txid &&
+           inputParam != txref::InputParam::txref && inputParam != txref::InputParam::txrefext) {
+            record.error = record.query + " is an invalid txid or txref.";
+            return record;
+        }
+
+        // only errors from the RPC layer are thrown from here
+        try {
+            Result<Transaction> transaction = inputParam == txref::InputParam::txid ?
+                    tryEncodeTxid(btc, record.query, txoIndex < 0 ? 0 : txoIndex) :
+                    tryDecodeTxref(btc, record.query);
+
+            if(!transaction) {
+                record.error = transaction.error();
+                return record;
+            }
+            record.transaction = transaction.value();
+
+            // a txref decides its own txoIndex. Only say so when the line asked for one, or when
+            // --txoIndex asked for another.
+            if(inputParam != txref::InputParam::txid &&
+               (!txoIndexStr.empty() || (txoIndex >= 0 && txoIndex != record.transaction.txoIndex))) {
+                std::stringstream ss;
+                ss << "txoIndex '" << txoIndex << "' was ignored as ";
+                if(inputParam == txref::InputParam::txrefext)
+                    ss << "the txref given already has an index '" << record.transaction.txoIndex << "' encoded within.";
+                else
+                    ss << "a txref with no index encoded within refers to output 0.";
+                record.warning = ss.str();
+            }
+            record.ok = true;
+        }
+        catch(BitcoinException &e) {
+            std::stringstream ss;
+            if(e.getCode() == -5)
+                ss << "transaction " << record.query << " not found.";
+            else
+                ss << e.getCode() << " " << e.getMessage();
+            record.error = ss.str();
+        }
+        catch(std::exception &e) {
+            record.error = e.what();
+        }
+
+        return record;
+    }
+
+    std::string formatRecord(const BatchRecord & record) {
+        nlohmann::json root;
+
+        root["line"] = record.line;
+        if(record.ok) {
+            const Transaction & transaction = record.transaction;
+            root["txid"] = transaction.txid;
+            root["txref"] = transaction.txref;
+            root["did"] = txref2did(transaction.txref);
+            root["network"] = transaction.network;
+            root["block-height"] = transaction.blockHeight;
+            root["transaction-index"] = transaction.transactionIndex;
+            root["txo-index"] = transaction.txoIndex;
+            if(!record.warning.empty())
+                root["warning"] = record.warning;
+        }
+        else {
+            root["error"] = record.error;
+        }
+        root["query-string"] = record.query;
+
+        return root.dump() + "\n";
+    }
+
+    size_t processBatch(
+            std::istream & in,
+            std::ostream & out,
+            const FacadeFactory & facadeFactory,
+            const BatchOptions & options) {
+
+        size_t numJobs = options.jobs > 0 ? static_cast<size_t>(options.jobs) : 1;
+        size_t window = numJobs * WINDOW_PER_JOB;
+
+        // create all connections up front, so any connection problem is reported before
+        // we start reading input
+        std::vector<std::unique_ptr<BitcoinRPCFacade>> facades;
+        for(size_t i = 0; i < numJobs; ++i)
+            facades.push_back(facadeFactory());
+
+        BatchState state;
+
+        auto worker = [&](const BitcoinRPCFacade & btc) {
+            for(;;) {
+                WorkItem item;
+                {
+                    std::unique_lock<std::mutex> lock(state.mutex);
+                    state.workAvailable.wait(lock, [&] { return !state.work.empty() || state.inputDone; });
+                    if(state.work.empty())
+                        return;
+                    item = std::move(state.work.front());
+                    state.work.pop_front();
+                }
+
+                BatchRecord record = processLine(btc, item.line, item.lineNumber, options.txoIndex);
+                std::string json = formatRecord(record);
+
+                std::lock_guard<std::mutex> lock(state.mutex);
+                if(!record.ok)
+                    ++state.numErrors;
+                if(options.ordered) {
+                    state.pending.emplace(item.sequence, std::move(json));
+                    auto it = state.pending.begin();
+                    while(it != state.pending.end() && it->first == state.nextToEmit) {
+                        out << it->second;
+                        it = state.pending.erase(it);
+                        ++state.nextToEmit;
+                    }
+                }
+                else {
+                    out << json;
+                    ++state.nextToEmit;
+                }
+                out.flush();
+                state.spaceAvailable.notify_one();
+            }
+        };
+
+        std::vector<std::thread> threads;
+        for(const auto & facade : facades)
+            threads.emplace_back(worker, std::cref(*facade));
+
+        // read input, blocking whenever too many results are outstanding
+        std::string line;
+        size_t lineNumber = 0;
+        while(std::getline(in, line)) {
+            ++lineNumber;
+            std::string query, txoIndexStr;
+            if(!splitLine(line, query, txoIndexStr))
+                continue;
+
+            std::unique_lock<std::mutex> lock(state.mutex);
+            state.spaceAvailable.wait(lock, [&] { return state.nextSequence - state.nextToEmit < window; });
+            state.work.push_back(WorkItem{state.nextSequence++, lineNumber, line});
+            state.workAvailable.notify_one();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(state.mutex);
+            state.inputDone = true;
+        }
+        state.workAvailable.notify_all();
+
+        for(auto & thread : threads)
+            thread.join();
+
+        return state.numErrors;
+    }
+
+}
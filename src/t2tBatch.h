@@ -0,0 +1,75 @@
+#ifndef TXREF_T2TBATCH_H
+#define TXREF_T2TBATCH_H
+
+#include "txid2txref.h"
+#include "bitcoinRPCFacade.h"
+
+#include <functional>
+#include <iosfwd>
+#include <memory>
+#include <string>
+
+namespace t2t {
+
+    struct BatchOptions {
+        int jobs = 4;           // number of queries in flight at once, each with its own RPC connection
+        bool ordered = true;    // emit results in input order (otherwise, as soon as they are ready)
+        int txoIndex = -1;      // default txoIndex for txids that don't specify one
+    };
+
+    struct BatchRecord {
+        size_t line = 0;        // line number in the input, starting at 1
+        std::string query;
+        bool ok = false;
+        Transaction transaction;
+        std::string warning;
+        std::string error;
+    };
+
+    typedef std::function<std::unique_ptr<BitcoinRPCFacade>()> FacadeFactory;
+
+    /**
+     * Convert one input line into a BatchRecord. The line holds a txid or txref, optionally
+     * followed by whitespace and a txoIndex. Errors are captured in the record instead of
+     * being thrown.
+     *
+     * @param btc the BitcoinRPCFacade
+     * @param line the input line
+     * @param lineNumber the line number to report in the record
+     * @param defaultTxoIndex the txoIndex to use for txids when the line doesn't have one
+     * @return the BatchRecord
+     */
+    BatchRecord processLine(
+            const BitcoinRPCFacade & btc,
+            const std::string & line,
+            size_t lineNumber,
+            int defaultTxoIndex);
+
+    /**
+     * Format a BatchRecord as a single line of JSON (NDJSON), including the trailing newline
+     *
+     * @param record the record to format
+     * @return the JSON line
+     */
+    std::string formatRecord(const BatchRecord & record);
+
+    /**
+     * Read txids and txrefs from 'in', one per line, and write one JSON record per line
+     * to 'out'. Up to options.jobs queries are converted concurrently, each worker using
+     * its own BitcoinRPCFacade created by 'facadeFactory'. Blank lines are skipped.
+     *
+     * @param in the input stream
+     * @param out the output stream
+     * @param facadeFactory creates one BitcoinRPCFacade per worker
+     * @param options batch options
+     * @return the number of records that failed
+     */
+    size_t processBatch(
+            std::istream & in,
+            std::ostream & out,
+            const FacadeFactory & facadeFactory,
+            const BatchOptions & options);
+
+}
+
+#endif //TXREF_T2TBATCH_H
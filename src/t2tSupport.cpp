@@ -2,9 +2,12 @@
 #include "libtxref.h"
 #include "txid2txref.h"
 #include "bitcoinRPCFacade.h"
+#include "domain/txrefDecoder.h"
 
 #include <bitcoinapi/types.h>
 #include <iostream>
+#include <sstream>
+#include <stdexcept>
 
 namespace t2t {
 
@@ -16,12 +19,16 @@ namespace t2t {
     }
 
     void encodeTxid(const BitcoinRPCFacade & btc, const std::string & txid, int txoIndex, struct Transaction & transaction) {
+        transaction = tryEncodeTxid(btc, txid, txoIndex).value();
+    }
 
-        blockchaininfo_t blockChainInfo = btc.getblockchaininfo();
+    void decodeTxref(const BitcoinRPCFacade &btc, const std::string & txref, struct Transaction &transaction) {
+        transaction = tryDecodeTxref(btc, txref).value();
+    }
 
-        // determine what network we are on
-        bool isTestnet = blockChainInfo.chain == "test";
-        bool isRegtest = blockChainInfo.chain == "regtest";
+    Result<Transaction> tryEncodeTxid(const BitcoinRPCFacade & btc, const std::string & txid, int txoIndex) {
+
+        blockchaininfo_t blockChainInfo = btc.getblockchaininfo();
 
         // use txid to call getrawtransaction to find the blockhash
         getrawtransaction_t rawTransaction = btc.getrawtransaction(txid, 1);
@@ -48,33 +55,24 @@ namespace t2t {
         }
 
         if (blockIndex == blockTransactions.size()) {
-            std::cerr << "Error: Could not find transaction " << txid
-                      << " within the block." << std::endl;
-            std::exit(-1);
+            std::stringstream ss;
+            ss << "Could not find transaction " << txid << " within the block.";
+            return Result<Transaction>::failure(ss.str());
         }
 
         // verify that the txoIndex provided on command line is valid for this txid
         auto numTxos = static_cast<int>(rawTransaction.vout.size());
         if(txoIndex >= numTxos) {
-            std::cerr << "Error: txoIndex provided [" << txoIndex
-                      << "] is too large for transaction " << txid << std::endl;
-            std::exit(-1);
+            std::stringstream ss;
+            ss << "txoIndex provided [" << txoIndex << "] is too large for transaction " << txid;
+            return Result<Transaction>::failure(ss.str());
         }
 
         // call txref code with block height, transaction index, and txoIndex (if provided) to get txref
-        std::string txref;
-        if (isTestnet) {
-            txref = txref::encodeTestnet(
-                    blockHeight, static_cast<int>(blockIndex), txoIndex, false);
-        } else if (isRegtest) {
-            txref = txref::encodeRegtest(
-                    blockHeight, static_cast<int>(blockIndex), txoIndex, false);
-        } else {
-            txref = txref::encode(
-                    blockHeight, static_cast<int>(blockIndex), txoIndex, false);
-        }
+        std::string txref = encodeTxref(blockChainInfo.chain, blockHeight, static_cast<int>(blockIndex), txoIndex);
 
         // output
+        Transaction transaction;
         transaction.query = txid;
         transaction.txid = txid;
         transaction.txref = txref;
@@ -82,19 +80,36 @@ namespace t2t {
         transaction.transactionIndex = static_cast<int>(blockIndex);
         transaction.network = blockChainInfo.chain;
         transaction.txoIndex = txoIndex;
+        return Result<Transaction>::success(transaction);
     }
 
-    void decodeTxref(const BitcoinRPCFacade &btc, const std::string & txref, struct Transaction &transaction) {
+    std::string encodeTxref(const std::string & chain, int blockHeight, int transactionIndex, int txoIndex) {
+        if (chain == "test")
+            return txref::encodeTestnet(blockHeight, transactionIndex, txoIndex, false);
+        if (chain == "regtest")
+            return txref::encodeRegtest(blockHeight, transactionIndex, txoIndex, false);
+        return txref::encode(blockHeight, transactionIndex, txoIndex, false);
+    }
+
+    Result<Transaction> tryDecodeTxref(const BitcoinRPCFacade &btc, const std::string & txref) {
+
+        // check the txref offline first: libtxref's decoder throws on bad input
+        DecodedTxref decoded;
+        TxrefDecodeStatus status = ::decodeTxref(txref, decoded);
+        if(status != TxrefDecodeStatus::ok) {
+            return Result<Transaction>::failure("txref '" + txref + "' is not valid: " + describe(status));
+        }
 
         txref::DecodedResult decodedResult = txref::decode(txref);
 
         blockchaininfo_t blockChainInfo = btc.getblockchaininfo();
 
         if(isNetworkMismatch(decodedResult.hrp, blockChainInfo.chain)) {
-            std::cerr << "Error: txref '" << txref
-                      << "' will not be found in your bitcoind which is configured for the "
-                      << blockChainInfo.chain << " network." << std::endl;
-            std::exit(-1);
+            std::stringstream ss;
+            ss << "txref '" << txref
+               << "' will not be found in your bitcoind which is configured for the "
+               << blockChainInfo.chain << " network.";
+            return Result<Transaction>::failure(ss.str());
         }
 
         // get block hash for block
@@ -104,18 +119,17 @@ namespace t2t {
         blockinfo_t blockInfo = btc.getblock(blockHash);
 
         // get the txid from the transaction
-        std::string txid;
-        try {
-            txid = blockInfo.tx.at(
-                    static_cast<unsigned long>(decodedResult.transactionIndex));
-        }
-        catch (std::out_of_range &) {
-            std::cerr << "Error: Could not find txid for transactionIndex '" << decodedResult.transactionIndex
-                      << "' within the block." << std::endl;
-            std::exit(-1);
+        auto transactionIndex = static_cast<std::vector<std::string>::size_type>(decodedResult.transactionIndex);
+        if (transactionIndex >= blockInfo.tx.size()) {
+            std::stringstream ss;
+            ss << "Could not find txid for transactionIndex '" << decodedResult.transactionIndex
+               << "' within the block.";
+            return Result<Transaction>::failure(ss.str());
         }
+        std::string txid = blockInfo.tx[transactionIndex];
 
         // output
+        Transaction transaction;
         transaction.query = txref;
         transaction.txid = txid;
         transaction.txref = decodedResult.txref;
@@ -123,6 +137,15 @@ namespace t2t {
         transaction.transactionIndex = decodedResult.transactionIndex;
         transaction.txoIndex = decodedResult.txoIndex;
         transaction.network = blockChainInfo.chain;
+        return Result<Transaction>::success(transaction);
+    }
+
+    std::string txref2did(const std::string & txref) {
+        if(txref.empty())
+            return "";
+        auto pos = txref.find_first_of(':');
+        std::string didPrefix = "did:btcr";
+        return didPrefix + txref.substr(pos);
     }
 
 }
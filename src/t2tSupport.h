@@ -3,15 +3,33 @@
 
 #include "txid2txref.h"
 #include "bitcoinRPCFacade.h"
+#include "result.h"
 
 namespace t2t {
 
     bool isNetworkMismatch(const std::string& hrp, const std::string& networkName);
 
+    // encodeTxid() and decodeTxref() throw std::runtime_error (or BitcoinException from
+    // the RPC layer) if the txid/txref can not be converted
+
     void encodeTxid(const BitcoinRPCFacade & btc, const std::string & txid, int txoIndex, struct Transaction & transaction);
 
     void decodeTxref(const BitcoinRPCFacade & btc, const std::string & txid, struct Transaction & transaction);
 
+    // tryEncodeTxid() and tryDecodeTxref() return a failure instead if the txid/txref can not
+    // be converted. BitcoinExceptions from the RPC layer are still thrown
+
+    Result<Transaction> tryEncodeTxid(const BitcoinRPCFacade & btc, const std::string & txid, int txoIndex);
+
+    Result<Transaction> tryDecodeTxref(const BitcoinRPCFacade & btc, const std::string & txref);
+
+    // the txref of a transaction whose position in the chain is already known, so it needs
+    // no RPC calls. 'chain' is the network as getblockchaininfo names it.
+
+    std::string encodeTxref(const std::string & chain, int blockHeight, int transactionIndex, int txoIndex);
+
+    std::string txref2did(const std::string & txref);
+
 }
 
 #endif //TXREF_T2TSUPPORT_H
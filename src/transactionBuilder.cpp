@@ -0,0 +1,233 @@
+#include "transactionBuilder.h"
+#include "hex.h"
+#include "sha256.h"
+
+#include <stdexcept>
+
+namespace {
+
+    const uint8_t OP_RETURN = 0x6a;
+    const uint8_t OP_PUSHDATA1 = 0x4c;
+
+    // the largest signature (DER with a sighash byte) and a compressed public key
+    const size_t MAX_SIGNATURE_SIZE = 72;
+    const size_t PUBLIC_KEY_SIZE = 33;
+    const size_t SCHNORR_SIGNATURE_SIZE = 64;
+
+    // bitcoind's dust relay fee, in satoshis per vbyte, and the vbytes it takes to spend an output
+    const int64_t DUST_RELAY_FEE = 3;
+    const size_t LEGACY_SPEND_SIZE = 148;
+    const size_t WITNESS_SPEND_SIZE = 67;
+
+    void appendLE32(std::vector<uint8_t> & out, uint32_t value) {
+        for(int i = 0; i < 4; ++i)
+            out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+
+    void appendLE64(std::vector<uint8_t> & out, uint64_t value) {
+        for(int i = 0; i < 8; ++i)
+            out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+
+    void appendCompactSize(std::vector<uint8_t> & out, uint64_t value) {
+        if(value < 0xfd)
+            out.push_back(static_cast<uint8_t>(value));
+        else if(value <= 0xffff) {
+            out.push_back(0xfd);
+            out.push_back(static_cast<uint8_t>(value));
+            out.push_back(static_cast<uint8_t>(value >> 8));
+        }
+        else if(value <= 0xffffffff) {
+            out.push_back(0xfe);
+            appendLE32(out, static_cast<uint32_t>(value));
+        }
+        else {
+            out.push_back(0xff);
+            appendLE64(out, value);
+        }
+    }
+
+    void appendBytes(std::vector<uint8_t> & out, const std::vector<uint8_t> & bytes) {
+        appendCompactSize(out, bytes.size());
+        out.insert(out.end(), bytes.begin(), bytes.end());
+    }
+}
+
+
+TransactionBuilder::TransactionBuilder() : txVersion(2), txLockTime(0) {
+}
+
+Amount TransactionBuilder::dustThreshold(const std::vector<uint8_t> & scriptPubKey) {
+    if(!scriptPubKey.empty() && scriptPubKey[0] == OP_RETURN)
+        return Amount();
+    Result<AddressType> type = scriptType(scriptPubKey.data(), scriptPubKey.size());
+    bool witness = type && type.value() != AddressType::p2pkh && type.value() != AddressType::p2sh;
+    size_t outputSize = 8 + 1 + scriptPubKey.size();
+    size_t spendSize = witness ? WITNESS_SPEND_SIZE : LEGACY_SPEND_SIZE;
+    return Amount::fromSatoshis(static_cast<int64_t>(outputSize + spendSize) * DUST_RELAY_FEE);
+}
+
+TransactionBuilder & TransactionBuilder::setVersion(int32_t version) {
+    txVersion = version;
+    return *this;
+}
+
+TransactionBuilder & TransactionBuilder::setLockTime(uint32_t lockTime) {
+    txLockTime = lockTime;
+    return *this;
+}
+
+int32_t TransactionBuilder::version() const {
+    return txVersion;
+}
+
+uint32_t TransactionBuilder::lockTime() const {
+    return txLockTime;
+}
+
+TransactionBuilder & TransactionBuilder::addInput(const Hash256 & prevTxid, uint32_t prevIndex, uint32_t sequence) {
+    txInputs.push_back(TxInput{prevTxid, prevIndex, {}, sequence, {}});
+    return *this;
+}
+
+TransactionBuilder & TransactionBuilder::addOutput(const Amount & value, const std::vector<uint8_t> & scriptPubKey) {
+    txOutputs.push_back(TxOutput{value, scriptPubKey});
+    return *this;
+}
+
+TransactionBuilder & TransactionBuilder::addOpReturn(const std::vector<uint8_t> & payload) {
+    if(payload.size() > MAX_OP_RETURN_SIZE)
+        throw std::invalid_argument("OP_RETURN data is " + std::to_string(payload.size()) +
+                                    " bytes, more than the " + std::to_string(MAX_OP_RETURN_SIZE) + " allowed");
+    std::vector<uint8_t> script{OP_RETURN};
+    if(!payload.empty()) {
+        // the smallest push that holds the payload, as bitcoind requires for relay
+        if(payload.size() >= OP_PUSHDATA1)
+            script.push_back(OP_PUSHDATA1);
+        script.push_back(static_cast<uint8_t>(payload.size()));
+        script.insert(script.end(), payload.begin(), payload.end());
+    }
+    return addOutput(Amount(), script);
+}
+
+std::vector<TxInput> & TransactionBuilder::inputs() {
+    return txInputs;
+}
+
+const std::vector<TxInput> & TransactionBuilder::inputs() const {
+    return txInputs;
+}
+
+const std::vector<TxOutput> & TransactionBuilder::outputs() const {
+    return txOutputs;
+}
+
+bool TransactionBuilder::hasWitness() const {
+    for(const TxInput & input : txInputs)
+        if(!input.witness.empty())
+            return true;
+    return false;
+}
+
+void TransactionBuilder::write(std::vector<uint8_t> & out, bool withWitness) const {
+    appendLE32(out, static_cast<uint32_t>(txVersion));
+    if(withWitness) {
+        out.push_back(0x00);    // marker
+        out.push_back(0x01);    // flag
+    }
+
+    appendCompactSize(out, txInputs.size());
+    for(const TxInput & input : txInputs) {
+        out.insert(out.end(), input.prevTxid.begin(), input.prevTxid.end());
+        appendLE32(out, input.prevIndex);
+        appendBytes(out, input.scriptSig);
+        appendLE32(out, input.sequence);
+    }
+
+    appendCompactSize(out, txOutputs.size());
+    for(const TxOutput & output : txOutputs) {
+        appendLE64(out, static_cast<uint64_t>(output.value.satoshis()));
+        appendBytes(out, output.scriptPubKey);
+    }
+
+    if(withWitness) {
+        for(const TxInput & input : txInputs) {
+            appendCompactSize(out, input.witness.size());
+            for(const std::vector<uint8_t> & item : input.witness)
+                appendBytes(out, item);
+        }
+    }
+    appendLE32(out, txLockTime);
+}
+
+std::vector<uint8_t> TransactionBuilder::serialize() const {
+    std::vector<uint8_t> out;
+    write(out, hasWitness());
+    return out;
+}
+
+std::string TransactionBuilder::toHex() const {
+    std::vector<uint8_t> bytes = serialize();
+    return hex::encode(bytes.data(), bytes.size());
+}
+
+std::vector<uint8_t> TransactionBuilder::serializeWithoutWitness() const {
+    std::vector<uint8_t> out;
+    write(out, false);
+    return out;
+}
+
+Hash256 TransactionBuilder::txid() const {
+    std::vector<uint8_t> bytes = serializeWithoutWitness();
+    Hash256 hash;
+    sha256::doubleHash(bytes.data(), bytes.size(), hash.data());
+    return hash;
+}
+
+size_t TransactionBuilder::weight() const {
+    size_t baseSize = serializeWithoutWitness().size();
+    size_t totalSize = hasWitness() ? serialize().size() : baseSize;
+    return baseSize * 3 + totalSize;
+}
+
+size_t TransactionBuilder::vsize() const {
+    return (weight() + 3) / 4;
+}
+
+size_t TransactionBuilder::estimateSignedVsize(const std::vector<AddressType> & spentTypes) const {
+    if(spentTypes.size() != txInputs.size())
+        throw std::invalid_argument("Need the type of output spent by each of the " +
+                                    std::to_string(txInputs.size()) + " inputs");
+
+    // a copy with placeholder signatures of the largest size
+    TransactionBuilder signedCopy(*this);
+    std::vector<uint8_t> signature(MAX_SIGNATURE_SIZE);
+    std::vector<uint8_t> publicKey(PUBLIC_KEY_SIZE);
+    for(size_t i = 0; i < spentTypes.size(); ++i) {
+        TxInput & input = signedCopy.txInputs[i];
+        switch(spentTypes[i]) {
+            case AddressType::p2pkh:
+                input.scriptSig.assign(1 + MAX_SIGNATURE_SIZE + 1 + PUBLIC_KEY_SIZE, 0);
+                input.witness.clear();
+                break;
+            case AddressType::p2sh:
+                // a push of the 22-byte p2wpkh redeem script
+                input.scriptSig.assign(23, 0);
+                input.witness = {signature, publicKey};
+                break;
+            case AddressType::p2wpkh:
+                input.scriptSig.clear();
+                input.witness = {signature, publicKey};
+                break;
+            case AddressType::p2tr:
+                input.scriptSig.clear();
+                input.witness = {std::vector<uint8_t>(SCHNORR_SIGNATURE_SIZE)};
+                break;
+            case AddressType::p2wsh:
+            case AddressType::witnessUnknown:
+                throw std::invalid_argument("Can't estimate the signed size of input " + std::to_string(i) +
+                                            ": it spends a script whose signatures aren't known");
+        }
+    }
+    return signedCopy.vsize();
+}
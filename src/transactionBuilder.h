@@ -0,0 +1,138 @@
+#ifndef TXREF_TRANSACTIONBUILDER_H
+#define TXREF_TRANSACTIONBUILDER_H
+
+#include "address.h"
+#include "amount.h"
+#include "block.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct TxInput {
+    /** the txid of the output being spent, in internal byte order */
+    Hash256 prevTxid;
+    uint32_t prevIndex;
+    std::vector<uint8_t> scriptSig;
+    uint32_t sequence;
+    std::vector<std::vector<uint8_t>> witness;
+};
+
+struct TxOutput {
+    Amount value;
+    std::vector<uint8_t> scriptPubKey;
+};
+
+/**
+ * Assembles and serializes a transaction locally, instead of asking bitcoind to with
+ * createrawtransaction. The result is serialized with witness data (BIP 144) once any input
+ * has a witness, and in the legacy format before that, as bitcoind does.
+ */
+class TransactionBuilder {
+
+public:
+    static const uint32_t SEQUENCE_FINAL = 0xffffffff;
+
+    /** the largest OP_RETURN payload bitcoind relays by default */
+    static const size_t MAX_OP_RETURN_SIZE = 80;
+
+    /** the heaviest transaction bitcoind relays: 100,000 vbytes */
+    static const size_t MAX_STANDARD_WEIGHT = 400000;
+
+    /**
+     * The smallest value bitcoind relays in an output with this script: less would cost more
+     * to spend, at 3 satoshis per vbyte, than it is worth. 546 satoshis for p2pkh, 294 for p2wpkh.
+     */
+    static Amount dustThreshold(const std::vector<uint8_t> & scriptPubKey);
+
+    /**
+     * Start a version 2 transaction with no inputs or outputs and no lock time
+     */
+    TransactionBuilder();
+
+    TransactionBuilder & setVersion(int32_t version);
+
+    TransactionBuilder & setLockTime(uint32_t lockTime);
+
+    int32_t version() const;
+
+    uint32_t lockTime() const;
+
+    /**
+     * Spend an output. Its scriptSig and witness start out empty, to be filled in by signing.
+     * @param prevTxid the txid of the transaction holding the output, in internal byte order
+     * @param prevIndex the output's index
+     * @param sequence the input's sequence number
+     */
+    TransactionBuilder & addInput(const Hash256 & prevTxid, uint32_t prevIndex, uint32_t sequence = SEQUENCE_FINAL);
+
+    TransactionBuilder & addOutput(const Amount & value, const std::vector<uint8_t> & scriptPubKey);
+
+    /**
+     * Add a zero-value output carrying data after an OP_RETURN
+     * @param payload the data, up to MAX_OP_RETURN_SIZE bytes
+     * @throws std::invalid_argument if the payload is too long
+     */
+    TransactionBuilder & addOpReturn(const std::vector<uint8_t> & payload);
+
+    std::vector<TxInput> & inputs();
+
+    const std::vector<TxInput> & inputs() const;
+
+    const std::vector<TxOutput> & outputs() const;
+
+    bool hasWitness() const;
+
+    /**
+     * @return the transaction as it would be sent to the network
+     */
+    std::vector<uint8_t> serialize() const;
+
+    /**
+     * @return serialize(), hex-encoded, as sendrawtransaction takes it
+     */
+    std::string toHex() const;
+
+    /**
+     * @return the transaction without its witness data, which is what the txid is computed over
+     */
+    std::vector<uint8_t> serializeWithoutWitness() const;
+
+    /**
+     * @return the txid, in internal byte order
+     */
+    Hash256 txid() const;
+
+    /**
+     * @return the BIP 141 weight: four units per byte outside the witness, one per byte in it
+     */
+    size_t weight() const;
+
+    /**
+     * @return the virtual size in vbytes (weight / 4, rounded up), which fees are paid on
+     */
+    size_t vsize() const;
+
+    /**
+     * Estimate the virtual size the transaction will have once signed, for checking the fee
+     * before signing. Signatures are taken to be the largest they can be, so the estimate may be
+     * a byte or two over.
+     * @param spentTypes the kind of output each input spends, in input order. A p2sh output is
+     * taken to be a segwit key hash wrapped in p2sh.
+     * @throws std::invalid_argument if there isn't one type per input, or an input spends a kind of
+     * output whose signature size can't be known (such as p2wsh)
+     */
+    size_t estimateSignedVsize(const std::vector<AddressType> & spentTypes) const;
+
+private:
+    int32_t txVersion;
+    uint32_t txLockTime;
+    std::vector<TxInput> txInputs;
+    std::vector<TxOutput> txOutputs;
+
+    void write(std::vector<uint8_t> & out, bool withWitness) const;
+};
+
+
+#endif //TXREF_TRANSACTIONBUILDER_H
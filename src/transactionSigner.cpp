@@ -0,0 +1,173 @@
+#include "transactionSigner.h"
+#include "ripemd160.h"
+#include "sha256.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+    const uint8_t OP_0 = 0x00;
+    const uint8_t OP_DUP = 0x76;
+    const uint8_t OP_EQUALVERIFY = 0x88;
+    const uint8_t OP_HASH160 = 0xa9;
+    const uint8_t OP_CHECKSIG = 0xac;
+
+    const uint32_t SIGHASH_ALL = 0x01;
+
+    void appendLE32(std::vector<uint8_t> & out, uint32_t value) {
+        for(int i = 0; i < 4; ++i)
+            out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+
+    void appendLE64(std::vector<uint8_t> & out, uint64_t value) {
+        for(int i = 0; i < 8; ++i)
+            out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+
+    /**
+     * Append a script with its length, which is always under 0xfd bytes here
+     */
+    void appendScript(std::vector<uint8_t> & out, const std::vector<uint8_t> & script) {
+        out.push_back(static_cast<uint8_t>(script.size()));
+        out.insert(out.end(), script.begin(), script.end());
+    }
+
+    Hash256 doubleHash(const std::vector<uint8_t> & bytes) {
+        Hash256 hash;
+        sha256::doubleHash(bytes.data(), bytes.size(), hash.data());
+        return hash;
+    }
+
+    std::vector<uint8_t> p2pkhScript(const uint8_t * keyHash) {
+        std::vector<uint8_t> script{OP_DUP, OP_HASH160, ripemd160::DIGEST_SIZE};
+        script.insert(script.end(), keyHash, keyHash + ripemd160::DIGEST_SIZE);
+        script.push_back(OP_EQUALVERIFY);
+        script.push_back(OP_CHECKSIG);
+        return script;
+    }
+
+    std::vector<uint8_t> p2wpkhScript(const uint8_t * keyHash) {
+        std::vector<uint8_t> script{OP_0, ripemd160::DIGEST_SIZE};
+        script.insert(script.end(), keyHash, keyHash + ripemd160::DIGEST_SIZE);
+        return script;
+    }
+
+    std::vector<uint8_t> signature(const PrivateKey & key, const Hash256 & hash) {
+        std::vector<uint8_t> sig = key.sign(hash.data());
+        sig.push_back(static_cast<uint8_t>(SIGHASH_ALL));
+        return sig;
+    }
+}
+
+
+TransactionSigner::TransactionSigner(TransactionBuilder & tx) : transaction(tx) {
+    std::vector<uint8_t> prevouts;
+    std::vector<uint8_t> sequences;
+    for(const TxInput & input : transaction.inputs()) {
+        prevouts.insert(prevouts.end(), input.prevTxid.begin(), input.prevTxid.end());
+        appendLE32(prevouts, input.prevIndex);
+        appendLE32(sequences, input.sequence);
+    }
+    std::vector<uint8_t> outputs;
+    for(const TxOutput & output : transaction.outputs()) {
+        appendLE64(outputs, static_cast<uint64_t>(output.value.satoshis()));
+        appendScript(outputs, output.scriptPubKey);
+    }
+    hashPrevouts = doubleHash(prevouts);
+    hashSequence = doubleHash(sequences);
+    hashOutputs = doubleHash(outputs);
+}
+
+Hash256 TransactionSigner::legacySignatureHash(size_t index, const std::vector<uint8_t> & scriptCode) const {
+    // the transaction with every scriptSig empty but this input's, which holds the script it spends
+    TransactionBuilder copy(transaction);
+    std::vector<TxInput> & inputs = copy.inputs();
+    for(TxInput & input : inputs) {
+        input.scriptSig.clear();
+        input.witness.clear();
+    }
+    inputs.at(index).scriptSig = scriptCode;
+
+    std::vector<uint8_t> preimage = copy.serializeWithoutWitness();
+    appendLE32(preimage, SIGHASH_ALL);
+    return doubleHash(preimage);
+}
+
+Hash256 TransactionSigner::segwitSignatureHash(size_t index, const std::vector<uint8_t> & scriptCode, const Amount & amount) const {
+    const TxInput & input = transaction.inputs().at(index);
+
+    std::vector<uint8_t> preimage;
+    appendLE32(preimage, static_cast<uint32_t>(transaction.version()));
+    preimage.insert(preimage.end(), hashPrevouts.begin(), hashPrevouts.end());
+    preimage.insert(preimage.end(), hashSequence.begin(), hashSequence.end());
+    preimage.insert(preimage.end(), input.prevTxid.begin(), input.prevTxid.end());
+    appendLE32(preimage, input.prevIndex);
+    appendScript(preimage, scriptCode);
+    appendLE64(preimage, static_cast<uint64_t>(amount.satoshis()));
+    appendLE32(preimage, input.sequence);
+    preimage.insert(preimage.end(), hashOutputs.begin(), hashOutputs.end());
+    appendLE32(preimage, transaction.lockTime());
+    appendLE32(preimage, SIGHASH_ALL);
+    return doubleHash(preimage);
+}
+
+Result<AddressType> TransactionSigner::signInput(size_t index, const PrivateKey & key,
+                                                 const std::vector<uint8_t> & spentScript, const Amount & spentAmount) {
+    typedef Result<AddressType> R;
+
+    TxInput & input = transaction.inputs().at(index);
+    std::string which = "input " + std::to_string(index);
+
+    Result<AddressType> type = scriptType(spentScript.data(), spentScript.size());
+    if(!type)
+        return R::failure("Can't sign " + which + ": it spends a non-standard script");
+
+    const std::vector<uint8_t> & publicKey = key.publicKey();
+    uint8_t keyHash[ripemd160::DIGEST_SIZE];
+    ripemd160::hash160(publicKey.data(), publicKey.size(), keyHash);
+    std::vector<uint8_t> keyScript = p2pkhScript(keyHash);
+    std::vector<uint8_t> witnessProgram = p2wpkhScript(keyHash);
+    R mismatch = R::failure("The private key does not match the output spent by " + which);
+
+    switch(type.value()) {
+        case AddressType::p2pkh: {
+            if(spentScript != keyScript)
+                return mismatch;
+            std::vector<uint8_t> sig = signature(key, legacySignatureHash(index, spentScript));
+            input.scriptSig.clear();
+            appendScript(input.scriptSig, sig);
+            appendScript(input.scriptSig, publicKey);
+            input.witness.clear();
+            break;
+        }
+        case AddressType::p2sh:
+        case AddressType::p2wpkh: {
+            if(!key.isCompressed())
+                return R::failure("Can't sign " + which + ": segwit outputs need a compressed private key");
+            if(type.value() == AddressType::p2sh) {
+                // only a p2wpkh redeem script is known from the key alone
+                uint8_t scriptHash[ripemd160::DIGEST_SIZE];
+                ripemd160::hash160(witnessProgram.data(), witnessProgram.size(), scriptHash);
+                if(!std::equal(scriptHash, scriptHash + ripemd160::DIGEST_SIZE, spentScript.begin() + 2))
+                    return mismatch;
+                input.scriptSig.clear();
+                appendScript(input.scriptSig, witnessProgram);
+            }
+            else {
+                if(spentScript != witnessProgram)
+                    return mismatch;
+                input.scriptSig.clear();
+            }
+            // a p2wpkh output is signed as if it were the p2pkh output for the same key
+            input.witness = {signature(key, segwitSignatureHash(index, keyScript, spentAmount)), publicKey};
+            break;
+        }
+        case AddressType::p2wsh:
+        case AddressType::p2tr:
+        case AddressType::witnessUnknown:
+            return R::failure("Can't sign " + which + ": only p2pkh, p2sh-p2wpkh and p2wpkh outputs are supported");
+    }
+    return type;
+}
@@ -0,0 +1,62 @@
+#ifndef TXREF_TRANSACTIONSIGNER_H
+#define TXREF_TRANSACTIONSIGNER_H
+
+#include "address.h"
+#include "amount.h"
+#include "block.h"
+#include "privateKey.h"
+#include "result.h"
+#include "transactionBuilder.h"
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * Signs a transaction's inputs in-process with libsecp256k1, instead of sending the private key
+ * to bitcoind with signrawtransactionwithkey.
+ *
+ * Inputs spending p2pkh, p2sh-wrapped p2wpkh and p2wpkh outputs can be signed, all with
+ * SIGHASH_ALL. The BIP 143 hashes of the transaction's outpoints, sequences and outputs are
+ * computed once, when the signer is made, and shared by every segwit input.
+ */
+class TransactionSigner {
+
+public:
+    /**
+     * @param tx the transaction to sign. Nothing but its scriptSigs and witnesses may change
+     * while it is being signed.
+     */
+    explicit TransactionSigner(TransactionBuilder & tx);
+
+    /**
+     * Sign an input, filling in its scriptSig and witness
+     * @param index the input
+     * @param key the key the spent output pays to
+     * @param spentScript the scriptPubKey of the spent output
+     * @param spentAmount the value of the spent output, which segwit signatures commit to
+     * @return the kind of output spent, or why the input can't be signed: the key doesn't match
+     * the output, or the output isn't one of the kinds above
+     * @throws std::out_of_range if the transaction has no such input
+     */
+    Result<AddressType> signInput(size_t index, const PrivateKey & key,
+                                  const std::vector<uint8_t> & spentScript, const Amount & spentAmount);
+
+    /**
+     * @return the hash a legacy (pre-segwit) signature of an input commits to
+     */
+    Hash256 legacySignatureHash(size_t index, const std::vector<uint8_t> & scriptCode) const;
+
+    /**
+     * @return the hash a segwit version 0 signature of an input commits to (BIP 143)
+     */
+    Hash256 segwitSignatureHash(size_t index, const std::vector<uint8_t> & scriptCode, const Amount & amount) const;
+
+private:
+    TransactionBuilder & transaction;
+    Hash256 hashPrevouts;
+    Hash256 hashSequence;
+    Hash256 hashOutputs;
+};
+
+
+#endif //TXREF_TRANSACTIONSIGNER_H
@@ -0,0 +1,77 @@
+#include "txIndex.h"
+#include "mappedFile.h"
+
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+    void writeBE32(uint8_t * out, uint32_t value) {
+        for(int i = 0; i < 4; ++i)
+            out[i] = static_cast<uint8_t>(value >> (24 - 8 * i));
+    }
+
+    uint32_t readBE32(const uint8_t * p) {
+        return static_cast<uint32_t>(p[0]) << 24 | static_cast<uint32_t>(p[1]) << 16 |
+               static_cast<uint32_t>(p[2]) << 8 | static_cast<uint32_t>(p[3]);
+    }
+}
+
+
+const std::array<uint8_t, TxIndex::HEADER_SIZE> & TxIndex::header() {
+    // "btcrtxi" and a format version
+    static const std::array<uint8_t, HEADER_SIZE> bytes = {{'b', 't', 'c', 'r', 't', 'x', 'i', 1}};
+    return bytes;
+}
+
+TxIndex::Record TxIndex::encode(const TxIndexEntry & entry) {
+    Record record;
+    std::memcpy(record.data(), entry.txid.data(), entry.txid.size());
+    writeBE32(&record[32], entry.height);
+    writeBE32(&record[36], entry.position);
+    return record;
+}
+
+TxIndexEntry TxIndex::decode(const uint8_t * record) {
+    TxIndexEntry entry;
+    std::memcpy(entry.txid.data(), record, entry.txid.size());
+    entry.height = readBE32(record + 32);
+    entry.position = readBE32(record + 36);
+    return entry;
+}
+
+TxIndex::TxIndex(const std::string & path)
+        : file(new MappedFile(path, MappedFile::Access::random)), numRecords(0) {
+    size_t size = file->size();
+    if(size < HEADER_SIZE || std::memcmp(file->data(), header().data(), HEADER_SIZE) != 0 ||
+       (size - HEADER_SIZE) % RECORD_SIZE != 0)
+        throw std::runtime_error("Not a transaction index: " + path);
+    numRecords = (size - HEADER_SIZE) / RECORD_SIZE;
+}
+
+TxIndex::~TxIndex() = default;
+
+size_t TxIndex::size() const {
+    return numRecords;
+}
+
+const uint8_t * TxIndex::record(size_t position) const {
+    return file->data() + HEADER_SIZE + position * RECORD_SIZE;
+}
+
+bool TxIndex::find(const Hash256 & txid, TxIndexEntry & entry) const {
+    // the first record not less than the txid
+    size_t low = 0;
+    size_t high = numRecords;
+    while(low < high) {
+        size_t middle = low + (high - low) / 2;
+        if(std::memcmp(record(middle), txid.data(), txid.size()) < 0)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    if(low == numRecords || std::memcmp(record(low), txid.data(), txid.size()) != 0)
+        return false;
+    entry = decode(record(low));
+    return true;
+}
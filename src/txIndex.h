@@ -0,0 +1,87 @@
+#ifndef TXREF_TXINDEX_H
+#define TXREF_TXINDEX_H
+
+#include "block.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+class MappedFile;
+
+/**
+ * Where a transaction is in the chain: its block height and its position in the block, which
+ * is all a txref needs
+ */
+struct TxIndexEntry {
+    Hash256 txid;
+    uint32_t height;
+    uint32_t position;
+};
+
+/**
+ * A file mapping txids to TxIndexEntries, as written by TxIndexBuilder. With one, txids can be
+ * turned into txrefs without bitcoind's -txindex.
+ *
+ * The file is an 8-byte header followed by fixed-size records sorted by txid, so a lookup is a
+ * binary search over the memory-mapped file. Each record is the txid in internal byte order,
+ * then the height and position as big-endian 32-bit numbers, so that records sort correctly by
+ * comparing their bytes.
+ */
+class TxIndex {
+
+public:
+    static const size_t HEADER_SIZE = 8;
+    static const size_t RECORD_SIZE = 40;
+
+    typedef std::array<uint8_t, RECORD_SIZE> Record;
+
+    /**
+     * @return the header that starts every index file
+     */
+    static const std::array<uint8_t, HEADER_SIZE> & header();
+
+    static Record encode(const TxIndexEntry & entry);
+
+    static TxIndexEntry decode(const uint8_t * record);
+
+    /**
+     * Open an index file
+     * @param path the file's path
+     * @throws std::runtime_error if the file can't be read or isn't an index
+     */
+    explicit TxIndex(const std::string & path);
+
+    ~TxIndex();
+
+    TxIndex(const TxIndex &) = delete;
+    TxIndex & operator=(const TxIndex &) = delete;
+
+    /**
+     * @return the number of records
+     */
+    size_t size() const;
+
+    /**
+     * @return the bytes of the record at this position, in sorted order
+     */
+    const uint8_t * record(size_t position) const;
+
+    /**
+     * Look up a transaction. Two mainnet coinbase transactions were each mined twice (before
+     * BIP 30 forbade it); for those the lower height is found.
+     * @param txid the txid in internal byte order
+     * @param entry receives the transaction's location, if found
+     * @return true if the txid is in the index
+     */
+    bool find(const Hash256 & txid, TxIndexEntry & entry) const;
+
+private:
+    std::unique_ptr<MappedFile> file;
+    size_t numRecords;
+};
+
+
+#endif //TXREF_TXINDEX_H
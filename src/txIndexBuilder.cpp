@@ -0,0 +1,306 @@
+#include "txIndexBuilder.h"
+#include "hex.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <queue>
+#include <sstream>
+#include <stdexcept>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+    // how often progress is reported while the segments are fetched
+    const std::chrono::seconds PROGRESS_INTERVAL(1);
+
+    std::string segmentFileName(const std::string & workDir, int fromHeight, int toHeight) {
+        return workDir + "/segment-" + std::to_string(fromHeight) + "-" + std::to_string(toHeight);
+    }
+
+    /**
+     * Write index records to a file, through a temporary file so that a crash never leaves
+     * a partly written file at 'path'
+     */
+    class IndexFileWriter {
+    public:
+        explicit IndexFileWriter(const std::string & p) : path(p), tempPath(p + ".tmp"),
+                out(tempPath, std::ios::binary | std::ios::trunc) {
+            if(!out)
+                throw std::runtime_error("Can't write " + tempPath);
+            const auto & header = TxIndex::header();
+            out.write(reinterpret_cast<const char *>(header.data()), header.size());
+        }
+
+        void write(const uint8_t * record) {
+            out.write(reinterpret_cast<const char *>(record), TxIndex::RECORD_SIZE);
+        }
+
+        void commit() {
+            out.close();
+            if(!out || std::rename(tempPath.c_str(), path.c_str()) != 0)
+                throw std::runtime_error("Can't write " + path);
+        }
+
+    private:
+        std::string path;
+        std::string tempPath;
+        std::ofstream out;
+    };
+
+    /**
+     * Merge sorted index files into one
+     * @return the number of records written
+     */
+    size_t mergeIndexFiles(const std::vector<std::string> & inputs, const std::string & output) {
+        std::vector<std::unique_ptr<TxIndex>> indexes;
+        for(const std::string & input : inputs)
+            indexes.emplace_back(new TxIndex(input));
+
+        // (index, position) of the next record from each file, smallest record on top
+        typedef std::pair<size_t, size_t> Cursor;
+        auto greater = [&indexes](const Cursor & a, const Cursor & b) {
+            return std::memcmp(indexes[a.first]->record(a.second), indexes[b.first]->record(b.second),
+                               TxIndex::RECORD_SIZE) > 0;
+        };
+        std::priority_queue<Cursor, std::vector<Cursor>, decltype(greater)> next(greater);
+        for(size_t i = 0; i < indexes.size(); ++i)
+            if(indexes[i]->size() > 0)
+                next.push(Cursor(i, 0));
+
+        IndexFileWriter writer(output);
+        size_t written = 0;
+        while(!next.empty()) {
+            Cursor cursor = next.top();
+            next.pop();
+            writer.write(indexes[cursor.first]->record(cursor.second));
+            ++written;
+            if(cursor.second + 1 < indexes[cursor.first]->size())
+                next.push(Cursor(cursor.first, cursor.second + 1));
+        }
+        writer.commit();
+        return written;
+    }
+
+    /**
+     * The segments finished by earlier runs, from the checkpoint file: the first height of
+     * each, mapped to its last height and the hash of its last block. A line cut short by a
+     * crash is ignored.
+     */
+    std::map<int, std::pair<int, std::string>> readCheckpoint(const std::string & path) {
+        std::map<int, std::pair<int, std::string>> finished;
+        std::ifstream in(path);
+        std::string line;
+        while(std::getline(in, line)) {
+            std::istringstream iss(line);
+            int fromHeight, toHeight;
+            std::string hash;
+            if(iss >> fromHeight >> toHeight >> hash && hash.size() == 64)
+                finished[fromHeight] = std::make_pair(toHeight, hash);
+        }
+        return finished;
+    }
+}
+
+
+TxIndexBuilder::TxIndexBuilder(const FacadeFactory & facadeFactory, size_t numThreads, int b)
+        : blocksPerSegment(b), pool(numThreads) {
+    if(blocksPerSegment < 1)
+        throw std::invalid_argument("blocksPerSegment should be one or greater");
+    for(size_t i = 0; i < pool.size(); ++i)
+        facades.push_back(facadeFactory());
+}
+
+TxIndexBuilder::TxIndexBuilder(const BlockFileReader & r, size_t numThreads, int b)
+        : blockFiles(&r), blocksPerSegment(b), pool(numThreads) {
+    if(blocksPerSegment < 1)
+        throw std::invalid_argument("blocksPerSegment should be one or greater");
+}
+
+TxIndexBuilder::~TxIndexBuilder() = default;
+
+std::string TxIndexBuilder::bestBlockHash(int height) const {
+    if(blockFiles != nullptr)
+        return hex::encodeHash(blockFiles->blockHash(height).data());
+    return facades[0]->getblockhash(height);
+}
+
+std::string TxIndexBuilder::indexSegment(
+        size_t workerIndex, const Segment & segment, const std::string & path,
+        const std::function<void(size_t transactions, size_t bytes)> & blockDone) const {
+
+    std::vector<TxIndex::Record> records;
+    // 'hash' is the block's as displayed, and 'size' its serialized length
+    auto indexBlock = [&](int height, const Block & block, const std::string & hash, size_t size) {
+        // make sure the block is the one asked for, and arrived intact
+        std::vector<Hash256> txids = block.txids();
+        if(hex::encodeHash(block.header().hash.data()) != hash || !block.hasValidMerkleRoot(txids))
+            throw std::runtime_error("Block " + hash + " does not match its hash");
+
+        for(size_t position = 0; position < txids.size(); ++position)
+            records.push_back(TxIndex::encode(TxIndexEntry{
+                    txids[position], static_cast<uint32_t>(height), static_cast<uint32_t>(position)}));
+        blockDone(txids.size(), size);
+    };
+
+    std::string hash;
+    if(blockFiles != nullptr) {
+        blockFiles->forEachBlock(segment.fromHeight, segment.toHeight, [&](int height, const Block & block) {
+            hash = hex::encodeHash(blockFiles->blockHash(height).data());
+            // the transaction count's few bytes aside
+            size_t size = BlockHeader::SIZE;
+            for(const RawTransaction & tx : block.transactions())
+                size += tx.bytes().size;
+            indexBlock(height, block, hash, size);
+        });
+    }
+    else {
+        const BitcoinRPCFacade & btc = *facades[workerIndex];
+        std::vector<uint8_t> bytes;
+        for(int height = segment.fromHeight; height <= segment.toHeight; ++height) {
+            hash = btc.getblockhash(height);
+            std::string blockHex = btc.getrawblock(hash);
+            if(!hex::decode(blockHex, bytes))
+                throw std::runtime_error("Block " + hash + " is not valid hex");
+
+            Result<Block> block = Block::parse(bytes.data(), bytes.size());
+            if(!block)
+                throw std::runtime_error("Can't parse block " + hash + ": " + block.error());
+            indexBlock(height, block.value(), hash, bytes.size());
+        }
+    }
+
+    std::sort(records.begin(), records.end());
+    IndexFileWriter writer(path);
+    for(const TxIndex::Record & record : records)
+        writer.write(record.data());
+    writer.commit();
+    return hash;
+}
+
+size_t TxIndexBuilder::build(const std::string & indexPath, int toHeight, const ProgressCallback & progress) {
+
+    if(blockFiles != nullptr) {
+        if(toHeight < 0)
+            toHeight = blockFiles->tipHeight();
+        else if(toHeight > blockFiles->tipHeight())
+            throw std::runtime_error("The block files end at height " + std::to_string(blockFiles->tipHeight()));
+    }
+    else if(toHeight < 0) {
+        toHeight = facades[0]->getblockchaininfo().blocks;
+    }
+
+    std::string workDir = indexPath + ".partial";
+    if(::mkdir(workDir.c_str(), 0755) != 0 && errno != EEXIST)
+        throw std::runtime_error("Can't create directory " + workDir);
+    std::string checkpointPath = workDir + "/checkpoint";
+
+    std::vector<Segment> segments;
+    for(int fromHeight = 0; fromHeight <= toHeight; fromHeight += blocksPerSegment)
+        segments.push_back(Segment{fromHeight, std::min(fromHeight + blocksPerSegment - 1, toHeight)});
+
+    // keep the segments an earlier run finished, if they are still what this run would make
+    std::map<int, std::pair<int, std::string>> finished = readCheckpoint(checkpointPath);
+    std::vector<Segment> todo;
+    int blocksResumed = 0;
+    for(const Segment & segment : segments) {
+        auto found = finished.find(segment.fromHeight);
+        bool resume = false;
+        if(found != finished.end() && found->second.first == segment.toHeight) {
+            try {
+                TxIndex check(segmentFileName(workDir, segment.fromHeight, segment.toHeight));
+                resume = bestBlockHash(segment.toHeight) == found->second.second;
+            }
+            catch(std::runtime_error &) {
+                // the file is missing or damaged, so fetch the segment again
+            }
+        }
+        if(resume)
+            blocksResumed += segment.toHeight - segment.fromHeight + 1;
+        else
+            todo.push_back(segment);
+        if(found != finished.end())
+            finished.erase(found);
+    }
+    // a segment that no longer fits, such as the previous run's last one
+    for(const auto & stale : finished)
+        std::remove(segmentFileName(workDir, stale.first, stale.second.first).c_str());
+
+    std::ofstream checkpoint(checkpointPath, std::ios::app);
+    if(!checkpoint)
+        throw std::runtime_error("Can't write " + checkpointPath);
+
+    std::mutex mutex;
+    TxIndexProgress current;
+    current.blocksDone = blocksResumed;
+    current.blocksTotal = toHeight + 1;
+    int blocksFetched = 0;
+    auto start = std::chrono::steady_clock::now();
+    auto lastReport = start;
+
+    // the caller holds the mutex
+    auto report = [&](std::chrono::steady_clock::time_point now) {
+        double seconds = std::chrono::duration<double>(now - start).count();
+        if(seconds > 0 && blocksFetched > 0) {
+            current.blocksPerSecond = blocksFetched / seconds;
+            current.secondsLeft = (current.blocksTotal - current.blocksDone) / current.blocksPerSecond;
+        }
+        lastReport = now;
+        if(progress)
+            progress(current);
+    };
+
+    auto blockDone = [&](size_t transactions, size_t bytes) {
+        std::lock_guard<std::mutex> lock(mutex);
+        ++blocksFetched;
+        ++current.blocksDone;
+        current.transactions += transactions;
+        current.bytes += bytes;
+        auto now = std::chrono::steady_clock::now();
+        if(now - lastReport >= PROGRESS_INTERVAL)
+            report(now);
+    };
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        report(start);
+    }
+
+    for(const Segment & segment : todo) {
+        pool.submit([this, segment, &workDir, &checkpoint, &checkpointPath, &mutex, &blockDone](size_t workerIndex) {
+            std::string lastHash = indexSegment(workerIndex, segment,
+                    segmentFileName(workDir, segment.fromHeight, segment.toHeight), blockDone);
+
+            std::lock_guard<std::mutex> lock(mutex);
+            checkpoint << segment.fromHeight << " " << segment.toHeight << " " << lastHash << "\n";
+            checkpoint.flush();
+            if(!checkpoint)
+                throw std::runtime_error("Can't write " + checkpointPath);
+        });
+    }
+    pool.wait();
+
+    std::vector<std::string> segmentFiles;
+    for(const Segment & segment : segments)
+        segmentFiles.push_back(segmentFileName(workDir, segment.fromHeight, segment.toHeight));
+    size_t numTransactions = mergeIndexFiles(segmentFiles, indexPath);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        report(std::chrono::steady_clock::now());
+    }
+
+    checkpoint.close();
+    for(const std::string & segmentFile : segmentFiles)
+        std::remove(segmentFile.c_str());
+    std::remove(checkpointPath.c_str());
+    ::rmdir(workDir.c_str());
+    return numTransactions;
+}
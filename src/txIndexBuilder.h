@@ -0,0 +1,116 @@
+#ifndef TXREF_TXINDEXBUILDER_H
+#define TXREF_TXINDEXBUILDER_H
+
+#include "bitcoinRPCFacade.h"
+#include "blockFileReader.h"
+#include "txIndex.h"
+#include "workStealingPool.h"
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * How far along a TxIndexBuilder is
+ */
+struct TxIndexProgress {
+    int blocksDone = 0;             // including blocks indexed by an earlier, interrupted run
+    int blocksTotal = 0;
+    size_t transactions = 0;        // indexed by this run
+    size_t bytes = 0;               // of serialized blocks fetched (or read) by this run
+    double blocksPerSecond = 0;     // by this run
+    double secondsLeft = -1;        // estimated, or negative until there is a rate to go by
+};
+
+/**
+ * Builds a TxIndex, over RPC or straight from bitcoind's block files (see BlockFileReader).
+ * Reading the block files skips RPC and hex altogether, but needs bitcoind stopped and its
+ * files at hand; RPC works with any node that isn't pruned.
+ *
+ * The chain is split into fixed ranges of heights ("segments"). The segments are fetched in
+ * parallel on a WorkStealingPool, each worker with its own RPC connection (made by the
+ * FacadeFactory), and each worker parses its blocks and computes their txids itself. A
+ * finished segment is written to its own sorted index file, and recorded in a checkpoint file,
+ * so if the build stops, running it again only fetches the segments that weren't finished. A
+ * recorded segment is fetched again if its last block is no longer on the best chain. When
+ * every segment is done, they are merged into the index and removed.
+ *
+ * Segments are sorted in memory: each worker holds 40 bytes per transaction in its segment.
+ */
+class TxIndexBuilder {
+
+public:
+    typedef std::function<std::unique_ptr<BitcoinRPCFacade>()> FacadeFactory;
+    typedef std::function<void(const TxIndexProgress & progress)> ProgressCallback;
+
+    static const int DEFAULT_BLOCKS_PER_SEGMENT = 500;
+
+    /**
+     * Construct a TxIndexBuilder. All RPC connections are made here.
+     * @param facadeFactory makes one BitcoinRPCFacade per worker thread
+     * @param numThreads the number of worker threads, and so of blocks fetched at once
+     * @param blocksPerSegment the number of blocks in each segment. Changing it between runs
+     * of the same build throws away the finished segments.
+     */
+    TxIndexBuilder(
+            const FacadeFactory & facadeFactory,
+            size_t numThreads,
+            int blocksPerSegment = DEFAULT_BLOCKS_PER_SEGMENT);
+
+    /**
+     * Construct a TxIndexBuilder that reads the blocks from bitcoind's block files instead
+     * @param blockFiles the block files. Must outlive this object.
+     * @param numThreads the number of worker threads, and so of segments read at once
+     * @param blocksPerSegment the number of blocks in each segment
+     */
+    TxIndexBuilder(
+            const BlockFileReader & blockFiles,
+            size_t numThreads,
+            int blocksPerSegment = DEFAULT_BLOCKS_PER_SEGMENT);
+
+    ~TxIndexBuilder();
+
+    /**
+     * Index every transaction from the genesis block to 'toHeight'. The segments and checkpoint
+     * are kept in the directory indexPath + ".partial" until the index is written.
+     * @param indexPath where to write the index
+     * @param toHeight the last block to index, or -1 for the current tip (or the block files'
+     * last block). Blocks near the tip may yet be reorganized away, so an index meant to last
+     * should stop some blocks short.
+     * @param progress if set, called now and then with the progress so far (never from two
+     * threads at once), and once at the end
+     * @return the number of transactions in the index
+     * @throws std::runtime_error if a file can't be written, a block is invalid, or the block
+     * files end before 'toHeight'
+     * @throws BitcoinException if an RPC call fails
+     */
+    size_t build(const std::string & indexPath, int toHeight, const ProgressCallback & progress = ProgressCallback());
+
+private:
+    struct Segment {
+        int fromHeight;
+        int toHeight;
+    };
+
+    std::vector<std::unique_ptr<BitcoinRPCFacade>> facades;  // one per worker, unless reading block files
+    const BlockFileReader * blockFiles = nullptr;
+    int blocksPerSegment;
+    WorkStealingPool pool;
+
+    /**
+     * @return the hash of the block at this height on the best chain, as displayed
+     */
+    std::string bestBlockHash(int height) const;
+
+    /**
+     * Fetch (or read) the segment's blocks and write its index file
+     * @return the hash of its last block, as displayed
+     */
+    std::string indexSegment(size_t workerIndex, const Segment & segment, const std::string & path,
+                             const std::function<void(size_t transactions, size_t bytes)> & blockDone) const;
+};
+
+
+#endif //TXREF_TXINDEXBUILDER_H
@@ -1,5 +1,6 @@
 #include "txid2txref.h"
 #include "t2tSupport.h"
+#include "t2tBatch.h"
 #include "libtxref.h"
 #include "bitcoinRPCFacade.h"
 #include "anyoption.h"
@@ -8,6 +9,7 @@
 #include <boost/property_tree/ptree.hpp>
 #include <boost/property_tree/json_parser.hpp>
 #include <iostream>
+#include <fstream>
 #include <cstdlib>
 #include <memory>
 #include <stdexcept>
@@ -17,23 +19,18 @@ namespace pt = boost::property_tree;
 struct CmdlineInput {
     std::string query;
     int txoIndex = -1;
+    std::string inputFile;      // batch mode: file to read queries from ("-" for stdin)
+    bool unordered = false;
+    int jobs = 4;
 };
 
 
-std::string txref2did(const std::string & txref) {
-    if(txref.empty())
-        return "";
-    auto pos = txref.find_first_of(':');
-    std::string didPrefix = "did:btcr";
-    return didPrefix + txref.substr(pos);
-}
-
 void printAsJson(const t2t::Transaction &transaction) {
     pt::ptree root;
 
     root.put("txid", transaction.txid);
     root.put("txref", transaction.txref);
-    root.put("did", txref2did(transaction.txref));
+    root.put("did", t2t::txref2did(transaction.txref));
     root.put("network", transaction.network);
     root.put("block-height", transaction.blockHeight);
     root.put("transaction-index", transaction.transactionIndex);
@@ -88,8 +85,15 @@ int parseCommandLineArgs(int argc, char **argv,
     opt->addUsage( " --rpcport [port]           RPC port (default: try both 8332 and 18332) " );
     opt->addUsage( " --config [config_path]     Full pathname to bitcoin.conf (default: <homedir>/.bitcoin/bitcoin.conf) " );
     opt->addUsage( " --txoIndex [index #]       Index # for TXO within the transaction (default: 0) " );
+    opt->addUsage( " --input [file|-]           Batch mode: read txids/txrefs from file (or stdin), one per line " );
+    opt->addUsage( " --batch                    Batch mode: same as '--input -' " );
+    opt->addUsage( " --unordered                Batch mode: output results as they complete, not in input order " );
+    opt->addUsage( " --jobs [#]                 Batch mode: number of concurrent RPC connections (default: 4) " );
     opt->addUsage( "" );
     opt->addUsage( "<txid|txref>                input: can be a txid to encode, or a txref to decode" );
+    opt->addUsage( "" );
+    opt->addUsage( "In batch mode, each input line holds a txid or txref, optionally followed by a txoIndex." );
+    opt->addUsage( "One JSON object is written per line (NDJSON); errors are reported per line." );
 
     opt->setFlag("help", 'h');
     opt->setOption("rpcconnect");
@@ -98,6 +102,10 @@ int parseCommandLineArgs(int argc, char **argv,
     opt->setOption("rpcport");
     opt->setCommandOption("config");
     opt->setOption("txoIndex");
+    opt->setOption("input");
+    opt->setFlag("batch");
+    opt->setFlag("unordered");
+    opt->setOption("jobs");
 
     // parse any command line arguments--this is a first pass, mainly to get a possible
     // "config" option that tells if the bitcoin.conf file is in a non-default location
@@ -170,6 +178,31 @@ int parseCommandLineArgs(int argc, char **argv,
         }
     }
 
+    // batch mode reads queries from a file or stdin instead of the command line
+    if (opt->getValue("input") != nullptr) {
+        cmdlineInput.inputFile = opt->getValue("input");
+    }
+    else if (opt->getFlag("batch")) {
+        cmdlineInput.inputFile = "-";
+    }
+
+    if (opt->getFlag("unordered")) {
+        cmdlineInput.unordered = true;
+    }
+
+    if (opt->getValue("jobs") != nullptr) {
+        cmdlineInput.jobs = convertIntegerArg("jobs", opt.get());
+        if(cmdlineInput.jobs < 1) {
+            std::cerr << "Error: jobs '" << cmdlineInput.jobs << "' should be one or greater. Check command line usage.\n";
+            opt->printUsage();
+            return -1;
+        }
+    }
+
+    if (!cmdlineInput.inputFile.empty()) {
+        return 1;
+    }
+
     // finally, the last argument will be the query string -- either the txid or the txref
     if(opt->getArgc() < 1) {
         std::cerr << "Error: txid/txref not found. Check command line usage.\n";
@@ -181,6 +214,35 @@ int parseCommandLineArgs(int argc, char **argv,
     return 1;
 }
 
+int runBatch(const RpcConfig &rpcConfig, const CmdlineInput &cmdlineInput) {
+
+    std::ifstream inputFile;
+    if(cmdlineInput.inputFile != "-") {
+        inputFile.open(cmdlineInput.inputFile);
+        if(!inputFile) {
+            std::cerr << "Error: input file " << cmdlineInput.inputFile << " not readable.\n";
+            return -1;
+        }
+    }
+    std::istream & in = cmdlineInput.inputFile == "-" ? std::cin : inputFile;
+
+    t2t::BatchOptions options;
+    options.jobs = cmdlineInput.jobs;
+    options.ordered = !cmdlineInput.unordered;
+    options.txoIndex = cmdlineInput.txoIndex;
+
+    t2t::FacadeFactory facadeFactory = [&rpcConfig]() {
+        return std::unique_ptr<BitcoinRPCFacade>(new BitcoinRPCFacade(rpcConfig));
+    };
+
+    size_t numErrors = t2t::processBatch(in, std::cout, facadeFactory, options);
+    if(numErrors > 0) {
+        std::cerr << "Warning: " << numErrors << " queries could not be converted.\n";
+    }
+
+    return 0;
+}
+
 int main(int argc, char *argv[]) {
 
     struct RpcConfig rpcConfig;
@@ -192,6 +254,10 @@ int main(int argc, char *argv[]) {
     }
 
     try {
+        if(!cmdlineInput.inputFile.empty()) {
+            return runBatch(rpcConfig, cmdlineInput);
+        }
+
         BitcoinRPCFacade btc(rpcConfig);
 
         t2t::Transaction transaction;
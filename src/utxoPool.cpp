@@ -0,0 +1,159 @@
+#include "utxoPool.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+
+    bool sameOutpoint(const PoolCoin & a, const PoolCoin & b) {
+        return a.vout == b.vout && a.txid == b.txid;
+    }
+
+    std::vector<PoolCoin>::iterator find(std::vector<PoolCoin> & coins, const PoolCoin & coin) {
+        return std::find_if(coins.begin(), coins.end(), [&](const PoolCoin & c) { return sameOutpoint(c, coin); });
+    }
+
+    bool containsCoin(const std::vector<PoolCoin> & coins, const PoolCoin & coin) {
+        return std::any_of(coins.begin(), coins.end(), [&](const PoolCoin & c) { return sameOutpoint(c, coin); });
+    }
+}
+
+UtxoPool::UtxoPool(int maxChainLength) : maxChain(maxChainLength) {
+    if(maxChainLength < 1)
+        throw std::invalid_argument("The longest chain of unconfirmed transactions must be one or more");
+}
+
+void UtxoPool::add(const PoolCoin & coin) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        available.push_back(coin);
+    }
+    returned.notify_all();
+}
+
+bool UtxoPool::take(const Amount & minimum, PoolCoin & coin) {
+    std::unique_lock<std::mutex> lock(mutex);
+    for(;;) {
+        // a transaction spending the coin hangs from one more than the coin does
+        auto best = available.end();
+        for(auto it = available.begin(); it != available.end(); ++it) {
+            if(it->amount >= minimum && it->unconfirmedDepth < maxChain &&
+                    (best == available.end() || it->amount < best->amount))
+                best = it;
+        }
+        if(best != available.end()) {
+            coin = *best;
+            lent.push_back(coin);
+            available.erase(best);
+            return true;
+        }
+        if(lent.empty())
+            return false;
+        returned.wait(lock);
+    }
+}
+
+bool UtxoPool::takeLargest(PoolCoin & coin) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto best = available.end();
+    for(auto it = available.begin(); it != available.end(); ++it) {
+        if(it->unconfirmedDepth < maxChain && (best == available.end() || it->amount > best->amount))
+            best = it;
+    }
+    if(best == available.end())
+        return false;
+    coin = *best;
+    lent.push_back(coin);
+    available.erase(best);
+    return true;
+}
+
+void UtxoPool::release(const PoolCoin & coin) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        removeLent(coin);
+        available.push_back(coin);
+    }
+    returned.notify_all();
+}
+
+void UtxoPool::hold(const PoolCoin & coin) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        removeLent(coin);
+        PoolCoin held = coin;
+        held.unconfirmedDepth = maxChain;
+        available.push_back(held);
+    }
+    returned.notify_all();
+}
+
+void UtxoPool::discard(const PoolCoin & coin) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        removeLent(coin);
+    }
+    returned.notify_all();
+}
+
+void UtxoPool::spent(const PoolCoin & coin, const std::vector<PoolCoin> & created) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        removeLent(coin);
+        available.insert(available.end(), created.begin(), created.end());
+    }
+    returned.notify_all();
+}
+
+bool UtxoPool::contains(const PoolCoin & coin) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return containsCoin(available, coin) || containsCoin(lent, coin);
+}
+
+void UtxoPool::refresh(const std::vector<PoolCoin> & confirmed) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        // confirmed coins that aren't there anymore were spent elsewhere
+        available.erase(std::remove_if(available.begin(), available.end(), [&](const PoolCoin & c) {
+            return c.unconfirmedDepth == 0 && !containsCoin(confirmed, c);
+        }), available.end());
+
+        for(const PoolCoin & coin : confirmed) {
+            auto it = find(available, coin);
+            auto lentIt = find(lent, coin);
+            if(it != available.end())
+                it->unconfirmedDepth = 0;
+            else if(lentIt != lent.end())
+                lentIt->unconfirmedDepth = 0;
+            else {
+                PoolCoin added = coin;
+                added.unconfirmedDepth = 0;
+                available.push_back(added);
+            }
+        }
+    }
+    returned.notify_all();
+}
+
+size_t UtxoPool::size() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return available.size() + lent.size();
+}
+
+Amount UtxoPool::total() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    Amount sum;
+    for(const PoolCoin & coin : available)
+        sum += coin.amount;
+    for(const PoolCoin & coin : lent)
+        sum += coin.amount;
+    return sum;
+}
+
+void UtxoPool::removeLent(const PoolCoin & coin) {
+    auto it = find(lent, coin);
+    if(it == lent.end())
+        throw std::invalid_argument("The coin was not taken from the pool");
+    lent.erase(it);
+}
@@ -0,0 +1,123 @@
+#ifndef TXREF_UTXOPOOL_H
+#define TXREF_UTXOPOOL_H
+
+#include "amount.h"
+#include "block.h"
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+/**
+ * An output the issuer holds the key to, ready to fund a DID transaction
+ */
+struct PoolCoin {
+    /** in internal byte order */
+    Hash256 txid;
+    uint32_t vout;
+    Amount amount;
+    std::vector<uint8_t> scriptPubKey;
+    /** 0 once confirmed; otherwise how many unconfirmed transactions, this one's included, it hangs from */
+    int unconfirmedDepth;
+};
+
+/**
+ * The funding coins of an issuer that sends many DID transactions at once. Each coin is lent to
+ * one transaction at a time, and the change of a transaction comes back as a new coin that can
+ * be spent before it confirms, as long as the chain of unconfirmed transactions stays short
+ * enough for bitcoind to relay. Safe to use from many threads.
+ */
+class UtxoPool {
+
+public:
+    /** bitcoind's default limit on unconfirmed ancestors, -limitancestorcount */
+    static const int DEFAULT_MAX_CHAIN_LENGTH = 25;
+
+    /**
+     * @param maxChainLength the most unconfirmed transactions, the new one included, that a
+     * transaction funded from the pool may hang from
+     */
+    explicit UtxoPool(int maxChainLength = DEFAULT_MAX_CHAIN_LENGTH);
+
+    void add(const PoolCoin & coin);
+
+    /**
+     * Lend out the smallest coin worth at least 'minimum', so larger coins are kept for the
+     * transactions that need them. While no coin fits but some are lent out, waits for them to
+     * come back, as their change may fit.
+     * @param minimum the least the coin must be worth
+     * @param coin receives the coin
+     * @return false if no coin fits and none are lent out
+     */
+    bool take(const Amount & minimum, PoolCoin & coin);
+
+    /**
+     * Lend out the largest coin, without waiting
+     * @return false if no coin can be spent now
+     */
+    bool takeLargest(PoolCoin & coin);
+
+    /**
+     * Give back a lent coin that was not spent
+     */
+    void release(const PoolCoin & coin);
+
+    /**
+     * Give back a lent coin that can't be spent before the pool is refreshed: its unconfirmed
+     * ancestors or descendants are too many for bitcoind to take another.
+     */
+    void hold(const PoolCoin & coin);
+
+    /**
+     * Forget a lent coin that no longer exists, such as one whose parent left the mempool
+     */
+    void discard(const PoolCoin & coin);
+
+    /**
+     * Record that a lent coin was spent
+     * @param coin the coin
+     * @param created the outputs of the spending transaction that come back to the pool
+     */
+    void spent(const PoolCoin & coin, const std::vector<PoolCoin> & created);
+
+    /**
+     * @return whether the pool has the coin, lent out or not
+     */
+    bool contains(const PoolCoin & coin) const;
+
+    /**
+     * Bring the pool up to date with the confirmed unspent outputs of the issuer, as found by
+     * scantxoutset. Coins that have confirmed can be chained from again, outputs the pool hasn't
+     * seen are added, and confirmed coins that are gone, spent by someone else, are dropped.
+     * The scan doesn't see the mempool, so outputs already spent by unconfirmed transactions
+     * must be left out by the caller.
+     * @param confirmed the issuer's confirmed unspent outputs
+     */
+    void refresh(const std::vector<PoolCoin> & confirmed);
+
+    /**
+     * @return the number of coins, lent out or not
+     */
+    size_t size() const;
+
+    /**
+     * @return the value of the coins, lent out or not
+     */
+    Amount total() const;
+
+private:
+    int maxChain;
+    mutable std::mutex mutex;
+    std::condition_variable returned;
+
+    std::vector<PoolCoin> available;
+    std::vector<PoolCoin> lent;
+
+    /** must be called with the mutex held */
+    void removeLent(const PoolCoin & coin);
+};
+
+
+#endif //TXREF_UTXOPOOL_H
@@ -0,0 +1,125 @@
+#include "workStealingPool.h"
+
+#include <utility>
+
+namespace {
+    // lets submit() find out if it is being called from one of a pool's workers
+    thread_local const WorkStealingPool * currentPool = nullptr;
+    thread_local size_t currentWorker = 0;
+}
+
+WorkStealingPool::WorkStealingPool(size_t numThreads) : nextQueue(0) {
+    if(numThreads == 0)
+        numThreads = 1;
+
+    for(size_t i = 0; i < numThreads; ++i)
+        queues.emplace_back(new WorkerQueue());
+
+    for(size_t i = 0; i < numThreads; ++i)
+        threads.emplace_back(&WorkStealingPool::run, this, i);
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        allDone.wait(lock, [this] { return unfinished == 0; });
+        stopping = true;
+    }
+    workAvailable.notify_all();
+
+    for(auto & thread : threads)
+        thread.join();
+}
+
+void WorkStealingPool::submit(Task task) {
+    size_t queueIndex = currentPool == this
+            ? currentWorker
+            : nextQueue.fetch_add(1) % queues.size();
+
+    // count the task before it can be taken, so the counts never go below zero
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ++queued;
+        ++unfinished;
+    }
+    {
+        std::lock_guard<std::mutex> lock(queues[queueIndex]->mutex);
+        queues[queueIndex]->tasks.push_back(std::move(task));
+    }
+    workAvailable.notify_one();
+}
+
+void WorkStealingPool::wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    allDone.wait(lock, [this] { return unfinished == 0; });
+
+    if(firstError) {
+        std::exception_ptr error = firstError;
+        firstError = nullptr;
+        std::rethrow_exception(error);
+    }
+}
+
+size_t WorkStealingPool::size() const {
+    return threads.size();
+}
+
+bool WorkStealingPool::popOwn(size_t workerIndex, Task & task) {
+    WorkerQueue & queue = *queues[workerIndex];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if(queue.tasks.empty())
+        return false;
+    task = std::move(queue.tasks.back());
+    queue.tasks.pop_back();
+    return true;
+}
+
+bool WorkStealingPool::steal(size_t workerIndex, Task & task) {
+    for(size_t i = 1; i < queues.size(); ++i) {
+        WorkerQueue & victim = *queues[(workerIndex + i) % queues.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if(!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkStealingPool::run(size_t workerIndex) {
+    currentPool = this;
+    currentWorker = workerIndex;
+
+    for(;;) {
+        Task task;
+        if(popOwn(workerIndex, task) || steal(workerIndex, task)) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                --queued;
+            }
+
+            std::exception_ptr error;
+            try {
+                task(workerIndex);
+            }
+            catch(...) {
+                error = std::current_exception();
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            if(error && !firstError)
+                firstError = error;
+            if(--unfinished == 0)
+                allDone.notify_all();
+            continue;
+        }
+
+        // nothing to run: sleep until something is queued. 'queued' can be briefly non-zero
+        // while a task is being pushed or taken by someone else, in which case we just look again.
+        std::unique_lock<std::mutex> lock(mutex);
+        workAvailable.wait(lock, [this] { return queued > 0 || stopping; });
+        if(stopping && queued == 0)
+            return;
+    }
+}
@@ -0,0 +1,85 @@
+#ifndef TXREF_WORKSTEALINGPOOL_H
+#define TXREF_WORKSTEALINGPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * A fixed-size thread pool where each worker has its own task queue. A worker takes the newest
+ * task from its own queue, and when that is empty, steals the oldest task from another worker.
+ * Tasks submitted from inside a task go to the submitting worker's queue, so related work
+ * stays on one thread (and its caches) unless other workers run out of things to do.
+ */
+class WorkStealingPool {
+
+public:
+    /**
+     * A unit of work. It is given the index of the worker running it, which can be used to
+     * pick per-worker resources (like an RPC connection).
+     */
+    typedef std::function<void(size_t workerIndex)> Task;
+
+    /**
+     * Construct a WorkStealingPool and start its threads
+     * @param numThreads the number of worker threads (at least 1)
+     */
+    explicit WorkStealingPool(size_t numThreads);
+
+    /**
+     * Waits for all submitted tasks, then stops the worker threads
+     */
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool &) = delete;
+    WorkStealingPool & operator=(const WorkStealingPool &) = delete;
+
+    /**
+     * Queue a task. From outside the pool, tasks are spread over the workers' queues in turn.
+     * From inside a task, the task goes to the current worker's queue.
+     * @param task the task to run
+     */
+    void submit(Task task);
+
+    /**
+     * Block until every submitted task (including tasks submitted by tasks) has finished. If
+     * any task threw, the first exception is rethrown here.
+     */
+    void wait();
+
+    /**
+     * @return the number of worker threads
+     */
+    size_t size() const;
+
+private:
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    bool popOwn(size_t workerIndex, Task & task);
+    bool steal(size_t workerIndex, Task & task);
+    void run(size_t workerIndex);
+
+    std::vector<std::unique_ptr<WorkerQueue>> queues;
+    std::vector<std::thread> threads;
+    std::atomic<size_t> nextQueue;
+
+    std::mutex mutex;
+    std::condition_variable workAvailable;
+    std::condition_variable allDone;
+    size_t queued = 0;      // tasks sitting in a queue
+    size_t unfinished = 0;  // tasks submitted but not yet finished
+    bool stopping = false;
+    std::exception_ptr firstError;
+};
+
+
+#endif //TXREF_WORKSTEALINGPOOL_H
@@ -0,0 +1,82 @@
+#ifndef BTCR_DID_COUNTING_BITCOINRPCFACADE_H
+#define BTCR_DID_COUNTING_BITCOINRPCFACADE_H
+
+#include <atomic>
+#include <map>
+#include <string>
+#include <bitcoinapi/bitcoinapi.h>
+#include "../src/bitcoinRPCFacade.h"
+
+/**
+ * A fake BitcoinRPCFacade that knows about two testnet blocks, 1355601 and 1355603, each
+ * holding 1100 made-up transactions with two outputs. Every output is unspent. It counts how
+ * many times each kind of call reaches it, and may be called from more than one thread.
+ */
+class Counting_BitcoinRPCFacade : public BitcoinRPCFacade {
+public:
+    mutable std::atomic<int> getblockCalls{0};
+    mutable std::atomic<int> getblockhashCalls{0};
+    mutable std::atomic<int> getrawtransactionCalls{0};
+
+    static std::string blockHashFor(int height) {
+        return std::string(57, '0') + std::to_string(height);
+    }
+
+    static std::string txidFor(int height, size_t position) {
+        std::string s = std::to_string(height) + "f" + std::to_string(position);
+        return std::string(64 - s.size(), 'a') + s;
+    }
+
+    Counting_BitcoinRPCFacade() {
+        heights[blockHashFor(1355601)] = 1355601;
+        heights[blockHashFor(1355603)] = 1355603;
+    }
+
+    blockchaininfo_t getblockchaininfo() const override {
+        blockchaininfo_t info;
+        info.chain = "test";
+        return info;
+    }
+
+    std::string getblockhash(int height) const override {
+        ++getblockhashCalls;
+        return blockHashFor(height);
+    }
+
+    blockinfo_t getblock(const std::string & hash) const override {
+        ++getblockCalls;
+        auto found = heights.find(hash);
+        if(found == heights.end())
+            throw BitcoinException(-5, "Block not found");
+        blockinfo_t blockInfo;
+        blockInfo.hash = hash;
+        blockInfo.height = found->second;
+        blockInfo.confirmations = 100;
+        for(size_t i = 0; i < 1100; ++i)
+            blockInfo.tx.push_back(txidFor(found->second, i));
+        return blockInfo;
+    }
+
+    getrawtransaction_t getrawtransaction(const std::string & txid, int) const override {
+        ++getrawtransactionCalls;
+        size_t start = txid.find_first_not_of('a');
+        getrawtransaction_t rawTransaction;
+        rawTransaction.hex = "00";
+        rawTransaction.blockhash = blockHashFor(std::stoi(txid.substr(start, txid.find('f', start) - start)));
+        rawTransaction.vout.resize(2);
+        return rawTransaction;
+    }
+
+    utxoinfo_t gettxout(const std::string &, int) const override {
+        utxoinfo_t utxoinfo;
+        utxoinfo.bestblock = blockHashFor(1355700);
+        utxoinfo.confirmations = 10;
+        return utxoinfo;
+    }
+
+private:
+    std::map<std::string, int> heights;
+};
+
+
+#endif //BTCR_DID_COUNTING_BITCOINRPCFACADE_H
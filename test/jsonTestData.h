@@ -166,7 +166,7 @@ static const char get_tx_data_opreturn_at_1[] =
         "        \"script\" : \"OP_RETURN 68747470733a2f2f7261772e67697468756275736572636f6e74656e742e636f6d2f64616e706170652f73656c662f6d61737465722f64646f2d6578742e302e6a736f6e6c64\"\n"
         "      }\n"
         "    ],\n"
-        "    \"tx_hex\" : \"0200000001e9705d192c911ce3dc5a00a9654bdb7829bacb37805df9876d2c7424e5eab8e6010000006a47304402205219fbc57b4806246fb57e9a7b582d4369f1292bd2f2348f8d2272b9bb923ad7022076f01bbdfd697c840865a7a9ce540a3927f4819cb6dfaaefdaa4f63c3330582e0121034e85ac999dd799a3e5d0149a240ad79472af9e8040bb77e0eae908661974dff6ffffffff020000000000000000486a4668747470733a2f2f7261772e67697468756275736572636f6e74656e742e636f6d2f64616e706170652f73656c662f6d61737465722f64646f2d6578742e302e6a736f6e6c64f00edf03000000001976a914143f1c03a4c256a88a2334130a05ff38fc3e8f8488ac00000000\",\n"
+        "    \"tx_hex\" : \"0200000001e9705d192c911ce3dc5a00a9654bdb7829bacb37805df9876d2c7424e5eab8e6010000006a47304402205219fbc57b4806246fb57e9a7b582d4369f1292bd2f2348f8d2272b9bb923ad7022076f01bbdfd697c840865a7a9ce540a3927f4819cb6dfaaefdaa4f63c3330582e0121034e85ac999dd799a3e5d0149a240ad79472af9e8040bb77e0eae908661974dff6ffffffff02f00edf03000000001976a914143f1c03a4c256a88a2334130a05ff38fc3e8f8488ac0000000000000000486a4668747470733a2f2f7261772e67697468756275736572636f6e74656e742e636f6d2f64616e706170652f73656c662f6d61737465722f64646f2d6578742e302e6a736f6e6c6400000000\",\n"
         "    \"size\" : 272,\n"
         "    \"version\" : 2,\n"
         "    \"locktime\" : 0\n"
@@ -25,6 +25,26 @@ public:
                        std::string(const std::string& rawTx, const std::vector<signrawtxinext_t> & inputs, const std::vector<std::string>& privkeys, const std::string& sighashtype));
     MOCK_CONST_METHOD0(getblockchaininfo,
             blockchaininfo_t());
+    MOCK_CONST_METHOD1(getrawblock,
+            std::string(const std::string& blockhash));
+    MOCK_CONST_METHOD2(getrawtransactioninblock,
+            std::string(const std::string& txid, const std::string& blockhash));
+    MOCK_CONST_METHOD1(getblockheader,
+            blockheader_t(const std::string& blockhash));
+    MOCK_CONST_METHOD1(getrawblockheader,
+            std::string(const std::string& blockhash));
+    MOCK_CONST_METHOD2(gettxoutproof,
+            std::string(const std::vector<std::string>& txids, const std::string& blockhash));
+    MOCK_CONST_METHOD1(testmempoolaccept,
+            mempoolacceptance_t(const std::string& hexString));
+    MOCK_CONST_METHOD1(scantxoutset,
+            std::vector<scannedutxo_t>(const std::vector<std::string>& descriptors));
+    MOCK_CONST_METHOD0(getrawmempool,
+            std::vector<std::string>());
+    MOCK_CONST_METHOD1(gettxspendingprevout,
+            std::vector<prevoutspending_t>(const std::vector<txout_t>& outputs));
+    MOCK_CONST_METHOD2(waitforblockheight,
+            blocktip_t(int height, int timeoutMs));
     virtual ~MockBitcoinRPCFacade();
 };
 
@@ -0,0 +1,111 @@
+#include <gtest/gtest.h>
+
+#include "base58.cpp"
+#include "address.cpp"
+#include "hex.h"
+
+namespace {
+
+    std::string scriptHex(const std::string & address, const std::string & chain) {
+        Result<Address> decoded = decodeAddress(address, chain);
+        EXPECT_TRUE(decoded) << decoded.error();
+        if(!decoded)
+            return "";
+        return hex::encode(decoded.value().scriptPubKey.data(), decoded.value().scriptPubKey.size());
+    }
+
+    std::vector<uint8_t> fromHex(const std::string & text) {
+        std::vector<uint8_t> bytes;
+        hex::decode(text, bytes);
+        return bytes;
+    }
+}
+
+
+TEST(Base58Test, round_trips_with_checksum) {
+    std::vector<uint8_t> genesis = fromHex("0062e907b15cbf27d5425399ebf6f0fb50ebb88f18");
+    EXPECT_EQ(base58::encodeCheck(genesis), "1A1zP1eP5QGefi2DMPTfTL5SLmv7DivfNa");
+    EXPECT_EQ(base58::decodeCheck("1A1zP1eP5QGefi2DMPTfTL5SLmv7DivfNa").value(), genesis);
+
+    // leading zero bytes become leading '1's
+    std::vector<uint8_t> zeros = fromHex("000000ff");
+    EXPECT_EQ(base58::decodeCheck(base58::encodeCheck(zeros)).value(), zeros);
+}
+
+TEST(Base58Test, rejects_bad_strings) {
+    EXPECT_FALSE(base58::decodeCheck("1A1zP1eP5QGefi2DMPTfTL5SLmv7DivfNb"));    // checksum
+    EXPECT_FALSE(base58::decodeCheck("1A1zP1eP5QGefi2DMPTfTL5SLmv7Divf0a"));    // '0' is not base58
+    EXPECT_FALSE(base58::decodeCheck("1"));
+    EXPECT_FALSE(base58::decodeCheck(""));
+}
+
+TEST(AddressTest, decodes_legacy_addresses) {
+    EXPECT_EQ(scriptHex("1A1zP1eP5QGefi2DMPTfTL5SLmv7DivfNa", "main"),
+              "76a91462e907b15cbf27d5425399ebf6f0fb50ebb88f1888ac");
+
+    std::vector<uint8_t> hash = fromHex("62e907b15cbf27d5425399ebf6f0fb50ebb88f18");
+    std::vector<uint8_t> payload{0xc4};
+    payload.insert(payload.end(), hash.begin(), hash.end());
+    std::string testnetP2sh = base58::encodeCheck(payload);
+    EXPECT_EQ(testnetP2sh[0], '2');
+
+    Result<Address> address = decodeAddress(testnetP2sh, "test");
+    ASSERT_TRUE(address);
+    EXPECT_EQ(address.value().type, AddressType::p2sh);
+    EXPECT_EQ(address.value().program, hash);
+    EXPECT_EQ(scriptHex(testnetP2sh, "regtest"), "a91462e907b15cbf27d5425399ebf6f0fb50ebb88f1887");
+}
+
+TEST(AddressTest, decodes_segwit_addresses) {
+    // from BIP 173 and BIP 350
+    EXPECT_EQ(scriptHex("BC1QW508D6QEJXTDG4Y5R3ZARVARY0C5XW7KV8F3T4", "main"),
+              "0014751e76e8199196d454941c45d1b3a323f1433bd6");
+    EXPECT_EQ(scriptHex("tb1qrp33g0q5c5txsp9arysrx4k6zdkfs4nce4xj0gdcccefvpysxf3q0sl5k7", "test"),
+              "00201863143c14c5166804bd19203356da136c985678cd4d27a1b8c6329604903262");
+    EXPECT_EQ(scriptHex("bc1p0xlxvlhemja6c4dqv22uapctqupfhlxm9h8z3k2e72q4k9hcz7vqzk5jj0", "main"),
+              "512079be667ef9dcbbac55a06295ce870b07029bfcdb2dce28d959f2815b16f81798");
+    EXPECT_EQ(scriptHex("tb1pqqqqp399et2xygdj5xreqhjjvcmzhxw4aywxecjdzew6hylgvsesf3hn0c", "signet"),
+              "5120000000c4a5cad46221b2a187905e5266362b99d5e91c6ce24d165dab93e86433");
+
+    EXPECT_EQ(decodeAddress("bc1qw508d6qejxtdg4y5r3zarvary0c5xw7kv8f3t4", "main").value().type, AddressType::p2wpkh);
+    EXPECT_EQ(decodeAddress("bc1p0xlxvlhemja6c4dqv22uapctqupfhlxm9h8z3k2e72q4k9hcz7vqzk5jj0", "main").value().type,
+              AddressType::p2tr);
+}
+
+TEST(AddressTest, rejects_invalid_addresses) {
+    // bad checksum
+    EXPECT_FALSE(decodeAddress("bc1qw508d6qejxtdg4y5r3zarvary0c5xw7kv8f3t5", "main"));
+    // mixed case
+    EXPECT_FALSE(decodeAddress("bc1qw508d6qejxtdg4y5r3zarvary0c5xw7kV8F3T4", "main"));
+    // witness version 1 with a bech32 (not bech32m) checksum, valid before BIP 350
+    EXPECT_FALSE(decodeAddress("bc1pw508d6qejxtdg4y5r3zarvary0c5xw7kw508d6qejxtdg4y5r3zarvary0c5xw7k7grplx", "main"));
+    // witness version 0 with a bech32m checksum
+    EXPECT_FALSE(decodeAddress("bc1qw508d6qejxtdg4y5r3zarvary0c5xw7kemeawh", "main"));
+    // invalid program length for version 0
+    EXPECT_FALSE(decodeAddress("BC1QR508D6QEJXTDG4Y5R3ZARVARYV98GJ9P", "main"));
+    EXPECT_FALSE(decodeAddress("not an address", "main"));
+    EXPECT_FALSE(decodeAddress("1A1zP1eP5QGefi2DMPTfTL5SLmv7DivfNa", "nonesuch"));
+}
+
+TEST(AddressTest, rejects_addresses_for_another_chain) {
+    Result<Address> address = decodeAddress("1A1zP1eP5QGefi2DMPTfTL5SLmv7DivfNa", "test");
+    ASSERT_FALSE(address);
+    EXPECT_EQ(address.error(), "Address '1A1zP1eP5QGefi2DMPTfTL5SLmv7DivfNa' is not for the test chain");
+
+    EXPECT_FALSE(decodeAddress("bc1qw508d6qejxtdg4y5r3zarvary0c5xw7kv8f3t4", "regtest"));
+    EXPECT_FALSE(decodeAddress("tb1qrp33g0q5c5txsp9arysrx4k6zdkfs4nce4xj0gdcccefvpysxf3q0sl5k7", "main"));
+}
+
+TEST(AddressTest, recognizes_scripts) {
+    for(const char * address : {"1A1zP1eP5QGefi2DMPTfTL5SLmv7DivfNa",
+                                "bc1qw508d6qejxtdg4y5r3zarvary0c5xw7kv8f3t4",
+                                "bc1p0xlxvlhemja6c4dqv22uapctqupfhlxm9h8z3k2e72q4k9hcz7vqzk5jj0"}) {
+        Address decoded = decodeAddress(address, "main").value();
+        Result<AddressType> type = scriptType(decoded.scriptPubKey.data(), decoded.scriptPubKey.size());
+        ASSERT_TRUE(type) << address;
+        EXPECT_EQ(type.value(), decoded.type) << address;
+    }
+
+    std::vector<uint8_t> opReturn = fromHex("6a0401020304");
+    EXPECT_FALSE(scriptType(opReturn.data(), opReturn.size()));
+}
@@ -0,0 +1,89 @@
+#include <gtest/gtest.h>
+
+#include "amount.h"
+
+#include <limits>
+
+
+TEST(AmountTest, parses_exactly) {
+    EXPECT_EQ(Amount::parse("1").value().satoshis(), 100000000);
+    EXPECT_EQ(Amount::parse("0.1").value().satoshis(), 10000000);
+    EXPECT_EQ(Amount::parse("12.34567").value().satoshis(), 1234567000);
+    EXPECT_EQ(Amount::parse("0.00000001").value().satoshis(), 1);
+    EXPECT_EQ(Amount::parse("0.01164026").value().satoshis(), 1164026);
+    EXPECT_EQ(Amount::parse(".5").value().satoshis(), 50000000);
+    EXPECT_EQ(Amount::parse("2.").value().satoshis(), 200000000);
+    EXPECT_EQ(Amount::parse("-0.001").value().satoshis(), -100000);
+    EXPECT_EQ(Amount::parse("21000000").value(), Amount::fromSatoshis(Amount::MAX_MONEY));
+
+    // 0.1 + 0.2 is exactly 0.3 here, unlike with doubles
+    EXPECT_EQ(Amount::parse("0.1").value() + Amount::parse("0.2").value(), Amount::parse("0.3").value());
+}
+
+TEST(AmountTest, rejects_what_is_not_an_amount) {
+    for(const char * text : {"", "-", ".", "abc", "1.2.3", "1e-5", "+1", " 1", "1 ", "0x10", "1,5"}) {
+        Result<Amount> amount = Amount::parse(text);
+        EXPECT_FALSE(amount) << text;
+        EXPECT_NE(amount.error().find("is not a number of BTC"), std::string::npos) << text;
+    }
+
+    Result<Amount> tooPrecise = Amount::parse("0.000000001");
+    ASSERT_FALSE(tooPrecise);
+    EXPECT_EQ(tooPrecise.error(), "Amount '0.000000001' has more than 8 decimal places");
+
+    EXPECT_FALSE(Amount::parse("21000000.00000001"));
+    EXPECT_FALSE(Amount::parse("-21000001"));
+    EXPECT_FALSE(Amount::parse("99999999999999999999999"));
+}
+
+TEST(AmountTest, formats_with_all_decimals) {
+    EXPECT_EQ(Amount::fromSatoshis(0).toString(), "0.00000000");
+    EXPECT_EQ(Amount::fromSatoshis(1).toString(), "0.00000001");
+    EXPECT_EQ(Amount::fromSatoshis(1154000).toString(), "0.01154000");
+    EXPECT_EQ(Amount::fromSatoshis(100000000).toString(), "1.00000000");
+    EXPECT_EQ(Amount::fromSatoshis(-123456789).toString(), "-1.23456789");
+    EXPECT_EQ(Amount::fromSatoshis(Amount::MAX_MONEY).toString(), "21000000.00000000");
+    EXPECT_EQ(Amount::fromSatoshis(std::numeric_limits<int64_t>::min()).toString(), "-92233720368.54775808");
+}
+
+TEST(AmountTest, formats_into_a_caller_buffer) {
+    char buffer[Amount::MAX_CHARS];
+    Amount amount = Amount::fromSatoshis(1164026);
+
+    char * end = amount.format(buffer, buffer + sizeof(buffer));
+    ASSERT_NE(end, nullptr);
+    EXPECT_EQ(std::string(buffer, end), "0.01164026");
+
+    // exactly enough room, then one short
+    EXPECT_EQ(amount.format(buffer, buffer + 10), buffer + 10);
+    EXPECT_EQ(amount.format(buffer, buffer + 9), nullptr);
+}
+
+TEST(AmountTest, round_trips) {
+    for(int64_t satoshis : {int64_t(0), int64_t(1), int64_t(99999999), int64_t(100000001), int64_t(-5), Amount::MAX_MONEY}) {
+        Amount amount = Amount::fromSatoshis(satoshis);
+        EXPECT_EQ(Amount::parse(amount.toString()).value(), amount);
+    }
+}
+
+TEST(AmountTest, from_btc_rounds_to_the_nearest_satoshi) {
+    EXPECT_EQ(Amount::fromBtc(0.1 + 0.2).satoshis(), 30000000);
+    EXPECT_EQ(Amount::fromBtc(0.01164026).satoshis(), 1164026);
+    EXPECT_EQ(Amount::fromBtc(-0.00000001).satoshis(), -1);
+    EXPECT_EQ(Amount::fromBtc(20999999.99999999).satoshis(), Amount::MAX_MONEY - 1);
+}
+
+TEST(AmountTest, arithmetic_and_comparison) {
+    Amount a = Amount::fromSatoshis(1000);
+    Amount b = Amount::fromSatoshis(300);
+    EXPECT_EQ((a - b).satoshis(), 700);
+    EXPECT_EQ((-a).satoshis(), -1000);
+    a -= b;
+    a += b;
+    EXPECT_EQ(a.satoshis(), 1000);
+    EXPECT_TRUE(b < a);
+    EXPECT_TRUE(a > b);
+    EXPECT_TRUE(b <= b);
+    EXPECT_TRUE(a != b);
+    EXPECT_EQ(Amount().satoshis(), 0);
+}
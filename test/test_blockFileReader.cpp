@@ -0,0 +1,343 @@
+#include <gtest/gtest.h>
+
+#include "block.cpp"
+#include "blockFileReader.cpp"
+#include "mappedFile.cpp"
+#include "hex.h"
+
+#include <cstdlib>
+#include <fstream>
+
+namespace {
+
+    const char GENESIS_BLOCK_HEX[] =
+            "0100000000000000000000000000000000000000000000000000000000000000000000003ba3edfd7a7b12b27ac72c3e"
+            "67768f617fc81bc3888a51323a9fb8aa4b1e5e4a29ab5f49ffff001d1dac2b7c01010000000100000000000000000000"
+            "00000000000000000000000000000000000000000000ffffffff4d04ffff001d0104455468652054696d65732030332f"
+            "4a616e2f32303039204368616e63656c6c6f72206f6e206272696e6b206f66207365636f6e64206261696c6f75742066"
+            "6f722062616e6b73ffffffff0100f2052a01000000434104678afdb0fe5548271967f1a67130b7105cd6a828e03909a6"
+            "7962e0ea1f61deb649f6bc3f4cef38c4f35504e51ec112de5c384df7ba0b8d578a4c702b6bf11d5fac00000000";
+
+    const uint8_t REGTEST_MAGIC[] = {0xfa, 0xbf, 0xb5, 0xda};
+
+    void appendLE32(std::vector<uint8_t> & out, uint32_t value) {
+        for(int i = 0; i < 4; ++i)
+            out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+
+    /**
+     * A coinbase-like transaction, made unique by 'tag'
+     */
+    std::vector<uint8_t> taggedTransaction(uint32_t tag) {
+        std::vector<uint8_t> tx;
+        appendLE32(tx, 1);
+        tx.push_back(1);
+        tx.insert(tx.end(), 32, 0);
+        appendLE32(tx, 0xffffffff);
+        tx.push_back(5);
+        tx.push_back(4);
+        appendLE32(tx, tag);
+        appendLE32(tx, 0xffffffff);
+        tx.push_back(1);
+        tx.insert(tx.end(), {0x00, 0xf2, 0x05, 0x2a, 0x01, 0x00, 0x00, 0x00});
+        tx.push_back(1);
+        tx.push_back(0x51);
+        appendLE32(tx, 0);
+        return tx;
+    }
+
+    /**
+     * A segwit transaction spending output 'tag' of some earlier transaction. 'stripped'
+     * receives it without the witness data.
+     */
+    std::vector<uint8_t> segwitTransaction(uint32_t tag, std::vector<uint8_t> & stripped) {
+        std::vector<uint8_t> inputsAndOutputs;
+        inputsAndOutputs.push_back(1);
+        inputsAndOutputs.insert(inputsAndOutputs.end(), 32, 0x11);
+        appendLE32(inputsAndOutputs, tag);
+        inputsAndOutputs.push_back(0);
+        appendLE32(inputsAndOutputs, 0xfffffffd);
+        inputsAndOutputs.push_back(1);
+        inputsAndOutputs.insert(inputsAndOutputs.end(), {0xa0, 0x86, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00});
+        inputsAndOutputs.push_back(2);
+        inputsAndOutputs.insert(inputsAndOutputs.end(), {0x51, 0x51});
+
+        std::vector<uint8_t> tx;
+        appendLE32(tx, 2);
+        tx.insert(tx.end(), {0x00, 0x01});
+        tx.insert(tx.end(), inputsAndOutputs.begin(), inputsAndOutputs.end());
+        tx.insert(tx.end(), {0x01, 0x03, 0xaa, 0xbb, 0xcc});
+        appendLE32(tx, 0);
+
+        stripped.clear();
+        appendLE32(stripped, 2);
+        stripped.insert(stripped.end(), inputsAndOutputs.begin(), inputsAndOutputs.end());
+        appendLE32(stripped, 0);
+        return tx;
+    }
+
+    /**
+     * A regtest block after 'prev', with a tagged transaction and optionally a segwit one
+     */
+    std::vector<uint8_t> makeBlock(const Hash256 & prev, uint32_t tag, bool withSegwit = false) {
+        std::vector<std::vector<uint8_t>> txs {taggedTransaction(tag)};
+        std::vector<uint8_t> txids(32);
+        sha256::doubleHash(txs[0].data(), txs[0].size(), txids.data());
+        if(withSegwit) {
+            std::vector<uint8_t> stripped;
+            txs.push_back(segwitTransaction(tag, stripped));
+            txids.resize(64);
+            sha256::doubleHash(stripped.data(), stripped.size(), &txids[32]);
+        }
+        Hash256 merkleRoot;
+        merkle::root(txids.data(), txs.size(), merkleRoot.data());
+
+        std::vector<uint8_t> block;
+        appendLE32(block, 4);
+        block.insert(block.end(), prev.begin(), prev.end());
+        block.insert(block.end(), merkleRoot.begin(), merkleRoot.end());
+        appendLE32(block, 1600000000 + tag);
+        appendLE32(block, 0x207fffff);
+        appendLE32(block, tag);
+        block.push_back(static_cast<uint8_t>(txs.size()));
+        for(const std::vector<uint8_t> & tx : txs)
+            block.insert(block.end(), tx.begin(), tx.end());
+        return block;
+    }
+
+    Hash256 hashOf(const std::vector<uint8_t> & block) {
+        return BlockHeader::parse(block.data()).hash;
+    }
+
+    /**
+     * A directory laid out like bitcoind's blocks directory, removed afterwards
+     */
+    class BlocksDir {
+    public:
+        BlocksDir() {
+            char pattern[] = "/tmp/btcrBlocksXXXXXX";
+            path = ::mkdtemp(pattern);
+        }
+
+        ~BlocksDir() {
+            for(const std::string & file : written)
+                std::remove(file.c_str());
+            ::rmdir(path.c_str());
+        }
+
+        /**
+         * Write a block file holding these records. 'extra' goes after them, as garbage or
+         * preallocated zeros.
+         */
+        void writeFile(size_t number, const std::vector<std::vector<uint8_t>> & blocks,
+                       const std::vector<uint8_t> & extra = std::vector<uint8_t>()) {
+            std::vector<uint8_t> contents;
+            for(const std::vector<uint8_t> & block : blocks) {
+                contents.insert(contents.end(), REGTEST_MAGIC, REGTEST_MAGIC + 4);
+                appendLE32(contents, static_cast<uint32_t>(block.size()));
+                contents.insert(contents.end(), block.begin(), block.end());
+            }
+            contents.insert(contents.end(), extra.begin(), extra.end());
+            for(size_t i = 0; i < contents.size(); ++i)
+                contents[i] ^= key[i % 8];
+            write(blockFileName(path, number), contents);
+        }
+
+        void obfuscate(const std::vector<uint8_t> & xorKey) {
+            key = xorKey;
+            write(path + "/xor.dat", key);
+        }
+
+        std::string path;
+
+    private:
+        std::vector<uint8_t> key = std::vector<uint8_t>(8, 0);
+        std::vector<std::string> written;
+
+        void write(const std::string & file, const std::vector<uint8_t> & contents) {
+            std::ofstream out(file, std::ios::binary);
+            out.write(reinterpret_cast<const char *>(contents.data()), static_cast<std::streamsize>(contents.size()));
+            written.push_back(file);
+        }
+    };
+
+    /**
+     * A chain of 'length' regtest blocks, tagged from 'firstTag', after 'prev'
+     */
+    std::vector<std::vector<uint8_t>> makeChain(Hash256 prev, uint32_t firstTag, size_t length) {
+        std::vector<std::vector<uint8_t>> chain;
+        for(size_t i = 0; i < length; ++i) {
+            chain.push_back(makeBlock(prev, firstTag + static_cast<uint32_t>(i), i % 2 == 1));
+            prev = hashOf(chain.back());
+        }
+        return chain;
+    }
+
+    std::vector<std::string> visitedHashes(const BlockFileReader & reader) {
+        std::vector<std::string> hashes;
+        reader.forEachBlock(0, reader.tipHeight(), [&](int height, const Block & block) {
+            EXPECT_EQ(static_cast<size_t>(height), hashes.size());
+            EXPECT_TRUE(block.hasValidMerkleRoot(block.txids()));
+            hashes.push_back(hex::encodeHash(block.header().hash.data()));
+        });
+        return hashes;
+    }
+
+    std::vector<std::string> displayedHashes(const std::vector<std::vector<uint8_t>> & blocks) {
+        std::vector<std::string> hashes;
+        for(const std::vector<uint8_t> & block : blocks)
+            hashes.push_back(hex::encodeHash(hashOf(block).data()));
+        return hashes;
+    }
+}
+
+
+TEST(BlockTest, parses_genesis_block) {
+    std::vector<uint8_t> bytes;
+    ASSERT_TRUE(hex::decode(GENESIS_BLOCK_HEX, bytes));
+
+    Result<Block> block = Block::parse(bytes.data(), bytes.size());
+    ASSERT_TRUE(block.ok()) << block.error();
+    EXPECT_EQ(hex::encodeHash(block.value().header().hash.data()), "000000000019d6689c085ae165831e934ff763ae46a2a6c172b3f1b60a8ce26f");
+    EXPECT_EQ(block.value().header().bits, 0x1d00ffffu);
+    ASSERT_EQ(block.value().transactions().size(), 1u);
+
+    std::vector<Hash256> txids = block.value().txids();
+    EXPECT_EQ(hex::encodeHash(txids[0].data()), "4a5e1e4baab89f3a32518a88c31bc87f618f76673e2cc77ab2127b7afdeda33b");
+    EXPECT_TRUE(block.value().hasValidMerkleRoot(txids));
+}
+
+TEST(BlockTest, txids_leave_out_witness_data) {
+    std::vector<uint8_t> bytes = makeBlock(Hash256(), 7, true);
+
+    Result<Block> block = Block::parse(bytes.data(), bytes.size());
+    ASSERT_TRUE(block.ok()) << block.error();
+    ASSERT_EQ(block.value().transactions().size(), 2u);
+    EXPECT_TRUE(block.value().transactions()[1].hasWitness());
+
+    std::vector<Hash256> txids = block.value().txids();
+    EXPECT_EQ(txids[0], block.value().transactions()[0].txid());
+    EXPECT_EQ(txids[1], block.value().transactions()[1].txid());
+    EXPECT_TRUE(block.value().hasValidMerkleRoot(txids));
+}
+
+TEST(BlockTest, rejects_truncated_block) {
+    std::vector<uint8_t> bytes = makeBlock(Hash256(), 7, true);
+    for(size_t len = 0; len < bytes.size(); ++len)
+        ASSERT_FALSE(Block::parse(bytes.data(), len).ok()) << "length " << len;
+}
+
+TEST(BlockTest, checks_proof_of_work) {
+    std::vector<uint8_t> bytes;
+    ASSERT_TRUE(hex::decode(GENESIS_BLOCK_HEX, bytes));
+    EXPECT_TRUE(BlockHeader::parse(bytes.data()).meetsTarget());
+
+    // bits are bytes 72 to 75; a target 256 times smaller, then a negative one
+    bytes[75] = 0x1c;
+    EXPECT_FALSE(BlockHeader::parse(bytes.data()).meetsTarget());
+    bytes[75] = 0x1d;
+    bytes[74] = 0x80;
+    EXPECT_FALSE(BlockHeader::parse(bytes.data()).meetsTarget());
+}
+
+TEST(MerkleBlockTest, parses_a_proof_of_the_genesis_coinbase) {
+    std::vector<uint8_t> block;
+    ASSERT_TRUE(hex::decode(GENESIS_BLOCK_HEX, block));
+    std::vector<uint8_t> bytes(block.begin(), block.begin() + BlockHeader::SIZE);
+    appendLE32(bytes, 1);
+    bytes.push_back(1);
+    // the coinbase txid, in internal byte order, as the header's merkle root
+    bytes.insert(bytes.end(), block.begin() + 36, block.begin() + 68);
+    bytes.push_back(1);
+    bytes.push_back(0x01);
+
+    Result<MerkleBlock> merkleBlock = MerkleBlock::parse(bytes.data(), bytes.size());
+    ASSERT_TRUE(merkleBlock.ok()) << merkleBlock.error();
+    EXPECT_EQ(merkleBlock.value().numTransactions, 1u);
+    ASSERT_EQ(merkleBlock.value().matches.size(), 1u);
+    EXPECT_EQ(merkleBlock.value().matches[0].first, 0u);
+    EXPECT_EQ(hex::encodeHash(merkleBlock.value().matches[0].second.data()), "4a5e1e4baab89f3a32518a88c31bc87f618f76673e2cc77ab2127b7afdeda33b");
+
+    std::vector<uint8_t> wrongHash = bytes;
+    wrongHash[BlockHeader::SIZE + 5] ^= 1;
+    EXPECT_FALSE(MerkleBlock::parse(wrongHash.data(), wrongHash.size()).ok());
+
+    std::vector<uint8_t> extraFlags = bytes;
+    extraFlags[extraFlags.size() - 2] = 2;
+    extraFlags.push_back(0xff);
+    EXPECT_FALSE(MerkleBlock::parse(extraFlags.data(), extraFlags.size()).ok());
+
+    for(size_t len = 0; len < bytes.size(); ++len)
+        ASSERT_FALSE(MerkleBlock::parse(bytes.data(), len).ok()) << "length " << len;
+}
+
+TEST(BlockFileReaderTest, follows_best_chain_across_files) {
+    std::vector<std::vector<uint8_t>> chain = makeChain(Hash256(), 100, 5);
+    // a stale block off the second one
+    std::vector<uint8_t> stale = makeBlock(hashOf(chain[1]), 200);
+
+    // blocks are stored as they arrived, not in chain order
+    BlocksDir dir;
+    dir.writeFile(0, {chain[2], chain[0], stale}, std::vector<uint8_t>(1000, 0));
+    dir.writeFile(1, {chain[4], chain[1], chain[3]});
+
+    BlockFileReader reader(dir.path, "regtest");
+    ASSERT_EQ(reader.tipHeight(), 4);
+    EXPECT_EQ(reader.blockHash(2), hashOf(chain[2]));
+    EXPECT_EQ(visitedHashes(reader), displayedHashes(chain));
+}
+
+TEST(BlockFileReaderTest, chooses_fork_with_most_work) {
+    std::vector<std::vector<uint8_t>> chain = makeChain(Hash256(), 100, 3);
+    std::vector<std::vector<uint8_t>> fork = makeChain(hashOf(chain[0]), 300, 4);
+
+    BlocksDir dir;
+    dir.writeFile(0, {chain[0], chain[1], chain[2], fork[0], fork[1], fork[2], fork[3]});
+
+    BlockFileReader reader(dir.path, "regtest");
+    ASSERT_EQ(reader.tipHeight(), 4);
+
+    std::vector<std::vector<uint8_t>> expected {chain[0]};
+    expected.insert(expected.end(), fork.begin(), fork.end());
+    EXPECT_EQ(visitedHashes(reader), displayedHashes(expected));
+}
+
+TEST(BlockFileReaderTest, reads_obfuscated_files) {
+    std::vector<std::vector<uint8_t>> chain = makeChain(Hash256(), 100, 4);
+
+    BlocksDir dir;
+    dir.obfuscate({0x3c, 0x91, 0x07, 0xe2, 0x55, 0x00, 0xab, 0x18});
+    dir.writeFile(0, {chain[1], chain[0]});
+    dir.writeFile(1, {chain[3], chain[2]});
+
+    BlockFileReader reader(dir.path, "regtest");
+    ASSERT_EQ(reader.tipHeight(), 3);
+    EXPECT_EQ(visitedHashes(reader), displayedHashes(chain));
+}
+
+TEST(BlockFileReaderTest, skips_garbage_and_partly_written_blocks) {
+    std::vector<std::vector<uint8_t>> chain = makeChain(Hash256(), 100, 3);
+
+    // a block cut off when bitcoind stopped
+    std::vector<uint8_t> partial(REGTEST_MAGIC, REGTEST_MAGIC + 4);
+    appendLE32(partial, static_cast<uint32_t>(chain[2].size()));
+    partial.insert(partial.end(), chain[2].begin(), chain[2].begin() + 50);
+
+    BlocksDir dir;
+    dir.writeFile(0, {chain[0]}, std::vector<uint8_t>(20, 0x01));
+    dir.writeFile(1, {chain[1]}, partial);
+
+    BlockFileReader reader(dir.path, "regtest");
+    ASSERT_EQ(reader.tipHeight(), 1);
+    EXPECT_EQ(reader.blockHash(1), hashOf(chain[1]));
+    EXPECT_THROW(reader.blockHash(2), std::out_of_range);
+    EXPECT_THROW(reader.forEachBlock(0, 2, [](int, const Block &) {}), std::out_of_range);
+}
+
+TEST(BlockFileReaderTest, rejects_missing_files_and_unknown_chains) {
+    BlocksDir dir;
+    EXPECT_THROW(BlockFileReader(dir.path, "regtest"), std::runtime_error);
+
+    dir.writeFile(0, makeChain(Hash256(), 100, 1));
+    EXPECT_THROW(BlockFileReader(dir.path, "nonesuch"), std::runtime_error);
+}
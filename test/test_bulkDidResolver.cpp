@@ -0,0 +1,247 @@
+#include <gtest/gtest.h>
+
+#include "forwardingBitcoinRPCFacade.cpp"
+#include "cachingBitcoinRPCFacade.cpp"
+#include "didResolution.cpp"
+#include "bulkDidResolver.cpp"
+#include "mempoolSpends.cpp"
+#include "domain/txid.cpp"
+#include "domain/vout.cpp"
+#include "domain/blockHeight.cpp"
+#include "domain/transactionIndex.cpp"
+#include "domain/txref.cpp"
+#include "domain/txrefDecoder.cpp"
+#include "domain/did.cpp"
+#include "counting_bitcoinRPCFacade.h"
+
+#include <set>
+
+namespace {
+    // DIDs for outputs of testnet blocks 1355601 (tx position 1022) and 1355603 (tx position 692)
+    const char didA[] = "did:btcr:8z4h-jz7l-qpqq-xkh8-xa";
+    const char didB[] = "did:btcr:8x4h-jz54-qpqq-uf26-gj";
+
+    // spends output 3 of 2211...11, and has an OP_RETURN output followed by one a DID would follow
+    const char spendingTxHex[] = "0100000001"
+                                 "1111111111111111111111111111111111111111111111111111111111111122"
+                                 "0300000000ffffffff02"
+                                 "0000000000000000026a00"
+                                 "e80300000000000000"
+                                 "00000000";
+    const std::string spentTxid = "22" + std::string(62, '1');
+}
+
+/**
+ * Every output in the Counting_BitcoinRPCFacade is unspent, so the chain should never be followed
+ */
+class Unused_ChainQuery : public ChainQuery {
+public:
+    UnspentData getUnspentOutputs(const std::string &, int, const std::string &) const override {
+        throw std::runtime_error("not expected");
+    }
+
+    std::string getLastUpdatedTxid(const std::string &, int, const std::string &) const override {
+        throw std::runtime_error("not expected");
+    }
+};
+
+
+TEST(BulkDidResolverTest, plan_groups_by_block_and_merges_duplicates) {
+    std::vector<std::string> dids = {didB, didA, "did:btcr:foo", didA, "DID:BTCR:8X4H-JZ54-QPQQ-UF26-GJ"};
+    std::vector<DidResolution> results;
+
+    BulkPlan plan = BulkDidResolver::plan(dids, results);
+
+    ASSERT_EQ(results.size(), dids.size());
+    EXPECT_FALSE(results[2].ok);
+    EXPECT_EQ(results[2].did, "did:btcr:foo");
+    EXPECT_FALSE(results[2].error.empty());
+
+    ASSERT_EQ(plan.entries.size(), 2u);
+    ASSERT_EQ(plan.groups.size(), 2u);
+    EXPECT_EQ(plan.groups.begin()->first, 1355601);
+    EXPECT_EQ(plan.groups.rbegin()->first, 1355603);
+
+    const BulkPlan::Entry & first = plan.entries[plan.groups.begin()->second.at(0)];
+    EXPECT_EQ(first.did, didA);
+    EXPECT_EQ(first.positions, std::vector<size_t>({1, 3}));
+
+    const BulkPlan::Entry & second = plan.entries[plan.groups.rbegin()->second.at(0)];
+    EXPECT_EQ(second.positions, std::vector<size_t>({0, 4}));
+}
+
+TEST(BulkDidResolverTest, results_are_in_input_order_and_blocks_are_fetched_once) {
+    Counting_BitcoinRPCFacade btc;
+    RpcCache cache;
+    CachingBitcoinRPCFacade cachingBtc(btc, cache);
+    CachingBitcoinRPCFacade cachingPrefetchBtc(btc, cache);
+    Unused_ChainQuery chainQuery;
+
+    BulkDidResolver resolver(cachingBtc, cachingPrefetchBtc, chainQuery);
+    std::vector<std::string> dids = {didB, didA, "did:btcr:foo", didA, didB};
+    std::vector<DidResolution> results = resolver.resolve(dids);
+
+    ASSERT_EQ(results.size(), dids.size());
+    for(size_t i = 0; i < dids.size(); ++i) {
+        EXPECT_EQ(results[i].did, dids[i]);
+        EXPECT_EQ(results[i].ok, i != 2) << results[i].error;
+    }
+    EXPECT_EQ(results[0].blockHeight, 1355603);
+    EXPECT_EQ(results[0].transactionIndex, 692);
+    EXPECT_EQ(results[0].txid, Counting_BitcoinRPCFacade::txidFor(1355603, 692));
+    EXPECT_EQ(results[0].tipTxid, results[0].txid);
+    EXPECT_EQ(results[1].blockHeight, 1355601);
+    EXPECT_EQ(results[1].transactionIndex, 1022);
+    EXPECT_EQ(results[1].network, "test");
+    EXPECT_EQ(results[3].txid, results[1].txid);
+
+    EXPECT_EQ(btc.getblockCalls, 2);
+    EXPECT_EQ(btc.getblockhashCalls, 2);
+}
+
+/**
+ * The same blocks, but the outputs of 'spent' transactions are gone, and 'mempool' is what
+ * getrawmempool and gettxspendingprevout know about
+ */
+class Mempool_BitcoinRPCFacade : public Counting_BitcoinRPCFacade {
+public:
+    getrawtransaction_t getrawtransaction(const std::string & txid, int verbose) const override {
+        if(txid == "gone")
+            throw BitcoinException(-5, "No such mempool or blockchain transaction");
+        auto found = mempool.find(txid);
+        if(found == mempool.end())
+            return Counting_BitcoinRPCFacade::getrawtransaction(txid, verbose);
+        getrawtransaction_t rawTransaction;
+        rawTransaction.hex = found->second;
+        return rawTransaction;
+    }
+
+    utxoinfo_t gettxout(const std::string & txid, int n) const override {
+        if(spent.count(txid) == 0)
+            return Counting_BitcoinRPCFacade::gettxout(txid, n);
+        // nothing: the output has been spent
+        return utxoinfo_t();
+    }
+
+    std::vector<std::string> getrawmempool() const override {
+        std::vector<std::string> txids;
+        for(const auto & tx : mempool)
+            txids.push_back(tx.first);
+        // left the mempool before it could be fetched
+        txids.push_back("gone");
+        return txids;
+    }
+
+    std::vector<prevoutspending_t> gettxspendingprevout(const std::vector<txout_t> & outputs) const override {
+        std::vector<prevoutspending_t> spending;
+        for(const txout_t & output : outputs) {
+            prevoutspending_t s;
+            s.txid = output.txid;
+            s.vout = output.n;
+            if(output.txid == spentTxid && output.n == 3)
+                s.spendingtxid = "pending";
+            spending.push_back(s);
+        }
+        return spending;
+    }
+
+    std::map<std::string, std::string> mempool;
+    std::set<std::string> spent;
+};
+
+/**
+ * Follows every chain to the same tip
+ */
+class FixedTip_ChainQuery : public ChainQuery {
+public:
+    explicit FixedTip_ChainQuery(const std::string & t) : tip(t) {}
+
+    UnspentData getUnspentOutputs(const std::string &, int, const std::string &) const override {
+        throw std::runtime_error("not expected");
+    }
+
+    std::string getLastUpdatedTxid(const std::string &, int, const std::string &) const override {
+        return tip;
+    }
+
+private:
+    std::string tip;
+};
+
+TEST(MempoolSpendsTest, snapshot_indexes_the_outputs_mempool_transactions_spend) {
+    Mempool_BitcoinRPCFacade btc;
+    btc.mempool["pending"] = spendingTxHex;
+    btc.mempool["unreadable"] = "00";
+
+    MempoolSnapshot snapshot = MempoolSnapshot::take(btc);
+    EXPECT_EQ(snapshot.size(), 1u);
+    EXPECT_EQ(snapshot.spender(btc, spentTxid, 3), "pending");
+    EXPECT_EQ(snapshot.spender(btc, spentTxid, 2), "");
+
+    RpcMempoolSpends rpc;
+    EXPECT_EQ(rpc.spender(btc, spentTxid, 3), "pending");
+    EXPECT_EQ(rpc.spender(btc, spentTxid, 0), "");
+}
+
+TEST(MempoolSpendsTest, resolution_reports_a_pending_update) {
+    Mempool_BitcoinRPCFacade btc;
+    Unused_ChainQuery chainQuery;
+    std::string txidA = Counting_BitcoinRPCFacade::txidFor(1355601, 1022);
+    btc.spent.insert(txidA);
+
+    // the DID's own output is spent by a transaction in the mempool: no chain to follow
+    MempoolSnapshot snapshot;
+    snapshot.add(txidA, 1, "pending");
+    DidResolution pending = resolveDid(didA, btc, chainQuery, &snapshot);
+    ASSERT_TRUE(pending.ok) << pending.error;
+    EXPECT_TRUE(pending.mempoolChecked);
+    EXPECT_EQ(pending.tipTxid, txidA);
+    EXPECT_EQ(pending.pendingTxid, "pending");
+
+    DidResolution unspent = resolveDid(didB, btc, chainQuery, &snapshot);
+    ASSERT_TRUE(unspent.ok) << unspent.error;
+    EXPECT_TRUE(unspent.mempoolChecked);
+    EXPECT_TRUE(unspent.pendingTxid.empty());
+
+    DidResolution unchecked = resolveDid(didB, btc, chainQuery);
+    EXPECT_FALSE(unchecked.mempoolChecked);
+}
+
+TEST(MempoolSpendsTest, resolution_checks_the_output_the_tip_is_followed_through) {
+    Mempool_BitcoinRPCFacade btc;
+    btc.spent.insert(Counting_BitcoinRPCFacade::txidFor(1355601, 1022));
+    // the chain ends at a transaction whose first output is an OP_RETURN
+    btc.mempool[spentTxid] = spendingTxHex;
+    FixedTip_ChainQuery chainQuery(spentTxid);
+
+    MempoolSnapshot snapshot;
+    snapshot.add(spentTxid, 0, "wrong output");
+    snapshot.add(spentTxid, 1, "pending");
+    DidResolution resolution = resolveDid(didA, btc, chainQuery, &snapshot);
+    ASSERT_TRUE(resolution.ok) << resolution.error;
+    EXPECT_EQ(resolution.tipTxid, spentTxid);
+    EXPECT_EQ(resolution.pendingTxid, "pending");
+}
+
+TEST(CachingBitcoinRPCFacadeTest, verbose_transaction_answers_non_verbose_request) {
+    Counting_BitcoinRPCFacade btc;
+    RpcCache cache;
+    CachingBitcoinRPCFacade cachingBtc(btc, cache);
+
+    std::string txid = Counting_BitcoinRPCFacade::txidFor(1355601, 3);
+    cachingBtc.getrawtransaction(txid, 1);
+    getrawtransaction_t rawTransaction = cachingBtc.getrawtransaction(txid, 0);
+
+    EXPECT_EQ(rawTransaction.hex, "00");
+    EXPECT_EQ(btc.getrawtransactionCalls, 1);
+}
+
+TEST(CachingBitcoinRPCFacadeTest, errors_are_not_cached) {
+    Counting_BitcoinRPCFacade btc;
+    RpcCache cache;
+    CachingBitcoinRPCFacade cachingBtc(btc, cache);
+
+    EXPECT_THROW(cachingBtc.getblock(Counting_BitcoinRPCFacade::blockHashFor(1)), BitcoinException);
+    EXPECT_THROW(cachingBtc.getblock(Counting_BitcoinRPCFacade::blockHashFor(1)), BitcoinException);
+    EXPECT_EQ(btc.getblockCalls, 2);
+}
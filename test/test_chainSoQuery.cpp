@@ -67,7 +67,7 @@ TEST(ChainSoQueryTest, get_index_zero) {
     d = q.getUnspentOutputs("mr85paFJtFCJyHfyHPeaftU4ytNvNGRSwy", 0, "test");
 
     EXPECT_EQ(d.txid, "2ee994e55b8c71a6f4025a04ebec08aeaffc42c914a9a3646cb3e35489d0e705");
-    EXPECT_EQ(d.amountSatoshis, 16250000);
+    EXPECT_EQ(d.amount.satoshis(), 16250000);
 }
 
 TEST(ChainSoQueryTest, get_index_one) {
@@ -77,7 +77,7 @@ TEST(ChainSoQueryTest, get_index_one) {
     d = q.getUnspentOutputs("mr85paFJtFCJyHfyHPeaftU4ytNvNGRSwy", 1, "test");
 
     EXPECT_EQ(d.txid, "2ee994e55b8c71a6f4025a04ebec08aeaffc42c914a9a3646cb3e35489d0e706");
-    EXPECT_EQ(d.amountSatoshis, 18250000);
+    EXPECT_EQ(d.amount.satoshis(), 18250000);
 
 }
 
@@ -0,0 +1,132 @@
+#include <gtest/gtest.h>
+#include <atomic>
+
+#include "concurrencyLimiter.cpp"
+#include "limitingBitcoinRPCFacade.cpp"
+
+namespace {
+    const std::chrono::milliseconds fast(1);
+
+    /**
+     * Rejects the first 'rejections' calls to getblockhash() as overloaded, then succeeds
+     */
+    class Busy_BitcoinRPCFacade : public BitcoinRPCFacade {
+    public:
+        explicit Busy_BitcoinRPCFacade(int r) : rejections(r) {}
+
+        mutable std::atomic<int> calls{0};
+
+        std::string getblockhash(int) const override {
+            if(++calls <= rejections)
+                throw BitcoinException(-32003, "Work queue depth exceeded");
+            return "hash";
+        }
+
+        blockinfo_t getblock(const std::string &) const override {
+            ++calls;
+            throw BitcoinException(-5, "Block not found");
+        }
+
+    private:
+        const int rejections;
+    };
+}
+
+
+TEST(ConcurrencyLimiterTest, limit_grows_while_saturated_and_fast) {
+    ConcurrencyLimiter::Options options;
+    options.initialLimit = 2;
+    ConcurrencyLimiter limiter(options);
+
+    // two calls at a time, all completing quickly: the limit should grow by about one per
+    // limit's worth of calls
+    for(int i = 0; i < 20; ++i) {
+        limiter.acquire();
+        limiter.acquire();
+        limiter.release(fast, false);
+        limiter.release(fast, false);
+    }
+    EXPECT_GT(limiter.currentLimit(), 2u);
+    EXPECT_EQ(limiter.inFlight(), 0u);
+}
+
+TEST(ConcurrencyLimiterTest, limit_does_not_grow_when_unused) {
+    ConcurrencyLimiter::Options options;
+    options.initialLimit = 4;
+    ConcurrencyLimiter limiter(options);
+
+    for(int i = 0; i < 100; ++i) {
+        limiter.acquire();
+        limiter.release(fast, false);
+    }
+    EXPECT_EQ(limiter.currentLimit(), 4u);
+}
+
+TEST(ConcurrencyLimiterTest, overload_cuts_limit_once_per_window) {
+    ConcurrencyLimiter::Options options;
+    options.initialLimit = 8;
+    ConcurrencyLimiter limiter(options);
+
+    for(int i = 0; i < 8; ++i)
+        limiter.acquire();
+    for(int i = 0; i < 8; ++i)
+        limiter.release(fast, true);
+
+    // a burst of rejections from one window of calls only halves the limit once
+    EXPECT_EQ(limiter.currentLimit(), 4u);
+    EXPECT_EQ(limiter.overloadCount(), 8u);
+
+    for(int i = 0; i < 20; ++i) {
+        limiter.acquire();
+        limiter.release(fast, true);
+    }
+    EXPECT_EQ(limiter.currentLimit(), 1u);
+}
+
+TEST(ConcurrencyLimiterTest, growing_latency_cuts_limit) {
+    ConcurrencyLimiter::Options options;
+    options.initialLimit = 8;
+    ConcurrencyLimiter limiter(options);
+
+    for(int i = 0; i < 20; ++i) {
+        limiter.acquire();
+        limiter.release(fast, false);
+    }
+    for(int i = 0; i < 40; ++i) {
+        limiter.acquire();
+        limiter.release(std::chrono::milliseconds(50), false);
+    }
+    EXPECT_LT(limiter.currentLimit(), 8u);
+    EXPECT_EQ(limiter.overloadCount(), 0u);
+}
+
+TEST(LimitingBitcoinRPCFacadeTest, overloaded_calls_are_retried) {
+    Busy_BitcoinRPCFacade btc(2);
+    ConcurrencyLimiter limiter;
+    LimitingBitcoinRPCFacade limitedBtc(btc, limiter);
+
+    EXPECT_EQ(limitedBtc.getblockhash(1), "hash");
+    EXPECT_EQ(btc.calls, 3);
+    EXPECT_EQ(limiter.overloadCount(), 2u);
+    EXPECT_EQ(limiter.inFlight(), 0u);
+}
+
+TEST(LimitingBitcoinRPCFacadeTest, retries_give_up_eventually) {
+    Busy_BitcoinRPCFacade btc(100);
+    ConcurrencyLimiter limiter;
+    LimitingBitcoinRPCFacade limitedBtc(btc, limiter, 2);
+
+    EXPECT_THROW(limitedBtc.getblockhash(1), BitcoinException);
+    EXPECT_EQ(btc.calls, 3);
+}
+
+TEST(LimitingBitcoinRPCFacadeTest, other_errors_are_not_retried) {
+    Busy_BitcoinRPCFacade btc(0);
+    ConcurrencyLimiter limiter;
+    LimitingBitcoinRPCFacade limitedBtc(btc, limiter);
+
+    EXPECT_THROW(limitedBtc.getblock("hash"), BitcoinException);
+    EXPECT_EQ(btc.calls, 1);
+    EXPECT_EQ(limiter.overloadCount(), 0u);
+    EXPECT_EQ(limiter.inFlight(), 0u);
+}
@@ -0,0 +1,192 @@
+#include <gtest/gtest.h>
+
+#include "confirmationWatcher.cpp"
+
+#include <bitcoinapi/types.h>
+#include <deque>
+#include <functional>
+
+namespace {
+
+    /**
+     * A chain of blocks that grows, or is reorganized, whenever the watcher waits on it
+     */
+    class FakeChain_BitcoinRPCFacade : public BitcoinRPCFacade {
+    public:
+        explicit FakeChain_BitcoinRPCFacade(int baseHeight) {
+            for(int height = 0; height <= baseHeight; ++height)
+                mine({});
+        }
+
+        blockchaininfo_t getblockchaininfo() const override {
+            blockchaininfo_t info;
+            info.chain = "main";
+            info.blocks = tipHeight();
+            info.bestblockhash = blocks.back().hash;
+            return info;
+        }
+
+        std::string getblockhash(int blocknumber) const override {
+            return blocks.at(static_cast<size_t>(blocknumber)).hash;
+        }
+
+        blockinfo_t getblock(const std::string & blockhash) const override {
+            for(const blockinfo_t & block : blocks) {
+                if(block.hash == blockhash)
+                    return block;
+            }
+            return stale.at(blockhash);
+        }
+
+        blocktip_t waitforblockheight(int height, int) const override {
+            ++waits;
+            if(!events.empty()) {
+                events.front()();
+                events.pop_front();
+            }
+            lastWaitedFor = height;
+            blocktip_t tip;
+            tip.hash = blocks.back().hash;
+            tip.height = tipHeight();
+            return tip;
+        }
+
+        void mine(const std::vector<std::string> & txids) {
+            blockinfo_t block;
+            block.height = static_cast<int>(blocks.size());
+            block.hash = "block" + std::to_string(block.height) + "-" + std::to_string(++mined);
+            block.previousblockhash = blocks.empty() ? "" : blocks.back().hash;
+            block.tx.push_back("coinbase" + block.hash);
+            block.tx.insert(block.tx.end(), txids.begin(), txids.end());
+            blocks.push_back(block);
+        }
+
+        // replace the top blocks with others, which the caller then mines
+        void disconnect(size_t count) {
+            for(size_t i = 0; i < count; ++i) {
+                stale[blocks.back().hash] = blocks.back();
+                blocks.pop_back();
+            }
+        }
+
+        int tipHeight() const {
+            return static_cast<int>(blocks.size()) - 1;
+        }
+
+        mutable std::deque<std::function<void()>> events;
+        mutable int waits = 0;
+        mutable int lastWaitedFor = 0;
+
+    private:
+        std::vector<blockinfo_t> blocks;
+        std::map<std::string, blockinfo_t> stale;
+        int mined = 0;
+    };
+}
+
+
+TEST(ConfirmationWatcherTest, reports_transactions_once_they_have_enough_confirmations) {
+    FakeChain_BitcoinRPCFacade chain(100);
+    ConfirmationWatcher watcher(chain, 2);
+    watcher.watch("a");
+    watcher.watch("b");
+    watcher.watch("c");
+    EXPECT_EQ(watcher.pending(), 3u);
+
+    chain.events.push_back([&] { chain.mine({"x", "a"}); });
+    EXPECT_TRUE(watcher.poll().empty());
+    EXPECT_EQ(chain.lastWaitedFor, 101);
+
+    chain.events.push_back([&] { chain.mine({"c", "b"}); });
+    std::vector<ConfirmedTransaction> first = watcher.poll();
+    ASSERT_EQ(first.size(), 1u);
+    EXPECT_EQ(first[0].txid, "a");
+    EXPECT_EQ(first[0].blockHeight, 101);
+    EXPECT_EQ(first[0].transactionIndex, 2);
+    EXPECT_EQ(first[0].blockHash, chain.getblockhash(101));
+
+    chain.events.push_back([&] { chain.mine({}); });
+    std::vector<ConfirmedTransaction> rest = watcher.poll();
+    ASSERT_EQ(rest.size(), 2u);
+    // in the order they were mined
+    EXPECT_EQ(rest[0].txid, "c");
+    EXPECT_EQ(rest[0].transactionIndex, 1);
+    EXPECT_EQ(rest[1].txid, "b");
+    EXPECT_EQ(rest[1].transactionIndex, 2);
+    EXPECT_EQ(watcher.pending(), 0u);
+}
+
+TEST(ConfirmationWatcherTest, catches_up_on_several_blocks_at_once) {
+    FakeChain_BitcoinRPCFacade chain(10);
+    ConfirmationWatcher watcher(chain, 3);
+    watcher.watch("a");
+
+    chain.events.push_back([&] {
+        chain.mine({});
+        chain.mine({"a"});
+        chain.mine({});
+        chain.mine({});
+    });
+    std::vector<ConfirmedTransaction> confirmed = watcher.poll();
+    ASSERT_EQ(confirmed.size(), 1u);
+    EXPECT_EQ(confirmed[0].blockHeight, 12);
+    EXPECT_EQ(chain.waits, 1);
+}
+
+TEST(ConfirmationWatcherTest, finds_transactions_again_after_a_reorganization) {
+    FakeChain_BitcoinRPCFacade chain(50);
+    ConfirmationWatcher watcher(chain, 3);
+    watcher.watch("a");
+
+    chain.events.push_back([&] { chain.mine({"a"}); });
+    chain.events.push_back([&] { chain.mine({}); });
+    // the block holding "a" is replaced, and "a" is mined again a block later
+    chain.events.push_back([&] {
+        chain.disconnect(2);
+        chain.mine({});
+        chain.mine({"a"});
+        chain.mine({});
+    });
+    chain.events.push_back([&] { chain.mine({}); });
+
+    std::vector<ConfirmedTransaction> confirmed;
+    watcher.waitForAll([&](const ConfirmedTransaction & transaction) { confirmed.push_back(transaction); });
+    ASSERT_EQ(confirmed.size(), 1u);
+    EXPECT_EQ(confirmed[0].blockHeight, 52);
+    EXPECT_EQ(confirmed[0].blockHash, chain.getblockhash(52));
+    EXPECT_EQ(chain.tipHeight(), 54);
+}
+
+TEST(ConfirmationWatcherTest, finds_transactions_after_the_starting_block_is_reorganized_away) {
+    FakeChain_BitcoinRPCFacade chain(50);
+    ConfirmationWatcher watcher(chain, 2);
+    watcher.watch("a");
+
+    // the chains fork below the tip the watcher started from, and "a" is mined at its height
+    chain.events.push_back([&] {
+        chain.disconnect(2);
+        chain.mine({});
+        chain.mine({"a"});
+        chain.mine({});
+    });
+
+    std::vector<ConfirmedTransaction> confirmed;
+    watcher.waitForAll([&](const ConfirmedTransaction & transaction) { confirmed.push_back(transaction); });
+    ASSERT_EQ(confirmed.size(), 1u);
+    EXPECT_EQ(confirmed[0].blockHeight, 50);
+    EXPECT_EQ(confirmed[0].blockHash, chain.getblockhash(50));
+    EXPECT_EQ(chain.waits, 1);
+}
+
+TEST(ConfirmationWatcherTest, a_timed_out_poll_finds_nothing) {
+    FakeChain_BitcoinRPCFacade chain(5);
+    ConfirmationWatcher watcher(chain, 1, 10);
+    watcher.watch("a");
+    EXPECT_TRUE(watcher.poll().empty());
+    EXPECT_EQ(watcher.pending(), 1u);
+
+    chain.events.push_back([&] { chain.mine({"a"}); });
+    EXPECT_EQ(watcher.poll().size(), 1u);
+
+    EXPECT_THROW(ConfirmationWatcher(chain, 0), std::invalid_argument);
+}
@@ -0,0 +1,64 @@
+#include <gtest/gtest.h>
+
+#include "didIssuance.cpp"
+
+#include <sstream>
+
+namespace {
+
+    Result<std::vector<DidOutput>> read(const std::string & text) {
+        std::istringstream in(text);
+        return readDidOutputs(in, "main");
+    }
+}
+
+
+TEST(DidIssuanceTest, reads_one_output_per_line) {
+    Result<std::vector<DidOutput>> outputs = read(
+            "# issued 2020-01-01\n"
+            "1A1zP1eP5QGefi2DMPTfTL5SLmv7DivfNa 0.001\n"
+            "\n"
+            "   bc1qw508d6qejxtdg4y5r3zarvary0c5xw7kv8f3t4\t0.00000294  \n");
+    ASSERT_TRUE(outputs) << outputs.error();
+    ASSERT_EQ(outputs.value().size(), 2u);
+    EXPECT_EQ(outputs.value()[0].address, "1A1zP1eP5QGefi2DMPTfTL5SLmv7DivfNa");
+    EXPECT_EQ(outputs.value()[0].amount.satoshis(), 100000);
+    EXPECT_EQ(outputs.value()[1].scriptPubKey.size(), 22u);
+    EXPECT_EQ(outputs.value()[1].amount.satoshis(), 294);
+    EXPECT_EQ(totalAmount(outputs.value()).satoshis(), 100294);
+
+    EXPECT_TRUE(read("").value().empty());
+}
+
+TEST(DidIssuanceTest, reports_the_first_bad_line) {
+    Result<std::vector<DidOutput>> badAddress = read("1A1zP1eP5QGefi2DMPTfTL5SLmv7DivfNa 0.001\nnonesuch 0.001\n");
+    ASSERT_FALSE(badAddress);
+    EXPECT_EQ(badAddress.error().find("Line 2: "), 0u);
+
+    Result<std::vector<DidOutput>> dust = read("bc1qw508d6qejxtdg4y5r3zarvary0c5xw7kv8f3t4 0.00000293");
+    ASSERT_FALSE(dust);
+    EXPECT_EQ(dust.error(), "Line 1: amount 0.00000293 is less than the 0.00000294 BTC that can be sent to "
+                            "bc1qw508d6qejxtdg4y5r3zarvary0c5xw7kv8f3t4");
+
+    EXPECT_FALSE(read("1A1zP1eP5QGefi2DMPTfTL5SLmv7DivfNa"));
+    EXPECT_FALSE(read("1A1zP1eP5QGefi2DMPTfTL5SLmv7DivfNa 0.001 extra"));
+    EXPECT_FALSE(read("1A1zP1eP5QGefi2DMPTfTL5SLmv7DivfNa 1e-3"));
+    // an address for another chain
+    EXPECT_FALSE(read("tb1qrp33g0q5c5txsp9arysrx4k6zdkfs4nce4xj0gdcccefvpysxf3q0sl5k7 0.001"));
+}
+
+TEST(DidIssuanceTest, puts_the_op_return_first_and_the_dids_in_order) {
+    std::vector<DidOutput> outputs = read("1A1zP1eP5QGefi2DMPTfTL5SLmv7DivfNa 0.001\n"
+                                          "bc1qw508d6qejxtdg4y5r3zarvary0c5xw7kv8f3t4 0.002\n"
+                                          "bc1qw508d6qejxtdg4y5r3zarvary0c5xw7kv8f3t4 0.003\n").value();
+    TransactionBuilder builder;
+    std::vector<uint32_t> txoIndexes = addDidOutputs(builder, {'d', 'd', 'o'}, outputs);
+
+    EXPECT_EQ(txoIndexes, (std::vector<uint32_t>{1, 2, 3}));
+    ASSERT_EQ(builder.outputs().size(), 4u);
+    EXPECT_EQ(builder.outputs()[0].scriptPubKey, (std::vector<uint8_t>{0x6a, 3, 'd', 'd', 'o'}));
+    for(size_t i = 0; i < outputs.size(); ++i) {
+        EXPECT_EQ(builder.outputs()[txoIndexes[i]].scriptPubKey, outputs[i].scriptPubKey);
+        EXPECT_EQ(builder.outputs()[txoIndexes[i]].value, outputs[i].amount);
+    }
+}
@@ -0,0 +1,261 @@
+#include <gtest/gtest.h>
+
+#include "didRotation.cpp"
+#include "forwardingBitcoinRPCFacade.h"
+
+#include <map>
+#include <mutex>
+#include <sstream>
+
+namespace {
+
+    const char * KEY_WIF = "KwDiBf89QgGbjEhKnhXJuH7LrciVrZi3qYjgd9M7rFU73sVHnoWn";
+    const char * OTHER_KEY_WIF = "KwDiBf89QgGbjEhKnhXJuH7LrciVrZi3qYjgd9M7rFU74NMTptX4";
+    const char * KEY_SCRIPT = "0014751e76e8199196d454941c45d1b3a323f1433bd6";
+    const char * NEW_ADDRESS = "1A1zP1eP5QGefi2DMPTfTL5SLmv7DivfNa";
+
+    std::string displayed(const uint8_t * txid) {
+        std::vector<uint8_t> reversed(txid, txid + 32);
+        std::reverse(reversed.begin(), reversed.end());
+        return hex::encode(reversed.data(), reversed.size());
+    }
+
+    /**
+     * A node with a few unspent outputs paying to the key, and a mempool that takes everything
+     * unless told to reject it
+     */
+    class FakeNode_BitcoinRPCFacade : public BitcoinRPCFacade {
+    public:
+        getrawtransaction_t getrawtransaction(const std::string & txid, int) const override {
+            getrawtransaction_t tx;
+            auto found = transactions.find(txid);
+            if(found != transactions.end())
+                tx.hex = found->second;
+            return tx;
+        }
+
+        utxoinfo_t gettxout(const std::string & txid, int n) const override {
+            utxoinfo_t info;
+            info.confirmations = 0;
+            info.value = 0;
+            auto found = unspent.find(txid + ":" + std::to_string(n));
+            if(found != unspent.end()) {
+                info.bestblock = "00";
+                info.confirmations = 6;
+                info.value = found->second;
+                info.scriptPubKey.hex = KEY_SCRIPT;
+            }
+            return info;
+        }
+
+        mempoolacceptance_t testmempoolaccept(const std::string & hexString) const override {
+            std::lock_guard<std::mutex> lock(mutex);
+            tested.push_back(RawTransaction::fromHex(hexString).value());
+            mempoolacceptance_t acceptance;
+            acceptance.txid = displayed(tested.back().txid().data());
+            acceptance.allowed = rejectReason.empty();
+            acceptance.rejectreason = rejectReason;
+            return acceptance;
+        }
+
+        std::string sendrawtransaction(const std::string & hexString) const override {
+            std::lock_guard<std::mutex> lock(mutex);
+            sent.push_back(RawTransaction::fromHex(hexString).value());
+            return displayed(sent.back().txid().data());
+        }
+
+        std::map<std::string, std::string> transactions;
+        std::map<std::string, double> unspent;
+        std::string rejectReason;
+        mutable std::vector<RawTransaction> tested;
+        mutable std::vector<RawTransaction> sent;
+
+    private:
+        mutable std::mutex mutex;
+    };
+
+    /**
+     * A DID whose own output, 'txoIndex' of 'txid', is still its tip
+     */
+    DidResolution unspentDid(const std::string & txid, int txoIndex) {
+        DidResolution resolution;
+        resolution.did = "did:btcr:" + txid.substr(0, 8);
+        resolution.ok = true;
+        resolution.txid = txid;
+        resolution.txoIndex = txoIndex;
+        resolution.tipTxid = txid;
+        return resolution;
+    }
+
+    RotationRequest request(const std::string & did, const std::string & ddoRef = "", const std::string & key = KEY_WIF) {
+        RotationRequest r;
+        r.did = did;
+        r.privateKey = key;
+        r.newAddress = NEW_ADDRESS;
+        r.ddoRef = ddoRef;
+        return r;
+    }
+
+    const std::string TXID_A = std::string(63, '0') + "a";
+    const std::string TXID_B = std::string(63, '0') + "b";
+}
+
+
+TEST(DidRotationTest, reads_one_request_per_line) {
+    std::istringstream in("# rotation of 2020-01-01\n"
+                          "did:btcr:xyv2-xzpq-q9wa-p7t key1 addr1\n"
+                          "\n"
+                          "did:btcr:xz35-jzv2-qqs2-9wjt key2 addr2 https://example.com/ddo\n");
+    Result<std::vector<RotationRequest>> requests = readRotationRequests(in);
+    ASSERT_TRUE(requests) << requests.error();
+    ASSERT_EQ(requests.value().size(), 2u);
+    EXPECT_EQ(requests.value()[0].line, 2u);
+    EXPECT_EQ(requests.value()[0].newAddress, "addr1");
+    EXPECT_TRUE(requests.value()[0].ddoRef.empty());
+    EXPECT_EQ(requests.value()[1].line, 4u);
+    EXPECT_EQ(requests.value()[1].privateKey, "key2");
+    EXPECT_EQ(requests.value()[1].ddoRef, "https://example.com/ddo");
+
+    std::istringstream bad("did:btcr:xyv2-xzpq-q9wa-p7t key1 addr1\ndid:btcr:xz35-jzv2-qqs2-9wjt key2\n");
+    Result<std::vector<RotationRequest>> badRequests = readRotationRequests(bad);
+    ASSERT_FALSE(badRequests);
+    EXPECT_EQ(badRequests.error().find("Line 2: "), 0u);
+}
+
+TEST(DidRotationTest, finds_the_output_resolution_followed) {
+    FakeNode_BitcoinRPCFacade node;
+
+    // the DID's own output
+    node.unspent[TXID_A + ":2"] = 0.0005;
+    Result<TipOutput> own = findTipOutput(node, unspentDid(TXID_A, 2));
+    ASSERT_TRUE(own) << own.error();
+    EXPECT_EQ(own.value().vout, 2u);
+    EXPECT_EQ(own.value().amount.satoshis(), 50000);
+    EXPECT_EQ(hex::encode(own.value().scriptPubKey.data(), own.value().scriptPubKey.size()), KEY_SCRIPT);
+
+    // a later transaction in the chain, whose first output is an OP_RETURN
+    TransactionBuilder later;
+    later.addInput(Hash256(), 0);
+    later.addOpReturn({'d', 'd', 'o'});
+    std::vector<uint8_t> keyScript;
+    hex::decode(KEY_SCRIPT, keyScript);
+    later.addOutput(Amount::fromSatoshis(40000), keyScript);
+    std::string laterTxid = displayed(later.txid().data());
+    node.transactions[laterTxid] = later.toHex();
+    node.unspent[laterTxid + ":1"] = 0.0004;
+
+    DidResolution followed = unspentDid(TXID_B, 1);
+    followed.tipTxid = laterTxid;
+    Result<TipOutput> tip = findTipOutput(node, followed);
+    ASSERT_TRUE(tip) << tip.error();
+    EXPECT_EQ(tip.value().txid, laterTxid);
+    EXPECT_EQ(tip.value().vout, 1u);
+    EXPECT_EQ(tip.value().amount.satoshis(), 40000);
+
+    // spent since it was resolved
+    node.unspent.erase(laterTxid + ":1");
+    EXPECT_EQ(findTipOutput(node, followed).error().find("The tip output " + laterTxid + ":1 has been spent"), 0u);
+
+    DidResolution failed;
+    failed.error = "DID not found";
+    EXPECT_EQ(findTipOutput(node, failed).error(), "DID not found");
+}
+
+TEST(DidRotationTest, spends_the_tip_to_the_new_address) {
+    FakeNode_BitcoinRPCFacade node;
+    node.unspent[TXID_A + ":1"] = 0.0005;
+    DidRotator rotator("main", 2, false);
+
+    RotationRecord record = rotator.rotate(node, request("did:btcr:a", "https://example.com/ddo"), unspentDid(TXID_A, 1));
+    ASSERT_TRUE(record.ok) << record.error;
+    EXPECT_EQ(record.previousTip, TXID_A);
+    EXPECT_EQ(record.txoIndex, 1u);
+    ASSERT_EQ(node.sent.size(), 1u);
+    EXPECT_EQ(record.txid, displayed(node.sent[0].txid().data()));
+
+    const RawTransaction & tx = node.sent[0];
+    ASSERT_EQ(tx.inputs().size(), 1u);
+    EXPECT_EQ(displayed(tx.inputs()[0].prevTxid.data), TXID_A);
+    EXPECT_EQ(tx.inputs()[0].prevIndex, 1u);
+    EXPECT_EQ(tx.inputs()[0].witness.size(), 2u);
+    ASSERT_EQ(tx.outputs().size(), 2u);
+    EXPECT_TRUE(isOpReturn(tx.outputs()[0].scriptPubKey));
+    EXPECT_EQ(tx.outputs()[1].value, 50000 - record.fee.satoshis());
+    // a p2wpkh input and two outputs are about 150 vbytes
+    EXPECT_GT(record.fee.satoshis(), 2 * 140);
+    EXPECT_LT(record.fee.satoshis(), 2 * 170);
+
+    // without a ddoRef, the new output comes first
+    node.unspent[TXID_B + ":0"] = 0.0005;
+    RotationRecord plain = rotator.rotate(node, request("did:btcr:b"), unspentDid(TXID_B, 0));
+    ASSERT_TRUE(plain.ok) << plain.error;
+    EXPECT_EQ(plain.txoIndex, 0u);
+    EXPECT_EQ(node.sent.back().outputs().size(), 1u);
+}
+
+TEST(DidRotationTest, reports_what_it_cannot_rotate) {
+    FakeNode_BitcoinRPCFacade node;
+    node.unspent[TXID_A + ":1"] = 0.0005;
+    node.unspent[TXID_B + ":1"] = 0.00000600;
+    DidRotator rotator("main", 2, false);
+
+    EXPECT_EQ(rotator.rotate(node, request("did:btcr:a", "", OTHER_KEY_WIF), unspentDid(TXID_A, 1)).error,
+              "The private key does not match the output spent by input 0");
+
+    RotationRecord dust = rotator.rotate(node, request("did:btcr:b"), unspentDid(TXID_B, 1));
+    EXPECT_FALSE(dust.ok);
+    EXPECT_EQ(dust.error.find("The tip output's 0.00000600 BTC doesn't cover the fee"), 0u);
+
+    EXPECT_EQ(rotator.rotate(node, request("did:btcr:a", std::string(81, 'x')), unspentDid(TXID_A, 1)).error,
+              "ddoRef is longer than 80 bytes");
+
+    node.rejectReason = "non-mandatory-script-verify-flag";
+    EXPECT_EQ(rotator.rotate(node, request("did:btcr:a"), unspentDid(TXID_A, 1)).error,
+              "The mempool would not accept the transaction: non-mandatory-script-verify-flag");
+    EXPECT_TRUE(node.sent.empty());
+
+    EXPECT_THROW(DidRotator("main", 0, false), std::invalid_argument);
+}
+
+TEST(DidRotationTest, dry_run_sends_nothing) {
+    FakeNode_BitcoinRPCFacade node;
+    node.unspent[TXID_A + ":1"] = 0.0005;
+    DidRotator rotator("main", 2, true);
+
+    RotationRecord record = rotator.rotate(node, request("did:btcr:a"), unspentDid(TXID_A, 1));
+    ASSERT_TRUE(record.ok) << record.error;
+    EXPECT_TRUE(node.sent.empty());
+    ASSERT_EQ(node.tested.size(), 1u);
+    EXPECT_EQ(record.txid, displayed(node.tested[0].txid().data()));
+}
+
+TEST(DidRotationTest, rotates_many_in_input_order) {
+    FakeNode_BitcoinRPCFacade node;
+    std::vector<RotationRequest> requests;
+    std::vector<DidResolution> resolutions;
+    for(int i = 0; i < 20; ++i) {
+        std::string txid = std::string(62, '0') + (i < 10 ? "0" : "") + std::to_string(i);
+        node.unspent[txid + ":1"] = 0.0001 * (i + 1);
+        requests.push_back(request("did:btcr:" + std::to_string(i)));
+        requests.back().line = static_cast<size_t>(i) + 1;
+        resolutions.push_back(unspentDid(txid, 1));
+    }
+    // one that can't be rotated doesn't hold up the rest
+    resolutions[7].ok = false;
+    resolutions[7].error = "Not a DID";
+
+    DidRotator rotator("main", 1, false);
+    std::vector<RotationRecord> records = rotator.rotateAll(requests, resolutions, [&] {
+        return std::unique_ptr<BitcoinRPCFacade>(new ForwardingBitcoinRPCFacade(node));
+    }, 4);
+
+    ASSERT_EQ(records.size(), 20u);
+    for(size_t i = 0; i < records.size(); ++i) {
+        EXPECT_EQ(records[i].line, i + 1);
+        EXPECT_EQ(records[i].ok, i != 7) << records[i].error;
+        if(records[i].ok) {
+            EXPECT_EQ(records[i].previousTip, resolutions[i].txid);
+        }
+    }
+    EXPECT_EQ(node.sent.size(), 19u);
+}
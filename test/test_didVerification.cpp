@@ -0,0 +1,377 @@
+#include <gtest/gtest.h>
+
+#include "didVerification.cpp"
+#include "forwardingBitcoinRPCFacade.h"
+#include "privateKey.h"
+
+#include <cstdlib>
+#include <map>
+
+namespace {
+
+    const char DID[] = "did:btcr:xkyt-fzgq-qq87-xnhn";
+
+    void appendLE32(std::vector<uint8_t> & out, uint32_t value) {
+        for(int i = 0; i < 4; ++i)
+            out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+
+    void appendPush(std::vector<uint8_t> & out, const std::vector<uint8_t> & data) {
+        out.push_back(static_cast<uint8_t>(data.size()));
+        out.insert(out.end(), data.begin(), data.end());
+    }
+
+    PrivateKey key(uint8_t fill) {
+        std::vector<uint8_t> secret(PrivateKey::SIZE, fill);
+        return PrivateKey::fromSecret(secret.data(), true).value();
+    }
+
+    std::string displayed(const Hash256 & hash) {
+        Hash256 reversed = hash;
+        std::reverse(reversed.begin(), reversed.end());
+        return hex::encode(reversed.data(), reversed.size());
+    }
+
+    /**
+     * A transaction with one input per spent output, signed (in appearance) by the given keys:
+     * in its scriptSig, or in its witness if 'segwit'
+     */
+    std::vector<uint8_t> transaction(const std::vector<std::pair<Hash256, uint32_t>> & inputs,
+                                     const std::vector<std::vector<uint8_t>> & publicKeys, bool segwit = false) {
+        // not a real signature, but shaped like one
+        std::vector<uint8_t> signature(71, 0x30);
+        std::vector<uint8_t> tx;
+        appendLE32(tx, 2);
+        if(segwit) {
+            tx.push_back(0);
+            tx.push_back(1);
+        }
+        tx.push_back(static_cast<uint8_t>(inputs.size()));
+        for(size_t i = 0; i < inputs.size(); ++i) {
+            tx.insert(tx.end(), inputs[i].first.begin(), inputs[i].first.end());
+            appendLE32(tx, inputs[i].second);
+            std::vector<uint8_t> scriptSig;
+            if(!segwit) {
+                appendPush(scriptSig, signature);
+                appendPush(scriptSig, publicKeys[i]);
+            }
+            appendPush(tx, scriptSig);
+            appendLE32(tx, 0xffffffff);
+        }
+        // an OP_RETURN, then the output a DID would follow
+        tx.push_back(2);
+        appendLE32(tx, 0);
+        appendLE32(tx, 0);
+        appendPush(tx, {0x6a, 0x01, 0x00});
+        appendLE32(tx, 10000);
+        appendLE32(tx, 0);
+        appendPush(tx, {0x51});
+        if(segwit) {
+            for(size_t i = 0; i < inputs.size(); ++i) {
+                tx.push_back(2);
+                appendPush(tx, signature);
+                appendPush(tx, publicKeys[i]);
+            }
+        }
+        appendLE32(tx, 0);
+        return tx;
+    }
+
+    Hash256 txidOf(const std::vector<uint8_t> & raw) {
+        return RawTransaction::parse(raw.data(), raw.size()).value().txid();
+    }
+
+    /**
+     * A DID document with 'keys-1' as its #keys-1, signed by each of 'signers' (as #keys-1 for
+     * the first key, #keys-2 for any other)
+     */
+    std::string document(const PrivateKey & keys1, const std::vector<PrivateKey> & signers, const std::string & did = DID) {
+        nlohmann::json doc;
+        doc["@context"] = "https://w3id.org/btcr/v1";
+        doc["id"] = did;
+        doc["publicKey"] = nlohmann::json::array();
+        doc["publicKey"].push_back({{"id", did + "#keys-1"}, {"type", "EcdsaSecp256k1VerificationKey2019"},
+                                    {"publicKeyHex", hex::encode(keys1.publicKey().data(), keys1.publicKey().size())}});
+        doc["authentication"] = nlohmann::json::array({{{"type", "EcdsaSecp256k1SignatureAuthentication2019"}, {"publicKey", "#keys-1"}}});
+        for(const PrivateKey & signer : signers) {
+            if(signer.publicKey() != keys1.publicKey())
+                doc["publicKey"].push_back({{"id", did + "#keys-2"},
+                                            {"publicKeyHex", hex::encode(signer.publicKey().data(), signer.publicKey().size())}});
+        }
+
+        std::string unsigned_ = doc.dump();
+        Hash256 hash;
+        sha256::Hasher().write(reinterpret_cast<const uint8_t *>(unsigned_.data()), unsigned_.size()).finalize(hash.data());
+        doc["proof"] = nlohmann::json::array();
+        for(const PrivateKey & signer : signers) {
+            std::vector<uint8_t> signature = signer.sign(hash.data());
+            doc["proof"].push_back({{"creator", signer.publicKey() == keys1.publicKey() ? "#keys-1" : "#keys-2"},
+                                    {"signatureValue", hex::encode(signature.data(), signature.size())}});
+        }
+        // written out of order and indented, which the signatures must not depend on
+        return doc.dump(2);
+    }
+
+    /**
+     * A node with -txindex that knows a few transactions, all in one block
+     */
+    class FakeNode_BitcoinRPCFacade : public BitcoinRPCFacade {
+    public:
+        std::string getblockhash(int) const override {
+            return "00000000000000000000000000000000000000000000000000000000000000aa";
+        }
+
+        getrawtransaction_t getrawtransaction(const std::string & txid, int) const override {
+            auto found = transactions.find(txid);
+            if(found == transactions.end())
+                throw BitcoinException(-5, "No such mempool or blockchain transaction");
+            getrawtransaction_t rawTransaction;
+            rawTransaction.txid = txid;
+            rawTransaction.hex = hex::encode(found->second.data(), found->second.size());
+            return rawTransaction;
+        }
+
+        std::string getrawtransactioninblock(const std::string & txid, const std::string &) const override {
+            return getrawtransaction(txid, 0).hex;
+        }
+
+        std::string add(const std::vector<uint8_t> & raw) {
+            std::string txid = displayed(txidOf(raw));
+            transactions[txid] = raw;
+            return txid;
+        }
+
+    private:
+        std::map<std::string, std::vector<uint8_t>> transactions;
+    };
+
+    /**
+     * A DID whose own transaction, signed by 'signer', is its tip
+     */
+    DidResolution unspentDid(FakeNode_BitcoinRPCFacade & btc, const PrivateKey & signer, uint8_t tag) {
+        Hash256 funding;
+        funding.fill(tag);
+        DidResolution resolution;
+        resolution.did = DID;
+        resolution.ok = true;
+        resolution.txid = resolution.tipTxid = btc.add(transaction({{funding, 0}}, {signer.publicKey()}));
+        resolution.txoIndex = 1;
+        return resolution;
+    }
+
+    VerificationRequest request(const std::string & json) {
+        VerificationRequest r;
+        r.source = "test";
+        Result<DidDocument> parsed = parseDidDocument(json);
+        EXPECT_TRUE(parsed.ok()) << parsed.error();
+        if(parsed) {
+            r.parsed = true;
+            r.document = parsed.value();
+        }
+        return r;
+    }
+}
+
+
+TEST(DidVerificationTest, finds_the_key_that_signed_an_input) {
+    Hash256 prev;
+    prev.fill(1);
+    std::vector<uint8_t> compressed = key(1).publicKey();
+
+    std::vector<uint8_t> legacy = transaction({{prev, 0}}, {compressed});
+    Result<std::vector<uint8_t>> found = signingPublicKey(RawTransaction::parse(legacy.data(), legacy.size()).value(), 0);
+    ASSERT_TRUE(found.ok()) << found.error();
+    EXPECT_EQ(found.value(), compressed);
+
+    std::vector<uint8_t> segwit = transaction({{prev, 0}}, {compressed}, true);
+    found = signingPublicKey(RawTransaction::parse(segwit.data(), segwit.size()).value(), 0);
+    ASSERT_TRUE(found.ok()) << found.error();
+    EXPECT_EQ(found.value(), compressed);
+
+    EXPECT_FALSE(signingPublicKey(RawTransaction::parse(legacy.data(), legacy.size()).value(), 1).ok());
+    std::vector<uint8_t> notAKey = transaction({{prev, 0}}, {std::vector<uint8_t>(20, 2)});
+    EXPECT_FALSE(signingPublicKey(RawTransaction::parse(notAKey.data(), notAKey.size()).value(), 0).ok());
+}
+
+TEST(DidVerificationTest, compares_keys_however_they_are_serialized) {
+    std::vector<uint8_t> secret(PrivateKey::SIZE, 3);
+    PrivateKey compressed = PrivateKey::fromSecret(secret.data(), true).value();
+    PrivateKey uncompressed = PrivateKey::fromSecret(secret.data(), false).value();
+    EXPECT_TRUE(samePublicKey(compressed.publicKey(), uncompressed.publicKey()));
+    EXPECT_FALSE(samePublicKey(compressed.publicKey(), key(4).publicKey()));
+    EXPECT_FALSE(samePublicKey(compressed.publicKey(), std::vector<uint8_t>(33, 2)));
+}
+
+TEST(DidVerificationTest, parses_documents) {
+    Result<DidDocument> parsed = parseDidDocument(document(key(1), {key(1), key(2)}));
+    ASSERT_TRUE(parsed.ok()) << parsed.error();
+    EXPECT_EQ(parsed.value().did, DID);
+    EXPECT_EQ(parsed.value().signingKey, key(1).publicKey());
+    ASSERT_EQ(parsed.value().signatures.size(), 2u);
+    EXPECT_EQ(parsed.value().signatures[1].publicKey, key(2).publicKey());
+
+    EXPECT_FALSE(parseDidDocument(document(key(1), {})).ok());
+
+    // the sample in data/btcrDids is not valid JSON
+    EXPECT_FALSE(parseDidDocument("{\"id\": \"did:btcr:xvn9-0zuq-qqqq-qqydtkx\" \"publicKey\": []}").ok());
+    EXPECT_FALSE(parseDidDocument("{\"id\": \"did:btcr:xvn9-0zuq-qqqq-qqydtkx\", \"publicKey\": []}").ok());
+
+    nlohmann::json noAuthentication = nlohmann::json::parse(document(key(1), {}));
+    noAuthentication.erase("authentication");
+    EXPECT_FALSE(parseDidDocument(noAuthentication.dump()).ok());
+
+    nlohmann::json unknownCreator = nlohmann::json::parse(document(key(1), {key(1)}));
+    unknownCreator["proof"][0]["creator"] = "#keys-9";
+    EXPECT_FALSE(parseDidDocument(unknownCreator.dump()).ok());
+}
+
+TEST(DidVerificationTest, verifies_signatures_in_a_batch) {
+    Hash256 hash, otherHash;
+    hash.fill(7);
+    otherHash.fill(8);
+    std::vector<uint8_t> signature = key(1).sign(hash.data());
+
+    SignatureBatch batch;
+    batch.add(key(1).publicKey(), hash, signature);
+    batch.add(key(1).publicKey(), otherHash, signature);
+    batch.add(key(2).publicKey(), hash, signature);
+    batch.add(key(1).publicKey(), hash, std::vector<uint8_t>(8, 0x30));
+    batch.add(key(1).publicKey(), hash, signature);
+    EXPECT_EQ(batch.size(), 5u);
+
+    std::vector<bool> expected = {true, false, false, false, true};
+    EXPECT_EQ(batch.verify(), expected);
+}
+
+TEST(DidVerificationTest, finds_the_key_that_signed_an_update) {
+    FakeNode_BitcoinRPCFacade btc;
+    DidResolution resolution = unspentDid(btc, key(1), 1);
+
+    // the update also has a null input, and spends an unrelated output, signed for by another key
+    Hash256 nothing, funding;
+    nothing.fill(0);
+    funding.fill(9);
+    std::vector<uint8_t> unrelated = transaction({{funding, 0}}, {key(4).publicKey()});
+    std::vector<uint8_t> raw;
+    hex::decode(btc.getrawtransaction(resolution.txid, 0).hex, raw);
+    std::string update = btc.add(transaction({{nothing, 0xffffffff}, {txidOf(unrelated), 0}, {txidOf(raw), 1}},
+                                             {key(5).publicKey(), key(3).publicKey(), key(2).publicKey()}));
+    resolution.tipTxid = update;
+
+    // as on a node without -txindex: the error is bitcoind's, not that no input spends the DID
+    EXPECT_THROW(findTipSigningKey(btc, resolution), BitcoinException);
+
+    btc.add(unrelated);
+    Result<std::vector<uint8_t>> found = findTipSigningKey(btc, resolution);
+    ASSERT_TRUE(found.ok()) << found.error();
+    EXPECT_EQ(found.value(), key(2).publicKey());
+
+    resolution.tipTxid = resolution.txid;
+    found = findTipSigningKey(btc, resolution);
+    ASSERT_TRUE(found.ok()) << found.error();
+    EXPECT_EQ(found.value(), key(1).publicKey());
+}
+
+TEST(DidVerificationTest, verifies_documents_against_their_tips) {
+    FakeNode_BitcoinRPCFacade btc;
+    std::vector<VerificationRequest> requests;
+    std::vector<DidResolution> resolutions;
+
+    // signed by the tip's key
+    requests.push_back(request(document(key(1), {key(1), key(2)})));
+    resolutions.push_back(unspentDid(btc, key(1), 1));
+    // #keys-1 isn't the tip's key
+    requests.push_back(request(document(key(2), {key(2)})));
+    resolutions.push_back(unspentDid(btc, key(1), 2));
+    // a signature of something else
+    nlohmann::json changed = nlohmann::json::parse(document(key(1), {key(1)}));
+    changed["service"] = "https://example.com/other";
+    requests.push_back(request(changed.dump()));
+    resolutions.push_back(unspentDid(btc, key(1), 3));
+    // not a document
+    VerificationRequest unparsed;
+    unparsed.source = "broken";
+    unparsed.error = "Not valid JSON";
+    requests.push_back(unparsed);
+    resolutions.push_back(DidResolution());
+
+    VerificationCache cache;
+    // one signature per batch, so there are several
+    DidVerifier verifier(&cache, 1);
+    auto facadeFactory = [&btc] { return std::unique_ptr<BitcoinRPCFacade>(new ForwardingBitcoinRPCFacade(btc)); };
+    std::vector<VerificationRecord> records = verifier.verifyAll(requests, resolutions, facadeFactory, 3);
+    ASSERT_EQ(records.size(), 4u);
+    EXPECT_TRUE(records[0].ok) << records[0].error;
+    EXPECT_EQ(records[0].signatures, 2u);
+    EXPECT_FALSE(records[0].cached);
+    EXPECT_EQ(records[0].tipTxid, resolutions[0].tipTxid);
+    EXPECT_FALSE(records[1].ok);
+    EXPECT_NE(records[1].error.find("#keys-1"), std::string::npos) << records[1].error;
+    EXPECT_FALSE(records[2].ok);
+    EXPECT_NE(records[2].error.find("not valid"), std::string::npos) << records[2].error;
+    EXPECT_FALSE(records[3].ok);
+    EXPECT_EQ(records[3].error, "Not valid JSON");
+    EXPECT_EQ(cache.size(), 1u);
+
+    // again, with the first from the cache
+    records = verifier.verifyAll(requests, resolutions, facadeFactory, 1);
+    EXPECT_TRUE(records[0].ok);
+    EXPECT_TRUE(records[0].cached);
+    EXPECT_FALSE(records[1].ok);
+
+    // but not once its DID has moved on
+    resolutions[0].tipTxid = resolutions[1].txid;
+    records = verifier.verifyAll(requests, resolutions, facadeFactory, 1);
+    EXPECT_FALSE(records[0].cached);
+}
+
+TEST(DidVerificationTest, reports_any_failure_to_find_the_tip_key) {
+    // e.g. the connection to bitcoind failing part way
+    class Failing_BitcoinRPCFacade : public BitcoinRPCFacade {
+    public:
+        getrawtransaction_t getrawtransaction(const std::string &, int) const override {
+            throw std::runtime_error("connection lost");
+        }
+
+        std::string getrawtransactioninblock(const std::string &, const std::string &) const override {
+            throw std::runtime_error("connection lost");
+        }
+    };
+
+    FakeNode_BitcoinRPCFacade btc;
+    std::vector<VerificationRequest> requests = {request(document(key(1), {key(1)}))};
+    std::vector<DidResolution> resolutions = {unspentDid(btc, key(1), 1)};
+
+    DidVerifier verifier(nullptr, 1);
+    auto facadeFactory = [] { return std::unique_ptr<BitcoinRPCFacade>(new Failing_BitcoinRPCFacade()); };
+    std::vector<VerificationRecord> records = verifier.verifyAll(requests, resolutions, facadeFactory, 1);
+    ASSERT_EQ(records.size(), 1u);
+    EXPECT_FALSE(records[0].ok);
+    EXPECT_EQ(records[0].error, "connection lost");
+}
+
+TEST(DidVerificationTest, keeps_the_cache_in_a_file) {
+    char pattern[] = "/tmp/btcrVerifyXXXXXX";
+    std::string dir = ::mkdtemp(pattern);
+    std::string path = dir + "/verified";
+    Hash256 documentHash;
+    documentHash.fill(5);
+    std::string tip(64, 'a');
+
+    VerificationCache cache;
+    cache.load(path);
+    EXPECT_EQ(cache.size(), 0u);
+    cache.add(documentHash, tip);
+    cache.save(path);
+
+    VerificationCache loaded;
+    loaded.load(path);
+    EXPECT_TRUE(loaded.contains(documentHash, tip));
+    EXPECT_FALSE(loaded.contains(documentHash, std::string(64, 'b')));
+
+    std::ofstream(path, std::ios::app) << "not a hash\n";
+    EXPECT_THROW(loaded.load(path), std::runtime_error);
+
+    std::string command = "rm -rf '" + dir + "'";
+    EXPECT_EQ(std::system(command.c_str()), 0);
+}
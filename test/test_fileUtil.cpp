@@ -0,0 +1,45 @@
+#include <gtest/gtest.h>
+
+#include "fileUtil.cpp"
+
+#include <fstream>
+#include <iterator>
+
+#include <unistd.h>
+
+namespace {
+
+    std::string contentsOf(const std::string & path) {
+        std::ifstream file(path, std::ios::binary);
+        return std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    }
+}
+
+
+TEST(FileUtilTest, has_suffix) {
+    EXPECT_TRUE(hasSuffix("did.json", ".json"));
+    EXPECT_TRUE(hasSuffix("a.did.txt", ".did.txt"));
+    EXPECT_FALSE(hasSuffix(".json", ".json"));
+    EXPECT_FALSE(hasSuffix("did.jsonld", ".json"));
+    EXPECT_FALSE(hasSuffix("json", ".json"));
+}
+
+TEST(FileUtilTest, replaces_a_file_without_leaving_a_temporary_one) {
+    char pattern[] = "/tmp/btcrFileXXXXXX";
+    int fd = ::mkstemp(pattern);
+    ASSERT_NE(fd, -1);
+    ::close(fd);
+    std::string path = pattern;
+
+    ASSERT_TRUE(replaceFile(path, "first\n"));
+    EXPECT_EQ(contentsOf(path), "first\n");
+    ASSERT_TRUE(replaceFile(path, "second\n"));
+    EXPECT_EQ(contentsOf(path), "second\n");
+    EXPECT_NE(::access((path + ".tmp").c_str(), F_OK), 0);
+
+    ::unlink(path.c_str());
+}
+
+TEST(FileUtilTest, fails_for_a_directory_that_does_not_exist) {
+    EXPECT_FALSE(replaceFile("/nonexistent-btcr-dir/file", "contents"));
+}
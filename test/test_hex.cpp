@@ -0,0 +1,97 @@
+#include <gtest/gtest.h>
+#include <random>
+
+#include "hex.cpp"
+
+namespace {
+    /**
+     * Run a test body once with each kernel this CPU supports
+     */
+    template <typename F>
+    void forEachKernel(F test) {
+        hex::Kernel original = hex::currentKernel();
+        for(hex::Kernel kernel : {hex::Kernel::scalar, hex::Kernel::sse2, hex::Kernel::avx2}) {
+            if(!hex::isSupported(kernel))
+                continue;
+            hex::setKernel(kernel);
+            SCOPED_TRACE(hex::kernelName(kernel));
+            test();
+        }
+        hex::setKernel(original);
+    }
+}
+
+
+TEST(HexTest, encodes_lowercase) {
+    forEachKernel([] {
+        EXPECT_EQ(hex::encode(std::string("hello world")), "68656c6c6f20776f726c64");
+        EXPECT_EQ(hex::encode(std::string("\x00\xff\x80\x7f", 4)), "00ff807f");
+        EXPECT_EQ(hex::encode(std::string()), "");
+    });
+}
+
+TEST(HexTest, decodes_either_case) {
+    forEachKernel([] {
+        std::vector<uint8_t> bytes;
+        ASSERT_TRUE(hex::decode("00fF807F", bytes));
+        EXPECT_EQ(bytes, std::vector<uint8_t>({0x00, 0xff, 0x80, 0x7f}));
+        ASSERT_TRUE(hex::decode("", bytes));
+        EXPECT_TRUE(bytes.empty());
+    });
+}
+
+TEST(HexTest, kernels_agree_for_every_length) {
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int> byte(0, 255);
+
+    for(size_t len = 0; len < 200; ++len) {
+        std::string data;
+        for(size_t i = 0; i < len; ++i)
+            data.push_back(static_cast<char>(byte(rng)));
+
+        hex::setKernel(hex::Kernel::scalar);
+        std::string expected = hex::encode(data);
+
+        forEachKernel([&] {
+            std::string encoded = hex::encode(data);
+            ASSERT_EQ(encoded, expected);
+
+            std::vector<uint8_t> decoded;
+            ASSERT_TRUE(hex::decode(encoded, decoded));
+            ASSERT_EQ(std::string(decoded.begin(), decoded.end()), data);
+        });
+    }
+}
+
+TEST(HexTest, rejects_non_hex_at_every_position) {
+    const char notHex[] = {'g', 'G', '/', ':', '@', '`', ' ', '\x10', '\x80', '\xff', '\0'};
+    std::string valid(130, 'a');
+
+    forEachKernel([&] {
+        EXPECT_TRUE(hex::isValid(valid));
+        EXPECT_FALSE(hex::isValid(valid + "a"));
+
+        for(size_t position = 0; position < valid.size(); ++position) {
+            for(char c : notHex) {
+                std::string invalid = valid;
+                invalid[position] = c;
+                ASSERT_FALSE(hex::isValid(invalid)) << "position " << position << " char " << int(c);
+                std::vector<uint8_t> decoded;
+                ASSERT_FALSE(hex::decode(invalid, decoded));
+            }
+        }
+    });
+}
+
+TEST(HexTest, hashes_are_displayed_reversed) {
+    // the genesis block's hash
+    const std::string displayed = "000000000019d6689c085ae165831e934ff763ae46a2a6c172b3f1b60a8ce26f";
+    uint8_t hash[32];
+    ASSERT_TRUE(hex::decodeHash(displayed, hash));
+    EXPECT_EQ(hash[0], 0x6f);
+    EXPECT_EQ(hash[31], 0x00);
+    EXPECT_EQ(hex::encodeHash(hash), displayed);
+
+    EXPECT_FALSE(hex::decodeHash(displayed.substr(2), hash));
+    EXPECT_FALSE(hex::decodeHash(displayed.substr(2) + "zz", hash));
+}
@@ -0,0 +1,317 @@
+#include <gtest/gtest.h>
+
+#include "utxoPool.cpp"
+#include "issuanceService.cpp"
+#include "forwardingBitcoinRPCFacade.h"
+#include "rawTransaction.h"
+
+#include <deque>
+#include <set>
+#include <sstream>
+
+namespace {
+
+    const char * FUNDING_WIF = "KwDiBf89QgGbjEhKnhXJuH7LrciVrZi3qYjgd9M7rFU73sVHnoWn";
+    const char * DID_ADDRESS = "1A1zP1eP5QGefi2DMPTfTL5SLmv7DivfNa";
+
+    PoolCoin coin(uint8_t tag, int64_t satoshis, int depth = 0) {
+        PoolCoin c;
+        c.txid = Hash256();
+        c.txid[0] = tag;
+        c.vout = 0;
+        c.amount = Amount::fromSatoshis(satoshis);
+        c.unconfirmedDepth = depth;
+        return c;
+    }
+
+    std::string displayed(const uint8_t * txid) {
+        std::vector<uint8_t> reversed(txid, txid + 32);
+        std::reverse(reversed.begin(), reversed.end());
+        return hex::encode(reversed.data(), reversed.size());
+    }
+
+    /**
+     * A node holding the funding key's confirmed outputs, with a mempool that takes everything
+     * unless told to reject it
+     */
+    class FakeNode_BitcoinRPCFacade : public BitcoinRPCFacade {
+    public:
+        std::vector<scannedutxo_t> scantxoutset(const std::vector<std::string> & descriptors) const override {
+            EXPECT_EQ(descriptors.size(), 1u);
+            return unspents;
+        }
+
+        utxoinfo_t gettxout(const std::string & txid, int n) const override {
+            utxoinfo_t info;
+            info.confirmations = 0;
+            if(spentInMempool.count(txid + ":" + std::to_string(n)) == 0) {
+                info.bestblock = "00";
+                info.confirmations = 1;
+            }
+            return info;
+        }
+
+        mempoolacceptance_t testmempoolaccept(const std::string & hexString) const override {
+            std::lock_guard<std::mutex> lock(mutex);
+            Result<RawTransaction> tx = RawTransaction::fromHex(hexString);
+            EXPECT_TRUE(tx);
+            mempoolacceptance_t acceptance;
+            acceptance.txid = displayed(tx.value().txid().data());
+            acceptance.allowed = rejections.empty();
+            if(!rejections.empty()) {
+                acceptance.rejectreason = rejections.front();
+                rejections.pop_front();
+            }
+            ++tested;
+            return acceptance;
+        }
+
+        std::string sendrawtransaction(const std::string & hexString) const override {
+            std::lock_guard<std::mutex> lock(mutex);
+            sent.push_back(RawTransaction::fromHex(hexString).value());
+            return displayed(sent.back().txid().data());
+        }
+
+        void addUnspent(uint8_t tag, int64_t satoshis, const std::vector<uint8_t> & script) {
+            scannedutxo_t utxo;
+            utxo.txid = std::string(62, '0') + hex::encode(&tag, 1);
+            utxo.vout = 0;
+            utxo.scriptPubKey = hex::encode(script.data(), script.size());
+            utxo.amount = Amount::fromSatoshis(satoshis);
+            utxo.height = 100;
+            unspents.push_back(utxo);
+        }
+
+        std::vector<scannedutxo_t> unspents;
+        std::set<std::string> spentInMempool;
+        mutable std::deque<std::string> rejections;
+        mutable std::vector<RawTransaction> sent;
+        mutable int tested = 0;
+
+    private:
+        mutable std::mutex mutex;
+    };
+
+    class IssuanceServiceTest : public ::testing::Test {
+    protected:
+        IssuanceServiceTest()
+                : service(PrivateKey::fromWif(FUNDING_WIF, "main").value(), "main", pool, IssuanceOptions()) {
+        }
+
+        UtxoPool pool;
+        IssuanceService service;
+        FakeNode_BitcoinRPCFacade node;
+    };
+
+    std::vector<uint8_t> bytes(const ByteView & view) {
+        return std::vector<uint8_t>(view.data, view.data + view.size);
+    }
+}
+
+
+TEST(UtxoPoolTest, lends_the_smallest_coin_that_fits) {
+    UtxoPool pool;
+    pool.add(coin(1, 5000));
+    pool.add(coin(2, 2000));
+    pool.add(coin(3, 9000));
+
+    PoolCoin taken;
+    ASSERT_TRUE(pool.take(Amount::fromSatoshis(3000), taken));
+    EXPECT_EQ(taken.txid[0], 1);
+    pool.release(taken);
+
+    ASSERT_TRUE(pool.takeLargest(taken));
+    EXPECT_EQ(taken.txid[0], 3);
+    pool.release(taken);
+
+    // nothing fits, and nothing is lent out that could come back as change
+    EXPECT_FALSE(pool.take(Amount::fromSatoshis(10000), taken));
+    EXPECT_EQ(pool.size(), 3u);
+    EXPECT_EQ(pool.total().satoshis(), 16000);
+    EXPECT_THROW(pool.release(coin(4, 1)), std::invalid_argument);
+}
+
+TEST(UtxoPoolTest, chains_change_up_to_the_limit) {
+    UtxoPool pool(3);
+    pool.add(coin(1, 10000));
+
+    PoolCoin taken;
+    for(int depth = 0; depth < 3; ++depth) {
+        ASSERT_TRUE(pool.take(Amount::fromSatoshis(1000), taken));
+        EXPECT_EQ(taken.unconfirmedDepth, depth);
+        PoolCoin change = coin(static_cast<uint8_t>(10 + depth), taken.amount.satoshis() - 1000, depth + 1);
+        pool.spent(taken, {change});
+    }
+    EXPECT_EQ(pool.size(), 1u);
+    EXPECT_FALSE(pool.take(Amount::fromSatoshis(1000), taken));
+
+    // once the chain confirms, its last change can be spent again
+    pool.refresh({coin(12, 7000)});
+    ASSERT_TRUE(pool.take(Amount::fromSatoshis(1000), taken));
+    EXPECT_EQ(taken.txid[0], 12);
+    EXPECT_EQ(taken.unconfirmedDepth, 0);
+}
+
+TEST(UtxoPoolTest, waits_for_lent_coins_to_come_back) {
+    UtxoPool pool;
+    pool.add(coin(1, 10000));
+    PoolCoin first;
+    ASSERT_TRUE(pool.take(Amount::fromSatoshis(1000), first));
+
+    PoolCoin second;
+    bool found = false;
+    std::thread waiter([&] { found = pool.take(Amount::fromSatoshis(1000), second); });
+    pool.spent(first, {coin(2, 9000, 1)});
+    waiter.join();
+
+    ASSERT_TRUE(found);
+    EXPECT_EQ(second.txid[0], 2);
+}
+
+TEST(UtxoPoolTest, refreshes_from_the_confirmed_outputs) {
+    UtxoPool pool;
+    pool.add(coin(1, 1000));
+    pool.add(coin(2, 2000, 1));
+    PoolCoin held;
+    pool.add(coin(3, 3000));
+    ASSERT_TRUE(pool.take(Amount::fromSatoshis(3000), held));
+    pool.hold(held);
+
+    // 1 was spent elsewhere, 2 and 3 confirmed, and 4 is new
+    pool.refresh({coin(2, 2000), coin(3, 3000), coin(4, 4000)});
+    EXPECT_EQ(pool.size(), 3u);
+    EXPECT_EQ(pool.total().satoshis(), 9000);
+    EXPECT_FALSE(pool.contains(coin(1, 1000)));
+
+    PoolCoin taken;
+    ASSERT_TRUE(pool.take(Amount::fromSatoshis(3000), taken));
+    EXPECT_EQ(taken.txid[0], 3);
+    EXPECT_EQ(taken.unconfirmedDepth, 0);
+    pool.discard(taken);
+    EXPECT_EQ(pool.size(), 2u);
+}
+
+TEST_F(IssuanceServiceTest, issues_from_the_pool_and_chains_change) {
+    node.addUnspent(1, 100000, service.fundingScript());
+    ASSERT_EQ(service.refresh(node), 1u);
+
+    IssuanceRecord first = service.issue(node, DID_ADDRESS, "https://example.com/ddo.jsonld");
+    ASSERT_TRUE(first.ok) << first.error;
+    EXPECT_EQ(first.txoIndex, 1u);
+    ASSERT_EQ(node.sent.size(), 1u);
+
+    const RawTransaction & tx = node.sent[0];
+    ASSERT_EQ(tx.inputs().size(), 1u);
+    EXPECT_EQ(tx.inputs()[0].prevTxid.data[0], 1);
+    ASSERT_EQ(tx.outputs().size(), 3u);
+    EXPECT_TRUE(isOpReturn(tx.outputs()[0].scriptPubKey));
+    EXPECT_EQ(tx.outputs()[1].value, 1000);
+    EXPECT_EQ(bytes(tx.outputs()[1].scriptPubKey), decodeAddress(DID_ADDRESS, "main").value().scriptPubKey);
+    EXPECT_EQ(bytes(tx.outputs()[2].scriptPubKey), service.fundingScript());
+    EXPECT_EQ(first.fee.satoshis(), 100000 - 1000 - tx.outputs()[2].value);
+    EXPECT_GE(first.fee.satoshis(), 2 * static_cast<int64_t>(tx.nonWitnessSize()));
+
+    // the next DID is funded from the change, before it confirms
+    IssuanceRecord second = service.issue(node, DID_ADDRESS, "");
+    ASSERT_TRUE(second.ok) << second.error;
+    ASSERT_EQ(node.sent.size(), 2u);
+    EXPECT_EQ(displayed(node.sent[1].inputs()[0].prevTxid.data), first.txid);
+    EXPECT_EQ(node.sent[1].inputs()[0].prevIndex, 2u);
+    EXPECT_EQ(pool.size(), 1u);
+}
+
+TEST_F(IssuanceServiceTest, sends_nothing_the_mempool_would_reject) {
+    node.addUnspent(1, 100000, service.fundingScript());
+    service.refresh(node);
+
+    node.rejections.push_back("min relay fee not met");
+    IssuanceRecord rejected = service.issue(node, DID_ADDRESS, "");
+    EXPECT_FALSE(rejected.ok);
+    EXPECT_EQ(rejected.error, "The mempool would not accept the transaction: min relay fee not met");
+    EXPECT_TRUE(node.sent.empty());
+
+    // the coin went back to the pool
+    IssuanceRecord accepted = service.issue(node, DID_ADDRESS, "");
+    EXPECT_TRUE(accepted.ok) << accepted.error;
+    EXPECT_EQ(node.sent.size(), 1u);
+}
+
+TEST_F(IssuanceServiceTest, tries_another_coin_when_the_chain_is_too_long) {
+    node.addUnspent(1, 100000, service.fundingScript());
+    node.addUnspent(2, 200000, service.fundingScript());
+    service.refresh(node);
+
+    node.rejections.push_back("too-long-mempool-chain, too many unconfirmed ancestors");
+    IssuanceRecord record = service.issue(node, DID_ADDRESS, "");
+    ASSERT_TRUE(record.ok) << record.error;
+    EXPECT_EQ(node.tested, 2);
+    ASSERT_EQ(node.sent.size(), 1u);
+    EXPECT_EQ(node.sent[0].inputs()[0].prevTxid.data[0], 2);
+    node.spentInMempool.insert(node.unspents[1].txid + ":0");
+
+    // the coin put aside is spent again once it is seen confirmed
+    node.rejections.push_back("too-long-mempool-chain, too many unconfirmed ancestors");
+    EXPECT_FALSE(service.issue(node, DID_ADDRESS, "").ok);
+    service.refresh(node);
+    EXPECT_TRUE(service.issue(node, DID_ADDRESS, "").ok);
+}
+
+TEST_F(IssuanceServiceTest, rejects_requests_it_cannot_issue) {
+    EXPECT_FALSE(service.issue(node, "nonesuch", "").ok);
+    EXPECT_EQ(service.issue(node, DID_ADDRESS, std::string(81, 'x')).error, "ddoRef is longer than 80 bytes");
+
+    IssuanceRecord empty = service.issue(node, DID_ADDRESS, "");
+    EXPECT_EQ(empty.error.find("No funding coin of "), 0u);
+
+    IssuanceOptions dust;
+    dust.didAmount = Amount::fromSatoshis(545);
+    IssuanceService dustService(PrivateKey::fromWif(FUNDING_WIF, "main").value(), "main", pool, dust);
+    EXPECT_EQ(dustService.issue(node, DID_ADDRESS, "").error,
+              "The DID amount of 0.00000545 BTC is less than the 0.00000546 BTC that can be sent to " + std::string(DID_ADDRESS));
+
+    PrivateKey uncompressed = PrivateKey::fromWif("91iS7EZqPeRGqPXcPiKLtbfjfLVUYYj17oQ54H3iFFw3n1UmZSS", "test").value();
+    EXPECT_THROW(IssuanceService(uncompressed, "test", pool, IssuanceOptions()), std::invalid_argument);
+}
+
+TEST_F(IssuanceServiceTest, refresh_skips_outputs_spent_in_the_mempool) {
+    node.addUnspent(1, 100000, service.fundingScript());
+    node.addUnspent(2, 100000, service.fundingScript());
+    // a bare public key output, which combo() finds but isn't signed for
+    std::vector<uint8_t> p2pk(1, 33);
+    p2pk.insert(p2pk.end(), 33, 2);
+    p2pk.push_back(0xac);
+    node.addUnspent(3, 100000, p2pk);
+    node.spentInMempool.insert(node.unspents[1].txid + ":0");
+
+    EXPECT_EQ(service.refresh(node), 1u);
+    EXPECT_EQ(service.fundingDescriptor(),
+              "combo(0279be667ef9dcbbac55a06295ce870b07029bfcdb2dce28d959f2815b16f81798)");
+}
+
+TEST_F(IssuanceServiceTest, splits_a_coin_and_serves_requests_concurrently) {
+    node.addUnspent(1, 1000000, service.fundingScript());
+    service.refresh(node);
+
+    Result<std::string> split = service.split(node, 5);
+    ASSERT_TRUE(split) << split.error();
+    ASSERT_EQ(node.sent.size(), 1u);
+    ASSERT_EQ(node.sent[0].outputs().size(), 6u);
+    for(size_t i = 0; i < 5; ++i)
+        EXPECT_EQ(node.sent[0].outputs()[i].value, service.coinSize().satoshis());
+    EXPECT_EQ(pool.size(), 6u);
+
+    std::istringstream in(std::string(DID_ADDRESS) + "\n\n" + DID_ADDRESS + " ddo1\nnonesuch\n" +
+                          DID_ADDRESS + "\n" + DID_ADDRESS + "\n");
+    std::ostringstream out;
+    size_t failed = service.serve(in, out, [&] {
+        return std::unique_ptr<BitcoinRPCFacade>(new ForwardingBitcoinRPCFacade(node));
+    }, 3);
+    EXPECT_EQ(failed, 1u);
+    EXPECT_EQ(node.sent.size(), 5u);
+
+    std::string output = out.str();
+    EXPECT_EQ(std::count(output.begin(), output.end(), '\n'), 5);
+    EXPECT_NE(output.find("{\"address\":\"nonesuch\",\"error\":"), std::string::npos);
+    EXPECT_NE(output.find(",\"line\":4}"), std::string::npos);
+    EXPECT_NE(output.find("\"txo-index\":1}"), std::string::npos);
+}
@@ -0,0 +1,91 @@
+#include <gtest/gtest.h>
+
+#include "merkle.cpp"
+#include "hex.h"
+
+namespace {
+    // the transactions of block 100000, and its merkle root, as displayed (reversed)
+    const char * const block100000Txids[] = {
+            "8c14f0db3df150123e6f3dbbf30f8b955a8249b62ac1d1ff16284aefa3d06d87",
+            "fff2525b8931402dd09222c50775608f75787bd2b87e56995a7bdd30f79702c4",
+            "6359f0868171b1d194cbee1af2f16ea598ae8fad666d9b012c8ed2b79a236ec4",
+            "e9a66845e05d5abc0ad04ec80f774a7e585c6e8db975962d069a522137b80c1d"
+    };
+    const char block100000MerkleRoot[] = "f3e94742aca4b5ef85488dc37c06c3282295ffec960994b2c0d5ac2a25a95766";
+
+    std::vector<uint8_t> internalOrder(const char * const * displayed, size_t count) {
+        std::vector<uint8_t> hashes;
+        for(size_t i = 0; i < count; ++i) {
+            std::vector<uint8_t> bytes;
+            hex::decode(displayed[i], bytes);
+            hashes.insert(hashes.end(), bytes.rbegin(), bytes.rend());
+        }
+        return hashes;
+    }
+
+    std::string displayed(const uint8_t * hash) {
+        std::vector<uint8_t> reversed(hash, hash + 32);
+        std::reverse(reversed.begin(), reversed.end());
+        return hex::encode(reversed.data(), reversed.size());
+    }
+}
+
+
+TEST(MerkleTest, computes_block_merkle_root) {
+    std::vector<uint8_t> hashes = internalOrder(block100000Txids, 4);
+    uint8_t root[32];
+    merkle::root(hashes.data(), 4, root);
+    EXPECT_EQ(displayed(root), block100000MerkleRoot);
+}
+
+TEST(MerkleTest, single_hash_is_its_own_root) {
+    std::vector<uint8_t> hashes = internalOrder(block100000Txids, 1);
+    uint8_t root[32];
+    merkle::root(hashes.data(), 1, root);
+    EXPECT_EQ(displayed(root), block100000Txids[0]);
+}
+
+TEST(MerkleTest, odd_level_repeats_last_hash) {
+    std::vector<uint8_t> three = internalOrder(block100000Txids, 3);
+    std::vector<uint8_t> four(three);
+    four.insert(four.end(), three.end() - 32, three.end());
+
+    uint8_t rootOfThree[32], rootOfFour[32];
+    merkle::root(three.data(), 3, rootOfThree);
+    merkle::root(four.data(), 4, rootOfFour);
+    EXPECT_EQ(displayed(rootOfThree), displayed(rootOfFour));
+}
+
+TEST(MerkleTest, computed_branches_lead_to_root) {
+    std::vector<uint8_t> hashes = internalOrder(block100000Txids, 4);
+    // three hashes make the last one its own sibling
+    for(size_t count = 3; count <= 4; ++count) {
+        uint8_t expected[32];
+        merkle::root(hashes.data(), count, expected);
+        for(uint32_t index = 0; index < count; ++index) {
+            std::vector<uint8_t> branch = merkle::branch(hashes.data(), count, index);
+            ASSERT_EQ(branch.size(), 64u);
+            uint8_t root[32];
+            merkle::rootFromBranch(&hashes[32 * index], branch.data(), 2, index, root);
+            EXPECT_EQ(displayed(root), displayed(expected)) << "index " << index << " of " << count;
+        }
+    }
+    EXPECT_TRUE(merkle::branch(hashes.data(), 1, 0).empty());
+}
+
+TEST(MerkleTest, branch_leads_to_root) {
+    std::vector<uint8_t> hashes = internalOrder(block100000Txids, 4);
+    uint8_t level1[64];
+    sha256::doubleHash64(hashes.data(), 2, level1);
+
+    for(uint32_t index = 0; index < 4; ++index) {
+        // the sibling leaf, then the hash of the other pair
+        uint8_t branch[64];
+        std::memcpy(branch, &hashes[32 * (index ^ 1)], 32);
+        std::memcpy(branch + 32, level1 + 32 * ((index >> 1) ^ 1), 32);
+
+        uint8_t root[32];
+        merkle::rootFromBranch(&hashes[32 * index], branch, 2, index, root);
+        EXPECT_EQ(displayed(root), block100000MerkleRoot) << "index " << index;
+    }
+}
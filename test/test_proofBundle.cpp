@@ -0,0 +1,376 @@
+#include <gtest/gtest.h>
+
+#include "proofBundle.cpp"
+#include "merkle.h"
+#include "sha256.h"
+
+#include <bitcoinapi/types.h>
+#include <cstring>
+#include <map>
+
+namespace {
+
+    // height 170, transaction 1, output 0
+    const char DID[] = "did:btcr:r52q-qqpq-qpty-cfg";
+    const int FIRST_HEIGHT = 170;
+
+    void appendLE32(std::vector<uint8_t> & out, uint32_t value) {
+        for(int i = 0; i < 4; ++i)
+            out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+
+    std::string displayed(const Hash256 & hash) {
+        return hex::encodeHash(hash.data());
+    }
+
+    Hash256 txidOf(const std::vector<uint8_t> & raw) {
+        return RawTransaction::parse(raw.data(), raw.size()).value().txid();
+    }
+
+    std::vector<uint8_t> p2pkh(uint8_t key) {
+        std::vector<uint8_t> script = {0x76, 0xa9, 0x14};
+        script.insert(script.end(), 20, key);
+        script.push_back(0x88);
+        script.push_back(0xac);
+        return script;
+    }
+
+    std::vector<uint8_t> opReturn() {
+        return {0x6a, 0x04, 'd', 'd', 'o', '1'};
+    }
+
+    /**
+     * A legacy transaction spending the given outputs. With no inputs it is a coinbase, told
+     * apart by its tag.
+     */
+    std::vector<uint8_t> transaction(const std::vector<std::pair<Hash256, uint32_t>> & inputs,
+                                     const std::vector<std::vector<uint8_t>> & outputScripts, uint8_t tag) {
+        std::vector<uint8_t> tx;
+        appendLE32(tx, 1);
+        tx.push_back(static_cast<uint8_t>(inputs.empty() ? 1 : inputs.size()));
+        if(inputs.empty()) {
+            tx.insert(tx.end(), 32, 0);
+            appendLE32(tx, 0xffffffff);
+            tx.push_back(2);
+            tx.push_back(0x01);
+            tx.push_back(tag);
+            appendLE32(tx, 0xffffffff);
+        }
+        for(const auto & input : inputs) {
+            tx.insert(tx.end(), input.first.begin(), input.first.end());
+            appendLE32(tx, input.second);
+            tx.push_back(0);
+            appendLE32(tx, 0xffffffff);
+        }
+        tx.push_back(static_cast<uint8_t>(outputScripts.size()));
+        for(const std::vector<uint8_t> & script : outputScripts) {
+            appendLE32(tx, 50000);
+            appendLE32(tx, 0);
+            tx.push_back(static_cast<uint8_t>(script.size()));
+            tx.insert(tx.end(), script.begin(), script.end());
+        }
+        appendLE32(tx, inputs.empty() ? tag : 0);
+        return tx;
+    }
+
+    /**
+     * Builds the BIP 37 partial merkle tree proving one transaction of a block
+     */
+    class PartialTreeBuilder {
+    public:
+        PartialTreeBuilder(const std::vector<Hash256> & t, uint32_t m) : txids(t), match(m) {}
+
+        void build(uint32_t height, uint32_t pos) {
+            bool parentOfMatch = (pos << height) <= match && match < ((pos + 1) << height);
+            flags.push_back(parentOfMatch);
+            if(height == 0 || !parentOfMatch) {
+                hashes.push_back(node(height, pos));
+                return;
+            }
+            build(height - 1, 2 * pos);
+            if(2 * pos + 1 < width(height - 1))
+                build(height - 1, 2 * pos + 1);
+        }
+
+        uint32_t treeHeight() const {
+            uint32_t height = 0;
+            while(width(height) > 1)
+                ++height;
+            return height;
+        }
+
+        std::vector<bool> flags;
+        std::vector<Hash256> hashes;
+
+    private:
+        uint32_t width(uint32_t height) const {
+            return static_cast<uint32_t>((txids.size() + (1u << height) - 1) >> height);
+        }
+
+        Hash256 node(uint32_t height, uint32_t pos) const {
+            if(height == 0)
+                return txids[pos];
+            Hash256 left = node(height - 1, 2 * pos);
+            Hash256 right = 2 * pos + 1 < width(height - 1) ? node(height - 1, 2 * pos + 1) : left;
+            Hash256 out;
+            sha256::Hasher().write(left.data(), left.size()).write(right.data(), right.size()).finalizeDouble(out.data());
+            return out;
+        }
+
+        const std::vector<Hash256> & txids;
+        const uint32_t match;
+    };
+
+    struct FakeBlock {
+        std::vector<uint8_t> header;
+        Hash256 hash;
+        std::vector<std::vector<uint8_t>> transactions;
+        std::vector<Hash256> txids;
+    };
+
+    /**
+     * A regtest-like chain from height 170 to 175 with a DID and two updates to it: the first
+     * update's DID output comes after an OP_RETURN, and the second also spends an output that
+     * has nothing to do with the DID. bitcoind has -txindex.
+     */
+    class FakeChain_BitcoinRPCFacade : public BitcoinRPCFacade {
+    public:
+        FakeChain_BitcoinRPCFacade() {
+            std::map<int, std::vector<std::vector<uint8_t>>> transactions;
+            for(int height = FIRST_HEIGHT; height <= 175; ++height)
+                transactions[height].push_back(transaction({}, {p2pkh(0xcc)}, static_cast<uint8_t>(height)));
+            Hash256 elsewhere;
+            elsewhere.fill(0x11);
+
+            didTx = transaction({{elsewhere, 0}}, {p2pkh(1), p2pkh(2)}, 0);
+            transactions[170].push_back(didTx);
+            funding = transaction({{txidOf(transactions[170][0]), 0}}, {p2pkh(3)}, 0);
+            transactions[171].push_back(funding);
+            update1 = transaction({{txidOf(didTx), 0}}, {opReturn(), p2pkh(4)}, 0);
+            transactions[172].push_back(transaction({{elsewhere, 1}}, {p2pkh(5)}, 0));
+            transactions[172].push_back(update1);
+            transactions[172].push_back(transaction({{elsewhere, 2}}, {p2pkh(6)}, 0));
+            update2 = transaction({{txidOf(funding), 0}, {txidOf(update1), 1}}, {p2pkh(7)}, 0);
+            transactions[174].push_back(update2);
+
+            Hash256 prevHash = {};
+            for(const auto & entry : transactions) {
+                FakeBlock block;
+                block.transactions = entry.second;
+                for(const std::vector<uint8_t> & tx : block.transactions)
+                    block.txids.push_back(txidOf(tx));
+                Hash256 root;
+                merkle::root(block.txids[0].data(), block.txids.size(), root.data());
+
+                appendLE32(block.header, 1);
+                block.header.insert(block.header.end(), prevHash.begin(), prevHash.end());
+                block.header.insert(block.header.end(), root.begin(), root.end());
+                appendLE32(block.header, 1600000000u + 600u * static_cast<uint32_t>(entry.first));
+                appendLE32(block.header, 0x207fffff);
+                appendLE32(block.header, 0);
+                for(uint32_t nonce = 0; !BlockHeader::parse(block.header.data()).meetsTarget(); ++nonce) {
+                    block.header.resize(76);
+                    appendLE32(block.header, nonce);
+                }
+                block.hash = BlockHeader::parse(block.header.data()).hash;
+                prevHash = block.hash;
+                blocks[entry.first] = block;
+            }
+        }
+
+        blockchaininfo_t getblockchaininfo() const override {
+            blockchaininfo_t info;
+            info.chain = "regtest";
+            info.blocks = tipHeight;
+            return info;
+        }
+
+        std::string getblockhash(int height) const override {
+            if(blocks.find(height) == blocks.end())
+                throw BitcoinException(-8, "Block height out of range");
+            return displayed(blocks.at(height).hash);
+        }
+
+        blockinfo_t getblock(const std::string & blockhash) const override {
+            int height = heightOf(blockhash);
+            blockinfo_t info;
+            info.hash = blockhash;
+            info.height = height;
+            info.confirmations = tipHeight - height + 1;
+            for(const Hash256 & txid : blocks.at(height).txids)
+                info.tx.push_back(displayed(txid));
+            return info;
+        }
+
+        getrawtransaction_t getrawtransaction(const std::string & txid, int) const override {
+            if(mining)
+                ++tipHeight;
+            if(txid == unreachable)
+                throw BitcoinException(-28, "Loading block index...");
+            for(const auto & entry : blocks) {
+                const FakeBlock & block = entry.second;
+                for(size_t i = 0; i < block.txids.size(); ++i) {
+                    if(displayed(block.txids[i]) == txid) {
+                        getrawtransaction_t rawTransaction;
+                        rawTransaction.txid = txid;
+                        rawTransaction.hex = hex::encode(block.transactions[i].data(), block.transactions[i].size());
+                        rawTransaction.blockhash = displayed(block.hash);
+                        rawTransaction.confirmations = static_cast<unsigned int>(tipHeight - entry.first + 1);
+                        return rawTransaction;
+                    }
+                }
+            }
+            throw BitcoinException(-5, "No such mempool or blockchain transaction");
+        }
+
+        std::string getrawtransactioninblock(const std::string & txid, const std::string & blockhash) const override {
+            getrawtransaction_t rawTransaction = getrawtransaction(txid, 0);
+            if(rawTransaction.blockhash != blockhash)
+                throw BitcoinException(-5, "No such transaction found in the provided block");
+            return rawTransaction.hex;
+        }
+
+        std::string getrawblockheader(const std::string & blockhash) const override {
+            const std::vector<uint8_t> & header = blocks.at(heightOf(blockhash)).header;
+            return hex::encode(header.data(), header.size());
+        }
+
+        std::string gettxoutproof(const std::vector<std::string> & txids, const std::string & blockhash) const override {
+            const FakeBlock & block = blocks.at(heightOf(blockhash));
+            uint32_t position = 0;
+            while(displayed(block.txids.at(position)) != txids.at(0))
+                ++position;
+
+            PartialTreeBuilder tree(block.txids, position);
+            tree.build(tree.treeHeight(), 0);
+            std::vector<uint8_t> proof = block.header;
+            appendLE32(proof, static_cast<uint32_t>(block.txids.size()));
+            proof.push_back(static_cast<uint8_t>(tree.hashes.size()));
+            for(const Hash256 & hash : tree.hashes)
+                proof.insert(proof.end(), hash.begin(), hash.end());
+            std::vector<uint8_t> flagBytes((tree.flags.size() + 7) / 8);
+            for(size_t i = 0; i < tree.flags.size(); ++i)
+                flagBytes[i / 8] = static_cast<uint8_t>(flagBytes[i / 8] | (tree.flags[i] ? 1 << (i % 8) : 0));
+            proof.push_back(static_cast<uint8_t>(flagBytes.size()));
+            proof.insert(proof.end(), flagBytes.begin(), flagBytes.end());
+            return hex::encode(proof.data(), proof.size());
+        }
+
+        std::vector<uint8_t> didTx, funding, update1, update2;
+        std::map<int, FakeBlock> blocks;
+        mutable int tipHeight = 175;
+        bool mining = false;            // a block arrives with every getrawtransaction
+        std::string unreachable;        // getrawtransaction fails for this txid
+
+    private:
+        int heightOf(const std::string & blockhash) const {
+            for(const auto & entry : blocks) {
+                if(displayed(entry.second.hash) == blockhash)
+                    return entry.first;
+            }
+            throw BitcoinException(-5, "Block not found");
+        }
+    };
+
+    std::vector<uint8_t> serializedBundle(const FakeChain_BitcoinRPCFacade & btc) {
+        Result<ProofBundle> bundle = ProofBundle::build(btc, DID, displayed(txidOf(btc.update2)));
+        EXPECT_TRUE(bundle.ok()) << bundle.error();
+        return bundle ? bundle.value().serialize() : std::vector<uint8_t>();
+    }
+}
+
+
+TEST(ProofBundleTest, verifies_a_did_chain_offline) {
+    FakeChain_BitcoinRPCFacade btc;
+    Result<ProofBundle> built = ProofBundle::build(btc, DID, displayed(txidOf(btc.update2)));
+    ASSERT_TRUE(built.ok()) << built.error();
+    EXPECT_EQ(built.value().numTransactions(), 3u);
+    // from the DID's block to the tip's, and no further
+    EXPECT_EQ(built.value().numHeaders(), 5u);
+
+    std::vector<uint8_t> bytes = built.value().serialize();
+    Result<ProofBundle> bundle = ProofBundle::parse(bytes.data(), bytes.size());
+    ASSERT_TRUE(bundle.ok()) << bundle.error();
+    EXPECT_EQ(bundle.value().getDid(), DID);
+
+    Result<VerifiedDid> verified = bundle.value().verify();
+    ASSERT_TRUE(verified.ok()) << verified.error();
+    EXPECT_EQ(verified.value().txid, displayed(txidOf(btc.didTx)));
+    EXPECT_EQ(verified.value().blockHeight, 170);
+    EXPECT_EQ(verified.value().transactionIndex, 1);
+    EXPECT_EQ(verified.value().txoIndex, 0);
+    EXPECT_EQ(verified.value().tipTxid, displayed(txidOf(btc.update2)));
+    EXPECT_EQ(verified.value().tipBlockHeight, 174);
+    EXPECT_EQ(verified.value().tipBlockHash, displayed(btc.blocks.at(174).hash));
+    EXPECT_EQ(verified.value().numTransactions, 3u);
+}
+
+TEST(ProofBundleTest, is_built_while_blocks_arrive) {
+    FakeChain_BitcoinRPCFacade btc;
+    btc.mining = true;
+    Result<ProofBundle> built = ProofBundle::build(btc, DID, displayed(txidOf(btc.update2)));
+    ASSERT_TRUE(built.ok()) << built.error();
+    EXPECT_EQ(built.value().numTransactions(), 3u);
+    EXPECT_GT(btc.tipHeight, 175);
+}
+
+TEST(ProofBundleTest, verifies_a_did_that_was_never_updated) {
+    FakeChain_BitcoinRPCFacade btc;
+    Result<ProofBundle> bundle = ProofBundle::build(btc, DID, displayed(txidOf(btc.didTx)));
+    ASSERT_TRUE(bundle.ok()) << bundle.error();
+    EXPECT_EQ(bundle.value().numHeaders(), 1u);
+
+    Result<VerifiedDid> verified = bundle.value().verify();
+    ASSERT_TRUE(verified.ok()) << verified.error();
+    EXPECT_EQ(verified.value().tipTxid, verified.value().txid);
+    EXPECT_EQ(verified.value().tipBlockHeight, 170);
+}
+
+TEST(ProofBundleTest, is_not_built_for_a_transaction_outside_the_chain) {
+    FakeChain_BitcoinRPCFacade btc;
+    EXPECT_FALSE(ProofBundle::build(btc, DID, displayed(txidOf(btc.funding))).ok());
+    EXPECT_FALSE(ProofBundle::build(btc, "did:btcr:not-a-txref", displayed(txidOf(btc.update2))).ok());
+}
+
+TEST(ProofBundleTest, reports_an_rpc_error_while_following_the_chain) {
+    FakeChain_BitcoinRPCFacade btc;
+    btc.unreachable = displayed(txidOf(btc.funding));
+    Result<ProofBundle> bundle = ProofBundle::build(btc, DID, displayed(txidOf(btc.update2)));
+    ASSERT_FALSE(bundle.ok());
+    EXPECT_EQ(bundle.error(), "-28 Loading block index...");
+}
+
+TEST(ProofBundleTest, refuses_a_changed_bundle) {
+    FakeChain_BitcoinRPCFacade btc;
+    std::vector<uint8_t> bytes = serializedBundle(btc);
+    ASSERT_TRUE(ProofBundle::parse(bytes.data(), bytes.size()).value().verify().ok());
+
+    // magic, DID, first height, header count
+    size_t firstHeader = 8 + 1 + std::strlen(DID) + 4 + 1;
+
+    // a header's merkle root
+    std::vector<uint8_t> changed = bytes;
+    changed[firstHeader + 2 * BlockHeader::SIZE + 40] ^= 1;
+    EXPECT_FALSE(ProofBundle::parse(changed.data(), changed.size()).value().verify().ok());
+
+    // a header that no longer follows the one before
+    changed = bytes;
+    changed[firstHeader + BlockHeader::SIZE + 4] ^= 1;
+    EXPECT_FALSE(ProofBundle::parse(changed.data(), changed.size()).value().verify().ok());
+
+    // the tip's lock time, so its txid isn't the one proven
+    changed = bytes;
+    changed.back() ^= 1;
+    EXPECT_FALSE(ProofBundle::parse(changed.data(), changed.size()).value().verify().ok());
+
+    // the first height, so the DID's transaction isn't where its txref says
+    changed = bytes;
+    changed[8 + 1 + std::strlen(DID)] ^= 1;
+    EXPECT_FALSE(ProofBundle::parse(changed.data(), changed.size()).value().verify().ok());
+
+    changed = bytes;
+    changed.push_back(0);
+    EXPECT_FALSE(ProofBundle::parse(changed.data(), changed.size()).ok());
+    for(size_t len = 0; len < bytes.size(); ++len)
+        ASSERT_FALSE(ProofBundle::parse(bytes.data(), len).ok()) << "length " << len;
+}
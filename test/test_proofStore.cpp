@@ -0,0 +1,212 @@
+#include <gtest/gtest.h>
+
+#include "proofStoreBitcoinRPCFacade.cpp"
+
+#include <bitcoinapi/types.h>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+
+namespace {
+
+    // block 100000 and its first transaction
+    const char BLOCK_HASH[] = "000000000003ba27aa200b1cecaad478d2b00432346c3f1f3986da1afd33e506";
+    const char COINBASE_HEX[] =
+            "01000000010000000000000000000000000000000000000000000000000000000000000000ffffffff08044c"
+            "86041b020602ffffffff0100f2052a010000004341041b0e8c2567c12536aa13357b79a073dc4444acb83c4e"
+            "c7a0e2f99dd7457516c5817242da796924ca4e99947d087fedf9ce467cb9f7c6287078f801df276fdf84ac"
+            "00000000";
+
+    blockinfo_t block100000() {
+        blockinfo_t block;
+        block.hash = BLOCK_HASH;
+        block.height = 100000;
+        block.version = 1;
+        block.previousblockhash = "000000000002d01c1fccc21636b607dfd930d31d01c3a62104612a1719011250";
+        block.merkleroot = "f3e94742aca4b5ef85488dc37c06c3282295ffec960994b2c0d5ac2a25a95766";
+        block.time = 1293623863;
+        block.bits = "1b04864c";
+        block.nonce = 274148111;
+        block.tx = {
+                "8c14f0db3df150123e6f3dbbf30f8b955a8249b62ac1d1ff16284aefa3d06d87",
+                "fff2525b8931402dd09222c50775608f75787bd2b87e56995a7bdd30f79702c4",
+                "6359f0868171b1d194cbee1af2f16ea598ae8fad666d9b012c8ed2b79a236ec4",
+                "e9a66845e05d5abc0ad04ec80f774a7e585c6e8db975962d069a522137b80c1d"
+        };
+        return block;
+    }
+
+    /**
+     * A node without -txindex that knows block 100000 until it is pruned
+     */
+    class Pruned_BitcoinRPCFacade : public BitcoinRPCFacade {
+    public:
+        blockchaininfo_t getblockchaininfo() const override {
+            blockchaininfo_t info;
+            info.chain = "main";
+            info.blocks = 100099;
+            return info;
+        }
+
+        std::string getblockhash(int) const override {
+            return BLOCK_HASH;
+        }
+
+        blockinfo_t getblock(const std::string & blockhash) const override {
+            if(pruned || blockhash != BLOCK_HASH)
+                throw BitcoinException(-1, "Block not available (pruned data)");
+            return block100000();
+        }
+
+        getrawtransaction_t getrawtransaction(const std::string &, int) const override {
+            throw BitcoinException(-5, "No such mempool transaction. Use -txindex or provide a block hash.");
+        }
+
+        blockheader_t getblockheader(const std::string & blockhash) const override {
+            if(blockhash != BLOCK_HASH)
+                throw BitcoinException(-5, "Block not found");
+            blockheader_t header;
+            header.hash = blockhash;
+            header.height = 100000;
+            header.confirmations = reorganized ? -1 : 100;
+            return header;
+        }
+
+        std::string getrawtransactioninblock(const std::string & txid, const std::string & blockhash) const override {
+            if(pruned || blockhash != BLOCK_HASH || txid != block100000().tx[0])
+                throw BitcoinException(-1, "Block not available (pruned data)");
+            return COINBASE_HEX;
+        }
+
+        bool pruned = false;
+        bool reorganized = false;   // block 100000 is no longer on the best chain
+    };
+
+    /**
+     * A directory for a store, removed afterwards with everything in it
+     */
+    class StoreDir {
+    public:
+        StoreDir() {
+            char pattern[] = "/tmp/btcrProofsXXXXXX";
+            path = ::mkdtemp(pattern);
+        }
+
+        ~StoreDir() {
+            std::string command = "rm -rf '" + path + "'";
+            EXPECT_EQ(std::system(command.c_str()), 0);
+        }
+
+        std::string path;
+    };
+}
+
+
+TEST(ProofStoreTest, answers_for_pruned_blocks_from_the_store) {
+    StoreDir dir;
+    Pruned_BitcoinRPCFacade btc;
+    const std::string txid = block100000().tx[0];
+    {
+        ProofStore store(dir.path);
+        EXPECT_TRUE(store.keepFrom(btc, txid, 100000));
+        EXPECT_FALSE(store.keepFrom(btc, txid, 100000));
+    }
+
+    btc.pruned = true;
+    // read back from the files
+    ProofStore store(dir.path);
+    EXPECT_EQ(store.size(), 1u);
+    ProofStoreBitcoinRPCFacade prunedBtc(btc, store);
+
+    blockinfo_t block = prunedBtc.getblock(BLOCK_HASH);
+    blockinfo_t expected = block100000();
+    EXPECT_EQ(block.height, 100000);
+    EXPECT_EQ(block.confirmations, 100);
+    EXPECT_EQ(block.previousblockhash, expected.previousblockhash);
+    EXPECT_EQ(block.merkleroot, expected.merkleroot);
+    EXPECT_EQ(block.bits, expected.bits);
+    EXPECT_EQ(block.time, expected.time);
+    EXPECT_EQ(block.nonce, expected.nonce);
+    ASSERT_EQ(block.tx.size(), 4u);
+    EXPECT_EQ(block.tx[0], txid);
+    EXPECT_EQ(block.tx[1], "");
+
+    EXPECT_EQ(prunedBtc.getrawtransactioninblock(txid, BLOCK_HASH), COINBASE_HEX);
+    getrawtransaction_t rawTransaction = prunedBtc.getrawtransaction(txid, 1);
+    EXPECT_EQ(rawTransaction.blockhash, BLOCK_HASH);
+    EXPECT_EQ(rawTransaction.vout.size(), 1u);
+    EXPECT_EQ(rawTransaction.confirmations, 100u);
+
+    // what was never kept is still an error
+    EXPECT_THROW(prunedBtc.getrawtransaction(expected.tx[1], 0), BitcoinException);
+    EXPECT_THROW(prunedBtc.getblock(expected.previousblockhash), BitcoinException);
+}
+
+TEST(ProofStoreTest, does_not_answer_for_blocks_reorganized_away) {
+    StoreDir dir;
+    Pruned_BitcoinRPCFacade btc;
+    ProofStore store(dir.path);
+    const std::string txid = block100000().tx[0];
+    ASSERT_TRUE(store.keepFrom(btc, txid, 100000));
+
+    btc.pruned = true;
+    btc.reorganized = true;
+    ProofStoreBitcoinRPCFacade prunedBtc(btc, store);
+    EXPECT_THROW(prunedBtc.getblock(BLOCK_HASH), BitcoinException);
+    EXPECT_THROW(prunedBtc.getrawtransaction(txid, 1), BitcoinException);
+    EXPECT_THROW(prunedBtc.getrawtransactioninblock(txid, BLOCK_HASH), BitcoinException);
+}
+
+TEST(ProofStoreTest, refuses_what_does_not_hash_right) {
+    StoreDir dir;
+    ProofStore store(dir.path);
+    blockinfo_t block = block100000();
+
+    // a transaction that isn't the one named
+    EXPECT_FALSE(store.keep(block, block.tx[1], COINBASE_HEX));
+
+    blockinfo_t wrongHeader = block;
+    ++wrongHeader.nonce;
+    EXPECT_FALSE(store.keep(wrongHeader, block.tx[0], COINBASE_HEX));
+
+    blockinfo_t wrongTxids = block;
+    wrongTxids.tx[1] = wrongTxids.tx[2];
+    EXPECT_FALSE(store.keep(wrongTxids, block.tx[0], COINBASE_HEX));
+
+    EXPECT_EQ(store.size(), 0u);
+}
+
+TEST(ProofStoreTest, refuses_a_changed_file) {
+    StoreDir dir;
+    blockinfo_t block = block100000();
+    {
+        ProofStore store(dir.path);
+        ASSERT_TRUE(store.keep(block, block.tx[0], COINBASE_HEX));
+    }
+
+    std::string path = dir.path + "/" + BLOCK_HASH + ".proofs";
+    std::string contents;
+    {
+        std::ifstream file(path);
+        contents.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+    ASSERT_NE(contents.find("height 100000"), std::string::npos);
+    ASSERT_NO_THROW(ProofStore(dir.path));
+
+    // no hash covers the height, so it is checked against bitcoind's header when used
+    {
+        std::string changed = contents;
+        changed.replace(changed.find("height 100000"), 13, "height 100001");
+        std::ofstream(path, std::ios::trunc) << changed;
+        Pruned_BitcoinRPCFacade btc;
+        btc.pruned = true;
+        ProofStore store(dir.path);
+        ProofStoreBitcoinRPCFacade prunedBtc(btc, store);
+        EXPECT_THROW(prunedBtc.getblock(BLOCK_HASH), std::runtime_error);
+    }
+
+    // the coinbase's value, in its serialized form
+    contents.replace(contents.find("00f2052a01"), 10, "00f2052a02");
+    std::ofstream(path, std::ios::trunc) << contents;
+    EXPECT_THROW(ProofStore(dir.path), std::runtime_error);
+}
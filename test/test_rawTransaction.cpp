@@ -0,0 +1,144 @@
+#include <gtest/gtest.h>
+
+#include "rawTransaction.cpp"
+
+namespace {
+    // testnet cb0252c5...: one P2PKH input, an OP_RETURN output then a P2PKH output
+    const char LEGACY_TX_HEX[] =
+            "0200000001e9705d192c911ce3dc5a00a9654bdb7829bacb37805df9876d2c7424e5eab8e6010000006a473044022052"
+            "19fbc57b4806246fb57e9a7b582d4369f1292bd2f2348f8d2272b9bb923ad7022076f01bbdfd697c840865a7a9ce540a"
+            "3927f4819cb6dfaaefdaa4f63c3330582e0121034e85ac999dd799a3e5d0149a240ad79472af9e8040bb77e0eae90866"
+            "1974dff6ffffffff020000000000000000486a4668747470733a2f2f7261772e67697468756275736572636f6e74656e"
+            "742e636f6d2f64616e706170652f73656c662f6d61737465722f64646f2d6578742e302e6a736f6e6c64f00edf030000"
+            "00001976a914143f1c03a4c256a88a2334130a05ff38fc3e8f8488ac00000000";
+
+    // one input spending a P2WPKH output (two witness items), paying 100000 satoshis to P2WPKH
+    const char SEGWIT_TX_HEX[] =
+            "0200000000010111111111111111111111111111111111111111111111111111111111111111110100000000fdffffff"
+            "01a086010000000000160014222222222222222222222222222222222222222202473030303030303030303030303030"
+            "303030303030303030303030303030303030303030303030303030303030303030303030303030303030303030303030"
+            "30303030303030303021034444444444444444444444444444444444444444444444444444444444444444e8030000";
+
+    std::string viewToHex(const ByteView & view) {
+        return hex::encode(view.data, view.size);
+    }
+}
+
+
+TEST(RawTransactionTest, parses_legacy_transaction) {
+    Result<RawTransaction> result = RawTransaction::fromHex(LEGACY_TX_HEX);
+    ASSERT_TRUE(result.ok()) << result.error();
+    const RawTransaction & tx = result.value();
+
+    EXPECT_EQ(tx.version(), 2);
+    EXPECT_EQ(tx.lockTime(), 0u);
+    EXPECT_FALSE(tx.hasWitness());
+
+    ASSERT_EQ(tx.inputs().size(), 1u);
+    const TxInputView & input = tx.inputs()[0];
+    EXPECT_EQ(viewToHex(input.prevTxid), "e9705d192c911ce3dc5a00a9654bdb7829bacb37805df9876d2c7424e5eab8e6");
+    EXPECT_EQ(input.prevIndex, 1u);
+    EXPECT_EQ(input.scriptSig.size, 0x6au);
+    EXPECT_EQ(input.sequence, 0xffffffffu);
+    EXPECT_TRUE(input.witness.empty());
+
+    ASSERT_EQ(tx.outputs().size(), 2u);
+    EXPECT_EQ(tx.outputs()[0].value, 0);
+    EXPECT_TRUE(isOpReturn(tx.outputs()[0].scriptPubKey));
+    EXPECT_EQ(tx.outputs()[1].value, 64950000);
+    EXPECT_FALSE(isOpReturn(tx.outputs()[1].scriptPubKey));
+    EXPECT_EQ(viewToHex(tx.outputs()[1].scriptPubKey), "76a914143f1c03a4c256a88a2334130a05ff38fc3e8f8488ac");
+
+    EXPECT_EQ(tx.bytes().size, std::string(LEGACY_TX_HEX).size() / 2);
+}
+
+TEST(RawTransactionTest, parses_segwit_transaction) {
+    Result<RawTransaction> result = RawTransaction::fromHex(SEGWIT_TX_HEX);
+    ASSERT_TRUE(result.ok()) << result.error();
+    const RawTransaction & tx = result.value();
+
+    EXPECT_TRUE(tx.hasWitness());
+    EXPECT_EQ(tx.lockTime(), 1000u);
+
+    ASSERT_EQ(tx.inputs().size(), 1u);
+    EXPECT_EQ(tx.inputs()[0].scriptSig.size, 0u);
+    EXPECT_EQ(tx.inputs()[0].sequence, 0xfffffffdu);
+    ASSERT_EQ(tx.inputs()[0].witness.size(), 2u);
+    EXPECT_EQ(tx.inputs()[0].witness[0].size, 71u);
+    EXPECT_EQ(tx.inputs()[0].witness[1].size, 33u);
+
+    ASSERT_EQ(tx.outputs().size(), 1u);
+    EXPECT_EQ(tx.outputs()[0].value, 100000);
+    EXPECT_EQ(viewToHex(tx.outputs()[0].scriptPubKey), "00142222222222222222222222222222222222222222");
+}
+
+TEST(RawTransactionTest, computes_txid_without_witness_data) {
+    std::array<uint8_t, 32> legacy = RawTransaction::fromHex(LEGACY_TX_HEX).value().txid();
+    std::reverse(legacy.begin(), legacy.end());
+    EXPECT_EQ(hex::encode(legacy.data(), legacy.size()), "cb0252c5ea4e24bee19edd1ed1338ef077dc75d30383097d8c4bae3a9862b35a");
+
+    std::array<uint8_t, 32> segwit = RawTransaction::fromHex(SEGWIT_TX_HEX).value().txid();
+    std::reverse(segwit.begin(), segwit.end());
+    EXPECT_EQ(hex::encode(segwit.data(), segwit.size()), "691a867ac12188622227b34dc574b1be9c77e0485cfff2df26dd0da7bb08ce08");
+}
+
+TEST(RawTransactionTest, views_point_into_the_input) {
+    std::vector<uint8_t> bytes;
+    ASSERT_TRUE(hex::decode(LEGACY_TX_HEX, bytes));
+
+    Result<RawTransaction> result = RawTransaction::parse(bytes.data(), bytes.size());
+    ASSERT_TRUE(result.ok()) << result.error();
+
+    const ByteView & script = result.value().outputs()[1].scriptPubKey;
+    EXPECT_GE(script.data, bytes.data());
+    EXPECT_LE(script.data + script.size, bytes.data() + bytes.size());
+}
+
+TEST(RawTransactionTest, copies_keep_decoded_bytes_alive) {
+    std::unique_ptr<Result<RawTransaction>> original(new Result<RawTransaction>(RawTransaction::fromHex(LEGACY_TX_HEX)));
+    RawTransaction copy = original->value();
+    original.reset();
+
+    EXPECT_EQ(viewToHex(copy.outputs()[1].scriptPubKey), "76a914143f1c03a4c256a88a2334130a05ff38fc3e8f8488ac");
+}
+
+TEST(RawTransactionTest, rejects_every_truncation) {
+    for(const char * txHex : {LEGACY_TX_HEX, SEGWIT_TX_HEX}) {
+        std::string full(txHex);
+        for(size_t len = 0; len < full.size(); len += 2) {
+            Result<RawTransaction> result = RawTransaction::fromHex(full.substr(0, len));
+            ASSERT_FALSE(result.ok()) << "length " << len;
+        }
+    }
+}
+
+TEST(RawTransactionTest, rejects_malformed_transactions) {
+    std::string legacy(LEGACY_TX_HEX);
+
+    EXPECT_EQ(RawTransaction::fromHex("zz").error(), "Raw transaction is not valid hex");
+    EXPECT_EQ(RawTransaction::fromHex(legacy + "00").error(), "Raw transaction has trailing bytes");
+
+    // input count of 1 written as a 3-byte CompactSize
+    std::string nonCanonical = legacy.substr(0, 8) + "fd0100" + legacy.substr(10);
+    EXPECT_EQ(RawTransaction::fromHex(nonCanonical).error(), "Raw transaction has a non-canonical CompactSize");
+
+    // a huge input count is rejected without trying to reserve room for it
+    std::string hugeCount = legacy.substr(0, 8) + "ffffffffffffffff7f" + legacy.substr(10);
+    EXPECT_EQ(RawTransaction::fromHex(hugeCount).error(), "Raw transaction is truncated");
+
+    std::string segwit(SEGWIT_TX_HEX);
+    std::string badFlag = segwit.substr(0, 10) + "02" + segwit.substr(12);
+    EXPECT_EQ(RawTransaction::fromHex(badFlag).error(), "Raw transaction has an unknown segwit flag");
+}
+
+TEST(RawTransactionTest, op_return_is_detected_by_opcode) {
+    const uint8_t opReturn[] = {0x6a, 0x04, 'b', 't', 'c', 'r'};
+    const uint8_t p2pkh[] = {0x76, 0xa9, 0x14};
+    // a push of the bytes "OP_RETURN" is not an OP_RETURN
+    const uint8_t pushedText[] = {0x09, 'O', 'P', '_', 'R', 'E', 'T', 'U', 'R', 'N'};
+
+    EXPECT_TRUE(isOpReturn(ByteView{opReturn, sizeof(opReturn)}));
+    EXPECT_FALSE(isOpReturn(ByteView{p2pkh, sizeof(p2pkh)}));
+    EXPECT_FALSE(isOpReturn(ByteView{pushedText, sizeof(pushedText)}));
+    EXPECT_FALSE(isOpReturn(ByteView{opReturn, 0}));
+}
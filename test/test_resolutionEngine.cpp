@@ -0,0 +1,124 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <set>
+#include <thread>
+
+#include "workStealingPool.cpp"
+#include "resolutionEngine.cpp"
+#include "counting_bitcoinRPCFacade.h"
+
+namespace {
+    /**
+     * Every output in the Counting_BitcoinRPCFacade is unspent, so the chain should never be followed
+     */
+    class NoSpends_ChainQuery : public ChainQuery {
+    public:
+        UnspentData getUnspentOutputs(const std::string &, int, const std::string &) const override {
+            throw std::runtime_error("not expected");
+        }
+
+        std::string getLastUpdatedTxid(const std::string &, int, const std::string &) const override {
+            throw std::runtime_error("not expected");
+        }
+    };
+}
+
+
+TEST(WorkStealingPoolTest, runs_every_task) {
+    WorkStealingPool pool(4);
+    std::atomic<int> sum(0);
+
+    for(int i = 1; i <= 1000; ++i)
+        pool.submit([&sum, i](size_t) { sum += i; });
+    pool.wait();
+
+    EXPECT_EQ(sum, 500500);
+}
+
+TEST(WorkStealingPoolTest, tasks_submitted_by_tasks_are_waited_for) {
+    WorkStealingPool pool(3);
+    std::atomic<int> count(0);
+
+    for(int i = 0; i < 10; ++i) {
+        pool.submit([&pool, &count](size_t) {
+            for(int j = 0; j < 10; ++j)
+                pool.submit([&count](size_t) { ++count; });
+        });
+    }
+    pool.wait();
+
+    EXPECT_EQ(count, 100);
+}
+
+TEST(WorkStealingPoolTest, idle_workers_steal_queued_tasks) {
+    WorkStealingPool pool(4);
+    std::mutex mutex;
+    std::set<size_t> workers;
+
+    // one task queues all the work on its own worker; the others have to steal it
+    pool.submit([&](size_t) {
+        for(int i = 0; i < 40; ++i) {
+            pool.submit([&](size_t workerIndex) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(2));
+                std::lock_guard<std::mutex> lock(mutex);
+                workers.insert(workerIndex);
+            });
+        }
+    });
+    pool.wait();
+
+    EXPECT_GT(workers.size(), 1u);
+}
+
+TEST(WorkStealingPoolTest, wait_rethrows_task_exception) {
+    WorkStealingPool pool(2);
+
+    pool.submit([](size_t) { throw std::runtime_error("task failed"); });
+    EXPECT_THROW(pool.wait(), std::runtime_error);
+
+    // the pool is still usable afterwards
+    std::atomic<int> count(0);
+    pool.submit([&count](size_t) { ++count; });
+    pool.wait();
+    EXPECT_EQ(count, 1);
+}
+
+TEST(ResolutionEngineTest, resolves_in_parallel_and_keeps_input_order) {
+    std::atomic<int> connectionsMade(0);
+    std::vector<Counting_BitcoinRPCFacade *> connections;
+    RpcCache cache;
+    NoSpends_ChainQuery chainQuery;
+
+    ResolutionEngine engine(
+            [&] {
+                ++connectionsMade;
+                connections.push_back(new Counting_BitcoinRPCFacade());
+                return std::unique_ptr<BitcoinRPCFacade>(connections.back());
+            },
+            cache, chainQuery, 4);
+
+    EXPECT_EQ(connectionsMade, 4);
+
+    std::vector<std::string> dids;
+    for(int i = 0; i < 20; ++i) {
+        dids.push_back(i % 2 ? "did:btcr:8z4h-jz7l-qpqq-xkh8-xa" : "did:btcr:8x4h-jz54-qpqq-uf26-gj");
+    }
+    dids.push_back("did:btcr:foo");
+
+    std::vector<DidResolution> results = engine.resolve(dids);
+
+    ASSERT_EQ(results.size(), dids.size());
+    for(size_t i = 0; i < 20; ++i) {
+        EXPECT_TRUE(results[i].ok) << results[i].error;
+        EXPECT_EQ(results[i].did, dids[i]);
+        EXPECT_EQ(results[i].blockHeight, i % 2 ? 1355601 : 1355603);
+        EXPECT_EQ(results[i].tipTxid, results[i].txid);
+    }
+    EXPECT_FALSE(results[20].ok);
+
+    // the shared cache means each block is fetched from bitcoind once, whichever worker asks
+    int getblockCalls = 0;
+    for(const Counting_BitcoinRPCFacade * connection : connections)
+        getblockCalls += connection->getblockCalls;
+    EXPECT_EQ(getblockCalls, 2);
+}
@@ -0,0 +1,40 @@
+#include <gtest/gtest.h>
+
+#include "ripemd160.cpp"
+#include "hex.h"
+
+#include <string>
+
+namespace {
+
+    std::string digestOf(const std::string & message) {
+        uint8_t digest[ripemd160::DIGEST_SIZE];
+        ripemd160::hash(reinterpret_cast<const uint8_t *>(message.data()), message.size(), digest);
+        return hex::encode(digest, sizeof(digest));
+    }
+}
+
+
+TEST(RIPEMD160Test, matches_the_reference_vectors) {
+    EXPECT_EQ(digestOf(""), "9c1185a5c5e9fc54612808977ee8f548b2258d31");
+    EXPECT_EQ(digestOf("a"), "0bdc9d2d256b3ee9daae347be6f4dc835a467ffe");
+    EXPECT_EQ(digestOf("abc"), "8eb208f7e05d987a9b044a8e98c6b087f15a0bfc");
+    EXPECT_EQ(digestOf("message digest"), "5d0689ef49d2fae572b881b123a85ffa21595f36");
+    EXPECT_EQ(digestOf("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq"),
+              "12a053384a9c0c88e405a06c27dcf49ada62eb2b");
+    // longer than one block, with the length in a block of its own
+    std::string digits;
+    for(int i = 0; i < 8; ++i)
+        digits += "1234567890";
+    EXPECT_EQ(digestOf(digits), "9b752e45573d4b39f4dbd3323cab82bf63326bfb");
+    EXPECT_EQ(digestOf(std::string(1000000, 'a')), "52783243c1697bdbe16d37f97f68f08325dc1528");
+}
+
+TEST(RIPEMD160Test, hash160_is_ripemd160_of_sha256) {
+    // the compressed public key of private key 1, and the hash its p2pkh address pays to
+    std::vector<uint8_t> publicKey;
+    hex::decode("0279be667ef9dcbbac55a06295ce870b07029bfcdb2dce28d959f2815b16f81798", publicKey);
+    uint8_t digest[ripemd160::DIGEST_SIZE];
+    ripemd160::hash160(publicKey.data(), publicKey.size(), digest);
+    EXPECT_EQ(hex::encode(digest, sizeof(digest)), "751e76e8199196d454941c45d1b3a323f1433bd6");
+}
@@ -0,0 +1,117 @@
+#include <gtest/gtest.h>
+#include <random>
+
+#include "sha256.cpp"
+#include "hex.h"
+
+namespace {
+    /**
+     * Run a test body once with each kernel this CPU supports
+     */
+    template <typename F>
+    void forEachSha256Kernel(F test) {
+        sha256::Kernel original = sha256::currentKernel();
+        for(sha256::Kernel kernel : {sha256::Kernel::scalar, sha256::Kernel::avx2, sha256::Kernel::shani}) {
+            if(!sha256::isSupported(kernel))
+                continue;
+            sha256::setKernel(kernel);
+            SCOPED_TRACE(sha256::kernelName(kernel));
+            test();
+        }
+        sha256::setKernel(original);
+    }
+
+    std::string sha256Hex(const std::string & message) {
+        uint8_t digest[sha256::DIGEST_SIZE];
+        sha256::hash(reinterpret_cast<const uint8_t *>(message.data()), message.size(), digest);
+        return hex::encode(digest, sizeof(digest));
+    }
+
+    std::string sha256dHex(const std::string & message) {
+        uint8_t digest[sha256::DIGEST_SIZE];
+        sha256::doubleHash(reinterpret_cast<const uint8_t *>(message.data()), message.size(), digest);
+        return hex::encode(digest, sizeof(digest));
+    }
+}
+
+
+TEST(Sha256Test, matches_known_digests) {
+    forEachSha256Kernel([] {
+        EXPECT_EQ(sha256Hex(""), "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+        EXPECT_EQ(sha256Hex("abc"), "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+        EXPECT_EQ(sha256Hex("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq"),
+                  "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+        EXPECT_EQ(sha256Hex(std::string(1000000, 'a')), "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0");
+        EXPECT_EQ(sha256dHex("hello"), "9595c9df90075148eb06860365df33584b75bff782a510c6cd4883a419833d50");
+    });
+}
+
+TEST(Sha256Test, incremental_writes_match_one_write) {
+    std::string message(300, '\0');
+    for(size_t i = 0; i < message.size(); ++i)
+        message[i] = static_cast<char>(i * 7);
+    const uint8_t * data = reinterpret_cast<const uint8_t *>(message.data());
+
+    forEachSha256Kernel([&] {
+        uint8_t expected[sha256::DIGEST_SIZE];
+        sha256::hash(data, message.size(), expected);
+
+        for(size_t split = 0; split <= message.size(); split += 13) {
+            uint8_t digest[sha256::DIGEST_SIZE];
+            sha256::Hasher().write(data, split).write(data + split, message.size() - split).finalize(digest);
+            ASSERT_EQ(hex::encode(digest, sizeof(digest)), hex::encode(expected, sizeof(expected))) << "split " << split;
+        }
+    });
+}
+
+TEST(Sha256Test, many_buffers_match_one_at_a_time) {
+    std::mt19937 rng(11);
+    std::uniform_int_distribution<int> byte(0, 255);
+
+    // every length up to a few blocks, in a shuffled order so groups mix lengths
+    std::vector<std::string> messages;
+    for(size_t len = 0; len < 300; ++len) {
+        std::string message;
+        for(size_t i = 0; i < len; ++i)
+            message.push_back(static_cast<char>(byte(rng)));
+        messages.push_back(message);
+    }
+    std::shuffle(messages.begin(), messages.end(), rng);
+
+    std::vector<const uint8_t *> data;
+    std::vector<size_t> lens;
+    for(const std::string & message : messages) {
+        data.push_back(reinterpret_cast<const uint8_t *>(message.data()));
+        lens.push_back(message.size());
+    }
+
+    forEachSha256Kernel([&] {
+        std::vector<uint8_t> digests(messages.size() * sha256::DIGEST_SIZE);
+        sha256::doubleHashMany(data.data(), lens.data(), messages.size(), digests.data());
+        for(size_t i = 0; i < messages.size(); ++i)
+            ASSERT_EQ(hex::encode(&digests[i * sha256::DIGEST_SIZE], sha256::DIGEST_SIZE), sha256dHex(messages[i]))
+                                    << "length " << messages[i].size();
+    });
+}
+
+TEST(Sha256Test, pairs_of_hashes_can_be_hashed_in_place) {
+    std::mt19937 rng(13);
+    std::uniform_int_distribution<int> byte(0, 255);
+
+    for(size_t count : {1, 7, 8, 9, 33}) {
+        std::vector<uint8_t> input(64 * count);
+        for(uint8_t & b : input)
+            b = static_cast<uint8_t>(byte(rng));
+
+        forEachSha256Kernel([&] {
+            std::vector<uint8_t> buffer(input);
+            sha256::doubleHash64(buffer.data(), count, buffer.data());
+            for(size_t i = 0; i < count; ++i) {
+                uint8_t expected[sha256::DIGEST_SIZE];
+                sha256::doubleHash(&input[64 * i], 64, expected);
+                ASSERT_EQ(hex::encode(&buffer[i * sha256::DIGEST_SIZE], sha256::DIGEST_SIZE),
+                          hex::encode(expected, sizeof(expected))) << "count " << count << " index " << i;
+            }
+        });
+    }
+}
@@ -0,0 +1,176 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "singleFlight.h"
+#include "coalescingBitcoinRPCFacade.cpp"
+
+namespace {
+    const int NUM_THREADS = 8;
+
+    /**
+     * Wait (a while, at most) until 'count' reaches 'expected'
+     */
+    template <typename F>
+    void waitFor(F count, size_t expected) {
+        for(int i = 0; i < 2000 && count() < expected; ++i)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    /**
+     * getblock() and getblockheader() don't return until every thread in the test has asked
+     * for the block
+     */
+    class Gated_BitcoinRPCFacade : public BitcoinRPCFacade {
+    public:
+        explicit Gated_BitcoinRPCFacade(const RpcFlights & f) : flights(f) {}
+
+        mutable std::atomic<int> getblockCalls{0};
+        mutable std::atomic<int> getblockheaderCalls{0};
+
+        blockinfo_t getblock(const std::string & hash) const override {
+            ++getblockCalls;
+            waitFor([this] { return flights.coalescedCount(); }, NUM_THREADS - 1);
+            blockinfo_t blockInfo;
+            blockInfo.hash = hash;
+            blockInfo.height = 42;
+            return blockInfo;
+        }
+
+        blockheader_t getblockheader(const std::string & hash) const override {
+            ++getblockheaderCalls;
+            waitFor([this] { return flights.coalescedCount(); }, NUM_THREADS - 1);
+            blockheader_t header;
+            header.hash = hash;
+            header.height = 42;
+            header.confirmations = 6;
+            return header;
+        }
+
+    private:
+        const RpcFlights & flights;
+    };
+}
+
+
+TEST(SingleFlightTest, concurrent_calls_for_same_key_share_one_call) {
+    SingleFlight<std::string, int> singleFlight;
+    std::atomic<int> calls(0);
+    std::vector<int> results(NUM_THREADS);
+
+    std::vector<std::thread> threads;
+    for(int i = 0; i < NUM_THREADS; ++i) {
+        threads.emplace_back([&, i] {
+            results[i] = singleFlight.run("key", [&] {
+                ++calls;
+                waitFor([&] { return singleFlight.coalescedCount(); }, NUM_THREADS - 1);
+                return 7;
+            });
+        });
+    }
+    for(auto & thread : threads)
+        thread.join();
+
+    EXPECT_EQ(calls, 1);
+    EXPECT_EQ(singleFlight.coalescedCount(), static_cast<size_t>(NUM_THREADS - 1));
+    for(int result : results)
+        EXPECT_EQ(result, 7);
+
+    // once finished, nothing is remembered
+    EXPECT_EQ(singleFlight.run("key", [] { return 8; }), 8);
+}
+
+TEST(SingleFlightTest, waiters_get_the_same_exception) {
+    SingleFlight<int, int> singleFlight;
+    std::atomic<int> calls(0);
+    std::atomic<int> failures(0);
+
+    std::vector<std::thread> threads;
+    for(int i = 0; i < NUM_THREADS; ++i) {
+        threads.emplace_back([&] {
+            try {
+                singleFlight.run(1, [&]() -> int {
+                    ++calls;
+                    waitFor([&] { return singleFlight.coalescedCount(); }, NUM_THREADS - 1);
+                    throw std::runtime_error("failed");
+                });
+            }
+            catch(std::runtime_error &) {
+                ++failures;
+            }
+        });
+    }
+    for(auto & thread : threads)
+        thread.join();
+
+    EXPECT_EQ(calls, 1);
+    EXPECT_EQ(failures, NUM_THREADS);
+}
+
+TEST(SingleFlightTest, different_keys_do_not_wait_for_each_other) {
+    SingleFlight<int, int> singleFlight;
+
+    int outer = singleFlight.run(1, [&] {
+        return singleFlight.run(2, [] { return 2; }) + 1;
+    });
+
+    EXPECT_EQ(outer, 3);
+    EXPECT_EQ(singleFlight.coalescedCount(), 0u);
+}
+
+TEST(CoalescingBitcoinRPCFacadeTest, connections_share_one_getblock) {
+    RpcFlights flights;
+    std::vector<std::unique_ptr<Gated_BitcoinRPCFacade>> connections;
+    std::vector<std::unique_ptr<CoalescingBitcoinRPCFacade>> facades;
+    for(int i = 0; i < NUM_THREADS; ++i) {
+        connections.emplace_back(new Gated_BitcoinRPCFacade(flights));
+        facades.emplace_back(new CoalescingBitcoinRPCFacade(*connections.back(), flights));
+    }
+
+    std::vector<int> heights(NUM_THREADS);
+    std::vector<std::thread> threads;
+    for(int i = 0; i < NUM_THREADS; ++i) {
+        threads.emplace_back([&, i] {
+            heights[i] = facades[i]->getblock("hash").height;
+        });
+    }
+    for(auto & thread : threads)
+        thread.join();
+
+    int getblockCalls = 0;
+    for(const auto & connection : connections)
+        getblockCalls += connection->getblockCalls;
+    EXPECT_EQ(getblockCalls, 1);
+    for(int height : heights)
+        EXPECT_EQ(height, 42);
+}
+
+TEST(CoalescingBitcoinRPCFacadeTest, connections_share_one_getblockheader) {
+    RpcFlights flights;
+    std::vector<std::unique_ptr<Gated_BitcoinRPCFacade>> connections;
+    std::vector<std::unique_ptr<CoalescingBitcoinRPCFacade>> facades;
+    for(int i = 0; i < NUM_THREADS; ++i) {
+        connections.emplace_back(new Gated_BitcoinRPCFacade(flights));
+        facades.emplace_back(new CoalescingBitcoinRPCFacade(*connections.back(), flights));
+    }
+
+    std::vector<int> confirmations(NUM_THREADS);
+    std::vector<std::thread> threads;
+    for(int i = 0; i < NUM_THREADS; ++i) {
+        threads.emplace_back([&, i] {
+            confirmations[i] = facades[i]->getblockheader("hash").confirmations;
+        });
+    }
+    for(auto & thread : threads)
+        thread.join();
+
+    int getblockheaderCalls = 0;
+    for(const auto & connection : connections)
+        getblockheaderCalls += connection->getblockheaderCalls;
+    EXPECT_EQ(getblockheaderCalls, 1);
+    EXPECT_EQ(flights.blockHeaders.coalescedCount(), static_cast<size_t>(NUM_THREADS - 1));
+    for(int c : confirmations)
+        EXPECT_EQ(c, 6);
+}
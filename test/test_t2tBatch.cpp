@@ -0,0 +1,155 @@
+#include <gtest/gtest.h>
+#include <sstream>
+
+#include "bitcoinRPCFacade.cpp"
+#include "t2tSupport.cpp"
+#include "t2tBatch.cpp"
+
+/**
+ * A fake BitcoinRPCFacade that knows about a single testnet block (height 1354001) which
+ * holds two transactions. Any other txid is "not found".
+ */
+class Fake_BitcoinRPCFacade : public BitcoinRPCFacade {
+public:
+    static const char txid[];
+
+    blockchaininfo_t getblockchaininfo() const override {
+        blockchaininfo_t info;
+        info.chain = "test";
+        return info;
+    }
+
+    getrawtransaction_t getrawtransaction(const std::string& t, int) const override {
+        if(t != txid)
+            throw BitcoinException(-5, "No such mempool or blockchain transaction.");
+        getrawtransaction_t rawTransaction;
+        rawTransaction.blockhash = "00000000000000e55ba1ad4b1bad0e4bb0d1da70f59f4b2a0e1b7e8a8e1d3ac0";
+        rawTransaction.vout.resize(2);
+        return rawTransaction;
+    }
+
+    std::string getblockhash(int) const override {
+        return "00000000000000e55ba1ad4b1bad0e4bb0d1da70f59f4b2a0e1b7e8a8e1d3ac0";
+    }
+
+    blockinfo_t getblock(const std::string&) const override {
+        blockinfo_t blockInfo;
+        blockInfo.height = 1354001;
+        blockInfo.confirmations = 100;
+        blockInfo.tx = {"1c95d3b5c1c0d3e8ea4f7f5cb7e0e5d3f27b4b1e39f0e1d4e2d0f2e7c3b6a9d8", txid};
+        return blockInfo;
+    }
+};
+
+const char Fake_BitcoinRPCFacade::txid[] = "f8cdaff3ebd9e862ed5885f8975489090595abe1470397f79780ead1c7528107";
+
+
+TEST(T2tBatchTest, txid_line_is_encoded) {
+    Fake_BitcoinRPCFacade btc;
+
+    t2t::BatchRecord record = t2t::processLine(btc, Fake_BitcoinRPCFacade::txid, 3, -1);
+
+    EXPECT_TRUE(record.ok);
+    EXPECT_EQ(record.line, 3u);
+    EXPECT_EQ(record.transaction.blockHeight, 1354001);
+    EXPECT_EQ(record.transaction.transactionIndex, 1);
+    EXPECT_EQ(record.transaction.txoIndex, 0);
+}
+
+TEST(T2tBatchTest, txoIndex_on_line_is_used) {
+    Fake_BitcoinRPCFacade btc;
+
+    t2t::BatchRecord record =
+            t2t::processLine(btc, std::string(Fake_BitcoinRPCFacade::txid) + " 1", 1, -1);
+
+    EXPECT_TRUE(record.ok);
+    EXPECT_EQ(record.transaction.txoIndex, 1);
+}
+
+TEST(T2tBatchTest, txoIndex_ignored_for_a_txref_is_warned_about) {
+    Fake_BitcoinRPCFacade btc;
+    const std::string txref = "txtest1:xz35-jzpq-quez-e06";
+    const std::string txrefext = "txtest1:8z35-jzpq-qpqq-ntyy-0r";   // txoIndex 1
+
+    // --txoIndex applies to txids, and means nothing to a txref that agrees with it
+    t2t::BatchRecord record = t2t::processLine(btc, txref, 1, 0);
+    ASSERT_TRUE(record.ok) << record.error;
+    EXPECT_EQ(record.transaction.txid, Fake_BitcoinRPCFacade::txid);
+    EXPECT_EQ(record.warning, "");
+    record = t2t::processLine(btc, txrefext, 1, 1);
+    ASSERT_TRUE(record.ok) << record.error;
+    EXPECT_EQ(record.warning, "");
+
+    record = t2t::processLine(btc, txref, 1, 2);
+    EXPECT_EQ(record.warning, "txoIndex '2' was ignored as a txref with no index encoded within refers to output 0.");
+    record = t2t::processLine(btc, txrefext, 1, 2);
+    EXPECT_EQ(record.warning, "txoIndex '2' was ignored as the txref given already has an index '1' encoded within.");
+
+    // one on the line itself is always warned about
+    record = t2t::processLine(btc, txrefext + " 1", 1, -1);
+    EXPECT_EQ(record.warning, "txoIndex '1' was ignored as the txref given already has an index '1' encoded within.");
+}
+
+TEST(T2tBatchTest, bad_lines_become_error_records) {
+    Fake_BitcoinRPCFacade btc;
+
+    t2t::BatchRecord record = t2t::processLine(btc, "foobarfoobar", 1, -1);
+    EXPECT_FALSE(record.ok);
+    EXPECT_EQ(record.error, "foobarfoobar is an invalid txid or txref.");
+
+    std::string unknownTxid = "f8cdaff3ebd9e862ed5885f8975489090595abe1470397f79780ead1c7528108";
+    record = t2t::processLine(btc, unknownTxid, 2, -1);
+    EXPECT_FALSE(record.ok);
+    EXPECT_EQ(record.error, "transaction " + unknownTxid + " not found.");
+
+    record = t2t::processLine(btc, std::string(Fake_BitcoinRPCFacade::txid) + " 5", 3, -1);
+    EXPECT_FALSE(record.ok);
+    EXPECT_NE(record.error.find("too large"), std::string::npos);
+}
+
+TEST(T2tBatchTest, txref_lookup_failures_are_results_not_exceptions) {
+    Fake_BitcoinRPCFacade btc;
+
+    // transaction position 1022 is past the end of the fake block
+    Result<t2t::Transaction> transaction = t2t::tryDecodeTxref(btc, "txtest1:8z4h-jz7l-qpqq-xkh8-xa");
+    EXPECT_FALSE(transaction.ok());
+    EXPECT_NE(transaction.error().find("1022"), std::string::npos);
+
+    // bad checksum
+    transaction = t2t::tryDecodeTxref(btc, "txtest1:8z4h-jz7l-qpqq-xkh8-xq");
+    EXPECT_FALSE(transaction.ok());
+
+    t2t::BatchRecord record = t2t::processLine(btc, "txtest1:8z4h-jz7l-qpqq-xkh8-xa", 1, -1);
+    EXPECT_FALSE(record.ok);
+    EXPECT_NE(record.error.find("1022"), std::string::npos);
+}
+
+TEST(T2tBatchTest, batch_output_is_in_input_order) {
+    std::stringstream in;
+    for(int i = 0; i < 50; ++i) {
+        in << (i % 7 == 0 ? "foobarfoobar" : Fake_BitcoinRPCFacade::txid) << "\n";
+        if(i % 10 == 0)
+            in << "\n";   // blank lines are skipped, but still counted
+    }
+
+    t2t::BatchOptions options;
+    options.jobs = 4;
+
+    std::stringstream out;
+    size_t numErrors = t2t::processBatch(in, out,
+            [] { return std::unique_ptr<BitcoinRPCFacade>(new Fake_BitcoinRPCFacade()); },
+            options);
+
+    EXPECT_EQ(numErrors, 8u);
+
+    std::string line;
+    int numLines = 0;
+    size_t lastLineNumber = 0;
+    while(std::getline(out, line)) {
+        ++numLines;
+        size_t lineNumber = std::stoul(line.substr(line.find("\"line\":") + 7));
+        EXPECT_GT(lineNumber, lastLineNumber);
+        lastLineNumber = lineNumber;
+    }
+    EXPECT_EQ(numLines, 50);
+}
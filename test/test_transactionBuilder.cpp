@@ -0,0 +1,119 @@
+#include <gtest/gtest.h>
+
+#include "transactionBuilder.cpp"
+#include "rawTransaction.h"
+
+namespace {
+
+    Hash256 hashFromHex(const std::string & text) {
+        std::vector<uint8_t> bytes;
+        hex::decode(text, bytes);
+        Hash256 hash;
+        std::copy(bytes.begin(), bytes.end(), hash.begin());
+        return hash;
+    }
+
+    std::vector<uint8_t> bytesFromHex(const std::string & text) {
+        std::vector<uint8_t> bytes;
+        hex::decode(text, bytes);
+        return bytes;
+    }
+}
+
+
+TEST(TransactionBuilderTest, serializes_a_legacy_transaction) {
+    // the unsigned transaction from BIP 143's native P2WPKH example
+    TransactionBuilder builder;
+    builder.setVersion(1).setLockTime(17)
+           .addInput(hashFromHex("fff7f7881a8099afa6940d42d1e7f6362bec38171ea3edf433541db4e4ad969f"), 0, 0xffffffee)
+           .addInput(hashFromHex("ef51e1b804cc89d182d279655c3aa89e815b1b309fe287d9b2b55d57b90ec68a"), 1)
+           .addOutput(Amount::fromSatoshis(112340000), bytesFromHex("76a9148280b37df378db99f66f85c95a783a76ac7a6d5988ac"))
+           .addOutput(Amount::fromSatoshis(223450000), bytesFromHex("76a9143bde42dbee7e4dbe6a21b2d50ce2f0167faa815988ac"));
+
+    EXPECT_EQ(builder.toHex(),
+              "0100000002fff7f7881a8099afa6940d42d1e7f6362bec38171ea3edf433541db4e4ad969f0000000000eeffffff"
+              "ef51e1b804cc89d182d279655c3aa89e815b1b309fe287d9b2b55d57b90ec68a0100000000ffffffff02202cb2060000"
+              "00001976a9148280b37df378db99f66f85c95a783a76ac7a6d5988ac9093510d000000001976a9143bde42dbee7e4dbe"
+              "6a21b2d50ce2f0167faa815988ac11000000");
+    EXPECT_FALSE(builder.hasWitness());
+    EXPECT_EQ(builder.weight(), 4 * builder.serialize().size());
+    EXPECT_EQ(builder.vsize(), builder.serialize().size());
+}
+
+TEST(TransactionBuilderTest, serializes_witness_data_once_there_is_some) {
+    TransactionBuilder builder;
+    builder.addInput(hashFromHex("11" + std::string(62, '0')), 3)
+           .addOpReturn({'h', 'i'})
+           .addOutput(Amount::fromSatoshis(5000), bytesFromHex("0014751e76e8199196d454941c45d1b3a323f1433bd6"));
+    Hash256 unsignedTxid = builder.txid();
+    size_t unsignedSize = builder.serialize().size();
+
+    builder.inputs()[0].witness = {std::vector<uint8_t>(71, 0x30), std::vector<uint8_t>(33, 0x02)};
+    ASSERT_TRUE(builder.hasWitness());
+    std::vector<uint8_t> bytes = builder.serialize();
+
+    // the witness doesn't change the txid, and each witness byte weighs a quarter of the rest
+    EXPECT_EQ(builder.txid(), unsignedTxid);
+    EXPECT_EQ(builder.serializeWithoutWitness().size(), unsignedSize);
+    EXPECT_EQ(builder.weight(), 3 * unsignedSize + bytes.size());
+
+    Result<RawTransaction> parsed = RawTransaction::parse(bytes.data(), bytes.size());
+    ASSERT_TRUE(parsed) << parsed.error();
+    const RawTransaction & tx = parsed.value();
+    EXPECT_EQ(tx.version(), 2);
+    EXPECT_TRUE(tx.hasWitness());
+    ASSERT_EQ(tx.inputs().size(), 1u);
+    EXPECT_EQ(tx.inputs()[0].prevIndex, 3u);
+    EXPECT_EQ(tx.inputs()[0].sequence, 0xffffffffu);
+    ASSERT_EQ(tx.inputs()[0].witness.size(), 2u);
+    EXPECT_EQ(tx.inputs()[0].witness[0].size, 71u);
+    ASSERT_EQ(tx.outputs().size(), 2u);
+    EXPECT_TRUE(isOpReturn(tx.outputs()[0].scriptPubKey));
+    EXPECT_EQ(tx.outputs()[0].value, 0);
+    EXPECT_EQ(tx.outputs()[1].value, 5000);
+    EXPECT_EQ(tx.txid(), unsignedTxid);
+}
+
+TEST(TransactionBuilderTest, uses_the_smallest_push_for_op_return_data) {
+    TransactionBuilder builder;
+    builder.addOpReturn({})
+           .addOpReturn(std::vector<uint8_t>(75, 0xaa))
+           .addOpReturn(std::vector<uint8_t>(80, 0xbb));
+
+    const std::vector<TxOutput> & outputs = builder.outputs();
+    EXPECT_EQ(outputs[0].scriptPubKey, std::vector<uint8_t>{0x6a});
+    EXPECT_EQ(outputs[1].scriptPubKey.size(), 77u);
+    EXPECT_EQ(outputs[1].scriptPubKey[1], 75);
+    EXPECT_EQ(outputs[2].scriptPubKey.size(), 83u);
+    EXPECT_EQ(outputs[2].scriptPubKey[1], 0x4c);
+    EXPECT_EQ(outputs[2].scriptPubKey[2], 80);
+
+    EXPECT_THROW(builder.addOpReturn(std::vector<uint8_t>(81)), std::invalid_argument);
+}
+
+TEST(TransactionBuilderTest, estimates_the_signed_size) {
+    // a DID transaction: one input, an OP_RETURN and the change
+    TransactionBuilder builder;
+    builder.addInput(Hash256(), 0)
+           .addOpReturn(std::vector<uint8_t>(20, 0x61))
+           .addOutput(Amount::fromSatoshis(100000), bytesFromHex("0014751e76e8199196d454941c45d1b3a323f1433bd6"));
+
+    // 113 bytes outside the witness; 110 in it (marker, flag, and a 72-byte signature and 33-byte key)
+    EXPECT_EQ(builder.estimateSignedVsize({AddressType::p2wpkh}), 141u);
+    // the same signature and key in the scriptSig weigh four times as much
+    EXPECT_EQ(builder.estimateSignedVsize({AddressType::p2pkh}), 113u + 107u);
+    EXPECT_EQ(builder.estimateSignedVsize({AddressType::p2sh}), 141u + 23u);
+    // estimating doesn't change the transaction
+    EXPECT_FALSE(builder.hasWitness());
+
+    EXPECT_THROW(builder.estimateSignedVsize({}), std::invalid_argument);
+    EXPECT_THROW(builder.estimateSignedVsize({AddressType::p2wsh}), std::invalid_argument);
+}
+
+TEST(TransactionBuilderTest, knows_the_dust_threshold_of_each_output_type) {
+    EXPECT_EQ(TransactionBuilder::dustThreshold(bytesFromHex("76a914751e76e8199196d454941c45d1b3a323f1433bd688ac")).satoshis(), 546);
+    EXPECT_EQ(TransactionBuilder::dustThreshold(bytesFromHex("a914751e76e8199196d454941c45d1b3a323f1433bd687")).satoshis(), 540);
+    EXPECT_EQ(TransactionBuilder::dustThreshold(bytesFromHex("0014751e76e8199196d454941c45d1b3a323f1433bd6")).satoshis(), 294);
+    EXPECT_EQ(TransactionBuilder::dustThreshold(bytesFromHex("5120" + std::string(64, '1'))).satoshis(), 330);
+    EXPECT_EQ(TransactionBuilder::dustThreshold(bytesFromHex("6a0401020304")).satoshis(), 0);
+}
@@ -0,0 +1,205 @@
+#include <gtest/gtest.h>
+
+#include "secp256k1Context.cpp"
+#include "privateKey.cpp"
+#include "transactionSigner.cpp"
+#include "hex.h"
+
+#include <algorithm>
+
+namespace {
+
+    std::vector<uint8_t> fromHex(const std::string & text) {
+        std::vector<uint8_t> bytes;
+        hex::decode(text, bytes);
+        return bytes;
+    }
+
+    std::string toHex(const std::vector<uint8_t> & bytes) {
+        return hex::encode(bytes.data(), bytes.size());
+    }
+
+    PrivateKey keyFromHex(const std::string & text, bool compressed = true) {
+        return PrivateKey::fromSecret(fromHex(text).data(), compressed).value();
+    }
+
+    Hash256 hashFromHex(const std::string & text) {
+        std::vector<uint8_t> bytes = fromHex(text);
+        Hash256 hash;
+        std::copy(bytes.begin(), bytes.end(), hash.begin());
+        return hash;
+    }
+
+    /**
+     * Check a DER signature with a sighash byte on the end, the way a node would
+     */
+    bool verifies(const std::vector<uint8_t> & signature, const Hash256 & hash, const std::vector<uint8_t> & publicKey) {
+        const secp256k1_context * context = secp256k1Context();
+        secp256k1_ecdsa_signature sig;
+        secp256k1_pubkey pubkey;
+        return signature.back() == 0x01 &&
+               secp256k1_ecdsa_signature_parse_der(context, &sig, signature.data(), signature.size() - 1) &&
+               secp256k1_ec_pubkey_parse(context, &pubkey, publicKey.data(), publicKey.size()) &&
+               secp256k1_ecdsa_verify(context, &sig, hash.data(), &pubkey);
+    }
+
+    /**
+     * The unsigned transaction from BIP 143's native P2WPKH example
+     */
+    TransactionBuilder bip143NativeExample() {
+        TransactionBuilder tx;
+        tx.setVersion(1).setLockTime(17)
+          .addInput(hashFromHex("fff7f7881a8099afa6940d42d1e7f6362bec38171ea3edf433541db4e4ad969f"), 0, 0xffffffee)
+          .addInput(hashFromHex("ef51e1b804cc89d182d279655c3aa89e815b1b309fe287d9b2b55d57b90ec68a"), 1)
+          .addOutput(Amount::fromSatoshis(112340000), fromHex("76a9148280b37df378db99f66f85c95a783a76ac7a6d5988ac"))
+          .addOutput(Amount::fromSatoshis(223450000), fromHex("76a9143bde42dbee7e4dbe6a21b2d50ce2f0167faa815988ac"));
+        return tx;
+    }
+}
+
+
+TEST(PrivateKeyTest, decodes_wif_keys) {
+    Result<PrivateKey> one = PrivateKey::fromWif("KwDiBf89QgGbjEhKnhXJuH7LrciVrZi3qYjgd9M7rFU73sVHnoWn", "main");
+    ASSERT_TRUE(one) << one.error();
+    EXPECT_TRUE(one.value().isCompressed());
+    EXPECT_EQ(toHex(one.value().publicKey()), "0279be667ef9dcbbac55a06295ce870b07029bfcdb2dce28d959f2815b16f81798");
+
+    Result<PrivateKey> testnet = PrivateKey::fromWif("cMahea7zqjxrtgAbB7LSGbcQUr1uX1ojuat9jZodMN87JcbXMTcA", "regtest");
+    ASSERT_TRUE(testnet) << testnet.error();
+    EXPECT_EQ(testnet.value().publicKey(), one.value().publicKey());
+
+    Result<PrivateKey> uncompressed = PrivateKey::fromWif("91iS7EZqPeRGqPXcPiKLtbfjfLVUYYj17oQ54H3iFFw3n1UmZSS", "test");
+    ASSERT_TRUE(uncompressed) << uncompressed.error();
+    EXPECT_FALSE(uncompressed.value().isCompressed());
+    EXPECT_EQ(toHex(uncompressed.value().publicKey()),
+              "044f355bdcb7cc0af728ef3cceb9615d90684bb5b2ca5f859ab0f0b704075871aa"
+              "385b6b1b8ead809ca67454d9683fcf2ba03456d6fe2c4abe2b07f0fbdbb2f1c1");
+}
+
+TEST(PrivateKeyTest, rejects_bad_wif_keys_without_echoing_them) {
+    Result<PrivateKey> wrongChain = PrivateKey::fromWif("KwDiBf89QgGbjEhKnhXJuH7LrciVrZi3qYjgd9M7rFU73sVHnoWn", "test");
+    ASSERT_FALSE(wrongChain);
+    EXPECT_EQ(wrongChain.error(), "Private key is not for the test chain");
+
+    Result<PrivateKey> badChecksum = PrivateKey::fromWif("KwDiBf89QgGbjEhKnhXJuH7LrciVrZi3qYjgd9M7rFU73sVHnoWo", "main");
+    ASSERT_FALSE(badChecksum);
+    EXPECT_EQ(badChecksum.error().find("KwDiBf"), std::string::npos);
+
+    // a valid Base58Check string that is an address, not a key
+    EXPECT_FALSE(PrivateKey::fromWif("1A1zP1eP5QGefi2DMPTfTL5SLmv7DivfNa", "main"));
+    EXPECT_FALSE(PrivateKey::fromWif("KwDiBf89QgGbjEhKnhXJuH7LrciVrZi3qYjgd9M7rFU73sVHnoWn", "nonesuch"));
+
+    std::vector<uint8_t> zero(PrivateKey::SIZE);
+    EXPECT_FALSE(PrivateKey::fromSecret(zero.data(), true));
+    // the curve order is out of range too
+    EXPECT_FALSE(PrivateKey::fromSecret(fromHex("fffffffffffffffffffffffffffffffebaaedce6af48a03bbfd25e8cd0364141").data(), true));
+}
+
+TEST(PrivateKeyTest, signs_deterministically_with_a_low_s) {
+    PrivateKey key = keyFromHex(std::string(64, '1'));
+    Hash256 hash = hashFromHex("08b489eb4120aa4824a8b73ab12f6dd50229f0705eb34e5faa27978bf64f6e43");
+    std::vector<uint8_t> first = key.sign(hash.data());
+    EXPECT_EQ(key.sign(hash.data()), first);
+
+    secp256k1_ecdsa_signature sig, normalized;
+    ASSERT_TRUE(secp256k1_ecdsa_signature_parse_der(secp256k1Context(), &sig, first.data(), first.size()));
+    EXPECT_FALSE(secp256k1_ecdsa_signature_normalize(secp256k1Context(), &normalized, &sig));
+}
+
+TEST(TransactionSignerTest, computes_bip143_signature_hashes) {
+    TransactionBuilder tx = bip143NativeExample();
+    TransactionSigner signer(tx);
+    Hash256 hash = signer.segwitSignatureHash(1, fromHex("76a9141d0f172a0ecb48aee1be1f2687d2963ae33f71a188ac"),
+                                              Amount::fromSatoshis(600000000));
+    EXPECT_EQ(hex::encode(hash.data(), hash.size()), "c37af31116d1b27caf68aae9e3ac82f1477929014d5b917657d0eb49478cb670");
+}
+
+TEST(TransactionSignerTest, signs_a_p2wpkh_input) {
+    TransactionBuilder tx = bip143NativeExample();
+    TransactionSigner signer(tx);
+    PrivateKey key = keyFromHex("619c335025c7f4012e556c2a58b2506e30b8511b53ade95ea316fd8c3286feb9");
+
+    Result<AddressType> type = signer.signInput(1, key, fromHex("00141d0f172a0ecb48aee1be1f2687d2963ae33f71a1"),
+                                                Amount::fromSatoshis(600000000));
+    ASSERT_TRUE(type) << type.error();
+    EXPECT_EQ(type.value(), AddressType::p2wpkh);
+
+    const TxInput & input = tx.inputs()[1];
+    EXPECT_TRUE(input.scriptSig.empty());
+    ASSERT_EQ(input.witness.size(), 2u);
+    // the same signature BIP 143 gives, as both use RFC 6979 nonces
+    EXPECT_EQ(toHex(input.witness[0]),
+              "304402203609e17b84f6a7d30c80bfa610b5b4542f32a8a0d5447a12fb1366d7f01cc44a"
+              "0220573a954c4518331561406f90300e8f3358f51928d43c212a8caed02de67eebee01");
+    EXPECT_EQ(toHex(input.witness[1]), "025476c2e83188368da1ff3e292e7acafcdb3566bb0ad253f62fc70f07aeee6357");
+}
+
+TEST(TransactionSignerTest, signs_a_p2sh_wrapped_p2wpkh_input) {
+    // BIP 143's P2SH-P2WPKH example
+    TransactionBuilder tx;
+    tx.setVersion(1).setLockTime(1170)
+      .addInput(hashFromHex("db6b1b20aa0fd7b23880be2ecbd4a98130974cf4748fb66092ac4d3ceb1a5477"), 1, 0xfffffffe)
+      .addOutput(Amount::fromSatoshis(199996600), fromHex("76a914a457b684d7f0d539a46a45bbc043f35b59d0d96388ac"))
+      .addOutput(Amount::fromSatoshis(800000000), fromHex("76a914fd270b1ee6abcaea97fea7ad0402e8bd8ad6d77c88ac"));
+    TransactionSigner signer(tx);
+    PrivateKey key = keyFromHex("eb696a065ef48a2192da5b28b694f87544b30fae8327c4510137a922f32c6dcf");
+
+    Result<AddressType> type = signer.signInput(0, key, fromHex("a9144733f37cf4db86fbc2efed2500b4f4e49f31202387"),
+                                                Amount::fromSatoshis(1000000000));
+    ASSERT_TRUE(type) << type.error();
+    EXPECT_EQ(type.value(), AddressType::p2sh);
+    EXPECT_EQ(tx.toHex(),
+              "01000000000101db6b1b20aa0fd7b23880be2ecbd4a98130974cf4748fb66092ac4d3ceb1a5477010000001716001479091972"
+              "186c449eb1ded22b78e40d009bdf0089feffffff02b8b4eb0b000000001976a914a457b684d7f0d539a46a45bbc043f35b59d0"
+              "d96388ac0008af2f000000001976a914fd270b1ee6abcaea97fea7ad0402e8bd8ad6d77c88ac02473044022047ac8e878352d3"
+              "ebbde1c94ce3a10d057c24175747116f8288e5d794d12d482f0220217f36a485cae903c713331d877c1f64677e3622ad401072"
+              "6870540656fe9dcb012103ad1d8e89212f0b92c74d23bb710c00662ad1470198ac48c43f7d6f93a2a2687392040000");
+}
+
+TEST(TransactionSignerTest, signs_a_p2pkh_input) {
+    std::vector<uint8_t> spentScript = fromHex("76a914fc7250a211deddc70ee5a2738de5f07817351cef88ac");
+    TransactionBuilder tx;
+    tx.addInput(hashFromHex(std::string(64, '2')), 1)
+      .addOutput(Amount::fromSatoshis(50000), spentScript);
+    TransactionSigner signer(tx);
+    PrivateKey key = keyFromHex(std::string(64, '1'));
+
+    Hash256 hash = signer.legacySignatureHash(0, spentScript);
+    EXPECT_EQ(hex::encode(hash.data(), hash.size()), "08b489eb4120aa4824a8b73ab12f6dd50229f0705eb34e5faa27978bf64f6e43");
+
+    Result<AddressType> type = signer.signInput(0, key, spentScript, Amount::fromSatoshis(60000));
+    ASSERT_TRUE(type) << type.error();
+    EXPECT_EQ(type.value(), AddressType::p2pkh);
+    EXPECT_FALSE(tx.hasWitness());
+
+    // <signature> <public key>
+    const std::vector<uint8_t> & scriptSig = tx.inputs()[0].scriptSig;
+    ASSERT_GT(scriptSig.size(), 1u + scriptSig[0]);
+    std::vector<uint8_t> signature(scriptSig.begin() + 1, scriptSig.begin() + 1 + scriptSig[0]);
+    std::vector<uint8_t> publicKey(scriptSig.begin() + 2 + scriptSig[0], scriptSig.end());
+    EXPECT_EQ(publicKey, key.publicKey());
+    EXPECT_TRUE(verifies(signature, hash, publicKey));
+}
+
+TEST(TransactionSignerTest, refuses_what_it_cannot_sign) {
+    TransactionBuilder tx = bip143NativeExample();
+    TransactionSigner signer(tx);
+    PrivateKey key = keyFromHex(std::string(64, '1'));
+    Amount amount = Amount::fromSatoshis(600000000);
+
+    Result<AddressType> wrongKey = signer.signInput(1, key, fromHex("00141d0f172a0ecb48aee1be1f2687d2963ae33f71a1"), amount);
+    ASSERT_FALSE(wrongKey);
+    EXPECT_EQ(wrongKey.error(), "The private key does not match the output spent by input 1");
+    EXPECT_FALSE(signer.signInput(1, key, fromHex("a9144733f37cf4db86fbc2efed2500b4f4e49f31202387"), amount));
+
+    PrivateKey uncompressed = keyFromHex(std::string(64, '1'), false);
+    EXPECT_FALSE(signer.signInput(1, uncompressed, fromHex("0014fc7250a211deddc70ee5a2738de5f07817351cef"), amount));
+
+    EXPECT_FALSE(signer.signInput(1, key, fromHex("51200000000000000000000000000000000000000000000000000000000000000000"), amount));
+    EXPECT_FALSE(signer.signInput(1, key, fromHex("6a0401020304"), amount));
+    EXPECT_THROW(signer.signInput(2, key, fromHex("76a914fc7250a211deddc70ee5a2738de5f07817351cef88ac"), amount),
+                 std::out_of_range);
+
+    // nothing was changed
+    EXPECT_TRUE(tx.inputs()[1].witness.empty());
+}
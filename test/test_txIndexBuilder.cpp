@@ -0,0 +1,307 @@
+#include <gtest/gtest.h>
+
+#include "txIndex.cpp"
+#include "txIndexBuilder.cpp"
+#include "merkle.h"
+#include "sha256.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+
+namespace {
+
+    void appendLE32(std::vector<uint8_t> & out, uint32_t value) {
+        for(int i = 0; i < 4; ++i)
+            out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+
+    /**
+     * A coinbase-like transaction, made unique by 'tag'
+     */
+    std::vector<uint8_t> taggedTransaction(uint32_t tag) {
+        std::vector<uint8_t> tx;
+        appendLE32(tx, 1);
+        tx.push_back(1);
+        tx.insert(tx.end(), 32, 0);
+        appendLE32(tx, 0xffffffff);
+        tx.push_back(5);
+        tx.push_back(4);
+        appendLE32(tx, tag);
+        appendLE32(tx, 0xffffffff);
+        tx.push_back(1);
+        tx.insert(tx.end(), {0x00, 0xf2, 0x05, 0x2a, 0x01, 0x00, 0x00, 0x00});
+        tx.push_back(1);
+        tx.push_back(0x51);
+        appendLE32(tx, 0);
+        return tx;
+    }
+
+    /**
+     * A regtest chain served over fake RPC. Block 'height' holds (height % 3) + 1 transactions.
+     * Blocks from 'forkHeight' up are made different by 'variant', to stand in for a reorg.
+     */
+    class FakeChain {
+    public:
+        FakeChain(int length, uint32_t variant = 0, int forkHeight = 0) {
+            Hash256 prev = {};
+            for(int height = 0; height < length; ++height) {
+                uint32_t base = static_cast<uint32_t>(height) * 16 + (height >= forkHeight ? variant * 100000 : 0);
+                std::vector<std::vector<uint8_t>> txs;
+                std::vector<uint8_t> txidBytes;
+                std::vector<Hash256> blockTxids;
+                for(uint32_t i = 0; i <= static_cast<uint32_t>(height) % 3; ++i) {
+                    txs.push_back(taggedTransaction(base + i));
+                    Hash256 txid;
+                    sha256::doubleHash(txs.back().data(), txs.back().size(), txid.data());
+                    blockTxids.push_back(txid);
+                    txidBytes.insert(txidBytes.end(), txid.begin(), txid.end());
+                }
+                Hash256 merkleRoot;
+                merkle::root(txidBytes.data(), txs.size(), merkleRoot.data());
+
+                std::vector<uint8_t> block;
+                appendLE32(block, 4);
+                block.insert(block.end(), prev.begin(), prev.end());
+                block.insert(block.end(), merkleRoot.begin(), merkleRoot.end());
+                appendLE32(block, 1600000000 + base);
+                appendLE32(block, 0x207fffff);
+                appendLE32(block, base);
+                block.push_back(static_cast<uint8_t>(txs.size()));
+                for(const std::vector<uint8_t> & tx : txs)
+                    block.insert(block.end(), tx.begin(), tx.end());
+
+                prev = BlockHeader::parse(block.data()).hash;
+                hashes.push_back(hex::encodeHash(prev.data()));
+                blocks.push_back(hex::encode(block.data(), block.size()));
+                txids.push_back(blockTxids);
+            }
+        }
+
+        std::vector<std::string> hashes;
+        std::vector<std::string> blocks;
+        std::vector<std::vector<Hash256>> txids;
+    };
+
+    class FakeChain_BitcoinRPCFacade : public BitcoinRPCFacade {
+    public:
+        FakeChain_BitcoinRPCFacade(const FakeChain & c, std::atomic<int> & calls, int failAt)
+                : chain(c), getrawblockCalls(calls), failAtHeight(failAt) {
+        }
+
+        blockchaininfo_t getblockchaininfo() const override {
+            blockchaininfo_t info;
+            info.chain = "regtest";
+            info.blocks = static_cast<int>(chain.hashes.size()) - 1;
+            return info;
+        }
+
+        std::string getblockhash(int height) const override {
+            return chain.hashes.at(static_cast<size_t>(height));
+        }
+
+        std::string getrawblock(const std::string & hash) const override {
+            ++getrawblockCalls;
+            auto found = std::find(chain.hashes.begin(), chain.hashes.end(), hash);
+            if(found == chain.hashes.end())
+                throw std::runtime_error("Block not found");
+            if(found - chain.hashes.begin() == failAtHeight)
+                throw std::runtime_error("Connection lost");
+            return chain.blocks[static_cast<size_t>(found - chain.hashes.begin())];
+        }
+
+    private:
+        const FakeChain & chain;
+        std::atomic<int> & getrawblockCalls;
+        int failAtHeight;
+    };
+
+    /**
+     * A directory to build indexes in, removed afterwards with everything in it
+     */
+    class IndexDir {
+    public:
+        IndexDir() {
+            char pattern[] = "/tmp/btcrTxIndexXXXXXX";
+            path = ::mkdtemp(pattern);
+            indexPath = path + "/txindex";
+        }
+
+        ~IndexDir() {
+            std::string command = "rm -rf '" + path + "'";
+            EXPECT_EQ(std::system(command.c_str()), 0);
+        }
+
+        std::string path;
+        std::string indexPath;
+    };
+
+    /**
+     * Build an index of 'chain' with segments of 10 blocks on 3 threads
+     * @return the number of getrawblock calls made
+     */
+    int buildIndex(const FakeChain & chain, const std::string & indexPath, int toHeight = -1, int failAtHeight = -1,
+                   const TxIndexBuilder::ProgressCallback & progress = TxIndexBuilder::ProgressCallback()) {
+        std::atomic<int> calls(0);
+        TxIndexBuilder builder([&] {
+            return std::unique_ptr<BitcoinRPCFacade>(new FakeChain_BitcoinRPCFacade(chain, calls, failAtHeight));
+        }, 3, 10);
+        builder.build(indexPath, toHeight, progress);
+        return calls;
+    }
+
+    /**
+     * Write 'chain' to a regtest block file in 'dir', as bitcoind would
+     */
+    void writeBlockFile(const FakeChain & chain, const std::string & dir) {
+        const uint8_t regtestMagic[] = {0xfa, 0xbf, 0xb5, 0xda};
+        std::vector<uint8_t> contents;
+        std::vector<uint8_t> block;
+        for(const std::string & blockHex : chain.blocks) {
+            hex::decode(blockHex, block);
+            contents.insert(contents.end(), regtestMagic, regtestMagic + 4);
+            appendLE32(contents, static_cast<uint32_t>(block.size()));
+            contents.insert(contents.end(), block.begin(), block.end());
+        }
+        std::ofstream out(dir + "/blk00000.dat", std::ios::binary);
+        out.write(reinterpret_cast<const char *>(contents.data()), static_cast<std::streamsize>(contents.size()));
+    }
+
+    void expectIndexed(const FakeChain & chain, const std::string & indexPath, int toHeight) {
+        TxIndex index(indexPath);
+        size_t expected = 0;
+        for(int height = 0; height <= toHeight; ++height) {
+            const std::vector<Hash256> & txids = chain.txids[static_cast<size_t>(height)];
+            for(size_t position = 0; position < txids.size(); ++position) {
+                TxIndexEntry entry;
+                ASSERT_TRUE(index.find(txids[position], entry));
+                EXPECT_EQ(entry.height, static_cast<uint32_t>(height));
+                EXPECT_EQ(entry.position, static_cast<uint32_t>(position));
+            }
+            expected += txids.size();
+        }
+        EXPECT_EQ(index.size(), expected);
+    }
+}
+
+
+TEST(TxIndexTest, records_round_trip_and_sort_by_txid_then_height) {
+    TxIndexEntry entry{{}, 0x01020304, 7};
+    entry.txid[0] = 0xab;
+    TxIndex::Record record = TxIndex::encode(entry);
+    TxIndexEntry decoded = TxIndex::decode(record.data());
+    EXPECT_EQ(decoded.txid, entry.txid);
+    EXPECT_EQ(decoded.height, 0x01020304u);
+    EXPECT_EQ(decoded.position, 7u);
+
+    TxIndexEntry later = entry;
+    later.height = 0x01020305;
+    EXPECT_LT(TxIndex::encode(entry), TxIndex::encode(later));
+}
+
+TEST(TxIndexTest, rejects_files_that_are_not_indexes) {
+    IndexDir dir;
+    std::ofstream(dir.indexPath) << "not an index";
+    EXPECT_THROW(TxIndex index(dir.indexPath), std::runtime_error);
+    EXPECT_THROW(TxIndex index(dir.path + "/missing"), std::runtime_error);
+}
+
+TEST(TxIndexBuilderTest, indexes_every_transaction) {
+    FakeChain chain(45);
+    IndexDir dir;
+
+    std::vector<TxIndexProgress> reports;
+    buildIndex(chain, dir.indexPath, -1, -1, [&](const TxIndexProgress & progress) { reports.push_back(progress); });
+    expectIndexed(chain, dir.indexPath, 44);
+
+    TxIndex index(dir.indexPath);
+    TxIndexEntry entry;
+    EXPECT_FALSE(index.find(Hash256(), entry));
+
+    // the segments and checkpoint are cleaned up
+    struct stat st;
+    EXPECT_NE(::stat((dir.indexPath + ".partial").c_str(), &st), 0);
+
+    ASSERT_GE(reports.size(), 2u);
+    EXPECT_EQ(reports.front().blocksDone, 0);
+    EXPECT_EQ(reports.back().blocksDone, 45);
+    EXPECT_EQ(reports.back().blocksTotal, 45);
+    EXPECT_EQ(reports.back().transactions, index.size());
+    EXPECT_GT(reports.back().bytes, 45u * BlockHeader::SIZE);
+    EXPECT_GT(reports.back().blocksPerSecond, 0);
+    EXPECT_DOUBLE_EQ(reports.back().secondsLeft, 0);
+}
+
+TEST(TxIndexBuilderTest, stops_short_of_the_tip) {
+    FakeChain chain(45);
+    IndexDir dir;
+
+    EXPECT_EQ(buildIndex(chain, dir.indexPath, 12), 13);
+    expectIndexed(chain, dir.indexPath, 12);
+}
+
+TEST(TxIndexBuilderTest, resumes_where_it_stopped) {
+    FakeChain chain(45);
+    IndexDir dir;
+
+    EXPECT_THROW(buildIndex(chain, dir.indexPath, -1, 25), std::runtime_error);
+
+    // only the segment with the failure, 20 to 29, is fetched again
+    std::vector<TxIndexProgress> reports;
+    int calls = buildIndex(chain, dir.indexPath, -1, -1, [&](const TxIndexProgress & progress) { reports.push_back(progress); });
+    EXPECT_EQ(calls, 10);
+    expectIndexed(chain, dir.indexPath, 44);
+    ASSERT_FALSE(reports.empty());
+    EXPECT_EQ(reports.front().blocksDone, 35);
+    EXPECT_EQ(reports.back().transactions, 21u);
+}
+
+TEST(TxIndexBuilderTest, fetches_again_after_a_reorg) {
+    FakeChain chain(45);
+    FakeChain reorganized(45, 1, 15);
+    IndexDir dir;
+
+    EXPECT_THROW(buildIndex(chain, dir.indexPath, -1, 25), std::runtime_error);
+
+    // 0 to 9 is still on the best chain; every later segment ends in a replaced block
+    EXPECT_EQ(buildIndex(reorganized, dir.indexPath), 35);
+    expectIndexed(reorganized, dir.indexPath, 44);
+}
+
+TEST(TxIndexBuilderTest, replaces_the_last_segment_when_the_tip_moves) {
+    FakeChain chain(50);
+    IndexDir dir;
+
+    EXPECT_THROW(buildIndex(chain, dir.indexPath, 44, 5), std::runtime_error);
+
+    // 0 to 9 failed, and 40 to 44 becomes 40 to 49
+    EXPECT_EQ(buildIndex(chain, dir.indexPath, 49), 20);
+    expectIndexed(chain, dir.indexPath, 49);
+}
+
+TEST(TxIndexBuilderTest, rejects_a_block_that_does_not_match_its_hash) {
+    FakeChain chain(5);
+    // change a transaction, so the merkle root no longer matches
+    std::string & block = chain.blocks[3];
+    block[block.size() - 20] = block[block.size() - 20] == '0' ? '1' : '0';
+    IndexDir dir;
+
+    EXPECT_THROW(buildIndex(chain, dir.indexPath), std::runtime_error);
+}
+
+TEST(TxIndexBuilderTest, reads_the_block_files) {
+    FakeChain chain(45);
+    IndexDir dir;
+    writeBlockFile(chain, dir.path);
+    BlockFileReader blockFiles(dir.path, "regtest");
+
+    std::vector<TxIndexProgress> reports;
+    TxIndexBuilder builder(blockFiles, 3, 10);
+    builder.build(dir.indexPath, -1, [&](const TxIndexProgress & progress) { reports.push_back(progress); });
+    expectIndexed(chain, dir.indexPath, 44);
+    ASSERT_FALSE(reports.empty());
+    EXPECT_EQ(reports.back().blocksDone, 45);
+    EXPECT_GT(reports.back().bytes, 45u * BlockHeader::SIZE);
+
+    EXPECT_THROW(builder.build(dir.indexPath, 45), std::runtime_error);
+}
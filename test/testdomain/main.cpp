@@ -3,11 +3,15 @@
 
 // TODO find a better way to include objects from main src directory
 #include "../../src/bitcoinRPCFacade.cpp"
+#include "../../src/hex.cpp"
+#include "../../src/rawTransaction.cpp"
+#include "../../src/sha256.cpp"
 #include "txid.cpp"
 #include "vout.cpp"
 #include "blockHeight.cpp"
 #include "transactionIndex.cpp"
 #include "txref.cpp"
+#include "txrefDecoder.cpp"
 #include "did.cpp"
 
 int main(int argc, char **argv) {
@@ -88,3 +88,13 @@ TEST(DidTest, constructingDid_withGoodTxrefStr_isSuccessful) {
 }
 
 // TODO: redo above test with an extended txref with a non-zero Vout
+
+TEST(DidTest, tryCreate_withBadDidStr_returnsFailure) {
+    MockBitcoinRPCFacade btc;
+
+    Result<Did> did = Did::tryCreate("did:btcr:xz4h-jzcl-foobar", btc);
+
+    ASSERT_FALSE(did.ok());
+    ASSERT_EQ("DID parameter doesn't contain a valid txref. Should be of the form 'did:btcr:<txref>'", did.error());
+    ASSERT_THROW(did.value(), std::runtime_error);
+}
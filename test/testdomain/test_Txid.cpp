@@ -2,6 +2,7 @@
 #include <gmock/gmock.h>
 
 #include "txid.h"
+#include <unordered_set>
 #include "../mock_bitcoinRPCFacade.h"
 
 using ::testing::Return;
@@ -121,8 +122,8 @@ TEST(TxidTest, txid_is_found) {
 
     ASSERT_NO_THROW(txid.reset(createTestTxid(txidStr, blockHeight, transactionIndex)));
 
-    ASSERT_EQ(blockHeight, txid->blockHeight()->value());
-    ASSERT_EQ(transactionIndex, txid->transactionIndex()->value());
+    ASSERT_EQ(blockHeight, txid->blockHeight().value());
+    ASSERT_EQ(transactionIndex, txid->transactionIndex().value());
 }
 
 TEST(TxidTest, txid_with_uppercase_chars_is_found) {
@@ -134,8 +135,8 @@ TEST(TxidTest, txid_with_uppercase_chars_is_found) {
 
     ASSERT_NO_THROW(txid.reset(createTestTxid(txidStr, blockHeight, transactionIndex)));
 
-    ASSERT_EQ(blockHeight, txid->blockHeight()->value());
-    ASSERT_EQ(transactionIndex, txid->transactionIndex()->value());
+    ASSERT_EQ(blockHeight, txid->blockHeight().value());
+    ASSERT_EQ(transactionIndex, txid->transactionIndex().value());
 }
 
 TEST(TxidTest, test_txid_equality) {
@@ -188,3 +189,26 @@ TEST(TxidTest, test_txid_inequality_for_diff_txpos) {
     ASSERT_NE(*txid1, *txid2);
 }
 
+
+TEST(TxidTest, txid_round_trips_through_raw_bytes) {
+    std::string txidStr = "8A76B282FA1E3585D5C4C0DD2774400AA0A075E2CD255F0F5324F2E837F282C5";
+
+    Txid txid(txidStr, BlockHeight(12345), TransactionIndex(1), true);
+
+    ASSERT_EQ("8a76b282fa1e3585d5c4c0dd2774400aa0a075e2cd255f0f5324f2e837f282c5", txid.asString());
+    ASSERT_EQ(0x8a, txid.bytes()[0]);
+    ASSERT_EQ(0xc5, txid.bytes()[31]);
+    ASSERT_THROW(Txid("foo", BlockHeight(12345), TransactionIndex(1), true), std::runtime_error);
+}
+
+TEST(TxidTest, txids_can_key_unordered_containers) {
+    Txid txid1("8a76b282fa1e3585d5c4c0dd2774400aa0a075e2cd255f0f5324f2e837f282c5",
+               BlockHeight(12345), TransactionIndex(1), true);
+    Txid txid2("f4184fc596403b9d638783cf57adfe4c75c605f6356fbc91338530e9831e9e16",
+               BlockHeight(170), TransactionIndex(1), true);
+
+    std::unordered_set<Txid> txids {txid1, txid2, txid1};
+
+    ASSERT_EQ(2u, txids.size());
+    ASSERT_EQ(1u, txids.count(txid2));
+}
@@ -10,6 +10,17 @@
 using ::testing::Return;
 using ::testing::_;
 
+namespace {
+    // a serialized transaction with one input and two outputs
+    const char TWO_OUTPUT_TX_HEX[] =
+            "0200000001e9705d192c911ce3dc5a00a9654bdb7829bacb37805df9876d2c7424e5eab8e6010000006a473044022052"
+            "19fbc57b4806246fb57e9a7b582d4369f1292bd2f2348f8d2272b9bb923ad7022076f01bbdfd697c840865a7a9ce540a"
+            "3927f4819cb6dfaaefdaa4f63c3330582e0121034e85ac999dd799a3e5d0149a240ad79472af9e8040bb77e0eae90866"
+            "1974dff6ffffffff020000000000000000486a4668747470733a2f2f7261772e67697468756275736572636f6e74656e"
+            "742e636f6d2f64616e706170652f73656c662f6d61737465722f64646f2d6578742e302e6a736f6e6c64f00edf030000"
+            "00001976a914143f1c03a4c256a88a2334130a05ff38fc3e8f8488ac00000000";
+}
+
 TEST(TxrefTest, constructingTxref_withEmptyTxref_isUnsuccessful) {
     MockBitcoinRPCFacade btc;
 
@@ -37,14 +48,11 @@ TEST(TxrefTest, constructingTxref_withGoodTxidAndVout_isSuccessful) {
     getrawtransaction_t rawTransaction1;
     rawTransaction1.hex = "3243f6a8885a308d";
     EXPECT_CALL(btc, getrawtransaction(_,0))
-            .WillOnce(Return(rawTransaction1));
+            .WillRepeatedly(Return(rawTransaction1));
 
     // it will also return a blockhash
     getrawtransaction_t rawTransaction2;
     rawTransaction2.blockhash = "3243f6a8885a308d";
-    // and a vector of vouts
-    rawTransaction2.vout.emplace_back();
-    rawTransaction2.vout.emplace_back();
     EXPECT_CALL(btc, getrawtransaction(_,1))
             .WillRepeatedly(Return(rawTransaction2));
 
@@ -63,11 +71,17 @@ TEST(TxrefTest, constructingTxref_withGoodTxidAndVout_isSuccessful) {
     EXPECT_CALL(btc, getblock(_))
             .WillOnce(Return(blockInfo));
 
+    // the vout is checked against the transaction as found in its block, which has two outputs
+    EXPECT_CALL(btc, getblockhash(12345))
+            .WillOnce(Return("3243f6a8885a308d"));
+    EXPECT_CALL(btc, getrawtransactioninblock(txidStr, "3243f6a8885a308d"))
+            .WillOnce(Return(TWO_OUTPUT_TX_HEX));
+
     std::unique_ptr<Txid> txid;
 
     ASSERT_NO_THROW(txid.reset(new Txid(txidStr, btc)));
 
-    // we made two vouts in the mock above, let's pick the second one
+    // the raw transaction in the mock above has two outputs, let's pick the second one
     Vout vout(1);
 
     std::unique_ptr<Txref> txrefp;
@@ -82,14 +96,11 @@ TEST(TxrefTest, constructingTxref_withGoodTxidAndBadVout_isUnsuccessful) {
     getrawtransaction_t rawTransaction1;
     rawTransaction1.hex = "3243f6a8885a308d";
     EXPECT_CALL(btc, getrawtransaction(_,0))
-            .WillOnce(Return(rawTransaction1));
+            .WillRepeatedly(Return(rawTransaction1));
 
     // it will also return a blockhash
     getrawtransaction_t rawTransaction2;
     rawTransaction2.blockhash = "3243f6a8885a308d";
-    // and a vector of vouts
-    rawTransaction2.vout.emplace_back();
-    rawTransaction2.vout.emplace_back();
     EXPECT_CALL(btc, getrawtransaction(_,1))
             .WillRepeatedly(Return(rawTransaction2));
 
@@ -108,12 +119,18 @@ TEST(TxrefTest, constructingTxref_withGoodTxidAndBadVout_isUnsuccessful) {
     EXPECT_CALL(btc, getblock(_))
             .WillOnce(Return(blockInfo));
 
+    // the vout is checked against the transaction as found in its block, which has two outputs
+    EXPECT_CALL(btc, getblockhash(12345))
+            .WillOnce(Return("3243f6a8885a308d"));
+    EXPECT_CALL(btc, getrawtransactioninblock(txidStr, "3243f6a8885a308d"))
+            .WillOnce(Return(TWO_OUTPUT_TX_HEX));
+
     std::unique_ptr<Txid> txid;
 
     ASSERT_NO_THROW(txid.reset(new Txid(txidStr, btc)));
 
-    // we made two vouts in the mock above, attempt to reference too many vouts
-    Vout vout(10);
+    // the raw transaction in the mock above has two outputs, attempt to reference one past them
+    Vout vout(2);
 
     std::unique_ptr<Txref> txrefp;
     ASSERT_THROW(txrefp.reset(new Txref(*txid, vout, btc)), std::runtime_error);
@@ -172,8 +189,8 @@ TEST(TxrefTest, constructingTxref_withGoodTxref_isSuccessful) {
     ASSERT_NO_THROW(txrefp.reset(new Txref(txrefStr, btc)));
 
     // test that the txref's txids and vouts are equal to what we expect
-    ASSERT_EQ(expectedTxid, *txrefp->getTxid());
-    ASSERT_EQ(expectedVout, *txrefp->getVout());
+    ASSERT_EQ(expectedTxid, txrefp->getTxid());
+    ASSERT_EQ(expectedVout, txrefp->getVout());
 
 }
 
@@ -229,8 +246,8 @@ TEST(TxrefTest, constructingTxref_withGoodTxrefExt_isSuccessful) {
     ASSERT_NO_THROW(txrefp.reset(new Txref(txrefStr, btc)));
 
     // test that the txref's txids and vouts are equal to what we expect
-    ASSERT_EQ(expectedTxid, *txrefp->getTxid());
-    ASSERT_EQ(expectedVout, *txrefp->getVout());
+    ASSERT_EQ(expectedTxid, txrefp->getTxid());
+    ASSERT_EQ(expectedVout, txrefp->getVout());
 
 }
 
@@ -286,7 +303,64 @@ TEST(TxrefTest, constructingTxref_withGoodTxrefExtVout1_isSuccessful) {
     ASSERT_NO_THROW(txrefp.reset(new Txref(txrefStr, btc)));
 
     // test that the txref's txids and vouts are equal to what we expect
-    ASSERT_EQ(expectedTxid, *txrefp->getTxid());
-    ASSERT_EQ(expectedVout, *txrefp->getVout());
+    ASSERT_EQ(expectedTxid, txrefp->getTxid());
+    ASSERT_EQ(expectedVout, txrefp->getVout());
+
+}
+
+TEST(TxrefTest, tryCreate_withoutTxindex_looksTransactionsUpInTheirBlocks) {
+    MockBitcoinRPCFacade btc;
+
+    // bitcoind without -txindex can't find transactions by txid alone
+    EXPECT_CALL(btc, getrawtransaction(_,_))
+            .Times(0);
+
+    // txrefEncode(txref::BECH32_HRP_MAIN, txref::MAGIC_BTC_MAIN, 170, 1)
+    std::string txrefStr = "r52q-qqpq-qpty-cfg";
+    std::string txidStr = "f4184fc596403b9d638783cf57adfe4c75c605f6356fbc91338530e9831e9e16";
+    std::string blockHash = "00000000d1145790a8694403d4063f323d499e655c83426834d4ce2f8dd4a2ee";
+
+    EXPECT_CALL(btc, getblockhash(170))
+            .WillRepeatedly(Return(blockHash));
+
+    blockinfo_t blockInfo;
+    blockInfo.height = 170;
+    blockInfo.tx = {"b1fea52486ce0c62bb442b530a3f0132b826c74e473d1f2c220bfa78111c5082", txidStr};
+    EXPECT_CALL(btc, getblock(blockHash))
+            .WillOnce(Return(blockInfo));
+
+    blockchaininfo_t blockChainInfo;
+    blockChainInfo.chain = "main";
+    EXPECT_CALL(btc, getblockchaininfo())
+            .WillOnce(Return(blockChainInfo));
+
+    Result<Txref> decoded = Txref::tryCreate(txrefStr, btc);
+    ASSERT_TRUE(decoded.ok());
+    EXPECT_EQ(decoded.value().getTxid(), Txid(txidStr, BlockHeight(170), TransactionIndex(1), false));
+
+    EXPECT_CALL(btc, getrawtransactioninblock(txidStr, blockHash))
+            .WillRepeatedly(Return(TWO_OUTPUT_TX_HEX));
+
+    EXPECT_TRUE(Txref::tryCreate(decoded.value().getTxid(), Vout(1), btc).ok());
+    EXPECT_FALSE(Txref::tryCreate(decoded.value().getTxid(), Vout(2), btc).ok());
+}
+
+TEST(TxrefTest, tryCreate_withTxrefPastEndOfBlock_returnsFailure) {
+    MockBitcoinRPCFacade btc;
+
+    std::string fakeBlockhash = "3243f6a8885a308d";
+    EXPECT_CALL(btc, getblockhash(_))
+            .WillOnce(Return(fakeBlockhash));
+
+    // the txref refers to transaction position 1, but the block only has one transaction
+    blockinfo_t blockInfo;
+    blockInfo.height = 170;
+    blockInfo.tx = {"f4184fc596403b9d638783cf57adfe4c75c605f6356fbc91338530e9831e9e16"};
+    EXPECT_CALL(btc, getblock(_))
+            .WillOnce(Return(blockInfo));
+
+    Result<Txref> txref = Txref::tryCreate("tx1:r52q-qqpq-qpty-cfg", btc);
 
+    ASSERT_FALSE(txref.ok());
+    ASSERT_EQ("Could not find transaction 1 within block 170.", txref.error());
 }
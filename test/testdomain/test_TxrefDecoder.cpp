@@ -0,0 +1,60 @@
+#include <gtest/gtest.h>
+#include <cstring>
+
+#include "txrefDecoder.h"
+
+
+TEST(TxrefDecoderTest, decodes_did_without_hrp) {
+    DecodedTxref decoded;
+
+    ASSERT_EQ(TxrefDecodeStatus::ok, decodeTxref("did:btcr:8z4h-jz7l-qpqq-xkh8-xa", decoded));
+
+    ASSERT_EQ(1355601, decoded.blockHeight);
+    ASSERT_EQ(1022, decoded.transactionIndex);
+    ASSERT_EQ(1, decoded.txoIndex);
+    ASSERT_STREQ("test", decoded.chain);
+    ASSERT_TRUE(decoded.extended);
+}
+
+TEST(TxrefDecoderTest, decodes_txref_with_hrp) {
+    DecodedTxref decoded;
+
+    ASSERT_EQ(TxrefDecodeStatus::ok, decodeTxref("txtest1:xz4h-jz7l-qfhw-kd7", decoded));
+    ASSERT_EQ(1355601, decoded.blockHeight);
+    ASSERT_EQ(0, decoded.txoIndex);
+    ASSERT_FALSE(decoded.extended);
+
+    ASSERT_EQ(TxrefDecodeStatus::ok, decodeTxref("TX1:R52Q-QQPQ-QPTY-CFG", decoded));
+    ASSERT_EQ(170, decoded.blockHeight);
+    ASSERT_EQ(1, decoded.transactionIndex);
+    ASSERT_STREQ("main", decoded.chain);
+}
+
+TEST(TxrefDecoderTest, skips_non_breaking_hyphens) {
+    DecodedTxref decoded;
+
+    ASSERT_EQ(TxrefDecodeStatus::ok, decodeTxref("y29u‑mqjx‑ppqq‑sfp2‑tt", decoded));
+    ASSERT_EQ(456789, decoded.blockHeight);
+    ASSERT_EQ(1234, decoded.transactionIndex);
+    ASSERT_EQ(1, decoded.txoIndex);
+}
+
+TEST(TxrefDecoderTest, decodes_part_of_a_buffer) {
+    const char buffer[] = "did:btcr:8x4h-jz54-qpqq-uf26-gj,did:btcr:8z4h-jz7l-qpqq-xkh8-xa";
+    DecodedTxref decoded;
+
+    ASSERT_EQ(TxrefDecodeStatus::ok, decodeTxref(buffer, std::strchr(buffer, ',') - buffer, decoded));
+    ASSERT_EQ(1355603, decoded.blockHeight);
+    ASSERT_EQ(692, decoded.transactionIndex);
+}
+
+TEST(TxrefDecoderTest, rejects_bad_txrefs) {
+    DecodedTxref decoded;
+
+    ASSERT_EQ(TxrefDecodeStatus::badLength, decodeTxref("", decoded));
+    ASSERT_EQ(TxrefDecodeStatus::badLength, decodeTxref("xg4h-jzgq-pqpq-q9r6sd9", decoded));
+    ASSERT_EQ(TxrefDecodeStatus::badChecksum, decodeTxref("8z4h-jz7l-qpqq-xkh8-xq", decoded));
+    ASSERT_EQ(TxrefDecodeStatus::badCharacter, decodeTxref("did:btcr:xz4h-jzcl-foobar", decoded));
+    ASSERT_EQ(TxrefDecodeStatus::badHrp, decodeTxref("tx1:8z4h-jz7l-qpqq-xkh8-xa", decoded));
+    ASSERT_EQ(TxrefDecodeStatus::badHrp, decodeTxref("bc1:8z4h-jz7l-qpqq-xkh8-xa", decoded));
+}